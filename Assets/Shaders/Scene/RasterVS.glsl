@@ -1,9 +1,17 @@
 #include "Scene/Raster.glsl"
 
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inBitangent;
 layout(location = 3) in vec2 inUV;
+#else
+// The attribute formats expand the packed values, the octahedral decode and the mesh bounds are left.
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inBitangent;
+layout(location = 3) in vec2 inUV;
+#endif
 layout(location = 4) in int inMeshInstanceID;
 layout(location = 5) in vec3 inPrevPos;
 
@@ -11,8 +19,25 @@ layout(location = 0) out CT_VERTEX_OUT vOut;
 
 void main()
 {
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    vec3 position = inPos;
+    vec3 normal = inNormal;
+    vec3 bitangent = inBitangent;
+    vec2 uv = inUV;
+#else
+    MeshDesc mesh = GetMeshDesc(inMeshInstanceID);
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_QUANTIZED
+    vec3 position = mesh.positionMin + inPos * mesh.positionScale;
+#else
+    vec3 position = inPos;
+#endif
+    vec3 normal = DecodeOctahedral(inNormal);
+    vec3 bitangent = DecodeBitangent(inBitangent);
+    vec2 uv = mesh.uvMin + inUV * mesh.uvScale;
+#endif
+
     mat4 worldMat = GetWorldMatrix(inMeshInstanceID);
-    vec4 posW = worldMat * vec4(inPos, 1.0);
+    vec4 posW = worldMat * vec4(position, 1.0);
     vOut.posW = posW.xyz;
 
     gl_Position = GetViewProjection(camera) * posW;
@@ -21,9 +46,9 @@ void main()
 
     vOut.meshInstanceID = inMeshInstanceID;
     vOut.materialID = GetMaterialID(inMeshInstanceID);
-    vOut.uv = inUV;
+    vOut.uv = uv;
 
     mat3 normalMatrix = GetInverseTransposeWorldMatrix(inMeshInstanceID);
-    vOut.normalW = normalMatrix * inNormal;
-    vOut.bitangentW = mat3(worldMat) * inBitangent;
+    vOut.normalW = normalMatrix * normal;
+    vOut.bitangentW = mat3(worldMat) * bitangent;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Scene/.Package.glsl"
 #include "Scene/Camera.glsl"
+#include "Scene/Vertex.glsl"
 
 #ifndef MATERIAL_COUNT
 #error MATERIAL_COUNT not defined!
@@ -30,7 +31,7 @@ layout(binding = 3) buffer InverseTransposeWorldMatrixBuffer
 
 layout(binding = 4) buffer StaticVertexBuffer
 {
-    StaticVertexData vertices[];
+    PackedVertexData vertices[];
 };
 
 layout(binding = 5) buffer IndexBuffer
@@ -115,9 +116,9 @@ LightData GetLight(int lightID)
     return lights[lightID];
 }
 
-StaticVertexData GetVertex(int index)
+StaticVertexData GetVertex(int meshInstanceID, int index)
 {
-    return vertices[index];
+    return UnpackVertex(vertices[index], GetMeshDesc(meshInstanceID));
 }
 
 ivec3 GetIndices(int meshInstanceID, int triangleIndex)
@@ -134,9 +135,10 @@ ivec3 GetIndices(int meshInstanceID, int triangleIndex)
 vec3 GetFaceNormalW(int meshInstanceID, int triangleIndex)
 {
     ivec3 vtxIndices = GetIndices(meshInstanceID, triangleIndex);
-    vec3 p0 = vertices[vtxIndices[0]].position;
-    vec3 p1 = vertices[vtxIndices[1]].position;
-    vec3 p2 = vertices[vtxIndices[2]].position;
+    MeshDesc mesh = GetMeshDesc(meshInstanceID);
+    vec3 p0 = UnpackPosition(vertices[vtxIndices[0]], mesh.positionMin, mesh.positionScale);
+    vec3 p1 = UnpackPosition(vertices[vtxIndices[1]], mesh.positionMin, mesh.positionScale);
+    vec3 p2 = UnpackPosition(vertices[vtxIndices[2]], mesh.positionMin, mesh.positionScale);
     vec3 N = cross(p1 - p0, p2 - p0);
     mat3 worldInvTransposeMat = GetInverseTransposeWorldMatrix(meshInstanceID);
     return normalize(worldInvTransposeMat * N);
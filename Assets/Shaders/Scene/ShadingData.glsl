@@ -28,7 +28,7 @@ vec3 RG2Normal(vec2 rg)
     vec3 n;
     n.xy = rg * 2.0 - 1.0;
     // saturate because error from BC5 can break the sqrt
-    n.z = saturate(dot(rg, rg));
+    n.z = saturate(dot(n.xy, n.xy));
     n.z = sqrt(1.0 - n.z);
     return normalize(n);
 }
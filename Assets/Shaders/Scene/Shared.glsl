@@ -5,6 +5,11 @@
 #define CT_MESH_INSTANCE_NONE 0
 #define CT_MESH_INSTANCE_FLIPPED 1
 
+// Vertex formats, CT_VERTEX_FORMAT selects the one of the static and dynamic vertex buffers
+#define CT_VERTEX_FORMAT_FULL 0
+#define CT_VERTEX_FORMAT_COMPACT 1 // Octahedral normal and bitangent, unorm16 uv in the mesh bounds, 8 bit bone indices and weights.
+#define CT_VERTEX_FORMAT_QUANTIZED 2 // Compact with unorm16 positions in the mesh bounds, only without skinning.
+
 // Light defs
 #define CT_LIGHT_TYPE_POINT 0
 #define CT_LIGHT_TYPE_DIRECTIONAL 1
@@ -97,7 +102,12 @@ struct MeshDesc
     int32 indexOffset;
     int32 vertexCount;
     int32 indexCount;
+    Vector3 positionMin; // Compact vertices store min + value * scale.
     int32 materialID;
+    Vector3 positionScale;
+    float _pad0;
+    Vector2 uvMin;
+    Vector2 uvScale;
 };
 
 struct StaticVertexData
@@ -116,6 +126,32 @@ struct DynamicVertexData
     int32 globalMatrixID;
 };
 
+// Scalar members only, so the C++ and std430 layouts agree.
+struct CompactVertexData
+{
+    float position[3];
+    uint32 normal;    // Octahedral, snorm16 x and y.
+    uint32 bitangent; // Octahedral, snorm16 x and y, 0 when there is none.
+    uint32 uv;        // unorm16 x and y in the uv bounds of the mesh.
+};
+
+struct QuantizedVertexData
+{
+    uint32 position[2]; // unorm16 x, y and z in the bounds of the mesh.
+    uint32 normal;
+    uint32 bitangent;
+    uint32 uv;
+};
+
+struct CompactDynamicVertexData
+{
+    uint32 boneIDs;     // 8 bits each, into the bone palette of the mesh.
+    uint32 boneWeights; // unorm8 each.
+    int32 paletteOffset;
+    int32 staticIndex;
+    int32 globalMatrixID;
+};
+
 struct PrevVertexData
 {
     Vector3 position;
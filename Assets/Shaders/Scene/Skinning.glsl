@@ -1,18 +1,22 @@
-#include "Scene/.Package.glsl"
+#include "Scene/Vertex.glsl"
+
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_QUANTIZED
+#error Skinned positions leave the mesh bounds, quantized positions can not be skinned.
+#endif
 
 layout(binding = 0) buffer StaticVertexBuffer
 {
-    StaticVertexData staticVertices[];
+    PackedVertexData staticVertices[];
 };
 
 layout(binding = 1) buffer DynamicVertexBuffer
 {
-    DynamicVertexData dynamicVertices[];
+    PackedDynamicVertexData dynamicVertices[];
 };
 
 layout(binding = 2) buffer SkinnedVertexBuffer
 {
-    StaticVertexData skinnedVertices[];
+    PackedVertexData skinnedVertices[];
 };
 
 layout(binding = 3) buffer PrevSkinnedVertexBuffer
@@ -40,6 +44,14 @@ layout(binding = 7) buffer InverseTransposeWorldMatrixBuffer
     mat4 inverseTransposeWorldMatrices[];
 };
 
+#if CT_VERTEX_FORMAT != CT_VERTEX_FORMAT_FULL
+// Bone matrix IDs of every skinned mesh, vertices index the range of their mesh.
+layout(binding = 8) buffer BonePaletteBuffer
+{
+    int bonePalette[];
+};
+#endif
+
 mat4 GetBoneMatrix(int matrixID)
 {
     return boneMatrices[matrixID];
@@ -60,28 +72,50 @@ mat4 GetInverseWorldMatrix(int matrixID)
     return transpose(inverseTransposeWorldMatrices[matrixID]);
 }
 
+ivec4 GetBoneIDs(int vertexID)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return dynamicVertices[vertexID].boneID;
+#else
+    PackedDynamicVertexData d = dynamicVertices[vertexID];
+    ivec4 local = ivec4(d.boneIDs & 0xFFu, (d.boneIDs >> 8) & 0xFFu, (d.boneIDs >> 16) & 0xFFu, d.boneIDs >> 24);
+    return ivec4(bonePalette[d.paletteOffset + local.x], bonePalette[d.paletteOffset + local.y], bonePalette[d.paletteOffset + local.z], bonePalette[d.paletteOffset + local.w]);
+#endif
+}
+
+vec4 GetBoneWeights(int vertexID)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return dynamicVertices[vertexID].boneWeight;
+#else
+    return unpackUnorm4x8(dynamicVertices[vertexID].boneWeights);
+#endif
+}
+
 mat4 GetBlendedMatrix(int vertexID)
 {
-    DynamicVertexData d = dynamicVertices[vertexID];
+    ivec4 boneID = GetBoneIDs(vertexID);
+    vec4 boneWeight = GetBoneWeights(vertexID);
 
-    mat4 mat = GetBoneMatrix(d.boneID.x) * d.boneWeight.x;
-    mat += GetBoneMatrix(d.boneID.y) * d.boneWeight.y;
-    mat += GetBoneMatrix(d.boneID.z) * d.boneWeight.z;
-    mat += GetBoneMatrix(d.boneID.w) * d.boneWeight.w;
+    mat4 mat = GetBoneMatrix(boneID.x) * boneWeight.x;
+    mat += GetBoneMatrix(boneID.y) * boneWeight.y;
+    mat += GetBoneMatrix(boneID.z) * boneWeight.z;
+    mat += GetBoneMatrix(boneID.w) * boneWeight.w;
     
-    return GetInverseWorldMatrix(d.globalMatrixID) * mat;
+    return GetInverseWorldMatrix(dynamicVertices[vertexID].globalMatrixID) * mat;
 }
 
 mat4 GetInverseTransposeBlendedMatrix(int vertexID)
 {
-    DynamicVertexData d = dynamicVertices[vertexID];
+    ivec4 boneID = GetBoneIDs(vertexID);
+    vec4 boneWeight = GetBoneWeights(vertexID);
 
-    mat4 mat = GetInverseTransposeBoneMatrix(d.boneID.x) * d.boneWeight.x;
-    mat += GetInverseTransposeBoneMatrix(d.boneID.y) * d.boneWeight.y;
-    mat += GetInverseTransposeBoneMatrix(d.boneID.z) * d.boneWeight.z;
-    mat += GetInverseTransposeBoneMatrix(d.boneID.w) * d.boneWeight.w;
+    mat4 mat = GetInverseTransposeBoneMatrix(boneID.x) * boneWeight.x;
+    mat += GetInverseTransposeBoneMatrix(boneID.y) * boneWeight.y;
+    mat += GetInverseTransposeBoneMatrix(boneID.z) * boneWeight.z;
+    mat += GetInverseTransposeBoneMatrix(boneID.w) * boneWeight.w;
 
-    return GetTransposeWorldMatrix(d.globalMatrixID) * mat;
+    return GetTransposeWorldMatrix(dynamicVertices[vertexID].globalMatrixID) * mat;
 }
 
 int GetStaticVertexID(int vertexID)
@@ -89,14 +123,14 @@ int GetStaticVertexID(int vertexID)
     return dynamicVertices[vertexID].staticIndex;
 }
 
-StaticVertexData GetStaticVertexData(int vertexID)
+PackedVertexData GetStaticVertexData(int vertexID)
 {
     return staticVertices[GetStaticVertexID(vertexID)];
 }
 
 vec3 GetCurrentPosition(int vertexID)
 {
-    return skinnedVertices[GetStaticVertexID(vertexID)].position;
+    return UnpackPosition(skinnedVertices[GetStaticVertexID(vertexID)], vec3(0.0), vec3(1.0));
 }
 
 #type compute
@@ -113,7 +147,12 @@ void main()
     PrevVertexData prev;
     prev.position = GetCurrentPosition(vertexID);
 
-    StaticVertexData s = GetStaticVertexData(vertexID);
+    // The uv is not skinned, PackVertex keeps the one of source.
+    PackedVertexData source = GetStaticVertexData(vertexID);
+    StaticVertexData s;
+    s.position = UnpackPosition(source, vec3(0.0), vec3(1.0));
+    s.normal = UnpackNormal(source);
+    s.bitangent = UnpackBitangent(source);
     mat4 boneMat = GetBlendedMatrix(vertexID);
     mat4 invTransposeMat = GetInverseTransposeBlendedMatrix(vertexID);
 
@@ -122,6 +161,6 @@ void main()
     s.normal = mat3(transpose(invTransposeMat)) * s.normal;
 
     // store
-    skinnedVertices[GetStaticVertexID(vertexID)] = s;
+    skinnedVertices[GetStaticVertexID(vertexID)] = PackVertex(s, source);
     prevSkinnedVertices[GetStaticVertexID(vertexID)] = prev;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef __CT_SCENE_VERTEX__
+#define __CT_SCENE_VERTEX__
+
+#include "Scene/.Package.glsl"
+
+#ifndef CT_VERTEX_FORMAT
+#define CT_VERTEX_FORMAT CT_VERTEX_FORMAT_FULL
+#endif
+
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+#define PackedVertexData StaticVertexData
+#define PackedDynamicVertexData DynamicVertexData
+#elif CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_COMPACT
+#define PackedVertexData CompactVertexData
+#define PackedDynamicVertexData CompactDynamicVertexData
+#else
+#define PackedVertexData QuantizedVertexData
+#define PackedDynamicVertexData CompactDynamicVertexData
+#endif
+
+// Unit vector to the octahedron unfolded onto [-1, 1]^2.
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return e;
+}
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// A missing bitangent is stored as 0 and stays zero, see SceneBuilder::PackVertices.
+vec3 DecodeBitangent(vec2 e)
+{
+    return e == vec2(0.0) ? vec3(0.0) : DecodeOctahedral(e);
+}
+
+uint EncodeBitangent(vec3 b)
+{
+    if (dot(b, b) == 0.0)
+        return 0u;
+    uint packed = packSnorm2x16(EncodeOctahedral(normalize(b)));
+    return packed == 0u ? 1u : packed;
+}
+
+// Mesh space position, quantized ones are relative to the bounds of their mesh.
+vec3 UnpackPosition(PackedVertexData v, vec3 positionMin, vec3 positionScale)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return v.position;
+#elif CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_COMPACT
+    return vec3(v.position[0], v.position[1], v.position[2]);
+#else
+    vec3 p = vec3(unpackUnorm2x16(v.position[0]), unpackUnorm2x16(v.position[1]).x);
+    return positionMin + p * positionScale;
+#endif
+}
+
+vec3 UnpackNormal(PackedVertexData v)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return v.normal;
+#else
+    return DecodeOctahedral(unpackSnorm2x16(v.normal));
+#endif
+}
+
+vec3 UnpackBitangent(PackedVertexData v)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return v.bitangent;
+#else
+    return DecodeBitangent(unpackSnorm2x16(v.bitangent));
+#endif
+}
+
+StaticVertexData UnpackVertex(PackedVertexData v, MeshDesc mesh)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    return v;
+#else
+    StaticVertexData s;
+    s.position = UnpackPosition(v, mesh.positionMin, mesh.positionScale);
+    s.normal = UnpackNormal(v);
+    s.bitangent = UnpackBitangent(v);
+    s.uv = mesh.uvMin + unpackUnorm2x16(v.uv) * mesh.uvScale;
+    return s;
+#endif
+}
+
+#if CT_VERTEX_FORMAT != CT_VERTEX_FORMAT_QUANTIZED
+// Writes the transformed position, normal and bitangent of s over source, the uv is kept as it is.
+PackedVertexData PackVertex(StaticVertexData s, PackedVertexData source)
+{
+#if CT_VERTEX_FORMAT == CT_VERTEX_FORMAT_FULL
+    s.uv = source.uv;
+    return s;
+#else
+    PackedVertexData v = source;
+    v.position[0] = s.position.x;
+    v.position[1] = s.position.y;
+    v.position[2] = s.position.z;
+    v.normal = packSnorm2x16(EncodeOctahedral(normalize(s.normal)));
+    v.bitangent = EncodeBitangent(s.bitangent);
+    return v;
+#endif
+}
+#endif
+
+#endif
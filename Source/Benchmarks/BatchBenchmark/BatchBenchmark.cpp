@@ -0,0 +1,114 @@
+#include "Benchmarks/Benchmark.h"
+#include "Math/BVH.h"
+#include "Math/Matrix3.h"
+#include "Math/Quat.h"
+#include <random>
+
+namespace
+{
+constexpr int32 ITERATIONS = 20;
+
+void RunCount(int32 count)
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    Array<Matrix4> matrices;
+    Array<AABox> boxes;
+    Array<Vector3> points;
+    Batch::Matrix4SoA matricesSoA;
+    Batch::AABoxSoA boxesSoA;
+    Batch::Vector3SoA pointsSoA;
+    matricesSoA.SetCount(count);
+    boxesSoA.SetCount(count);
+    pointsSoA.SetCount(count);
+    for (int32 i = 0; i < count; ++i)
+    {
+        Quat rotation = Quat(dist(random), dist(random), dist(random), dist(random)).Normalize();
+        Vector3 translation(dist(random) * 100.0f, dist(random) * 100.0f, dist(random) * 100.0f);
+        // Some instances are mirrored so the determinant test has both outcomes.
+        Vector3 scale(dist(random) < -0.8f ? -1.0f : 1.0f, 1.0f, 1.0f);
+        Vector3 extent(1.0f + dist(random) * 0.5f, 1.0f + dist(random) * 0.5f, 1.0f + dist(random) * 0.5f);
+
+        matrices.Add(Matrix4::TRS(translation, rotation, scale));
+        boxes.Add(AABox(-extent, extent));
+        points.Add(translation);
+        matricesSoA.Set(i, matrices[i]);
+        boxesSoA.Set(i, boxes[i]);
+        pointsSoA.Set(i, points[i]);
+    }
+
+    CT_LOG(Info, CT_TEXT("{0} instances:"), count);
+
+    Array<AABox> outBoxes;
+    outBoxes.SetCount(count);
+    Batch::AABoxSoA outBoxesSoA;
+    Benchmark::Run(CT_TEXT("AABox transform and merge (per instance)"), ITERATIONS, count, [&]() {
+        AABox merged = AABox::Transform(boxes[0], matrices[0]);
+        for (int32 i = 0; i < count; ++i)
+        {
+            outBoxes[i] = AABox::Transform(boxes[i], matrices[i]);
+            merged.Merge(outBoxes[i]);
+        }
+        Benchmark::DoNotOptimize(merged);
+    });
+    Benchmark::Run(CT_TEXT("AABox transform and merge (batch)"), ITERATIONS, count, [&]() {
+        Batch::TransformAABoxes(matricesSoA, boxesSoA, outBoxesSoA);
+        AABox merged = Batch::MergeAABoxes(outBoxesSoA);
+        Benchmark::DoNotOptimize(merged);
+    });
+
+    Array<bool> flipped;
+    flipped.SetCount(count);
+    Benchmark::Run(CT_TEXT("Determinant sign (per instance)"), ITERATIONS, count, [&]() {
+        for (int32 i = 0; i < count; ++i)
+            flipped[i] = matrices[i].ToMatrix3().Determinant() < 0.0f;
+        Benchmark::DoNotOptimize(flipped[0]);
+    });
+    Benchmark::Run(CT_TEXT("Determinant sign (batch)"), ITERATIONS, count, [&]() {
+        Batch::NegativeDeterminants(matricesSoA, flipped);
+        Benchmark::DoNotOptimize(flipped[0]);
+    });
+
+    Array<Vector3> outPoints;
+    outPoints.SetCount(count);
+    Batch::Vector3SoA outPointsSoA;
+    Benchmark::Run(CT_TEXT("Transform point (per instance)"), ITERATIONS, count, [&]() {
+        for (int32 i = 0; i < count; ++i)
+            outPoints[i] = matrices[i].TransformPoint(points[i]);
+        Benchmark::DoNotOptimize(outPoints[0]);
+    });
+    Benchmark::Run(CT_TEXT("Transform point (batch)"), ITERATIONS, count, [&]() {
+        Batch::TransformPoints(matricesSoA, pointsSoA, outPointsSoA);
+        Benchmark::DoNotOptimize(outPointsSoA.x[0]);
+    });
+
+    // A camera inside the instance cloud that sees a small part of it.
+    Frustum frustum(Matrix4::Projection(60.0f, 1.5f, 0.1f, 40.0f) * Matrix4::LookAt(Vector3::ZERO, Vector3(1.0f, 0.0f, -1.0f), Vector3::Y));
+    Array<bool> visible;
+    visible.SetCount(count);
+    Benchmark::Run(CT_TEXT("Frustum culling (batch)"), ITERATIONS, count, [&]() {
+        Batch::CullAABoxes(frustum, outBoxesSoA, 0, count, visible);
+        Benchmark::DoNotOptimize(visible[0]);
+    });
+
+    BVH bvh;
+    Benchmark::Run(CT_TEXT("BVH build"), 1, count, [&]() {
+        bvh.Build(outBoxesSoA);
+    });
+    Array<int32> result;
+    Benchmark::Run(CT_TEXT("Frustum culling (BVH)"), ITERATIONS, count, [&]() {
+        result.Clear();
+        bvh.QueryFrustum(frustum, result);
+        Benchmark::DoNotOptimize(result.GetData());
+    });
+    CT_LOG(Info, CT_TEXT("{0} of {1} instances visible."), result.Count(), count);
+}
+}
+
+int main(int argc, char **argv)
+{
+    RunCount(100000);
+    RunCount(1000000);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Core/Logger.h"
+#include "Core/Time.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Benchmark
+{
+
+// Keeps the compiler from discarding a result that is never read.
+template <typename T>
+CT_INLINE void DoNotOptimize(const T &value)
+{
+#if defined(_MSC_VER)
+    const volatile char *ptr = reinterpret_cast<const volatile char *>(&value);
+    (void)*ptr;
+    _ReadWriteBarrier();
+#else
+    asm volatile(""
+                 :
+                 : "r,m"(value)
+                 : "memory");
+#endif
+}
+
+// Runs func once to warm up, then iterations times, and logs the average cost of one of the items each run processes.
+template <typename Func>
+double Run(const String &name, int32 iterations, int64 itemsPerIteration, Func &&func)
+{
+    func();
+
+    int64 start = Time::NanoTime();
+    for (int32 i = 0; i < iterations; ++i)
+        func();
+    int64 elapsed = Time::NanoTime() - start;
+
+    double nsPerItem = static_cast<double>(elapsed) / (static_cast<double>(iterations) * itemsPerIteration);
+    CT_LOG(Info, CT_TEXT("{0}: {1} ns per item, {2} ms per run."), name, nsPerItem, elapsed / 1e6 / iterations);
+    return nsPerItem;
+}
+
+}
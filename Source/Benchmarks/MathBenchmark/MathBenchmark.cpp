@@ -0,0 +1,111 @@
+#include "Benchmarks/Benchmark.h"
+#include "Math/Matrix4.h"
+#include "Math/Quat.h"
+#include <random>
+
+namespace
+{
+constexpr int32 COUNT = 4096;
+constexpr int32 ITERATIONS = 200;
+
+const CharType *GetBackendName()
+{
+#if CT_MATH_SIMD >= CT_MATH_SIMD_AVX2
+    return CT_TEXT("AVX2");
+#elif CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+    return CT_TEXT("SSE4");
+#else
+    return CT_TEXT("Scalar");
+#endif
+}
+
+// The plain nested loop the math library used before it had a SIMD backend, kept as baseline.
+Matrix4 MultiplyReference(const Matrix4 &lhs, const Matrix4 &rhs)
+{
+    Matrix4 ret;
+    for (int32 col = 0; col < 4; ++col)
+    {
+        for (int32 row = 0; row < 4; ++row)
+        {
+            ret(row, col) = lhs(row, 0) * rhs(0, col) + lhs(row, 1) * rhs(1, col) + lhs(row, 2) * rhs(2, col) + lhs(row, 3) * rhs(3, col);
+        }
+    }
+    return ret;
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    Array<Matrix4> matrices;
+    Array<Quat> quats;
+    Array<Vector3> points;
+    for (int32 i = 0; i < COUNT; ++i)
+    {
+        Quat rotation = Quat(dist(random), dist(random), dist(random), dist(random)).Normalize();
+        Vector3 translation(dist(random) * 10.0f, dist(random) * 10.0f, dist(random) * 10.0f);
+        Vector3 scale(1.0f + dist(random) * 0.5f, 1.0f + dist(random) * 0.5f, 1.0f + dist(random) * 0.5f);
+        matrices.Add(Matrix4::TRS(translation, rotation, scale));
+        quats.Add(rotation);
+        points.Add(translation);
+    }
+
+    Array<Matrix4> outMatrices;
+    Array<Quat> outQuats;
+    Array<Vector3> outPoints;
+    outMatrices.SetCount(COUNT);
+    outQuats.SetCount(COUNT);
+    outPoints.SetCount(COUNT);
+
+    CT_LOG(Info, CT_TEXT("Math backend: {0}, {1} items per run."), GetBackendName(), COUNT);
+
+    Benchmark::Run(CT_TEXT("Matrix4 multiply (reference loop)"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = MultiplyReference(matrices[i], matrices[COUNT - 1 - i]);
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+    Benchmark::Run(CT_TEXT("Matrix4 multiply"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = matrices[i] * matrices[COUNT - 1 - i];
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+    Benchmark::Run(CT_TEXT("Matrix4 transpose"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = matrices[i].Transpose();
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+    Benchmark::Run(CT_TEXT("Matrix4 inverse"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = matrices[i].Inverse();
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+    Benchmark::Run(CT_TEXT("Matrix4 inverse transpose"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = matrices[i].Inverse().Transpose();
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+    Benchmark::Run(CT_TEXT("Matrix4 transform point"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outPoints[i] = matrices[i].TransformPoint(points[i]);
+        Benchmark::DoNotOptimize(outPoints[0]);
+    });
+    Benchmark::Run(CT_TEXT("Quat multiply"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outQuats[i] = quats[i] * quats[COUNT - 1 - i];
+        Benchmark::DoNotOptimize(outQuats[0]);
+    });
+    Benchmark::Run(CT_TEXT("Quat slerp"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outQuats[i] = Quat::Slerp(quats[i], quats[COUNT - 1 - i], 0.3f);
+        Benchmark::DoNotOptimize(outQuats[0]);
+    });
+    Benchmark::Run(CT_TEXT("Quat to matrix"), ITERATIONS, COUNT, [&]() {
+        for (int32 i = 0; i < COUNT; ++i)
+            outMatrices[i] = quats[i].ToMatrix4();
+        Benchmark::DoNotOptimize(outMatrices[0]);
+    });
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "Benchmarks/Benchmark.h"
+#include "Render/Pixmap.h"
+#include <random>
+
+namespace
+{
+constexpr int32 SIZE = 1024;
+constexpr int32 ITERATIONS = 20;
+
+const CharType *GetFormatName(ResourceFormat format)
+{
+    switch (format)
+    {
+    case ResourceFormat::RGBA8Unorm:
+        return CT_TEXT("RGBA8");
+    case ResourceFormat::RGBA8UnormSrgb:
+        return CT_TEXT("RGBA8 srgb");
+    case ResourceFormat::RGBA16Float:
+        return CT_TEXT("RGBA16F");
+    default:
+        return CT_TEXT("RGBA32F");
+    }
+}
+
+void RunFormat(ResourceFormat format)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    Array<Color> colors;
+    colors.SetCount(SIZE * SIZE);
+    for (auto &color : colors)
+        color = Color(dist(random), dist(random), dist(random), dist(random));
+
+    auto pixmap = Pixmap::Create(SIZE, SIZE, format);
+    pixmap->SetPixels(colors);
+    // Quarter sized sprite with partly transparent pixels.
+    auto sprite = Pixmap::Create(SIZE / 2, SIZE / 2, format);
+    sprite->SetPixels(colors.GetData(), SIZE * SIZE / 4);
+
+    CT_LOG(Info, CT_TEXT("{0}, {1}x{1}:"), GetFormatName(format), SIZE);
+    int64 pixels = static_cast<int64>(SIZE) * SIZE;
+    int64 spritePixels = pixels / 4;
+
+    Benchmark::Run(CT_TEXT("Write pixels"), ITERATIONS, pixels, [&]() {
+        pixmap->SetPixels(colors);
+        Benchmark::DoNotOptimize(pixmap->GetData());
+    });
+    Benchmark::Run(CT_TEXT("Read pixels"), ITERATIONS, pixels, [&]() {
+        auto result = pixmap->GetPixels();
+        Benchmark::DoNotOptimize(result.GetData());
+    });
+    Benchmark::Run(CT_TEXT("Fill"), ITERATIONS, pixels, [&]() {
+        pixmap->Fill(Color(0.2f, 0.4f, 0.6f, 1.0f));
+        Benchmark::DoNotOptimize(pixmap->GetData());
+    });
+    Benchmark::Run(CT_TEXT("Blit copy"), ITERATIONS, spritePixels, [&]() {
+        pixmap->Blit(*sprite, SIZE / 4, SIZE / 4);
+        Benchmark::DoNotOptimize(pixmap->GetData());
+    });
+    Benchmark::Run(CT_TEXT("Blit blend"), ITERATIONS, spritePixels, [&]() {
+        pixmap->Blit(*sprite, SIZE / 4, SIZE / 4, true);
+        Benchmark::DoNotOptimize(pixmap->GetData());
+    });
+
+    // Costs are per destination pixel.
+    Benchmark::Run(CT_TEXT("Resize half (box)"), ITERATIONS, pixels / 4, [&]() {
+        auto result = pixmap->Resize(SIZE / 2, SIZE / 2, PixmapFilter::Box);
+        Benchmark::DoNotOptimize(result->GetData());
+    });
+    Benchmark::Run(CT_TEXT("Resize half (lanczos)"), ITERATIONS, pixels / 4, [&]() {
+        auto result = pixmap->Resize(SIZE / 2, SIZE / 2, PixmapFilter::Lanczos);
+        Benchmark::DoNotOptimize(result->GetData());
+    });
+    Benchmark::Run(CT_TEXT("Resize 1.5x (lanczos)"), ITERATIONS / 4, pixels * 9 / 4, [&]() {
+        auto result = pixmap->Resize(SIZE * 3 / 2, SIZE * 3 / 2, PixmapFilter::Lanczos);
+        Benchmark::DoNotOptimize(result->GetData());
+    });
+}
+}
+
+int main(int argc, char **argv)
+{
+    RunFormat(ResourceFormat::RGBA8Unorm);
+    RunFormat(ResourceFormat::RGBA8UnormSrgb);
+    RunFormat(ResourceFormat::RGBA16Float);
+    RunFormat(ResourceFormat::RGBA32Float);
+    return 0;
+}
@@ -71,9 +71,10 @@ CT_INLINE SizeType QuickSortPrivate(T *ptr, SizeType first, SizeType last, Compa
     T *bound = ptr + first;
     while (lower <= upper)
     {
-        while (compare(*lower, *bound))
+        // Bounded, the pivot may be the largest or smallest element.
+        while (lower <= upper && compare(*lower, *bound))
             ++lower;
-        while (compare(*bound, *upper))
+        while (upper > bound && compare(*bound, *upper))
             --upper;
         if (lower < upper)
             std::swap(*lower++, *upper--);
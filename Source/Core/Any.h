@@ -3,6 +3,8 @@
 #include "Core/.Package.h"
 #include "Core/Exception.h"
 #include "Core/Memory.h"
+#include <cstring>
+#include <new>
 
 namespace AnyInternal
 {
@@ -34,6 +36,12 @@ public:
         return Memory::New<DynamicData>(value);
     }
 };
+
+// Small trivially copyable values live inside Any itself, no allocation at all.
+constexpr SizeType INLINE_SIZE = 2 * sizeof(void *);
+
+template <typename T>
+constexpr bool IsInline = std::is_trivially_copyable_v<T> && sizeof(T) <= INLINE_SIZE && alignof(T) <= alignof(void *);
 } // namespace AnyInternal
 
 class Any
@@ -42,15 +50,20 @@ public:
     Any() = default;
 
     Any(const Any &other)
+        : inlined(other.inlined)
     {
-        if (other.data)
+        if (inlined)
+            std::memcpy(storage, other.storage, sizeof(storage));
+        else if (other.data)
             data = other.data->Clone();
     }
 
     Any(Any &&other)
-        : data(other.data)
+        : inlined(other.inlined)
     {
+        std::memcpy(storage, other.storage, sizeof(storage));
         other.data = nullptr;
+        other.inlined = false;
     }
 
     Any &operator=(const Any &other)
@@ -75,21 +88,21 @@ public:
 
     template <typename T>
     Any(T *value)
-        : data(Memory::New<AnyInternal::DynamicData<std::decay_t<T *>>>(value))
     {
+        Emplace<std::decay_t<T *>>(value);
     }
 
     template <typename T>
     requires(!std::is_pointer_v<T>)
         Any(const T &value)
-        : data(Memory::New<AnyInternal::DynamicData<std::decay_t<T>>>(value))
     {
+        Emplace<std::decay_t<T>>(value);
     }
 
     template <typename T>
     Any(T &value)
-        : data(Memory::New<AnyInternal::DynamicData<std::decay_t<T>>>(value))
     {
+        Emplace<std::decay_t<T>>(value);
     }
 
     template <typename T>
@@ -107,43 +120,45 @@ public:
 
     bool IsEmpty() const
     {
-        return data == nullptr;
+        return !inlined && data == nullptr;
+    }
+
+    bool IsInline() const
+    {
+        return inlined;
     }
 
     void Swap(Any &other)
     {
-        std::swap(data, other.data);
+        // Both representations are plain bytes, heap data is only referenced by pointer.
+        std::swap(storage, other.storage);
+        std::swap(inlined, other.inlined);
     }
 
     void Clear()
     {
-        if (data)
+        if (!inlined && data)
             Memory::Delete(data);
         data = nullptr;
+        inlined = false;
     }
 
     template <typename T>
     T Cast() const
     {
-        if (!data)
-            CT_EXCEPTION(Runtime, "Invalid to cast an empty any.");
-        return static_cast<AnyInternal::DynamicData<T> *>(data)->value;
+        return *GetValuePtr<T>();
     }
 
     template <typename T>
     T &RefCast()
     {
-        if (!data)
-            CT_EXCEPTION(Runtime, "Invalid to cast an empty any.");
-        return static_cast<AnyInternal::DynamicData<T> *>(data)->value;
+        return *const_cast<T *>(GetValuePtr<T>());
     }
 
     template <typename T>
     const T &RefCast() const
     {
-        if (!data)
-            CT_EXCEPTION(Runtime, "Invalid to cast an empty any.");
-        return static_cast<AnyInternal::DynamicData<T> *>(data)->value;
+        return *GetValuePtr<T>();
     }
 
     template <typename T>
@@ -153,7 +168,44 @@ public:
     }
 
 private:
-    AnyInternal::IDynamicData *data = nullptr;
+    template <typename T, typename U>
+    void Emplace(U &&value)
+    {
+        if constexpr (AnyInternal::IsInline<T>)
+        {
+            new (storage) T(std::forward<U>(value));
+            inlined = true;
+        }
+        else
+        {
+            data = Memory::New<AnyInternal::DynamicData<T>>(std::forward<U>(value));
+        }
+    }
+
+    template <typename T>
+    const T *GetValuePtr() const
+    {
+        if (IsEmpty())
+            CT_EXCEPTION(Runtime, "Invalid to cast an empty any.");
+        if constexpr (AnyInternal::IsInline<T>)
+        {
+            CT_CHECK(inlined);
+            return std::launder(reinterpret_cast<const T *>(storage));
+        }
+        else
+        {
+            CT_CHECK(!inlined);
+            return &static_cast<AnyInternal::DynamicData<T> *>(data)->value;
+        }
+    }
+
+private:
+    union
+    {
+        AnyInternal::IDynamicData *data = nullptr;
+        alignas(void *) uint8 storage[AnyInternal::INLINE_SIZE];
+    };
+    bool inlined = false;
 };
 
 namespace std
@@ -94,6 +94,40 @@ CT_INLINE void HashCombine(HashType &hash, const T &value)
     hash ^= HashValue(value) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
 }
 
+constexpr uint64 BYTES_HASH_SEED = 14695981039346656037ull;
+
+// 64-bit FNV-1a over a byte range. Unlike HashValue it is the same on every run and platform, so it can name data on disk.
+// Ranges are chained by passing the previous hash.
+CT_INLINE uint64 HashBytes(const void *data, SizeType size, uint64 hash = BYTES_HASH_SEED)
+{
+    auto bytes = static_cast<const uint8 *>(data);
+    for (SizeType i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+CT_INLINE void HashBytesCombine(uint64 &hash, const T &value)
+{
+    hash = HashBytes(&value, sizeof(T), hash);
+}
+
+// Characters of a string, without the terminator.
+template <typename T>
+requires requires(const T &a)
+{
+    a.CStr();
+    a.Length();
+}
+CT_INLINE void HashBytesCombine(uint64 &hash, const T &str)
+{
+    hash = HashBytes(str.CStr(), sizeof(*str.CStr()) * str.Length(), hash);
+}
+
 }
 
 template <typename T>
@@ -67,6 +67,10 @@ public:
 
         auto settings = SceneImportSettings::Create();
         settings->dontLoadBones = true;
+        settings->lodCount = 4;
+        settings->buildMeshlets = true;
+        settings->vertexFormat = VertexFormat::Compact;
+        settings->compressTextures = true;
         scene = gAssetManager->Import<Scene>(path, settings);
 
         if (scene)
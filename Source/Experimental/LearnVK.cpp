@@ -71,6 +71,10 @@ public:
     {
         auto settings = SceneImportSettings::Create();
         settings->dontLoadBones = true;
+        settings->lodCount = 4;
+        settings->buildMeshlets = true;
+        settings->vertexFormat = VertexFormat::Compact;
+        settings->compressTextures = true;
         scene = gAssetManager->Import<Scene>(path, settings);
         loading = true;
     }
@@ -173,6 +177,10 @@ private:
         ImGui::Text("Materials: %d", s.materialCount);
         ImGui::NextColumn();
         ImGui::Text("Lights: %d", s.lightCount);
+        ImGui::NextColumn();
+        ImGui::Text("Visible instances: %d", s.visibleInstanceCount);
+        ImGui::NextColumn();
+        ImGui::Text("Culled instances: %d", s.culledInstanceCount);
         ImGui::Columns(1);
     }
 
@@ -3,6 +3,7 @@
 #include "Assets/AssetManager.h"
 #include "Core/Time.h"
 #include "Render/RenderManager.h"
+#include "Render/TextureStreamer.h"
 #include "Render/Importers/SceneImporter.h"
 #include "Render/Importers/TextureImporter.h"
 #include "Render/Exporters/TextureExporter.h"
@@ -38,6 +39,9 @@ void Application::Init()
     gAssetManager->Startup();
     CT_LOG(Info, CT_TEXT("AssetManager startup."));
 
+    gTextureStreamer->Startup();
+    CT_LOG(Info, CT_TEXT("TextureStreamer startup."));
+
     gImGuiLab->Startup();
     CT_LOG(Info, CT_TEXT("ImGuiLab startup."));
 
@@ -115,6 +119,9 @@ void Application::Run()
         CT_PROFILE_SESSION_BEGIN(CT_TEXT("AssetManager"));
         gAssetManager->Tick();
 
+        CT_PROFILE_SESSION_BEGIN(CT_TEXT("TextureStreamer"));
+        gTextureStreamer->Tick();
+
         CT_PROFILE_SESSION_BEGIN(CT_TEXT("Logic"));
         gLogic->Tick();
 
@@ -146,6 +153,12 @@ void Application::Exit()
     gImGuiLab->Shutdown();
     CT_LOG(Info, CT_TEXT("ImGui shutdown."));
 
+    gTextureStreamer->Shutdown();
+    CT_LOG(Info, CT_TEXT("TextureStreamer shutdown."));
+
+    gAssetManager->Shutdown();
+    CT_LOG(Info, CT_TEXT("AssetManager shutdown."));
+
     gRenderManager->Shutdown();
     CT_LOG(Info, CT_TEXT("RenderManager shutdown."));
 
@@ -1,12 +1,19 @@
 #pragma once
 
 #include "Assets/AssetPtr.h"
+#include "Core/Hash.h"
 
 class ImportSettings
 {
 public:
     virtual ~ImportSettings() = default;
 
+    // Part of the key the asset manager caches imported assets by, settings that import differently must hash differently.
+    virtual HashType HashCode() const
+    {
+        return 0;
+    }
+
     template <typename T>
     static SPtr<T> As(const SPtr<ImportSettings> &settings)
     {
@@ -1,25 +1,64 @@
 #include "Assets/AssetManager.h"
 #include "Application/ThreadManager.h"
+#include "Core/Time.h"
+#include "IO/FileHandle.h"
+#include "IO/VirtualFileSystem.h"
 
 AssetManager assetManager;
 AssetManager *gAssetManager = &assetManager;
 
+static thread_local AssetPriority threadPriority = AssetPriority::Visible;
+
 void AssetManager::Startup()
 {
+    // One core is left to the main thread.
+    maxWorkers = Math::Max(static_cast<int32>(Thread::HardwareConcurrency()) - 1, 1);
 }
 
 void AssetManager::Shutdown()
 {
+    // Work that has not started is dropped, workers still running finish their task.
+    {
+        std::unique_lock<std::mutex> lock(multithreadMutex);
+        for (auto &queue : multithreadTasks)
+            queue.Clear();
+    }
+    {
+        std::unique_lock<std::mutex> lock(assetSyncMutex);
+        for (auto &queue : assetSyncTasks)
+            queue.Clear();
+    }
+
+    // Prefetched assets must not outlive the render device.
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    records.Clear();
+    recordKeys.Clear();
+    pendingDependencies.Clear();
 }
 
 void AssetManager::Tick()
 {
-    std::unique_lock<std::mutex> lock(assetSyncMutex);
-    for (auto &task : assetSyncTasks)
+    int64 start = Time::NanoTime();
+    int64 budgetNanos = static_cast<int64>(mainthreadBudget.milliseconds * 1000000.0f);
+    uint64 bytes = 0;
+    bool first = true;
+    while (first || (Time::NanoTime() - start < budgetNanos && bytes < mainthreadBudget.bytes))
     {
-        task();
+        LoadTask task;
+        AssetPriority priority;
+        {
+            std::unique_lock<std::mutex> lock(assetSyncMutex);
+            if (!PopTask(assetSyncTasks, task, priority))
+                break;
+        }
+
+        // Tasks run unlocked, they may queue more work.
+        threadPriority = priority;
+        task.func();
+        threadPriority = AssetPriority::Visible;
+        bytes += task.bytes;
+        first = false;
     }
-    assetSyncTasks.Clear();
 }
 
 void AssetManager::RunMainthread(Runnable<> func)
@@ -30,12 +69,318 @@ void AssetManager::RunMainthread(Runnable<> func)
     }
     else
     {
-        std::unique_lock<std::mutex> lock(assetSyncMutex);
-        assetSyncTasks.Add(std::move(func));
+        ScheduleMainthread(nullptr, std::move(func), 0);
     }
 }
 
 void AssetManager::RunMultithread(Runnable<> func)
 {
-    gThreadManager->RunAsync(std::move(func));
-}
\ No newline at end of file
+    ScheduleMultithread(nullptr, std::move(func));
+}
+
+AssetPriority AssetManager::GetThreadPriority()
+{
+    return threadPriority;
+}
+
+void AssetManager::SetPriority(const SPtr<AssetState> &state, AssetPriority priority)
+{
+    if (!state)
+        return;
+
+    // Scheduling reads the priority under the queue lock, so a task is either queued before the change and moved here, or
+    // queued with the new priority.
+    std::unique_lock<std::mutex> multithreadLock(multithreadMutex);
+    std::unique_lock<std::mutex> assetSyncLock(assetSyncMutex);
+    if (state->priority == priority)
+        return;
+
+    state->priority = priority;
+    MoveTasks(multithreadTasks, state.get(), priority);
+    MoveTasks(assetSyncTasks, state.get(), priority);
+}
+
+void AssetManager::ScheduleMultithread(const SPtr<AssetState> &owner, Runnable<> func)
+{
+    bool spawn = false;
+    {
+        std::unique_lock<std::mutex> lock(multithreadMutex);
+        // Work of no asset runs with the priority of the work that queued it.
+        AssetPriority priority = owner ? owner->priority.load() : threadPriority;
+        multithreadTasks[static_cast<int32>(priority)].AddLast({ owner, owner != nullptr, std::move(func), 0 });
+        if (runningWorkers < maxWorkers)
+        {
+            ++runningWorkers;
+            spawn = true;
+        }
+    }
+
+    if (spawn)
+        gThreadManager->RunAsync([this]() { RunWorker(); });
+}
+
+void AssetManager::ScheduleMainthread(const SPtr<AssetState> &owner, Runnable<> func, uint64 bytes)
+{
+    std::unique_lock<std::mutex> lock(assetSyncMutex);
+    AssetPriority priority = owner ? owner->priority.load() : threadPriority;
+    assetSyncTasks[static_cast<int32>(priority)].AddLast({ owner, owner != nullptr, std::move(func), bytes });
+}
+
+void AssetManager::RunWorker()
+{
+    // Workers take the most urgent task each time, so visible work overtakes prefetches queued before it.
+    while (true)
+    {
+        LoadTask task;
+        AssetPriority priority;
+        {
+            std::unique_lock<std::mutex> lock(multithreadMutex);
+            if (!PopTask(multithreadTasks, task, priority))
+            {
+                --runningWorkers;
+                return;
+            }
+        }
+
+        threadPriority = priority;
+        task.func();
+        threadPriority = AssetPriority::Visible;
+    }
+}
+
+bool AssetManager::PopTask(List<LoadTask> *queues, LoadTask &task, AssetPriority &priority)
+{
+    for (int32 i = 0; i < PRIORITY_COUNT; ++i)
+    {
+        auto &queue = queues[i];
+        while (!queue.IsEmpty())
+        {
+            task = std::move(queue.GetHead()->GetValue());
+            queue.RemoveFirst();
+            if (task.tracked && task.owner.expired())
+                continue;
+
+            priority = static_cast<AssetPriority>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AssetManager::MoveTasks(List<LoadTask> *queues, const AssetState *state, AssetPriority priority)
+{
+    auto &target = queues[static_cast<int32>(priority)];
+    for (int32 i = 0; i < PRIORITY_COUNT; ++i)
+    {
+        if (i == static_cast<int32>(priority))
+            continue;
+
+        auto node = queues[i].GetHead();
+        while (node)
+        {
+            auto next = node->GetNext();
+            if (node->GetValue().tracked && node->GetValue().owner.lock().get() == state)
+            {
+                target.AddLast(std::move(node->GetValue()));
+                queues[i].RemoveNode(node);
+            }
+            node = next;
+        }
+    }
+}
+
+AssetKey AssetManager::GetAssetKey(std::type_index type, const String &path, const SPtr<ImportSettings> &settings)
+{
+    AssetKey key;
+    key.type = type;
+    key.path = IO::VirtualFileSystem::NormalizePath(IO::FileHandle(path).GetAbsolutePath());
+    key.settingsHash = settings ? settings->HashCode() : 0;
+    return key;
+}
+
+SPtr<AssetState> AssetManager::ImportCached(const AssetKey &key, const String &path, const SPtr<ImportSettings> &settings, ImportFunc importFunc,
+                                            AssetPriority priority, bool pin)
+{
+    SPtr<AssetState> cached;
+    {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        // Another thread is in the importer for the key, its asset is shared as soon as the importer returns.
+        AssetRecord *record = records.TryGet(key);
+        while (record && record->importing)
+        {
+            importCond.wait(lock);
+            record = records.TryGet(key);
+        }
+
+        if (record)
+        {
+            // A failed asset is left to whoever holds it, the record is refreshed by a new import.
+            cached = record->data.lock();
+            if (cached && cached->failed)
+            {
+                recordKeys.Remove(cached.get());
+                cached = nullptr;
+            }
+            if (cached)
+                record->pin = pin ? cached : nullptr;
+        }
+        else
+        {
+            records.Put(key, AssetRecord());
+            record = records.TryGet(key);
+        }
+
+        if (!cached)
+        {
+            record->importing = true;
+            record->settings = settings;
+            record->importFunc = importFunc;
+            ++importingCount;
+        }
+    }
+
+    // Asking for an asset again only makes its work more urgent.
+    if (cached)
+    {
+        if (priority < cached->priority)
+            SetPriority(cached, priority);
+        return cached;
+    }
+
+    // Importers only start the load and return, they run unlocked since they may import what they depend on.
+    SPtr<AssetState> data = importFunc(*this, path, settings);
+    SetPriority(data, priority);
+
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    auto &record = records.Get(key);
+    record.importing = false;
+    record.data = data;
+    record.pin = pin ? data : nullptr;
+    --importingCount;
+
+    if (data)
+    {
+        recordKeys.Put(data.get(), key);
+        if (auto pending = pendingDependencies.TryGet(data.get()))
+        {
+            for (const auto &child : *pending)
+            {
+                if (!record.dependencies.Contains(child))
+                    record.dependencies.Add(child);
+            }
+            pendingDependencies.Remove(data.get());
+        }
+    }
+    // Edges of parents that were not imported through the manager never find their record.
+    if (importingCount == 0)
+        pendingDependencies.Clear();
+
+    importCond.notify_all();
+    return data;
+}
+
+void AssetManager::Prefetch(const Array<AssetKey> &keys, const SPtr<ImportSettings> &settings, ImportFunc importFunc)
+{
+    struct Request
+    {
+        AssetKey key;
+        SPtr<ImportSettings> settings;
+        ImportFunc importFunc;
+    };
+
+    // Everything reachable in the graph is collected first, so all loads are started together.
+    Array<Request> requests;
+    {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        HashMap<AssetKey, bool> visited;
+        for (const auto &key : keys)
+        {
+            if (visited.Contains(key))
+                continue;
+            visited.Put(key, true);
+            requests.Add({ key, settings, importFunc });
+        }
+
+        for (int32 i = 0; i < requests.Count(); ++i)
+        {
+            auto record = records.TryGet(requests[i].key);
+            if (!record)
+                continue;
+
+            for (const auto &child : record->dependencies)
+            {
+                auto childRecord = records.TryGet(child);
+                if (!childRecord || !childRecord->importFunc || visited.Contains(child))
+                    continue;
+                visited.Put(child, true);
+                requests.Add({ child, childRecord->settings, childRecord->importFunc });
+            }
+        }
+    }
+
+    for (const auto &request : requests)
+        ImportCached(request.key, request.key.path, request.settings, request.importFunc, AssetPriority::Prefetch, true);
+}
+
+void AssetManager::ReleasePrefetched()
+{
+    // Assets are released outside the lock, destroying one may drop the last pointers to others.
+    Array<SPtr<AssetState>> pins;
+    {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        for (auto &[key, record] : records)
+        {
+            if (record.pin)
+                pins.Add(std::move(record.pin));
+        }
+    }
+}
+
+void AssetManager::AddDependency(const AssetState *parent, const AssetState *child)
+{
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    const AssetKey *childKey = FindKey(child);
+    if (!childKey)
+        return;
+
+    const AssetKey *parentKey = FindKey(parent);
+    if (!parentKey)
+    {
+        // The parent importer may not have returned yet.
+        if (importingCount > 0)
+        {
+            if (!pendingDependencies.Contains(parent))
+                pendingDependencies.Put(parent, {});
+            pendingDependencies.Get(parent).Add(*childKey);
+        }
+        return;
+    }
+
+    auto &dependencies = records.Get(*parentKey).dependencies;
+    if (!dependencies.Contains(*childKey))
+        dependencies.Add(*childKey);
+}
+
+const AssetKey *AssetManager::FindKey(const AssetState *data)
+{
+    // Addresses of unloaded assets may be taken by new ones, the record has to still point at the same data.
+    const AssetKey *key = recordKeys.TryGet(data);
+    if (!key)
+        return nullptr;
+    auto record = records.TryGet(*key);
+    if (!record || record->data.expired() || record->data.lock().get() != data)
+        return nullptr;
+    return key;
+}
+
+int32 AssetManager::GetLoadedCount()
+{
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    int32 count = 0;
+    for (const auto &[key, record] : records)
+    {
+        if (!record.data.expired())
+            ++count;
+    }
+    return count;
+}
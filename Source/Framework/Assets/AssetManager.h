@@ -4,7 +4,30 @@
 #include "Assets/AssetImporter.h"
 #include "Assets/AssetPtr.h"
 #include "Core/HashMap.h"
+#include "Core/List.h"
 #include "Utils/Module.h"
+#include <condition_variable>
+
+// Type, file and settings an asset was imported with, the file is normalized so different spellings of it meet.
+struct AssetKey
+{
+    std::type_index type = typeid(void);
+    String path;
+    HashType settingsHash = 0;
+
+    HashType HashCode() const
+    {
+        HashType hash = Hash::HashValue(type);
+        Hash::HashCombine(hash, path);
+        Hash::HashCombine(hash, settingsHash);
+        return hash;
+    }
+
+    bool operator==(const AssetKey &other) const
+    {
+        return type == other.type && settingsHash == other.settingsHash && path == other.path;
+    }
+};
 
 class AssetManager : public Module
 {
@@ -13,9 +36,50 @@ public:
     void Shutdown() override;
     void Tick() override;
 
+    // Main thread work one tick may run, the first task of a tick always runs. Bytes are what the tasks say they upload.
+    struct MainthreadBudget
+    {
+        float milliseconds = 4.0f;
+        uint64 bytes = 64ull << 20;
+    };
+
+    // Work that belongs to no asset, it always runs.
     void RunMultithread(Runnable<> func);
     void RunMainthread(Runnable<> func);
 
+    // Load work of an asset, queued by the priority of the asset. Work that has not started is dropped once the queues hold the only
+    // references to the asset, the function gets the asset back when it runs.
+    template <typename T>
+    void RunMultithread(const APtr<T> &asset, Runnable<const APtr<T> &> func)
+    {
+        ScheduleMultithread(asset.GetData(), BindAsset(asset, std::move(func)));
+    }
+
+    // Runs in a tick with budget left, uploadBytes counts against it.
+    template <typename T>
+    void RunMainthread(const APtr<T> &asset, uint64 uploadBytes, Runnable<const APtr<T> &> func)
+    {
+        ScheduleMainthread(asset.GetData(), BindAsset(asset, std::move(func)), uploadBytes);
+    }
+
+    // Queued work of the asset moves along. Assets imported by load work take the priority of the asset the work belongs to,
+    // others start as visible.
+    template <typename T>
+    void SetPriority(const APtr<T> &asset, AssetPriority priority)
+    {
+        SetPriority(SPtr<AssetState>(asset.GetData()), priority);
+    }
+
+    void SetMainthreadBudget(const MainthreadBudget &newBudget)
+    {
+        mainthreadBudget = newBudget;
+    }
+
+    const MainthreadBudget &GetMainthreadBudget() const
+    {
+        return mainthreadBudget;
+    }
+
     template <typename T>
     void RegisterImporter(IAssetImporter *importer)
     {
@@ -46,15 +110,45 @@ public:
         return dynamic_cast<AssetExporter<T> *>(*ptr);
     }
 
+    // Imported assets are cached by their key. Importing one that is loaded or still loading returns the same asset, so concurrent
+    // requests share one load. The cache does not keep assets alive, they unload once their last APtr is gone. Assets whose load
+    // failed are imported again.
     template <typename T>
     APtr<T> Import(const String &path, const SPtr<ImportSettings> &settings = nullptr)
     {
-        auto importer = GetImporter<T>();
-        if (importer)
-            return importer->Import(path, settings);
-        return APtr<T>();
+        APtr<T> result;
+        auto data = ImportCached(GetAssetKey(TypeIndexOf<T>(), path, settings), path, settings, &ImportAsset<T>, GetThreadPriority(), false);
+        if (data)
+            result.SetData(std::static_pointer_cast<typename APtr<T>::InnerData>(data));
+        return result;
     }
 
+    // Starts loading the assets together with everything they were seen to depend on, all at once instead of one after another as
+    // the importers find them. Their work runs after visible work, and prefetched assets are held until they are imported or
+    // ReleasePrefetched is called.
+    template <typename T>
+    void Prefetch(const Array<String> &paths, const SPtr<ImportSettings> &settings = nullptr)
+    {
+        Array<AssetKey> keys;
+        for (const auto &path : paths)
+            keys.Add(GetAssetKey(TypeIndexOf<T>(), path, settings));
+        Prefetch(keys, settings, &ImportAsset<T>);
+    }
+
+    void ReleasePrefetched();
+
+    // Records that parent needs child, like a scene needs the textures of its materials. Assets that were not imported through the
+    // manager are not tracked. The graph outlives the assets, so prefetching a parent again brings its children along.
+    template <typename T1, typename T2>
+    void AddDependency(const APtr<T1> &parent, const APtr<T2> &child)
+    {
+        if (parent.GetData() && child.GetData())
+            AddDependency(static_cast<const AssetState *>(parent.GetData().get()), static_cast<const AssetState *>(child.GetData().get()));
+    }
+
+    // Cached assets that are still alive.
+    int32 GetLoadedCount();
+
     template <typename T>
     void Export(const SPtr<T> &asset, const String &path, const SPtr<ExportSettings> &settings = nullptr)
     {
@@ -69,8 +163,90 @@ public:
     }
 
 private:
-    Array<Runnable<>> assetSyncTasks;
+    using ImportFunc = SPtr<AssetState> (*)(AssetManager &manager, const String &path, const SPtr<ImportSettings> &settings);
+
+    struct LoadTask
+    {
+        std::weak_ptr<AssetState> owner;
+        bool tracked = false; // Work of no asset is never dropped.
+        Runnable<> func;
+        uint64 bytes = 0;
+    };
+
+    static constexpr int32 PRIORITY_COUNT = 3;
+
+    struct AssetRecord
+    {
+        std::weak_ptr<AssetState> data; // InnerData of the asset, expires with its last APtr.
+        SPtr<AssetState> pin;           // Holds a prefetched asset until it is imported.
+        SPtr<ImportSettings> settings;
+        ImportFunc importFunc = nullptr;
+        Array<AssetKey> dependencies;
+        bool importing = false;
+    };
+
+    template <typename T>
+    static SPtr<AssetState> ImportAsset(AssetManager &manager, const String &path, const SPtr<ImportSettings> &settings)
+    {
+        auto importer = manager.GetImporter<T>();
+        if (!importer)
+        {
+            CT_LOG(Error, CT_TEXT("Import asset failed, no importer is registered for its type. Path: {0}."), path);
+            return nullptr;
+        }
+        return importer->Import(path, settings).GetData();
+    }
+
+    // The function only runs while the asset is alive.
+    template <typename T>
+    static Runnable<> BindAsset(const APtr<T> &asset, Runnable<const APtr<T> &> func)
+    {
+        std::weak_ptr<typename APtr<T>::InnerData> weak = asset.GetData();
+        return [weak, func = std::move(func)]() {
+            APtr<T> locked;
+            if (auto data = weak.lock())
+            {
+                locked.SetData(data);
+                func(locked);
+            }
+        };
+    }
+
+    // Priority of the load work running on the calling thread, visible outside of it.
+    static AssetPriority GetThreadPriority();
+    void SetPriority(const SPtr<AssetState> &state, AssetPriority priority);
+    void ScheduleMultithread(const SPtr<AssetState> &owner, Runnable<> func);
+    void ScheduleMainthread(const SPtr<AssetState> &owner, Runnable<> func, uint64 bytes);
+    void RunWorker();
+    // Most urgent task whose asset is still alive, dropped tasks are skipped.
+    static bool PopTask(List<LoadTask> *queues, LoadTask &task, AssetPriority &priority);
+    static void MoveTasks(List<LoadTask> *queues, const AssetState *state, AssetPriority priority);
+
+    static AssetKey GetAssetKey(std::type_index type, const String &path, const SPtr<ImportSettings> &settings);
+    SPtr<AssetState> ImportCached(const AssetKey &key, const String &path, const SPtr<ImportSettings> &settings, ImportFunc importFunc,
+                                  AssetPriority priority, bool pin);
+    void Prefetch(const Array<AssetKey> &keys, const SPtr<ImportSettings> &settings, ImportFunc importFunc);
+    void AddDependency(const AssetState *parent, const AssetState *child);
+    // Key of a cached asset that is still alive, nullptr for others.
+    const AssetKey *FindKey(const AssetState *data);
+
+    std::mutex cacheMutex;
+    std::condition_variable importCond;
+    HashMap<AssetKey, AssetRecord> records;
+    HashMap<const AssetState *, AssetKey> recordKeys;
+    // Edges whose parent is still in its importer, they are attached once it returns.
+    HashMap<const AssetState *, Array<AssetKey>> pendingDependencies;
+    int32 importingCount = 0;
+
+    // Queues by priority, workers are spawned on the thread manager as long as there is work and fewer than maxWorkers run.
+    List<LoadTask> multithreadTasks[PRIORITY_COUNT];
+    std::mutex multithreadMutex;
+    int32 runningWorkers = 0;
+    int32 maxWorkers = 1;
+
+    List<LoadTask> assetSyncTasks[PRIORITY_COUNT];
     std::mutex assetSyncMutex;
+    MainthreadBudget mainthreadBudget;
 
     HashMap<std::type_index, IAssetImporter *> importers;
     HashMap<std::type_index, IAssetExporter *> exporters;
@@ -3,11 +3,27 @@
 #include "Assets/.Package.h"
 #include "Core/Thread.h"
 
+// Order the asset manager runs load work in, assets that are on screen now come first.
+enum class AssetPriority
+{
+    Visible,
+    Prefetch,
+    Background,
+};
+
+// Shared by every pointer to one asset whatever its type, load work is dropped once nothing else holds it.
+struct AssetState
+{
+    std::atomic<AssetPriority> priority{ AssetPriority::Visible };
+    // Set by the importer when loading gave up, the asset manager imports the asset again instead of sharing it.
+    std::atomic<bool> failed{ false };
+};
+
 template <typename T>
 class AssetPtr
 {
 public:
-    struct InnerData
+    struct InnerData : AssetState
     {
         SPtr<T> ptr;
 
@@ -0,0 +1,551 @@
+#include "IO/AsyncIO.h"
+#include "IO/FileStream.h"
+#include "Core/Math.h"
+#include "Core/Queue.h"
+#include "Core/Thread.h"
+#include <filesystem>
+
+#if CT_PLATFORM_LINUX
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace IO
+{
+
+namespace
+{
+// Array counts are int32, larger reads have to be split by the caller.
+constexpr uint64 MAX_READ_SIZE = static_cast<uint64>(INT32_MAX);
+
+bool ResolveRange(uint64 fileSize, const AsyncIOService::ReadDesc &desc, uint64 &length)
+{
+    if (desc.offset > fileSize)
+        return false;
+
+    length = desc.size ? desc.size : fileSize - desc.offset;
+    if (desc.offset + length > fileSize)
+        length = fileSize - desc.offset;
+    return length <= MAX_READ_SIZE;
+}
+
+AsyncReadResult ReadBlocking(const AsyncIOService::ReadDesc &desc)
+{
+    AsyncReadResult result;
+    result.path = desc.path;
+    result.offset = desc.offset;
+
+    FileInputStream stream(desc.path);
+    uint64 length = 0;
+    if (!stream.IsOpen() || !ResolveRange(stream.Size(), desc, length))
+    {
+        CT_LOG(Error, CT_TEXT("Async read failed. Path: {0}."), desc.path);
+        return result;
+    }
+
+    result.bytes.AddUninitialized(static_cast<int32>(length));
+    stream.Seek(static_cast<SizeType>(desc.offset));
+    SizeType readCount = stream.Read(result.bytes.GetData(), static_cast<SizeType>(length));
+    result.bytes.SetCount(static_cast<int32>(readCount));
+    result.success = readCount == length;
+    return result;
+}
+
+//===============================================================================
+class ThreadedIOService : public AsyncIOService
+{
+public:
+    explicit ThreadedIOService(int32 threadCount)
+    {
+        for (int32 i = 0; i < threadCount; ++i)
+        {
+            workers.Add(Memory::MakeUnique<std::thread>([this]() {
+                Run();
+            }));
+        }
+    }
+
+    ~ThreadedIOService()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueCond.notify_all();
+
+        for (auto &e : workers)
+            e->join();
+    }
+
+    String GetBackendName() const override
+    {
+        return CT_TEXT("Threaded");
+    }
+
+protected:
+    void Submit(Array<UPtr<ReadRequest>> &requests) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (auto &e : requests)
+                queue.Push(e.release());
+        }
+        queueCond.notify_all();
+    }
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            UPtr<ReadRequest> request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (queue.IsEmpty() && !stopping)
+                    queueCond.wait(lock);
+
+                if (queue.IsEmpty())
+                    return;
+
+                request.reset(queue.First());
+                queue.Pop();
+            }
+
+            AsyncReadResult result = ReadBlocking(request->desc);
+            Complete(std::move(request), std::move(result));
+        }
+    }
+
+private:
+    Array<UPtr<std::thread>> workers;
+    Queue<ReadRequest *> queue;
+    std::mutex mutex;
+    std::condition_variable queueCond;
+    bool stopping = false;
+};
+
+#if CT_PLATFORM_LINUX
+//===============================================================================
+// io_uring through raw syscalls, one ring owned by a single submission thread.
+// New requests wake the thread through a poll on an eventfd that lives in the same ring.
+class IOUringService : public AsyncIOService
+{
+public:
+    static constexpr uint32 RING_ENTRIES = 256;
+    static constexpr uint64 WAKE_TAG = 0;
+
+    struct InFlight
+    {
+        UPtr<ReadRequest> request;
+        AsyncReadResult result;
+        int fd = -1;
+        uint64 length = 0;
+        uint64 done = 0;
+    };
+
+    IOUringService() = default;
+
+    ~IOUringService()
+    {
+        if (thread)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            Wake();
+            thread->join();
+        }
+
+        if (sqes)
+            munmap(sqes, sqeSize);
+        if (cqPtr && cqPtr != sqPtr)
+            munmap(cqPtr, cqRingSize);
+        if (sqPtr)
+            munmap(sqPtr, sqRingSize);
+        if (wakeFd >= 0)
+            close(wakeFd);
+        if (ringFd >= 0)
+            close(ringFd);
+    }
+
+    bool Init()
+    {
+        io_uring_params params{};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+        if (ringFd < 0)
+            return false;
+
+        // IORING_OP_READ needs 5.6, which is also where NODROP and the single mmap landed.
+        if (!(params.features & IORING_FEAT_NODROP))
+            return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap)
+            sqRingSize = cqRingSize = Math::Max(sqRingSize, cqRingSize);
+
+        sqPtr = MapRing(sqRingSize, IORING_OFF_SQ_RING);
+        if (!sqPtr)
+            return false;
+        cqPtr = singleMmap ? sqPtr : MapRing(cqRingSize, IORING_OFF_CQ_RING);
+        if (!cqPtr)
+            return false;
+        sqeSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(MapRing(sqeSize, IORING_OFF_SQES));
+        if (!sqes)
+            return false;
+
+        uint8 *sq = static_cast<uint8 *>(sqPtr);
+        sqTail = reinterpret_cast<uint32 *>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<uint32 *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<uint32 *>(sq + params.sq_off.array);
+        sqHead = reinterpret_cast<uint32 *>(sq + params.sq_off.head);
+        sqCapacity = params.sq_entries;
+
+        uint8 *cq = static_cast<uint8 *>(cqPtr);
+        cqHead = reinterpret_cast<uint32 *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<uint32 *>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<uint32 *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        maxInFlight = static_cast<int32>(params.cq_entries) - 1;
+
+        wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (wakeFd < 0)
+            return false;
+
+        thread = Memory::MakeUnique<std::thread>([this]() {
+            Run();
+        });
+        return true;
+    }
+
+    String GetBackendName() const override
+    {
+        return CT_TEXT("io_uring");
+    }
+
+protected:
+    void Submit(Array<UPtr<ReadRequest>> &requests) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (auto &e : requests)
+                incoming.Add(std::move(e));
+        }
+        Wake();
+    }
+
+private:
+    void *MapRing(SizeType size, uint64 offset)
+    {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, static_cast<off_t>(offset));
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    void Wake()
+    {
+        uint64 value = 1;
+        [[maybe_unused]] auto ret = write(wakeFd, &value, sizeof(value));
+    }
+
+    io_uring_sqe *AcquireSqe()
+    {
+        uint32 head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        uint32 tail = *sqTail + queuedSqes;
+        if (tail - head >= sqCapacity)
+            return nullptr;
+
+        uint32 index = tail & sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sqArray[index] = index;
+        ++queuedSqes;
+        return sqe;
+    }
+
+    bool QueueWakePoll()
+    {
+        io_uring_sqe *sqe = AcquireSqe();
+        if (!sqe)
+            return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = wakeFd;
+        sqe->poll_events = POLLIN;
+        sqe->user_data = WAKE_TAG;
+        return true;
+    }
+
+    bool QueueRead(InFlight *op)
+    {
+        io_uring_sqe *sqe = AcquireSqe();
+        if (!sqe)
+            return false;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = op->fd;
+        sqe->off = op->result.offset + op->done;
+        sqe->addr = reinterpret_cast<uint64>(op->result.bytes.GetData() + op->done);
+        sqe->len = static_cast<uint32>(op->length - op->done);
+        sqe->user_data = reinterpret_cast<uint64>(op);
+        return true;
+    }
+
+    // Opens the file and sizes the destination, completes the request right away on failure.
+    InFlight *Prepare(UPtr<ReadRequest> request)
+    {
+        auto op = Memory::New<InFlight>();
+        op->result.path = request->desc.path;
+        op->result.offset = request->desc.offset;
+        op->request = std::move(request);
+
+        auto path = std::filesystem::path(*op->result.path);
+        op->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        struct stat st;
+        if (op->fd < 0 || fstat(op->fd, &st) != 0 || !ResolveRange(static_cast<uint64>(st.st_size), op->request->desc, op->length))
+        {
+            CT_LOG(Error, CT_TEXT("Async read failed. Path: {0}."), op->result.path);
+            Finish(op, false);
+            return nullptr;
+        }
+
+        op->result.bytes.AddUninitialized(static_cast<int32>(op->length));
+        if (op->length == 0)
+        {
+            Finish(op, true);
+            return nullptr;
+        }
+        return op;
+    }
+
+    void Finish(InFlight *op, bool success)
+    {
+        if (op->fd >= 0)
+            close(op->fd);
+
+        if (op->done < op->length)
+            op->result.bytes.SetCount(static_cast<int32>(op->done));
+        op->result.success = success;
+        Complete(std::move(op->request), std::move(op->result));
+        Memory::Delete(op);
+        --inFlightCount;
+    }
+
+    void Flush(uint32 minComplete)
+    {
+        __atomic_store_n(sqTail, *sqTail + queuedSqes, __ATOMIC_RELEASE);
+        uint32 toSubmit = queuedSqes;
+        queuedSqes = 0;
+
+        while (true)
+        {
+            int ret = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret >= 0 || errno != EINTR)
+                break;
+            toSubmit = 0;
+        }
+    }
+
+    void Reap(bool &wakePending)
+    {
+        uint32 head = *cqHead;
+        uint32 tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe &cqe = cqes[head & cqMask];
+            if (cqe.user_data == WAKE_TAG)
+            {
+                uint64 value;
+                [[maybe_unused]] auto ret = read(wakeFd, &value, sizeof(value));
+                wakePending = false;
+                continue;
+            }
+
+            auto op = reinterpret_cast<InFlight *>(cqe.user_data);
+            if (cqe.res == -EAGAIN || cqe.res == -EINTR)
+            {
+                retries.Add(op);
+            }
+            else if (cqe.res <= 0)
+            {
+                Finish(op, false);
+            }
+            else
+            {
+                op->done += static_cast<uint64>(cqe.res);
+                // Short reads are legal, queue the remainder.
+                if (op->done < op->length)
+                    retries.Add(op);
+                else
+                    Finish(op, true);
+            }
+        }
+
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    void Run()
+    {
+        Array<UPtr<ReadRequest>> backlog;
+        bool wakePending = false;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (auto &e : incoming)
+                    backlog.Add(std::move(e));
+                incoming.Clear();
+
+                if (stopping && backlog.IsEmpty() && inFlightCount == 0)
+                    break;
+            }
+
+            if (!wakePending)
+                wakePending = QueueWakePoll();
+
+            int32 readyRetries = 0;
+            for (; readyRetries < retries.Count(); ++readyRetries)
+            {
+                if (!QueueRead(retries[readyRetries]))
+                    break;
+            }
+            if (readyRetries > 0)
+                retries.RemoveAt(0, readyRetries);
+
+            int32 consumed = 0;
+            for (; consumed < backlog.Count() && inFlightCount < maxInFlight; ++consumed)
+            {
+                ++inFlightCount;
+                auto op = Prepare(std::move(backlog[consumed]));
+                if (op && !QueueRead(op))
+                {
+                    retries.Add(op);
+                    ++consumed;
+                    break;
+                }
+            }
+            if (consumed > 0)
+                backlog.RemoveAt(0, consumed);
+
+            Flush(1);
+            Reap(wakePending);
+        }
+    }
+
+private:
+    std::mutex mutex;
+    Array<UPtr<ReadRequest>> incoming;
+    UPtr<std::thread> thread;
+    bool stopping = false;
+
+    int ringFd = -1;
+    int wakeFd = -1;
+    void *sqPtr = nullptr;
+    void *cqPtr = nullptr;
+    SizeType sqRingSize = 0;
+    SizeType cqRingSize = 0;
+    SizeType sqeSize = 0;
+    io_uring_sqe *sqes = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    uint32 *sqHead = nullptr;
+    uint32 *sqTail = nullptr;
+    uint32 *sqArray = nullptr;
+    uint32 *cqHead = nullptr;
+    uint32 *cqTail = nullptr;
+    uint32 sqMask = 0;
+    uint32 cqMask = 0;
+    uint32 sqCapacity = 0;
+    uint32 queuedSqes = 0;
+
+    // Touched only by the ring thread.
+    Array<InFlight *> retries;
+    int32 inFlightCount = 0;
+    int32 maxInFlight = 0;
+};
+#endif
+}
+
+//===============================================================================
+std::future<AsyncReadResult> AsyncIOService::Read(const String &path, uint64 offset, uint64 size, AsyncReadCallback callback)
+{
+    Array<ReadDesc> descs;
+    descs.Add({ path, offset, size, std::move(callback) });
+    return std::move(ReadBatch(std::move(descs))[0]);
+}
+
+Array<std::future<AsyncReadResult>> AsyncIOService::ReadBatch(Array<ReadDesc> descs)
+{
+    Array<std::future<AsyncReadResult>> futures(descs.Count());
+    Array<UPtr<ReadRequest>> requests(descs.Count());
+    for (auto &e : descs)
+    {
+        auto request = Memory::MakeUnique<ReadRequest>();
+        request->desc = std::move(e);
+        futures.Add(request->promise.get_future());
+        requests.Add(std::move(request));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingCount += requests.Count();
+    }
+    Submit(requests);
+
+    return futures;
+}
+
+void AsyncIOService::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    while (pendingCount > 0)
+        idleCond.wait(lock);
+}
+
+void AsyncIOService::Complete(UPtr<ReadRequest> request, AsyncReadResult &&result)
+{
+    if (request->desc.callback)
+        request->desc.callback(result);
+    request->promise.set_value(std::move(result));
+
+    {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        --pendingCount;
+    }
+    idleCond.notify_all();
+}
+
+UPtr<AsyncIOService> AsyncIOService::CreateThreaded(int32 threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = Math::Clamp(static_cast<int32>(Thread::HardwareConcurrency()) / 2, 1, 8);
+    return Memory::MakeUnique<ThreadedIOService>(threadCount);
+}
+
+UPtr<AsyncIOService> AsyncIOService::Create(int32 threadCount)
+{
+#if CT_PLATFORM_LINUX
+    auto ring = Memory::MakeUnique<IOUringService>();
+    if (ring->Init())
+        return ring;
+    CT_LOG(Info, CT_TEXT("io_uring is unavailable, async reads fall back to worker threads."));
+#endif
+    return CreateThreaded(threadCount);
+}
+
+AsyncIOService &AsyncIOService::GetGlobal()
+{
+    static UPtr<AsyncIOService> service = Create();
+    return *service;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "IO/.Package.h"
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
+namespace IO
+{
+
+struct AsyncReadResult
+{
+    String path;
+    uint64 offset = 0;
+    Array<uint8> bytes;
+    bool success = false;
+};
+
+// Invoked on an I/O thread right before the future becomes ready, keep it short or hand the work off.
+using AsyncReadCallback = std::function<void(AsyncReadResult &)>;
+
+class AsyncIOService
+{
+public:
+    // Size 0 means "read until the end of file".
+    struct ReadDesc
+    {
+        String path;
+        uint64 offset = 0;
+        uint64 size = 0;
+        AsyncReadCallback callback;
+    };
+
+    struct ReadRequest
+    {
+        ReadDesc desc;
+        std::promise<AsyncReadResult> promise;
+    };
+
+    AsyncIOService() = default;
+    virtual ~AsyncIOService() = default;
+
+    AsyncIOService(AsyncIOService &&) = delete;
+    AsyncIOService(const AsyncIOService &) = delete;
+    AsyncIOService &operator=(AsyncIOService &&) = delete;
+    AsyncIOService &operator=(const AsyncIOService &) = delete;
+
+    std::future<AsyncReadResult> Read(const String &path, uint64 offset = 0, uint64 size = 0, AsyncReadCallback callback = nullptr);
+    // All requests of a batch are handed to the backend together, io_uring submits them with one syscall.
+    Array<std::future<AsyncReadResult>> ReadBatch(Array<ReadDesc> descs);
+
+    // Block until every submitted request has completed.
+    void WaitIdle();
+
+    int32 GetPendingCount() const
+    {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        return pendingCount;
+    }
+
+    virtual String GetBackendName() const = 0;
+
+    // Prefer io_uring on linux, fall back to blocking reads on worker threads.
+    static UPtr<AsyncIOService> Create(int32 threadCount = 0);
+    static UPtr<AsyncIOService> CreateThreaded(int32 threadCount = 0);
+    static AsyncIOService &GetGlobal();
+
+protected:
+    virtual void Submit(Array<UPtr<ReadRequest>> &requests) = 0;
+
+    // Backends must call this once per request, it fires the callback and fulfills the future.
+    void Complete(UPtr<ReadRequest> request, AsyncReadResult &&result);
+
+private:
+    mutable std::mutex pendingMutex;
+    std::condition_variable idleCond;
+    int32 pendingCount = 0;
+};
+
+}
@@ -0,0 +1,223 @@
+#include "IO/Compression.h"
+#include "Core/Math.h"
+#include <cstring>
+
+namespace IO
+{
+
+namespace
+{
+namespace LZ4
+{
+constexpr int32 MIN_MATCH = 4;
+constexpr int32 LAST_LITERALS = 5;
+constexpr int32 MF_LIMIT = 12;
+constexpr int32 MAX_OFFSET = 65535;
+constexpr int32 HASH_BITS = 14;
+
+CT_INLINE uint32 Read32(const uint8 *ptr)
+{
+    uint32 value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+CT_INLINE uint32 HashSequence(uint32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+CT_INLINE uint8 *WriteLength(uint8 *op, int32 length)
+{
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = static_cast<uint8>(length);
+    return op;
+}
+
+int32 Compress(const uint8 *src, int32 srcSize, uint8 *dst, int32 dstCapacity)
+{
+    if (dstCapacity < Compression::CompressBound(CompressionMethod::LZ4, srcSize))
+        return 0;
+
+    const uint8 *ip = src;
+    const uint8 *anchor = src;
+    const uint8 *end = src + srcSize;
+    const uint8 *matchLimit = end - LAST_LITERALS;
+    const uint8 *ipLimit = end - MF_LIMIT;
+    uint8 *op = dst;
+
+    if (srcSize >= MF_LIMIT)
+    {
+        Array<int32> table;
+        table.AddUninitialized(1 << HASH_BITS);
+        std::memset(table.GetData(), 0, sizeof(int32) * table.Count());
+
+        while (ip < ipLimit)
+        {
+            uint32 sequence = Read32(ip);
+            uint32 hash = HashSequence(sequence);
+            const uint8 *ref = src + table[hash];
+            table[hash] = static_cast<int32>(ip - src);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || Read32(ref) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                --ip;
+                --ref;
+            }
+
+            const uint8 *matchEnd = ip + MIN_MATCH;
+            const uint8 *refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *refEnd)
+            {
+                ++matchEnd;
+                ++refEnd;
+            }
+
+            int32 literalLength = static_cast<int32>(ip - anchor);
+            int32 matchLength = static_cast<int32>(matchEnd - ip) - MIN_MATCH;
+            uint8 *token = op++;
+            *token = static_cast<uint8>((Math::Min(literalLength, 15) << 4) | Math::Min(matchLength, 15));
+            if (literalLength >= 15)
+                op = WriteLength(op, literalLength - 15);
+            std::memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            uint16 offset = static_cast<uint16>(ip - ref);
+            *op++ = static_cast<uint8>(offset & 0xFF);
+            *op++ = static_cast<uint8>(offset >> 8);
+            if (matchLength >= 15)
+                op = WriteLength(op, matchLength - 15);
+
+            ip = matchEnd;
+            anchor = ip;
+        }
+    }
+
+    int32 literalLength = static_cast<int32>(end - anchor);
+    *op++ = static_cast<uint8>(Math::Min(literalLength, 15) << 4);
+    if (literalLength >= 15)
+        op = WriteLength(op, literalLength - 15);
+    std::memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return static_cast<int32>(op - dst);
+}
+
+bool Decompress(const uint8 *src, int32 srcSize, uint8 *dst, int32 dstSize)
+{
+    const uint8 *ip = src;
+    const uint8 *iend = src + srcSize;
+    uint8 *op = dst;
+    uint8 *oend = dst + dstSize;
+
+    auto ReadLength = [&](int32 &length) {
+        uint8 value;
+        do
+        {
+            if (ip >= iend)
+                return false;
+            value = *ip++;
+            length += value;
+        } while (value == 255);
+        return true;
+    };
+
+    while (ip < iend)
+    {
+        uint8 token = *ip++;
+
+        int32 literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(literalLength))
+            return false;
+        if (literalLength > iend - ip || literalLength > oend - op)
+            return false;
+        std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence carries literals only.
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        int32 offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst)
+            return false;
+
+        int32 matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > oend - op)
+            return false;
+
+        // Overlapping copies repeat the pattern, so go byte by byte.
+        const uint8 *match = op - offset;
+        for (int32 i = 0; i < matchLength; ++i)
+            op[i] = match[i];
+        op += matchLength;
+    }
+
+    return op == oend;
+}
+}
+}
+
+int32 Compression::CompressBound(CompressionMethod method, int32 size)
+{
+    switch (method)
+    {
+    case CompressionMethod::LZ4:
+        return size + size / 255 + 16;
+    default:
+        return size;
+    }
+}
+
+int32 Compression::Compress(CompressionMethod method, const uint8 *src, int32 srcSize, uint8 *dst, int32 dstCapacity)
+{
+    switch (method)
+    {
+    case CompressionMethod::LZ4:
+        return LZ4::Compress(src, srcSize, dst, dstCapacity);
+    default:
+        if (dstCapacity < srcSize)
+            return 0;
+        std::memcpy(dst, src, srcSize);
+        return srcSize;
+    }
+}
+
+bool Compression::Decompress(CompressionMethod method, const uint8 *src, int32 srcSize, uint8 *dst, int32 dstSize)
+{
+    switch (method)
+    {
+    case CompressionMethod::LZ4:
+        return LZ4::Decompress(src, srcSize, dst, dstSize);
+    default:
+        if (srcSize != dstSize)
+            return false;
+        std::memcpy(dst, src, srcSize);
+        return true;
+    }
+}
+
+Array<uint8> Compression::Compress(CompressionMethod method, const Array<uint8> &src)
+{
+    Array<uint8> dst;
+    dst.AddUninitialized(CompressBound(method, src.Count()));
+    int32 size = Compress(method, src.GetData(), src.Count(), dst.GetData(), dst.Count());
+    dst.SetCount(size);
+    return dst;
+}
+
+}
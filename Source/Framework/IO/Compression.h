@@ -0,0 +1,29 @@
+#pragma once
+
+#include "IO/.Package.h"
+
+namespace IO
+{
+
+enum class CompressionMethod : uint32
+{
+    None = 0,
+    // Raw LZ4 block format, no frame header.
+    LZ4 = 1,
+};
+
+class Compression
+{
+public:
+    static int32 CompressBound(CompressionMethod method, int32 size);
+
+    // Returns the compressed size, 0 if dst is too small.
+    static int32 Compress(CompressionMethod method, const uint8 *src, int32 srcSize, uint8 *dst, int32 dstCapacity);
+
+    // The decompressed size must be known up front, fails unless exactly dstSize bytes are produced.
+    static bool Decompress(CompressionMethod method, const uint8 *src, int32 srcSize, uint8 *dst, int32 dstSize);
+
+    static Array<uint8> Compress(CompressionMethod method, const Array<uint8> &src);
+};
+
+}
@@ -0,0 +1,100 @@
+#include "IO/CookCache.h"
+#include "IO/FileHandle.h"
+#include "IO/VirtualFileSystem.h"
+#include "Core/Math.h"
+
+namespace IO
+{
+
+uint64 CookCache::GetSourceKey(const String &sourcePath, uint64 hash)
+{
+    Hash::HashBytesCombine(hash, VirtualFileSystem::NormalizePath(FileHandle(sourcePath).GetAbsolutePath()));
+
+    // Packs can not change while mounted, their size stands in for the time.
+    uint64 size = 0;
+    int64 time = 0;
+    if (!VirtualFileSystem::GetFileSize(sourcePath, size))
+    {
+        size = FileSystem::GetFileSize(sourcePath);
+        time = FileSystem::GetLastModifiedTime(sourcePath);
+    }
+    Hash::HashBytesCombine(hash, size);
+    Hash::HashBytesCombine(hash, time);
+    return hash;
+}
+
+String CookCache::GetPath(const String &directory, uint64 key, const String &extension)
+{
+    static const char8 digits[] = "0123456789abcdef";
+    char8 name[17] = {};
+    for (int32 i = 0; i < 16; ++i)
+        name[i] = digits[(key >> ((15 - i) * 4)) & 0xF];
+    return directory + CT_TEXT("/") + String(name) + extension;
+}
+
+bool CookCache::Write(const String &path, const Array<Part> &parts)
+{
+    FileHandle file(path);
+    String directory = VirtualFileSystem::NormalizePath(file.GetParentPath());
+    if (!directory.IsEmpty() && !FileSystem::IsDirectory(directory) && !FileSystem::CreateDirectories(directory))
+    {
+        CT_LOG(Error, CT_TEXT("Create cache directory failed, path: {0}."), directory);
+        return false;
+    }
+
+    FileHandle tempFile(path + CT_TEXT(".tmp"));
+    {
+        FileOutputStream stream(tempFile.GetPath());
+        if (!stream.IsOpen())
+        {
+            CT_LOG(Error, CT_TEXT("Open cache file failed, path: {0}."), tempFile.GetPath());
+            return false;
+        }
+
+        static const uint8 zeros[256] = {};
+        bool written = true;
+        for (int32 i = 0; i < parts.Count() && written; ++i)
+        {
+            const auto &part = parts[i];
+            if (part.data)
+            {
+                written = stream.Write(part.data, static_cast<SizeType>(part.size)) == part.size;
+                continue;
+            }
+            for (uint64 left = part.size; left > 0 && written;)
+            {
+                SizeType count = static_cast<SizeType>(Math::Min(left, static_cast<uint64>(sizeof(zeros))));
+                written = stream.Write(zeros, count) == count;
+                left -= count;
+            }
+        }
+        stream.Close();
+
+        if (!written)
+        {
+            CT_LOG(Error, CT_TEXT("Write cache file failed, path: {0}."), tempFile.GetPath());
+            tempFile.Remove();
+            return false;
+        }
+    }
+
+    if (!tempFile.RenameTo(file))
+    {
+        CT_LOG(Error, CT_TEXT("Rename cache file failed, path: {0}."), path);
+        tempFile.Remove();
+        return false;
+    }
+    return true;
+}
+
+bool CookCache::Read(const String &path, Array<uint8> &bytes)
+{
+    FileHandle file(path);
+    if (!file.IsFile())
+        return false;
+
+    bytes = file.ReadBytes();
+    return !bytes.IsEmpty();
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "IO/FileStream.h"
+
+namespace IO
+{
+
+// Files derived from a source file, like cooked textures, scenes and fonts. A file is named by a key of the source and the
+// settings it was cooked with, so a changed source or setting simply finds no file.
+class CookCache
+{
+public:
+    struct Part
+    {
+        const void *data; // Nullptr writes zeros.
+        uint64 size;
+    };
+
+    // Chains the normalized path, size and modification time of the source onto hash, settings are hashed on top by the caller.
+    static uint64 GetSourceKey(const String &sourcePath, uint64 hash = Hash::BYTES_HASH_SEED);
+    // File of the key in directory, the key in hex followed by extension.
+    static String GetPath(const String &directory, uint64 key, const String &extension);
+
+    // Writes the parts back to back, creating the directory when needed. The file is written under another name first, so a reader
+    // never sees a partly written one.
+    static bool Write(const String &path, const Array<Part> &parts);
+    // Whole file, also when it is inside a mounted pack. False when there is none.
+    static bool Read(const String &path, Array<uint8> &bytes);
+};
+
+}
@@ -1,7 +1,13 @@
 #include "IO/FileHandle.h"
+#include "IO/VirtualFileSystem.h"
+#include "Core/Math.h"
+#include <cstring>
 
 uint64 IO::FileHandle::GetSize() const
 {
+    uint64 size = 0;
+    if (VirtualFileSystem::GetFileSize(pathStr, size))
+        return size;
     return FileSystem::GetFileSize(pathStr);
 }
 
@@ -104,7 +110,7 @@ Array<IO::FileHandle> IO::FileHandle::List(bool recursive) const
 
 bool IO::FileHandle::Exists() const
 {
-    return FileSystem::Exists(pathStr);
+    return VirtualFileSystem::IsMounted(pathStr) || FileSystem::Exists(pathStr);
 }
 
 bool IO::FileHandle::IsDirectory() const
@@ -114,7 +120,7 @@ bool IO::FileHandle::IsDirectory() const
 
 bool IO::FileHandle::IsFile() const
 {
-    return FileSystem::IsFile(pathStr);
+    return VirtualFileSystem::IsMounted(pathStr) || FileSystem::IsFile(pathStr);
 }
 
 bool IO::FileHandle::IsEmpty() const
@@ -159,16 +165,84 @@ IO::FileInputStream IO::FileHandle::Read() const
 
 Array<uint8> IO::FileHandle::ReadBytes() const
 {
+    Array<uint8> bytes;
+    if (VirtualFileSystem::ReadBytes(pathStr, bytes))
+        return bytes;
+
     FileInputStream stream = Read();
     return stream.ReadBytes();
 }
 
+Array<uint8> IO::FileHandle::ReadRange(uint64 offset, uint64 size) const
+{
+    // Packed entries may be compressed, so the whole entry is decoded and then sliced.
+    Array<uint8> bytes;
+    if (VirtualFileSystem::ReadBytes(pathStr, bytes))
+    {
+        int32 begin = static_cast<int32>(Math::Min(offset, static_cast<uint64>(bytes.Count())));
+        int32 count = static_cast<int32>(Math::Min(size, static_cast<uint64>(bytes.Count() - begin)));
+        bytes.SetCount(begin + count);
+        if (begin > 0)
+            bytes.RemoveAt(0, begin);
+        return bytes;
+    }
+
+    FileInputStream stream = Read();
+    if (!stream.IsOpen() || offset >= stream.Size())
+        return bytes;
+
+    bytes.AddUninitialized(static_cast<int32>(Math::Min(size, static_cast<uint64>(stream.Size() - offset))));
+    stream.Seek(static_cast<SizeType>(offset));
+    bytes.SetCount(static_cast<int32>(stream.Read(bytes.GetData(), bytes.Count())));
+    return bytes;
+}
+
 String IO::FileHandle::ReadString() const
 {
+    Array<uint8> bytes;
+    if (VirtualFileSystem::ReadBytes(pathStr, bytes))
+    {
+        Array<char8> chars;
+        chars.AddUninitialized(bytes.Count() + 1);
+        std::memcpy(chars.GetData(), bytes.GetData(), bytes.Count());
+        chars[bytes.Count()] = 0;
+        return StringEncode::UTF8::FromChars(chars);
+    }
+
     FileInputStream stream = Read();
     return stream.ReadString();
 }
 
+std::future<IO::AsyncReadResult> IO::FileHandle::ReadAsync(AsyncReadCallback callback) const
+{
+    std::future<AsyncReadResult> future;
+    if (VirtualFileSystem::ReadAsync(pathStr, callback, future))
+        return future;
+    return AsyncIOService::GetGlobal().Read(pathStr, 0, 0, std::move(callback));
+}
+
+std::future<IO::AsyncReadResult> IO::FileHandle::ReadRangeAsync(uint64 offset, uint64 size, AsyncReadCallback callback) const
+{
+    // Packed entries may be compressed, so the whole entry is decoded and then sliced.
+    std::future<AsyncReadResult> future;
+    auto slice = [offset, size, callback](AsyncReadResult &result) {
+        if (result.success)
+        {
+            int32 begin = static_cast<int32>(Math::Min(offset, static_cast<uint64>(result.bytes.Count())));
+            int32 count = size ? static_cast<int32>(Math::Min(size, static_cast<uint64>(result.bytes.Count() - begin))) : result.bytes.Count() - begin;
+            result.bytes.SetCount(begin + count);
+            if (begin > 0)
+                result.bytes.RemoveAt(0, begin);
+            result.offset = offset;
+        }
+        if (callback)
+            callback(result);
+    };
+    if (VirtualFileSystem::ReadAsync(pathStr, slice, future))
+        return future;
+    return AsyncIOService::GetGlobal().Read(pathStr, offset, size, std::move(callback));
+}
+
 IO::FileOutputStream IO::FileHandle::Write(bool append) const
 {
     if(append)
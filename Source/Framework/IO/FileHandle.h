@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IO/.Package.h"
+#include "IO/AsyncIO.h"
 #include "IO/FileStream.h"
 #include "IO/FileSystem.h"
 
@@ -61,7 +62,11 @@ public:
 
     FileInputStream Read() const;
     Array<uint8> ReadBytes() const;
+    // Shorter than size when the file ends first.
+    Array<uint8> ReadRange(uint64 offset, uint64 size) const;
     String ReadString() const;
+    std::future<AsyncReadResult> ReadAsync(AsyncReadCallback callback = nullptr) const;
+    std::future<AsyncReadResult> ReadRangeAsync(uint64 offset, uint64 size, AsyncReadCallback callback = nullptr) const;
     FileOutputStream Write(bool append = false) const;
     void WriteBytes(const Array<uint8> &bytes, bool append = false) const;
     void WriteString(const String &str, bool append = false) const;
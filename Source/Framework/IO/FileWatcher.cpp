@@ -1,63 +1,331 @@
 #include "IO/FileWatcher.h"
 #include "Core/Thread.h"
+#include <filesystem>
+
+#if CT_PLATFORM_LINUX
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 namespace IO
 {
 void FileWatcher::Start()
 {
     pathMap.Clear();
+    pendingChanges.Clear();
     running = true;
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        active = true;
+        activeThreadID = Thread::GetCurrentThreadID();
+    }
+
+    if (pollingOnly || !RunNative())
+        RunPolling();
+
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        active = false;
+    }
+    stateCond.notify_all();
+}
+
+void FileWatcher::Stop()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    running = false;
+
+#if CT_PLATFORM_LINUX
+    if (wakeHandle >= 0)
+    {
+        uint64 value = 1;
+        [[maybe_unused]] auto ret = write(wakeHandle, &value, sizeof(value));
+    }
+#endif
+    stateCond.notify_all();
+
+    // Once this returns the descriptors are closed and the watcher is not touched again, so it can be destroyed.
+    if (activeThreadID != Thread::GetCurrentThreadID())
+        stateCond.wait(lock, [this]() { return !active; });
+}
 
+void FileWatcher::RunPolling()
+{
     FileSystem::Iterate(
         watchPath, [this](const String &path) {
             pathMap.Put(path, FileSystem::GetLastModifiedTime(path));
         },
         recursive);
 
+    // Changes wait out the debounce like native events, flushing them does not move the next scan.
+    int64 nextScan = Time::MilliTime() + interval;
     while (running)
     {
-        Thread::SleepFor(interval);
-
-        Array<String> removedPaths;
-        for (const auto &entry : pathMap)
+        int64 now = Time::MilliTime();
+        if (now >= nextScan)
         {
-            if (!FileSystem::Exists(entry.Key()))
-            {
-                removedPaths.Add(entry.Key());
+            ScanChanges(now);
+            nextScan = now + interval;
+        }
+
+        int32 timeout = static_cast<int32>(nextScan - now);
+        int32 due = FlushChanges(now);
+        if (due >= 0)
+            timeout = Math::Min(timeout, due);
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateCond.wait_for(lock, Time::Milliseconds(timeout), [this]() { return !running; });
+    }
+
+    FlushChanges(Time::MilliTime(), true);
+}
+
+void FileWatcher::ScanChanges(int64 time)
+{
+    Array<String> removedPaths;
+    for (const auto &entry : pathMap)
+    {
+        if (!FileSystem::Exists(entry.Key()))
+            removedPaths.Add(entry.Key());
+    }
+    for (const auto &path : removedPaths)
+    {
+        pathMap.Remove(path);
+        QueueChange(path, FileStatus::Deleted, time);
+    }
 
-                handler(entry.Key(), FileStatus::Deleted);
+    FileSystem::Iterate(
+        watchPath, [this, time](const String &path) {
+            auto modified = FileSystem::GetLastModifiedTime(path);
+            auto known = pathMap.TryGet(path);
+            if (!known)
+            {
+                pathMap.Put(path, modified);
+                QueueChange(path, FileStatus::Created, time);
+            }
+            else if (*known != modified)
+            {
+                *known = modified;
+                QueueChange(path, FileStatus::Changed, time);
             }
+        },
+        recursive);
+}
+
+void FileWatcher::QueueChange(const String &path, FileStatus status, int64 time)
+{
+    auto pending = pendingChanges.TryGet(path);
+    if (!pending)
+    {
+        pendingChanges.Put(path, { status, time });
+        return;
+    }
+
+    // Collapse the sequence into what a late observer would see.
+    FileStatus merged = status;
+    if (pending->status == FileStatus::Created)
+    {
+        if (status == FileStatus::Deleted)
+        {
+            pendingChanges.Remove(path);
+            return;
+        }
+        merged = FileStatus::Created;
+    }
+    else if (pending->status == FileStatus::Deleted && status != FileStatus::Deleted)
+    {
+        merged = FileStatus::Changed;
+    }
+
+    pending->status = merged;
+    pending->time = time;
+}
+
+int32 FileWatcher::FlushChanges(int64 time, bool force)
+{
+    if (pendingChanges.IsEmpty())
+        return -1;
+
+    Array<String> duePaths;
+    int64 nextDue = -1;
+    for (const auto &entry : pendingChanges)
+    {
+        int64 due = entry.Value().time + debounce;
+        if (force || due <= time)
+        {
+            duePaths.Add(entry.Key());
         }
-        for (const auto &path : removedPaths)
+        else if (nextDue == -1 || due < nextDue)
         {
-            pathMap.Remove(path);
+            nextDue = due;
         }
+    }
+
+    for (const auto &path : duePaths)
+    {
+        FileStatus status = pendingChanges.Get(path).status;
+        pendingChanges.Remove(path);
+        handler(path, status);
+    }
+
+    return nextDue == -1 ? -1 : static_cast<int32>(nextDue - time);
+}
+
+#if CT_PLATFORM_LINUX
+bool FileWatcher::RunNative()
+{
+    if (!FileSystem::IsDirectory(watchPath))
+        return false;
+
+    int notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyFd < 0)
+        return false;
+
+    int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0)
+    {
+        close(notifyFd);
+        return false;
+    }
+
+    constexpr uint32 WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
 
+    HashMap<int32, String> watches;
+    bool watchesFull = false;
+    auto AddWatch = [&](const String &dir) {
+        int wd = inotify_add_watch(notifyFd, std::filesystem::path(*dir).c_str(), WATCH_MASK);
+        if (wd >= 0)
+            watches.Put(wd, dir.EndsWith(CT_TEXT("/")) ? dir.Substring(0, dir.Length() - 1) : dir);
+        else if (errno == ENOSPC)
+            watchesFull = true;
+    };
+    // Directories that show up later may already hold entries before their watch is in place.
+    auto AddTree = [&](const String &dir, bool reportEntries, int64 time) {
+        AddWatch(dir);
         FileSystem::Iterate(
-            watchPath, [this](const String &path) {
-                auto time = FileSystem::GetLastModifiedTime(path);
-                if (!pathMap.Contains(path))
-                {
-                    pathMap.Put(path, time);
+            dir, [&](const String &path) {
+                if (recursive && FileSystem::IsDirectory(path))
+                    AddWatch(path);
+                pathMap.Put(path, 0);
+                if (reportEntries)
+                    QueueChange(path, FileStatus::Created, time);
+            },
+            recursive);
+    };
+    // Which events were dropped is unknown, so every path in the trees is reported as changed and known paths that are gone as deleted.
+    auto Rescan = [&](int64 time) {
+        HashMap<String, int64> known = std::move(pathMap);
+        pathMap.Clear();
+        AddWatch(watchPath);
+        FileSystem::Iterate(
+            watchPath, [&](const String &path) {
+                if (recursive && FileSystem::IsDirectory(path))
+                    AddWatch(path);
+                pathMap.Put(path, 0);
+                QueueChange(path, known.Contains(path) ? FileStatus::Changed : FileStatus::Created, time);
+            },
+            recursive);
+        for (const auto &entry : known)
+        {
+            if (!pathMap.Contains(entry.Key()))
+                QueueChange(entry.Key(), FileStatus::Deleted, time);
+        }
+    };
+
+    AddTree(watchPath, false, 0);
+    if (watches.IsEmpty() || watchesFull)
+    {
+        CT_LOG(Warning, CT_TEXT("Cannot watch {0} with inotify, fall back to polling."), watchPath);
+        close(wakeFd);
+        close(notifyFd);
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        wakeHandle = wakeFd;
+    }
 
-                    handler(path, FileStatus::Created);
+    alignas(inotify_event) char8 buffer[64 * 1024];
+    while (running)
+    {
+        int32 timeout = FlushChanges(Time::MilliTime());
+
+        pollfd fds[2] = { { notifyFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+        int ret = poll(fds, 2, timeout);
+        if (ret < 0 && errno != EINTR)
+            break;
+        if (!running || (fds[1].revents & POLLIN))
+            break;
+        if (ret <= 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+        int64 now = Time::MilliTime();
+        while (true)
+        {
+            auto length = read(notifyFd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+
+            for (char8 *ptr = buffer; ptr < buffer + length;)
+            {
+                const auto *event = reinterpret_cast<const inotify_event *>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    CT_LOG(Warning, CT_TEXT("File watcher event queue overflowed, rescanning {0}."), watchPath);
+                    Rescan(now);
+                    continue;
                 }
-                else
+                if (event->mask & IN_IGNORED)
                 {
-                    if (pathMap.Get(path) != time)
-                    {
-                        pathMap.Put(path, time);
+                    watches.Remove(event->wd);
+                    continue;
+                }
+
+                auto dir = watches.TryGet(event->wd);
+                if (!dir || event->len == 0)
+                    continue;
+                String path = *dir + CT_TEXT("/") + String(event->name);
 
-                        handler(path, FileStatus::Changed);
-                    }
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    pathMap.Put(path, 0);
+                    QueueChange(path, FileStatus::Created, now);
+                    if ((event->mask & IN_ISDIR) && recursive)
+                        AddTree(path, true, now);
                 }
-            },
-            recursive);
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    pathMap.Remove(path);
+                    QueueChange(path, FileStatus::Deleted, now);
+                }
+                else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB))
+                {
+                    QueueChange(path, FileStatus::Changed, now);
+                }
+            }
+        }
     }
-}
 
-void FileWatcher::Stop()
+    FlushChanges(Time::MilliTime(), true);
+
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        wakeHandle = -1;
+    }
+    close(wakeFd);
+    close(notifyFd);
+    return true;
+}
+#else
+bool FileWatcher::RunNative()
 {
-    running = false;
+    return false;
+}
+#endif
 }
-}
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "Core/HashMap.h"
 #include "Core/Time.h"
 #include "IO/FileSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace IO
 {
@@ -20,14 +23,19 @@ public:
     using FileStatusHandler = std::function<void(const String &, FileStatus)>;
 
 public:
-    FileWatcher(const String &watchPath, FileStatusHandler handler, int32 interval = 1000, bool recursive = true)
-        : watchPath(watchPath), handler(handler), interval(interval), recursive(recursive)
+    // Changes of one path that arrive within debounce ms are coalesced into one notification.
+    FileWatcher(const String &watchPath, FileStatusHandler handler, int32 interval = 1000, bool recursive = true, int32 debounce = 50)
+        : handler(handler), interval(interval), debounce(debounce), watchPath(watchPath), recursive(recursive)
     {
         if (interval <= 0)
         {
             CT_LOG(Warning, "Watch interval must > 0.");
             this->interval = 1000;
         }
+        if (debounce < 0)
+        {
+            this->debounce = 0;
+        }
     }
 
     ~FileWatcher()
@@ -40,16 +48,48 @@ public:
     FileWatcher &operator=(FileWatcher &&) = delete;
     FileWatcher &operator=(const FileWatcher &) = delete;
 
+    // Blocks until Stop() is called from another thread. Uses native change events when the
+    // platform has them, otherwise polls the tree every interval ms.
     void Start();
+    // Waits for Start() to return, unless called from a handler.
     void Stop();
 
+    void SetPollingOnly(bool value)
+    {
+        pollingOnly = value;
+    }
+
+private:
+    struct PendingChange
+    {
+        FileStatus status;
+        int64 time;
+    };
+
+    bool RunNative();
+    void RunPolling();
+    void ScanChanges(int64 time);
+    void QueueChange(const String &path, FileStatus status, int64 time);
+    // Returns ms until the next pending change is due, -1 if nothing is pending.
+    int32 FlushChanges(int64 time, bool force = false);
+
 private:
+    // Paths known to exist, with their modification time when polling.
     HashMap<String, int64> pathMap;
+    HashMap<String, PendingChange> pendingChanges;
     FileStatusHandler handler;
     int32 interval;
+    int32 debounce;
     String watchPath;
     bool recursive = true;
-    bool running = false;
+    bool pollingOnly = false;
+    std::atomic_bool running = false;
+    // Guards the wake handle and whether Start() is running, Stop() waits on it.
+    std::mutex stateMutex;
+    std::condition_variable stateCond;
+    bool active = false;
+    uint32 activeThreadID = 0;
+    int32 wakeHandle = -1;
 };
 
-}
\ No newline at end of file
+}
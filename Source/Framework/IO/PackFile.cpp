@@ -0,0 +1,318 @@
+#include "IO/PackFile.h"
+#include "IO/FileSystem.h"
+#include "Core/Math.h"
+#include <cstring>
+
+namespace IO
+{
+
+namespace
+{
+Array<uint8> ToEntryName(const String &path)
+{
+    String name = path.ReplaceAll(CT_TEXT('\\'), CT_TEXT('/'));
+    while (name.StartsWith(CT_TEXT("/")))
+        name = name.Substring(1);
+    return StringEncode::UTF8::ToBytes(name);
+}
+
+bool ReadExact(FileInputStream &stream, void *dst, uint64 size)
+{
+    return stream.Read(dst, static_cast<SizeType>(size)) == size;
+}
+}
+
+PackFile::PackFile(const String &path)
+    : pathStr(path)
+{
+}
+
+uint64 PackFile::HashPath(const Array<uint8> &utf8Path)
+{
+    // Collisions are still resolved by comparing names.
+    return Hash::HashBytes(utf8Path.GetData(), utf8Path.Count());
+}
+
+SPtr<PackFile> PackFile::Open(const String &path)
+{
+    auto pack = Memory::MakeShared<PackFile>(path);
+    if (!pack->Load())
+        return nullptr;
+    return pack;
+}
+
+bool PackFile::Load()
+{
+    stream = Memory::MakeUnique<FileInputStream>(pathStr);
+    if (!stream->IsOpen())
+    {
+        CT_LOG(Error, CT_TEXT("Open pack file failed. Path: {0}."), pathStr);
+        return false;
+    }
+
+    PackHeader header;
+    if (!ReadExact(*stream, &header, sizeof(header)) || header.magic != PackHeader::MAGIC || header.version != PackHeader::VERSION)
+    {
+        CT_LOG(Error, CT_TEXT("Invalid pack file header. Path: {0}."), pathStr);
+        return false;
+    }
+
+    uint64 fileSize = stream->Size();
+    uint64 tocSize = sizeof(PackEntry) * static_cast<uint64>(header.entryCount);
+    if (header.entryCount > INT32_MAX || header.namesSize > INT32_MAX || sizeof(header) + tocSize + header.namesSize > fileSize)
+    {
+        CT_LOG(Error, CT_TEXT("Truncated pack file. Path: {0}."), pathStr);
+        return false;
+    }
+
+    entries.AddUninitialized(static_cast<int32>(header.entryCount));
+    names.AddUninitialized(static_cast<int32>(header.namesSize));
+    if (!ReadExact(*stream, entries.GetData(), tocSize) || !ReadExact(*stream, names.GetData(), header.namesSize))
+    {
+        CT_LOG(Error, CT_TEXT("Read pack file table of contents failed. Path: {0}."), pathStr);
+        return false;
+    }
+
+    // Every entry is checked, so a damaged pack fails to mount instead of reading past its end later.
+    uint64 dataBegin = sizeof(header) + tocSize + header.namesSize;
+    for (int32 i = 0; i < entries.Count(); ++i)
+    {
+        const auto &entry = entries[i];
+        bool valid = entry.nameOffset <= header.namesSize && entry.nameSize <= header.namesSize - entry.nameOffset;
+        valid = valid && entry.offset >= dataBegin && entry.offset <= fileSize && entry.storedSize <= fileSize - entry.offset;
+        valid = valid && entry.storedSize <= INT32_MAX && entry.size <= INT32_MAX;
+        valid = valid && (entry.compression == CompressionMethod::LZ4 || (entry.compression == CompressionMethod::None && entry.storedSize == entry.size));
+        // Find does a binary search over the hashes.
+        valid = valid && (i == 0 || entries[i - 1].pathHash <= entry.pathHash);
+        if (!valid)
+        {
+            CT_LOG(Error, CT_TEXT("Invalid pack file entry {0}. Path: {1}."), i, pathStr);
+            entries.Clear();
+            names.Clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+String PackFile::GetEntryName(const PackEntry &entry) const
+{
+    Array<char8> chars;
+    chars.AddUninitialized(static_cast<int32>(entry.nameSize) + 1);
+    std::memcpy(chars.GetData(), names.GetData() + entry.nameOffset, entry.nameSize);
+    chars[entry.nameSize] = 0;
+    return StringEncode::UTF8::FromChars(chars);
+}
+
+const PackEntry *PackFile::Find(const String &entryPath) const
+{
+    auto name = ToEntryName(entryPath);
+    uint64 hash = HashPath(name);
+
+    int32 lo = 0;
+    int32 hi = entries.Count();
+    while (lo < hi)
+    {
+        int32 mid = lo + (hi - lo) / 2;
+        if (entries[mid].pathHash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < entries.Count() && entries[lo].pathHash == hash; ++lo)
+    {
+        const auto &entry = entries[lo];
+        if (entry.nameSize == static_cast<uint32>(name.Count()) && std::memcmp(names.GetData() + entry.nameOffset, name.GetData(), name.Count()) == 0)
+            return &entry;
+    }
+    return nullptr;
+}
+
+bool PackFile::Decode(const PackEntry &entry, Array<uint8> &bytes)
+{
+    if (bytes.Count() != static_cast<int32>(entry.storedSize))
+        return false;
+    if (entry.compression == CompressionMethod::None)
+        return true;
+
+    Array<uint8> decoded;
+    decoded.AddUninitialized(static_cast<int32>(entry.size));
+    if (!Compression::Decompress(entry.compression, bytes.GetData(), bytes.Count(), decoded.GetData(), decoded.Count()))
+        return false;
+    bytes = std::move(decoded);
+    return true;
+}
+
+Array<uint8> PackFile::ReadBytes(const PackEntry &entry) const
+{
+    Array<uint8> bytes;
+    bytes.AddUninitialized(static_cast<int32>(entry.storedSize));
+    {
+        std::unique_lock<std::mutex> lock(streamMutex);
+        stream->Seek(static_cast<SizeType>(entry.offset));
+        if (!ReadExact(*stream, bytes.GetData(), entry.storedSize))
+            bytes.Clear();
+    }
+
+    if (!Decode(entry, bytes))
+    {
+        CT_LOG(Error, CT_TEXT("Read pack entry {0} failed. Path: {1}."), GetEntryName(entry), pathStr);
+        bytes.Clear();
+    }
+    return bytes;
+}
+
+std::future<AsyncReadResult> PackFile::ReadAsync(const PackEntry &entry, const String &entryPath, AsyncReadCallback callback) const
+{
+    PackEntry copied = entry;
+    return AsyncIOService::GetGlobal().Read(pathStr, entry.offset, entry.storedSize, [copied, entryPath, callback](AsyncReadResult &result) {
+        result.path = entryPath;
+        result.offset = 0;
+        if (result.success && !Decode(copied, result.bytes))
+        {
+            CT_LOG(Error, CT_TEXT("Decode pack entry {0} failed."), entryPath);
+            result.success = false;
+        }
+        if (callback)
+            callback(result);
+    });
+}
+
+//===============================================================================
+bool PackFileBuilder::AddFile(const String &entryPath, const String &sourcePath, CompressionMethod compression)
+{
+    if (!FileSystem::IsFile(sourcePath))
+    {
+        CT_LOG(Error, CT_TEXT("Add file to pack failed, not a file. Path: {0}."), sourcePath);
+        return false;
+    }
+
+    Source source;
+    source.name = ToEntryName(entryPath);
+    source.pathHash = PackFile::HashPath(source.name);
+    source.sourcePath = sourcePath;
+    source.compression = compression;
+
+    sources.Add(std::move(source));
+    return true;
+}
+
+int32 PackFileBuilder::AddDirectory(const String &directory, CompressionMethod compression)
+{
+    String root = directory.ReplaceAll(CT_TEXT('\\'), CT_TEXT('/'));
+    if (!root.EndsWith(CT_TEXT("/")))
+        root += CT_TEXT('/');
+
+    int32 count = 0;
+    FileSystem::Iterate(
+        directory, [&](const String &path) {
+            if (!FileSystem::IsFile(path))
+                return;
+            String normalized = path.ReplaceAll(CT_TEXT('\\'), CT_TEXT('/'));
+            if (normalized.StartsWith(root) && AddFile(normalized.Substring(root.Length()), path, compression))
+                ++count;
+        },
+        true);
+    return count;
+}
+
+bool PackFileBuilder::Write(const String &outputPath) const
+{
+    Array<int32> order;
+    for (int32 i = 0; i < sources.Count(); ++i)
+        order.Add(i);
+    order.Sort([this](int32 a, int32 b) {
+        return sources[a].pathHash != sources[b].pathHash ? sources[a].pathHash < sources[b].pathHash : a < b;
+    });
+
+    // Keep the first of duplicated entries, equal names always end up next to each other.
+    Array<int32> unique;
+    for (int32 i : order)
+    {
+        const auto &source = sources[i];
+        bool duplicated = false;
+        for (int32 j = unique.Count() - 1; j >= 0 && sources[unique[j]].pathHash == source.pathHash; --j)
+        {
+            if (sources[unique[j]].name == source.name)
+                duplicated = true;
+        }
+        if (duplicated)
+            CT_LOG(Warning, CT_TEXT("Duplicated pack entry, ignored. Source: {0}."), source.sourcePath);
+        else
+            unique.Add(i);
+    }
+    order = std::move(unique);
+
+    PackHeader header;
+    header.entryCount = order.Count();
+    header.alignment = Math::Max(alignment, 1u);
+
+    Array<PackEntry> entries;
+    Array<uint8> names;
+    for (int32 i : order)
+    {
+        PackEntry entry;
+        entry.pathHash = sources[i].pathHash;
+        entry.nameOffset = names.Count();
+        entry.nameSize = sources[i].name.Count();
+        names.AddUninitialized(entry.nameSize);
+        std::memcpy(names.GetData() + entry.nameOffset, sources[i].name.GetData(), entry.nameSize);
+        entries.Add(entry);
+    }
+    header.namesSize = names.Count();
+
+    FileOutputStream stream(outputPath);
+    if (!stream.IsOpen())
+    {
+        CT_LOG(Error, CT_TEXT("Create pack file failed. Path: {0}."), outputPath);
+        return false;
+    }
+
+    // Table of contents is rewritten once every blob offset is known.
+    uint64 offset = sizeof(PackHeader) + sizeof(PackEntry) * static_cast<uint64>(entries.Count()) + names.Count();
+    stream.Write(&header, sizeof(header));
+    stream.Write(entries.GetData(), sizeof(PackEntry) * entries.Count());
+    stream.Write(names.GetData(), names.Count());
+
+    Array<uint8> zeros;
+    zeros.SetCount(header.alignment);
+
+    for (int32 i = 0; i < order.Count(); ++i)
+    {
+        const auto &source = sources[order[i]];
+        auto &entry = entries[i];
+
+        uint64 alignedOffset = CT_ALIGN(offset, static_cast<uint64>(header.alignment));
+        stream.Write(zeros.GetData(), static_cast<SizeType>(alignedOffset - offset));
+        offset = alignedOffset;
+
+        FileInputStream input(source.sourcePath);
+        Array<uint8> bytes = input.ReadBytes();
+        entry.offset = offset;
+        entry.size = bytes.Count();
+
+        if (source.compression != CompressionMethod::None)
+        {
+            auto compressed = Compression::Compress(source.compression, bytes);
+            // Not worth a decode step when it barely shrinks.
+            if (compressed.Count() > 0 && compressed.Count() < bytes.Count() - bytes.Count() / 16)
+            {
+                bytes = std::move(compressed);
+                entry.compression = source.compression;
+            }
+        }
+
+        entry.storedSize = bytes.Count();
+        stream.Write(bytes.GetData(), bytes.Count());
+        offset += entry.storedSize;
+    }
+
+    stream.Seek(sizeof(PackHeader));
+    stream.Write(entries.GetData(), sizeof(PackEntry) * entries.Count());
+    stream.Close();
+    return true;
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "IO/AsyncIO.h"
+#include "IO/Compression.h"
+#include "IO/FileStream.h"
+
+namespace IO
+{
+
+/**
+ * Layout: PackHeader | PackEntry[entryCount] sorted by pathHash | UTF-8 names | aligned blobs.
+ * Entry paths are relative to the packed root and always use '/' separators.
+ */
+struct PackHeader
+{
+    static constexpr uint32 MAGIC = 0x4B505443; // "CTPK"
+    static constexpr uint32 VERSION = 1;
+
+    uint32 magic = MAGIC;
+    uint32 version = VERSION;
+    uint32 entryCount = 0;
+    uint32 alignment = 0;
+    uint64 namesSize = 0;
+    uint64 reserved = 0;
+};
+
+struct PackEntry
+{
+    uint64 pathHash = 0;
+    uint64 offset = 0;
+    uint64 storedSize = 0;
+    uint64 size = 0;
+    uint32 nameOffset = 0;
+    uint32 nameSize = 0;
+    CompressionMethod compression = CompressionMethod::None;
+    uint32 reserved = 0;
+};
+
+static_assert(sizeof(PackHeader) == 32 && sizeof(PackEntry) == 48, "Pack layout must stay stable.");
+
+class PackFile
+{
+public:
+    explicit PackFile(const String &path);
+
+    const String &GetPath() const
+    {
+        return pathStr;
+    }
+
+    int32 GetEntryCount() const
+    {
+        return entries.Count();
+    }
+
+    const PackEntry &GetEntry(int32 index) const
+    {
+        return entries[index];
+    }
+
+    String GetEntryName(const PackEntry &entry) const;
+    const PackEntry *Find(const String &entryPath) const;
+    Array<uint8> ReadBytes(const PackEntry &entry) const;
+    std::future<AsyncReadResult> ReadAsync(const PackEntry &entry, const String &entryPath, AsyncReadCallback callback = nullptr) const;
+
+    static uint64 HashPath(const Array<uint8> &utf8Path);
+    static bool Decode(const PackEntry &entry, Array<uint8> &bytes);
+    static SPtr<PackFile> Open(const String &path);
+
+private:
+    bool Load();
+
+private:
+    String pathStr;
+    Array<PackEntry> entries;
+    Array<uint8> names;
+    mutable UPtr<FileInputStream> stream;
+    mutable std::mutex streamMutex;
+};
+
+class PackFileBuilder
+{
+public:
+    void SetAlignment(uint32 value)
+    {
+        alignment = value;
+    }
+
+    bool AddFile(const String &entryPath, const String &sourcePath, CompressionMethod compression = CompressionMethod::None);
+    // Adds every file below directory, entry paths are relative to it. Returns the number of files added.
+    int32 AddDirectory(const String &directory, CompressionMethod compression = CompressionMethod::None);
+    bool Write(const String &outputPath) const;
+
+private:
+    struct Source
+    {
+        Array<uint8> name;
+        String sourcePath;
+        uint64 pathHash;
+        CompressionMethod compression;
+    };
+
+    Array<Source> sources;
+    uint32 alignment = 64;
+};
+
+}
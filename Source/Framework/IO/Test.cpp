@@ -64,6 +64,58 @@ void IO::TestFileStream()
     // ostream.WriteBytes(arr);
 }
 
+void IO::TestAsyncIO()
+{
+    auto &service = AsyncIOService::GetGlobal();
+    CT_LOG(Info, CT_TEXT("Async io backend: {0}"), service.GetBackendName());
+
+    FileHandle file(CT_TEXT("E:/dog.tree"));
+    auto whole = file.ReadAsync([](AsyncReadResult &result) {
+        CT_LOG(Info, CT_TEXT("Callback of {0}, success:{1}, size:{2}"), result.path, result.success, result.bytes.Count());
+    });
+    auto range = file.ReadRangeAsync(4, 16);
+
+    auto wholeResult = whole.get();
+    auto rangeResult = range.get();
+    CT_LOG(Info, CT_TEXT("Whole read size:{0}, range read size:{1}"), wholeResult.bytes.Count(), rangeResult.bytes.Count());
+
+    Array<AsyncIOService::ReadDesc> descs;
+    for (int32 i = 0; i < 64; ++i)
+    {
+        descs.Add({ file.GetPath(), static_cast<uint64>(i), 1 });
+    }
+    auto futures = service.ReadBatch(std::move(descs));
+    service.WaitIdle();
+    for (int32 i = 0; i < futures.Count(); ++i)
+    {
+        auto result = futures[i].get();
+        if (!result.success || result.bytes[0] != wholeResult.bytes[i])
+        {
+            CT_LOG(Error, CT_TEXT("Batch read mismatch at offset {0}."), i);
+        }
+    }
+}
+
+void IO::TestPackFile()
+{
+    PackFileBuilder builder;
+    int32 count = builder.AddDirectory(CT_TEXT("E:/Watcher"), CompressionMethod::LZ4);
+    builder.Write(CT_TEXT("E:/watcher.pak"));
+    CT_LOG(Info, CT_TEXT("Packed {0} files."), count);
+
+    VirtualFileSystem::Mount(CT_TEXT("E:/watcher.pak"), CT_TEXT("Packed"));
+    FileHandle packed(CT_TEXT("Packed/dog.tree"));
+    FileHandle loose(CT_TEXT("E:/Watcher/dog.tree"));
+    CT_LOG(Info, CT_TEXT("{0} is file? {1}, same content? {2}"), packed, packed.IsFile(), packed.ReadBytes() == loose.ReadBytes());
+    VirtualFileSystem::UnmountAll();
+
+    // Blobs cut off at the end leave entries pointing past the file.
+    auto bytes = FileHandle(CT_TEXT("E:/watcher.pak")).ReadBytes();
+    bytes.SetCount(bytes.Count() - 1);
+    FileHandle(CT_TEXT("E:/truncated.pak")).WriteBytes(bytes);
+    CT_LOG(Info, CT_TEXT("Truncated pack mounts? {0}"), VirtualFileSystem::Mount(CT_TEXT("E:/truncated.pak")));
+}
+
 void IO::Test()
 {
     //TestFileHandle();
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "IO/AsyncIO.h"
 #include "IO/FileHandle.h"
 #include "IO/FileStream.h"
 #include "IO/FileSystem.h"
+#include "IO/VirtualFileSystem.h"
 
 namespace IO
 {
@@ -13,6 +15,10 @@ void TestFileSystem();
 
 void TestFileStream();
 
+void TestAsyncIO();
+
+void TestPackFile();
+
 void Test();
 
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "IO/VirtualFileSystem.h"
+
+namespace IO
+{
+
+String VirtualFileSystem::NormalizePath(const String &path)
+{
+    String formatted = path.ReplaceAll(CT_TEXT('\\'), CT_TEXT('/'));
+    bool absolute = formatted.StartsWith(CT_TEXT("/"));
+
+    Array<String> parts;
+    int32 start = 0;
+    for (int32 i = 0; i <= formatted.Length(); ++i)
+    {
+        if (i < formatted.Length() && formatted[i] != CT_TEXT('/'))
+            continue;
+
+        String part = formatted.Substring(start, i - start);
+        start = i + 1;
+        if (part.IsEmpty() || part == CT_TEXT("."))
+            continue;
+        if (part == CT_TEXT("..") && !parts.IsEmpty() && parts.Last() != CT_TEXT(".."))
+            parts.RemoveLast();
+        else
+            parts.Add(part);
+    }
+
+    String result = absolute ? String(CT_TEXT("/")) : String();
+    for (int32 i = 0; i < parts.Count(); ++i)
+    {
+        if (i > 0)
+            result += CT_TEXT('/');
+        result += parts[i];
+    }
+    return result;
+}
+
+bool VirtualFileSystem::Mount(const String &packPath, const String &mountPoint)
+{
+    auto pack = PackFile::Open(packPath);
+    if (!pack)
+        return false;
+    return Mount(pack, mountPoint);
+}
+
+bool VirtualFileSystem::Mount(const SPtr<PackFile> &pack, const String &mountPoint)
+{
+    if (!pack)
+        return false;
+
+    String prefix = NormalizePath(mountPoint);
+    if (!prefix.IsEmpty())
+        prefix += CT_TEXT('/');
+
+    std::unique_lock<std::shared_mutex> lock(mountsMutex);
+    mounts.Add({ pack, prefix });
+    CT_LOG(Info, CT_TEXT("Mount pack {0} with {1} entries at \"{2}\"."), pack->GetPath(), pack->GetEntryCount(), prefix);
+    return true;
+}
+
+void VirtualFileSystem::Unmount(const String &packPath)
+{
+    std::unique_lock<std::shared_mutex> lock(mountsMutex);
+    for (int32 i = mounts.Count() - 1; i >= 0; --i)
+    {
+        if (mounts[i].pack->GetPath() == packPath)
+            mounts.RemoveAt(i);
+    }
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+    std::unique_lock<std::shared_mutex> lock(mountsMutex);
+    mounts.Clear();
+}
+
+const PackEntry *VirtualFileSystem::Resolve(const String &path, SPtr<PackFile> &pack)
+{
+    std::shared_lock<std::shared_mutex> lock(mountsMutex);
+    if (mounts.IsEmpty())
+        return nullptr;
+
+    String normalized = NormalizePath(path);
+    for (int32 i = mounts.Count() - 1; i >= 0; --i)
+    {
+        const auto &mount = mounts[i];
+        if (!normalized.StartsWith(mount.prefix))
+            continue;
+
+        auto entry = mount.pack->Find(normalized.Substring(mount.prefix.Length()));
+        if (entry)
+        {
+            pack = mount.pack;
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool VirtualFileSystem::IsMounted(const String &path)
+{
+    SPtr<PackFile> pack;
+    return Resolve(path, pack) != nullptr;
+}
+
+bool VirtualFileSystem::GetFileSize(const String &path, uint64 &size)
+{
+    SPtr<PackFile> pack;
+    auto entry = Resolve(path, pack);
+    if (!entry)
+        return false;
+    size = entry->size;
+    return true;
+}
+
+bool VirtualFileSystem::ReadBytes(const String &path, Array<uint8> &bytes)
+{
+    SPtr<PackFile> pack;
+    auto entry = Resolve(path, pack);
+    if (!entry)
+        return false;
+    bytes = pack->ReadBytes(*entry);
+    return true;
+}
+
+bool VirtualFileSystem::ReadAsync(const String &path, AsyncReadCallback callback, std::future<AsyncReadResult> &future)
+{
+    SPtr<PackFile> pack;
+    auto entry = Resolve(path, pack);
+    if (!entry)
+        return false;
+    // The callback holds the pack so an unmount cannot close it mid-read.
+    future = pack->ReadAsync(*entry, path, [pack, callback](AsyncReadResult &result) {
+        if (callback)
+            callback(result);
+    });
+    return true;
+}
+
+}
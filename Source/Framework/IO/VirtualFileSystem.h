@@ -0,0 +1,42 @@
+#pragma once
+
+#include "IO/PackFile.h"
+#include <shared_mutex>
+
+namespace IO
+{
+
+// Routes reads of mounted paths into pack files. Packs mounted later shadow earlier ones,
+// paths not covered by any pack fall through to the native file system.
+class VirtualFileSystem
+{
+public:
+    // Entries of the pack become visible as mountPoint/entryPath, an empty mount point maps them to the working directory.
+    static bool Mount(const String &packPath, const String &mountPoint = String());
+    static bool Mount(const SPtr<PackFile> &pack, const String &mountPoint = String());
+    static void Unmount(const String &packPath);
+    static void UnmountAll();
+
+    static bool IsMounted(const String &path);
+    static bool GetFileSize(const String &path, uint64 &size);
+    static bool ReadBytes(const String &path, Array<uint8> &bytes);
+    // Returns false when path is not in any pack, the caller should read from disk then.
+    static bool ReadAsync(const String &path, AsyncReadCallback callback, std::future<AsyncReadResult> &future);
+
+    // Collapses '.', '..' and duplicated separators, always uses '/'.
+    static String NormalizePath(const String &path);
+
+private:
+    struct MountPoint
+    {
+        SPtr<PackFile> pack;
+        String prefix;
+    };
+
+    static const PackEntry *Resolve(const String &path, SPtr<PackFile> &pack);
+
+    inline static Array<MountPoint> mounts;
+    inline static std::shared_mutex mountsMutex;
+};
+
+}
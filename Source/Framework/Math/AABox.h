@@ -110,7 +110,7 @@ public:
         return result.Merge(rhs);
     }
 
-    bool operator=(const AABox &other) const
+    bool operator==(const AABox &other) const
     {
         return min == other.min && max == other.max;
     }
@@ -0,0 +1,469 @@
+#include "Math/BVH.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Traversal stacks are fixed size, the build falls back to median splits below MAX_SAH_DEPTH to bound the depth.
+constexpr int32 STACK_SIZE = 128;
+constexpr int32 MAX_SAH_DEPTH = 64;
+
+struct BuildTask
+{
+    int32 node;
+    int32 begin;
+    int32 end;
+    int32 depth;
+};
+
+// Items are partitioned by value rather than through an index, so every pass reads memory in order.
+struct BuildItem
+{
+    AABox box;
+    Vector3 center;
+    int32 index;
+};
+
+struct Bin
+{
+    AABox bounds{ Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+    int32 count = 0;
+};
+
+const AABox EMPTY_BOX(Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+
+CT_INLINE float HalfArea(const AABox &box)
+{
+    Vector3 size = box.max - box.min;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+CT_INLINE float Axis(const Vector3 &v, int32 axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Distance at which the ray enters the box, FLT_MAX if it misses or enters beyond maxDistance.
+CT_INLINE float IntersectRay(const AABox &box, const Vector3 &origin, const Vector3 &invDir, float maxDistance)
+{
+    float t0 = (box.min.x - origin.x) * invDir.x;
+    float t1 = (box.max.x - origin.x) * invDir.x;
+    float tMin = Math::Min(t0, t1), tMax = Math::Max(t0, t1);
+
+    t0 = (box.min.y - origin.y) * invDir.y;
+    t1 = (box.max.y - origin.y) * invDir.y;
+    tMin = Math::Max(tMin, Math::Min(t0, t1));
+    tMax = Math::Min(tMax, Math::Max(t0, t1));
+
+    t0 = (box.min.z - origin.z) * invDir.z;
+    t1 = (box.max.z - origin.z) * invDir.z;
+    tMin = Math::Max(tMin, Math::Min(t0, t1));
+    tMax = Math::Min(tMax, Math::Max(t0, t1));
+
+    tMin = Math::Max(tMin, 0.0f);
+    return tMin <= tMax && tMin <= maxDistance ? tMin : FLT_MAX;
+}
+
+CT_INLINE bool Overlaps(const AABox &a, const AABox &b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+}
+
+void BVH::Clear()
+{
+    nodes.Clear();
+    items.Clear();
+    itemBoxes.SetCount(0);
+    itemSlots.Clear();
+    itemLeaves.Clear();
+    parents.Clear();
+    nodeItemCounts.Clear();
+    nodeStamps.Clear();
+}
+
+void BVH::Build(const Batch::AABoxSoA &boxes)
+{
+    Clear();
+    int32 count = boxes.Count();
+    if (count == 0)
+        return;
+
+    Array<BuildItem> buildItems;
+    buildItems.Reserve(count);
+    for (int32 i = 0; i < count; ++i)
+    {
+        AABox box = boxes.Get(i);
+        buildItems.Add({ box, box.GetCenter(), i });
+    }
+
+    nodes.Reserve(count * 2);
+    parents.Reserve(count * 2);
+    nodes.Add(Node());
+    parents.Add(-1);
+
+    Array<BuildTask> tasks;
+    tasks.Add({ 0, 0, count, 0 });
+    while (!tasks.IsEmpty())
+    {
+        BuildTask task = tasks.Last();
+        tasks.RemoveLast();
+
+        AABox nodeBounds = EMPTY_BOX, centerBounds = EMPTY_BOX;
+        for (int32 i = task.begin; i < task.end; ++i)
+        {
+            const auto &item = buildItems[i];
+            nodeBounds.Merge(item.box);
+            centerBounds.min = Vector3::Min(centerBounds.min, item.center);
+            centerBounds.max = Vector3::Max(centerBounds.max, item.center);
+        }
+        nodes[task.node].min = nodeBounds.min;
+        nodes[task.node].max = nodeBounds.max;
+
+        int32 itemCount = task.end - task.begin;
+        if (itemCount <= MAX_LEAF_SIZE)
+        {
+            nodes[task.node].offset = task.begin;
+            nodes[task.node].count = itemCount;
+            continue;
+        }
+
+        // Bin centers along every axis and take the split with the lowest surface area cost.
+        float bestCost = FLT_MAX;
+        int32 bestAxis = -1, bestSplit = 0;
+        for (int32 axis = 0; axis < 3 && task.depth < MAX_SAH_DEPTH; ++axis)
+        {
+            float lo = Axis(centerBounds.min, axis);
+            float extent = Axis(centerBounds.max, axis) - lo;
+            if (extent <= 0.0f)
+                continue;
+
+            Bin bins[BIN_COUNT];
+            float scale = BIN_COUNT / extent;
+            for (int32 i = task.begin; i < task.end; ++i)
+            {
+                const auto &item = buildItems[i];
+                int32 bin = Math::Min(static_cast<int32>((Axis(item.center, axis) - lo) * scale), BIN_COUNT - 1);
+                bins[bin].count++;
+                bins[bin].bounds.Merge(item.box);
+            }
+
+            float rightCosts[BIN_COUNT];
+            AABox right = EMPTY_BOX;
+            int32 rightCount = 0;
+            for (int32 i = BIN_COUNT - 1; i > 0; --i)
+            {
+                right.Merge(bins[i].bounds);
+                rightCount += bins[i].count;
+                rightCosts[i] = rightCount ? rightCount * HalfArea(right) : 0.0f;
+            }
+
+            AABox left = EMPTY_BOX;
+            int32 leftCount = 0;
+            for (int32 i = 0; i < BIN_COUNT - 1; ++i)
+            {
+                left.Merge(bins[i].bounds);
+                leftCount += bins[i].count;
+                if (leftCount == 0 || leftCount == itemCount)
+                    continue;
+                float cost = leftCount * HalfArea(left) + rightCosts[i + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        int32 middle;
+        if (bestAxis >= 0)
+        {
+            float lo = Axis(centerBounds.min, bestAxis);
+            float scale = BIN_COUNT / (Axis(centerBounds.max, bestAxis) - lo);
+            auto first = buildItems.GetData();
+            middle = static_cast<int32>(std::partition(first + task.begin, first + task.end, [&](const BuildItem &item) {
+                                            return Math::Min(static_cast<int32>((Axis(item.center, bestAxis) - lo) * scale), BIN_COUNT - 1) <= bestSplit;
+                                        }) -
+                                        first);
+        }
+        else
+        {
+            // Too deep, or all centers coincide. Split at the median of the widest axis.
+            Vector3 extent = centerBounds.max - centerBounds.min;
+            int32 axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            middle = task.begin + itemCount / 2;
+            auto first = buildItems.GetData();
+            std::nth_element(first + task.begin, first + middle, first + task.end, [&](const BuildItem &a, const BuildItem &b) {
+                return Axis(a.center, axis) < Axis(b.center, axis);
+            });
+        }
+
+        int32 left = nodes.Count();
+        nodes[task.node].offset = left;
+        nodes[task.node].count = 0;
+        nodes.Add(Node());
+        nodes.Add(Node());
+        parents.Add(task.node);
+        parents.Add(task.node);
+        tasks.Add({ left + 1, middle, task.end, task.depth + 1 });
+        tasks.Add({ left, task.begin, middle, task.depth + 1 });
+    }
+
+    items.SetCount(count);
+    itemBoxes.SetCount(count);
+    itemSlots.SetCount(count);
+    itemLeaves.SetCount(count);
+    for (int32 slot = 0; slot < count; ++slot)
+    {
+        items[slot] = buildItems[slot].index;
+        itemBoxes.Set(slot, buildItems[slot].box);
+        itemSlots[items[slot]] = slot;
+    }
+    for (int32 i = 0; i < nodes.Count(); ++i)
+    {
+        const auto &node = nodes[i];
+        for (int32 slot = node.offset; node.IsLeaf() && slot < node.offset + node.count; ++slot)
+            itemLeaves[items[slot]] = i;
+    }
+    // Children always come after their parent.
+    nodeItemCounts.SetCount(nodes.Count());
+    for (int32 i = nodes.Count() - 1; i >= 0; --i)
+    {
+        const auto &node = nodes[i];
+        nodeItemCounts[i] = node.IsLeaf() ? node.count : nodeItemCounts[node.offset] + nodeItemCounts[node.offset + 1];
+    }
+    nodeStamps.SetCount(nodes.Count());
+    for (auto &e : nodeStamps)
+        e = 0;
+}
+
+void BVH::RefitNode(int32 index)
+{
+    auto &node = nodes[index];
+    AABox bounds = EMPTY_BOX;
+    if (node.IsLeaf())
+    {
+        for (int32 slot = node.offset; slot < node.offset + node.count; ++slot)
+            bounds.Merge(itemBoxes.Get(slot));
+    }
+    else
+    {
+        bounds.Merge(nodes[node.offset].GetBounds()).Merge(nodes[node.offset + 1].GetBounds());
+    }
+    node.min = bounds.min;
+    node.max = bounds.max;
+}
+
+void BVH::Refit(const Batch::AABoxSoA &boxes)
+{
+    CT_CHECK(boxes.Count() == items.Count());
+    for (int32 slot = 0; slot < items.Count(); ++slot)
+        itemBoxes.Set(slot, boxes.Get(items[slot]));
+
+    // Children always come after their parent.
+    for (int32 i = nodes.Count() - 1; i >= 0; --i)
+        RefitNode(i);
+}
+
+void BVH::Refit(const Batch::AABoxSoA &boxes, const Array<int32> &movedItems)
+{
+    CT_CHECK(boxes.Count() == items.Count());
+
+    // Collect each node on a path to the root once, then update them children first.
+    Array<int32> dirty;
+    ++stamp;
+    for (int32 item : movedItems)
+    {
+        itemBoxes.Set(itemSlots[item], boxes.Get(item));
+        for (int32 node = itemLeaves[item]; node >= 0 && nodeStamps[node] != stamp; node = parents[node])
+        {
+            nodeStamps[node] = stamp;
+            dirty.Add(node);
+        }
+    }
+
+    dirty.Sort([](int32 a, int32 b) { return a > b; });
+    for (int32 node : dirty)
+        RefitNode(node);
+}
+
+void BVH::AppendSubtree(int32 index, Array<int32> &result) const
+{
+    // The items of a subtree span from its leftmost to its rightmost leaf.
+    int32 first = index, last = index;
+    while (!nodes[first].IsLeaf())
+        first = nodes[first].offset;
+    while (!nodes[last].IsLeaf())
+        last = nodes[last].offset + 1;
+
+    int32 begin = nodes[first].offset, end = nodes[last].offset + nodes[last].count;
+    int32 offset = result.Count();
+    result.AddUninitialized(end - begin);
+    std::memcpy(result.GetData() + offset, items.GetData() + begin, sizeof(int32) * (end - begin));
+}
+
+void BVH::QueryFrustum(const Frustum &frustum, Array<int32> &result, int32 root) const
+{
+    Array<bool> visible;
+    QueryFrustum(frustum, result, visible, root);
+}
+
+void BVH::QueryFrustum(const Frustum &frustum, Array<int32> &result, Array<bool> &visible, int32 root) const
+{
+    if (nodes.IsEmpty())
+        return;
+    if (visible.Count() < items.Count())
+        visible.SetCount(items.Count());
+
+    // Items of partly visible leaves that follow each other are tested in one batch. The batch is flushed before
+    // anything else is appended, so results come in the same order as a per leaf test.
+    int32 pendingBegin = 0, pendingEnd = 0;
+    auto Flush = [&]() {
+        Batch::CullAABoxes(frustum, itemBoxes, pendingBegin, pendingEnd, visible);
+        for (int32 slot = pendingBegin; slot < pendingEnd; ++slot)
+        {
+            if (visible[slot])
+                result.Add(items[slot]);
+        }
+        pendingBegin = pendingEnd = 0;
+    };
+
+    int32 stack[STACK_SIZE];
+    int32 top = 0;
+    stack[top++] = root;
+    while (top > 0)
+    {
+        const auto &node = nodes[stack[--top]];
+        AABox bounds = node.GetBounds();
+        if (!frustum.Intersects(bounds))
+            continue;
+
+        if (frustum.Contains(bounds))
+        {
+            Flush();
+            AppendSubtree(static_cast<int32>(&node - nodes.GetData()), result);
+        }
+        else if (node.IsLeaf())
+        {
+            if (node.offset != pendingEnd)
+            {
+                Flush();
+                pendingBegin = node.offset;
+            }
+            pendingEnd = node.offset + node.count;
+        }
+        else
+        {
+            stack[top++] = node.offset + 1;
+            stack[top++] = node.offset;
+        }
+    }
+    Flush();
+}
+
+void BVH::QueryOverlap(const AABox &box, Array<int32> &result) const
+{
+    if (nodes.IsEmpty())
+        return;
+
+    int32 stack[STACK_SIZE];
+    int32 top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const auto &node = nodes[stack[--top]];
+        if (!Overlaps(node.GetBounds(), box))
+            continue;
+
+        if (node.IsLeaf())
+        {
+            for (int32 slot = node.offset; slot < node.offset + node.count; ++slot)
+            {
+                if (Overlaps(itemBoxes.Get(slot), box))
+                    result.Add(items[slot]);
+            }
+        }
+        else
+        {
+            stack[top++] = node.offset + 1;
+            stack[top++] = node.offset;
+        }
+    }
+}
+
+int32 BVH::Raycast(const Ray &ray, float &distance, float maxDistance) const
+{
+    int32 hit = -1;
+    if (nodes.IsEmpty())
+        return hit;
+
+    // Division by zero gives infinities, which the slab test handles.
+    Vector3 invDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+    float best = maxDistance;
+
+    int32 stack[STACK_SIZE];
+    int32 top = 0;
+    if (IntersectRay(nodes[0].GetBounds(), ray.origin, invDir, best) != FLT_MAX)
+        stack[top++] = 0;
+    while (top > 0)
+    {
+        const auto &node = nodes[stack[--top]];
+        if (node.IsLeaf())
+        {
+            for (int32 slot = node.offset; slot < node.offset + node.count; ++slot)
+            {
+                float t = IntersectRay(itemBoxes.Get(slot), ray.origin, invDir, best);
+                if (t != FLT_MAX && (hit < 0 || t < best))
+                {
+                    best = t;
+                    hit = items[slot];
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so that it can prune the other one.
+        int32 first = node.offset, second = node.offset + 1;
+        float tFirst = IntersectRay(nodes[first].GetBounds(), ray.origin, invDir, best);
+        float tSecond = IntersectRay(nodes[second].GetBounds(), ray.origin, invDir, best);
+        if (tSecond < tFirst)
+        {
+            std::swap(first, second);
+            std::swap(tFirst, tSecond);
+        }
+        if (tSecond != FLT_MAX)
+            stack[top++] = second;
+        if (tFirst != FLT_MAX)
+            stack[top++] = first;
+    }
+
+    if (hit >= 0)
+        distance = best;
+    return hit;
+}
+
+void BVH::GetSubtrees(int32 count, Array<int32> &roots) const
+{
+    roots.Clear();
+    if (nodes.IsEmpty())
+        return;
+
+    // Counts are few, a linear search for the largest subtree is enough.
+    roots.Add(0);
+    while (roots.Count() < count)
+    {
+        int32 largest = -1;
+        for (int32 i = 0; i < roots.Count(); ++i)
+        {
+            if (!nodes[roots[i]].IsLeaf() && (largest < 0 || nodeItemCounts[roots[i]] > nodeItemCounts[roots[largest]]))
+                largest = i;
+        }
+        if (largest < 0)
+            break;
+
+        int32 first = nodes[roots[largest]].offset;
+        roots[largest] = first;
+        roots.Add(first + 1);
+    }
+}
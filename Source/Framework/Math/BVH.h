@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Math/Batch.h"
+#include "Math/Ray.h"
+#include <cfloat>
+
+/**
+ * Bounding volume hierarchy over a set of boxes, built top down with a binned surface area heuristic.
+ * Nodes are flattened into one array of 32 byte entries, children are always stored next to each other
+ * after their parent, and every subtree owns a contiguous range of items.
+ */
+class BVH
+{
+public:
+    static constexpr int32 MAX_LEAF_SIZE = 4;
+    static constexpr int32 BIN_COUNT = 16;
+
+    struct Node
+    {
+        Vector3 min;
+        // First child for inner nodes, the second one follows it. First item slot for leaves.
+        int32 offset = 0;
+        Vector3 max;
+        // Item count of a leaf, 0 for inner nodes.
+        int32 count = 0;
+
+        bool IsLeaf() const
+        {
+            return count > 0;
+        }
+
+        AABox GetBounds() const
+        {
+            return AABox(min, max);
+        }
+    };
+
+    void Build(const Batch::AABoxSoA &boxes);
+    // Recomputes every bound bottom up, the tree shape is kept.
+    void Refit(const Batch::AABoxSoA &boxes);
+    // Same as above but only walks the paths from the moved items to the root.
+    void Refit(const Batch::AABoxSoA &boxes, const Array<int32> &movedItems);
+    void Clear();
+
+    // Appends the items whose boxes intersect, subtrees fully inside are taken without testing their items.
+    void QueryFrustum(const Frustum &frustum, Array<int32> &result, int32 root = 0) const;
+    // Same as above, visible is scratch for the batched item tests so that repeated queries do not allocate it.
+    void QueryFrustum(const Frustum &frustum, Array<int32> &result, Array<bool> &visible, int32 root = 0) const;
+    void QueryOverlap(const AABox &box, Array<int32> &result) const;
+    // Nearest item whose box the ray enters within maxDistance, -1 if there is none.
+    int32 Raycast(const Ray &ray, float &distance, float maxDistance = FLT_MAX) const;
+    // Splits the tree into disjoint subtrees covering all items, at least count of them if the tree is deep enough. The largest
+    // subtree is split each time, so the item counts stay close.
+    void GetSubtrees(int32 count, Array<int32> &roots) const;
+
+    bool IsEmpty() const
+    {
+        return nodes.IsEmpty();
+    }
+
+    int32 GetItemCount() const
+    {
+        return items.Count();
+    }
+
+    const Array<Node> &GetNodes() const
+    {
+        return nodes;
+    }
+
+    AABox GetBounds() const
+    {
+        return nodes.IsEmpty() ? AABox() : nodes[0].GetBounds();
+    }
+
+private:
+    void RefitNode(int32 index);
+    void AppendSubtree(int32 index, Array<int32> &result) const;
+
+private:
+    Array<Node> nodes;
+    // Item indices in leaf order, and their boxes in the same order.
+    Array<int32> items;
+    Batch::AABoxSoA itemBoxes;
+    Array<int32> itemSlots;
+    Array<int32> itemLeaves;
+    Array<int32> parents;
+    Array<int32> nodeItemCounts;
+    Array<uint32> nodeStamps;
+    uint32 stamp = 0;
+};
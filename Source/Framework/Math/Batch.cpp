@@ -0,0 +1,361 @@
+#include "Math/Batch.h"
+#include "Math/Simd.h"
+#include <cfloat>
+#include <type_traits>
+
+namespace Batch
+{
+
+namespace
+{
+// One element, used for the scalar backend and for the tail of every other one.
+struct Single
+{
+    static constexpr int32 WIDTH = 1;
+    float m;
+
+    static Single Load(const float *ptr)
+    {
+        return { *ptr };
+    }
+
+    static Single Splat(float value)
+    {
+        return { value };
+    }
+
+    void Store(float *ptr) const
+    {
+        *ptr = m;
+    }
+
+    int32 NegativeMask() const
+    {
+        return m < 0.0f ? 1 : 0;
+    }
+};
+
+CT_INLINE Single operator+(Single a, Single b)
+{
+    return { a.m + b.m };
+}
+
+CT_INLINE Single operator-(Single a, Single b)
+{
+    return { a.m - b.m };
+}
+
+CT_INLINE Single operator*(Single a, Single b)
+{
+    return { a.m * b.m };
+}
+
+// Same operand order as minps/maxps and Math::Min/Max.
+CT_INLINE Single Min(Single a, Single b)
+{
+    return { a.m < b.m ? a.m : b.m };
+}
+
+CT_INLINE Single Max(Single a, Single b)
+{
+    return { a.m > b.m ? a.m : b.m };
+}
+
+#if CT_MATH_SIMD >= CT_MATH_SIMD_AVX2
+
+struct Lanes
+{
+    static constexpr int32 WIDTH = 8;
+    __m256 m;
+
+    static Lanes Load(const float *ptr)
+    {
+        return { _mm256_loadu_ps(ptr) };
+    }
+
+    static Lanes Splat(float value)
+    {
+        return { _mm256_set1_ps(value) };
+    }
+
+    void Store(float *ptr) const
+    {
+        _mm256_storeu_ps(ptr, m);
+    }
+
+    int32 NegativeMask() const
+    {
+        return _mm256_movemask_ps(_mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+};
+
+CT_INLINE Lanes operator+(Lanes a, Lanes b)
+{
+    return { _mm256_add_ps(a.m, b.m) };
+}
+
+CT_INLINE Lanes operator-(Lanes a, Lanes b)
+{
+    return { _mm256_sub_ps(a.m, b.m) };
+}
+
+CT_INLINE Lanes operator*(Lanes a, Lanes b)
+{
+    return { _mm256_mul_ps(a.m, b.m) };
+}
+
+CT_INLINE Lanes Min(Lanes a, Lanes b)
+{
+    return { _mm256_min_ps(a.m, b.m) };
+}
+
+CT_INLINE Lanes Max(Lanes a, Lanes b)
+{
+    return { _mm256_max_ps(a.m, b.m) };
+}
+
+#elif CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+
+struct Lanes
+{
+    static constexpr int32 WIDTH = 4;
+    Simd::Float4 m;
+
+    static Lanes Load(const float *ptr)
+    {
+        return { Simd::Load(ptr) };
+    }
+
+    static Lanes Splat(float value)
+    {
+        return { Simd::Splat(value) };
+    }
+
+    void Store(float *ptr) const
+    {
+        Simd::Store(ptr, m);
+    }
+
+    int32 NegativeMask() const
+    {
+        return _mm_movemask_ps(_mm_cmplt_ps(m.m, _mm_setzero_ps()));
+    }
+};
+
+CT_INLINE Lanes operator+(Lanes a, Lanes b)
+{
+    return { Simd::Add(a.m, b.m) };
+}
+
+CT_INLINE Lanes operator-(Lanes a, Lanes b)
+{
+    return { Simd::Sub(a.m, b.m) };
+}
+
+CT_INLINE Lanes operator*(Lanes a, Lanes b)
+{
+    return { Simd::Mul(a.m, b.m) };
+}
+
+CT_INLINE Lanes Min(Lanes a, Lanes b)
+{
+    return { Simd::Min(a.m, b.m) };
+}
+
+CT_INLINE Lanes Max(Lanes a, Lanes b)
+{
+    return { Simd::Max(a.m, b.m) };
+}
+
+#else
+
+using Lanes = Single;
+
+#endif
+
+// Calls func(V(), i) for each group of V::WIDTH elements starting at i, the remainder one element at a time.
+template <typename Func>
+CT_INLINE void ForEachGroup(int32 begin, int32 end, Func &&func)
+{
+    int32 i = begin;
+    for (; i + Lanes::WIDTH <= end; i += Lanes::WIDTH)
+        func(Lanes(), i);
+    for (; i < end; ++i)
+        func(Single(), i);
+}
+}
+
+void TransformAABoxes(const Matrix4SoA &matrices, const AABoxSoA &boxes, AABoxSoA &out)
+{
+    int32 count = boxes.Count();
+    CT_CHECK(matrices.Count() >= count);
+    out.SetCount(count);
+
+    const Array<float> *m = matrices.m;
+    const Array<float> *src[2][3] = { { &boxes.min.x, &boxes.min.y, &boxes.min.z }, { &boxes.max.x, &boxes.max.y, &boxes.max.z } };
+    Array<float> *dst[2][3] = { { &out.min.x, &out.min.y, &out.min.z }, { &out.max.x, &out.max.y, &out.max.z } };
+
+    ForEachGroup(0, count, [&](auto tag, int32 i) {
+        using V = decltype(tag);
+        V lo[3], hi[3];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            lo[axis] = V::Load(src[0][axis]->GetData() + i);
+            hi[axis] = V::Load(src[1][axis]->GetData() + i);
+        }
+
+        // Per output row, the same steps and summation order as AABox::Transform.
+        V resultMin[3], resultMax[3];
+        for (int32 row = 0; row < 3; ++row)
+        {
+            V sumMin, sumMax;
+            for (int32 col = 0; col < 3; ++col)
+            {
+                V e = V::Load(m[col * 3 + row].GetData() + i);
+                V a = e * lo[col];
+                V b = e * hi[col];
+                if (col == 0)
+                {
+                    sumMin = Min(a, b);
+                    sumMax = Max(a, b);
+                }
+                else
+                {
+                    sumMin = sumMin + Min(a, b);
+                    sumMax = sumMax + Max(a, b);
+                }
+            }
+            V translation = V::Load(m[9 + row].GetData() + i);
+            resultMin[row] = sumMin + translation;
+            resultMax[row] = sumMax + translation;
+        }
+
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            resultMin[axis].Store(dst[0][axis]->GetData() + i);
+            resultMax[axis].Store(dst[1][axis]->GetData() + i);
+        }
+    });
+}
+
+void TransformPoints(const Matrix4SoA &matrices, const Vector3SoA &points, Vector3SoA &out)
+{
+    int32 count = points.Count();
+    CT_CHECK(matrices.Count() >= count);
+    out.SetCount(count);
+
+    const Array<float> *m = matrices.m;
+    const Array<float> *src[3] = { &points.x, &points.y, &points.z };
+    Array<float> *dst[3] = { &out.x, &out.y, &out.z };
+
+    ForEachGroup(0, count, [&](auto tag, int32 i) {
+        using V = decltype(tag);
+        V p[3] = { V::Load(src[0]->GetData() + i), V::Load(src[1]->GetData() + i), V::Load(src[2]->GetData() + i) };
+
+        V result[3];
+        for (int32 row = 0; row < 3; ++row)
+        {
+            V sum = V::Load(m[row].GetData() + i) * p[0] + V::Load(m[3 + row].GetData() + i) * p[1];
+            sum = sum + V::Load(m[6 + row].GetData() + i) * p[2];
+            result[row] = sum + V::Load(m[9 + row].GetData() + i);
+        }
+
+        for (int32 axis = 0; axis < 3; ++axis)
+            result[axis].Store(dst[axis]->GetData() + i);
+    });
+}
+
+void NegativeDeterminants(const Matrix4SoA &matrices, Array<bool> &negative)
+{
+    int32 count = matrices.Count();
+    negative.SetCount(count);
+
+    const Array<float> *m = matrices.m;
+    ForEachGroup(0, count, [&](auto tag, int32 i) {
+        using V = decltype(tag);
+        // e(col, row), the expression of Matrix3::Determinant.
+        auto e = [&](int32 col, int32 row) { return V::Load(m[col * 3 + row].GetData() + i); };
+        V det = e(0, 0) * (e(1, 1) * e(2, 2) - e(2, 1) * e(1, 2)) +
+                e(1, 0) * (e(2, 1) * e(0, 2) - e(0, 1) * e(2, 2)) +
+                e(2, 0) * (e(0, 1) * e(1, 2) - e(1, 1) * e(0, 2));
+
+        int32 mask = det.NegativeMask();
+        for (int32 lane = 0; lane < V::WIDTH; ++lane)
+            negative[i + lane] = (mask >> lane) & 1;
+    });
+}
+
+void CullAABoxes(const Frustum &frustum, const AABoxSoA &boxes, int32 begin, int32 end, Array<bool> &visible)
+{
+    CT_CHECK(begin >= 0 && end <= boxes.Count() && visible.Count() >= boxes.Count());
+
+    const Array<float> *src[2][3] = { { &boxes.min.x, &boxes.min.y, &boxes.min.z }, { &boxes.max.x, &boxes.max.y, &boxes.max.z } };
+    ForEachGroup(begin, end, [&](auto tag, int32 i) {
+        using V = decltype(tag);
+        V lo[3], hi[3];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            lo[axis] = V::Load(src[0][axis]->GetData() + i);
+            hi[axis] = V::Load(src[1][axis]->GetData() + i);
+        }
+
+        // A box is outside when its corner furthest along any plane normal is behind that plane.
+        int32 outside = 0;
+        for (const auto &plane : frustum.planes)
+        {
+            V a = V::Splat(plane.x), b = V::Splat(plane.y), c = V::Splat(plane.z);
+            V dist = Max(a * lo[0], a * hi[0]) + Max(b * lo[1], b * hi[1]) + Max(c * lo[2], c * hi[2]) + V::Splat(plane.w);
+            outside |= dist.NegativeMask();
+        }
+
+        for (int32 lane = 0; lane < V::WIDTH; ++lane)
+            visible[i + lane] = ((outside >> lane) & 1) == 0;
+    });
+}
+
+AABox MergeAABoxes(const AABoxSoA &boxes)
+{
+    int32 count = boxes.Count();
+    const Array<float> *src[2][3] = { { &boxes.min.x, &boxes.min.y, &boxes.min.z }, { &boxes.max.x, &boxes.max.y, &boxes.max.z } };
+
+    Lanes lo[3], hi[3];
+    Single loTail[3], hiTail[3];
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        lo[axis] = Lanes::Splat(FLT_MAX);
+        hi[axis] = Lanes::Splat(-FLT_MAX);
+        loTail[axis] = Single::Splat(FLT_MAX);
+        hiTail[axis] = Single::Splat(-FLT_MAX);
+    }
+
+    ForEachGroup(0, count, [&](auto tag, int32 i) {
+        using V = decltype(tag);
+        V *groupLo, *groupHi;
+        if constexpr (std::is_same_v<V, Lanes>)
+            groupLo = lo, groupHi = hi;
+        else
+            groupLo = loTail, groupHi = hiTail;
+
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            groupLo[axis] = Min(groupLo[axis], V::Load(src[0][axis]->GetData() + i));
+            groupHi[axis] = Max(groupHi[axis], V::Load(src[1][axis]->GetData() + i));
+        }
+    });
+
+    // Fold the lanes into the tail accumulators.
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        float loLanes[Lanes::WIDTH], hiLanes[Lanes::WIDTH];
+        lo[axis].Store(loLanes);
+        hi[axis].Store(hiLanes);
+        for (int32 lane = 0; lane < Lanes::WIDTH; ++lane)
+        {
+            loTail[axis] = Min(loTail[axis], Single::Load(loLanes + lane));
+            hiTail[axis] = Max(hiTail[axis], Single::Load(hiLanes + lane));
+        }
+    }
+    return AABox(Vector3(loTail[0].m, loTail[1].m, loTail[2].m), Vector3(hiTail[0].m, hiTail[1].m, hiTail[2].m));
+}
+
+}
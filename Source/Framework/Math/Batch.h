@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Math/AABox.h"
+#include "Math/Frustum.h"
+
+// Structure-of-arrays kernels over many transforms at once.
+// Each kernel processes 8 (AVX2), 4 (SSE4) or 1 (scalar) elements per step and matches the per-element Math code bit for bit.
+namespace Batch
+{
+
+struct Vector3SoA
+{
+    Array<float> x, y, z;
+
+    int32 Count() const
+    {
+        return x.Count();
+    }
+
+    void SetCount(int32 count)
+    {
+        x.SetCount(count);
+        y.SetCount(count);
+        z.SetCount(count);
+    }
+
+    void Set(int32 index, const Vector3 &v)
+    {
+        x[index] = v.x;
+        y[index] = v.y;
+        z[index] = v.z;
+    }
+
+    Vector3 Get(int32 index) const
+    {
+        return Vector3(x[index], y[index], z[index]);
+    }
+};
+
+struct AABoxSoA
+{
+    Vector3SoA min, max;
+
+    int32 Count() const
+    {
+        return min.Count();
+    }
+
+    void SetCount(int32 count)
+    {
+        min.SetCount(count);
+        max.SetCount(count);
+    }
+
+    void Set(int32 index, const AABox &box)
+    {
+        min.Set(index, box.min);
+        max.Set(index, box.max);
+    }
+
+    AABox Get(int32 index) const
+    {
+        return AABox(min.Get(index), max.Get(index));
+    }
+};
+
+// Affine matrices, only the upper 3 rows are kept. Element (row, col) of matrix i is m[col * 3 + row][i].
+struct Matrix4SoA
+{
+    Array<float> m[12];
+
+    int32 Count() const
+    {
+        return m[0].Count();
+    }
+
+    void SetCount(int32 count)
+    {
+        for (auto &e : m)
+            e.SetCount(count);
+    }
+
+    void Set(int32 index, const Matrix4 &mat)
+    {
+        const float *ptr = mat.GetPtr();
+        for (int32 col = 0; col < 4; ++col)
+        {
+            for (int32 row = 0; row < 3; ++row)
+                m[col * 3 + row][index] = ptr[col * 4 + row];
+        }
+    }
+};
+
+// Same as AABox::Transform for every pair, out may be boxes.
+void TransformAABoxes(const Matrix4SoA &matrices, const AABoxSoA &boxes, AABoxSoA &out);
+// Same as Matrix4::TransformPoint for every pair, out may be points.
+void TransformPoints(const Matrix4SoA &matrices, const Vector3SoA &points, Vector3SoA &out);
+// True where the upper 3x3 determinant is negative, i.e. the transform flips triangle winding.
+void NegativeDeterminants(const Matrix4SoA &matrices, Array<bool> &negative);
+// Writes Frustum::Intersects of boxes [begin, end) to the same range of visible, which must hold boxes.Count() entries.
+void CullAABoxes(const Frustum &frustum, const AABoxSoA &boxes, int32 begin, int32 end, Array<bool> &visible);
+// Union of all boxes, min is FLT_MAX and max is -FLT_MAX when there are none.
+AABox MergeAABoxes(const AABoxSoA &boxes);
+
+}
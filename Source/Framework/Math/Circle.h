@@ -73,7 +73,7 @@ public:
         return dx * dx + dy * dy < radiusSum * radiusSum;
     }
 
-    bool operator=(const Circle &other) const
+    bool operator==(const Circle &other) const
     {
         return x == other.x && y == other.y && radius == other.radius;
     }
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Math/AABox.h"
+#include "Math/Sphere.h"
+#include "Math/Vector4.h"
+
+class Frustum
+{
+public:
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        PlaneCount,
+    };
+
+    // (a, b, c, d), a point p is inside a plane when a * p.x + b * p.y + c * p.z + d >= 0. Planes are not normalized.
+    Vector4 planes[PlaneCount];
+
+    Frustum() = default;
+
+    // Extracts the planes of a clip space with -w <= x, y, z <= w, as Matrix4::Projection produces.
+    explicit Frustum(const Matrix4 &viewProj)
+    {
+        Vector4 rows[4];
+        for (int32 r = 0; r < 4; ++r)
+            rows[r] = Vector4(viewProj(r, 0), viewProj(r, 1), viewProj(r, 2), viewProj(r, 3));
+
+        planes[Left] = rows[3] + rows[0];
+        planes[Right] = rows[3] - rows[0];
+        planes[Bottom] = rows[3] + rows[1];
+        planes[Top] = rows[3] - rows[1];
+        planes[Near] = rows[3] + rows[2];
+        planes[Far] = rows[3] - rows[2];
+    }
+
+    // Conservative, boxes near the frustum corners may pass although they are outside.
+    bool Intersects(const AABox &box) const
+    {
+        for (const auto &p : planes)
+        {
+            float dist = Math::Max(p.x * box.min.x, p.x * box.max.x) + Math::Max(p.y * box.min.y, p.y * box.max.y) + Math::Max(p.z * box.min.z, p.z * box.max.z) + p.w;
+            if (dist < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    bool Intersects(const Sphere &sphere) const
+    {
+        for (const auto &p : planes)
+        {
+            Vector3 normal(p.x, p.y, p.z);
+            if (normal.Dot(sphere.center) + p.w < -sphere.radius * normal.Length())
+                return false;
+        }
+        return true;
+    }
+
+    // True when the whole box is inside, the corner nearest to each plane must be in front of it.
+    bool Contains(const AABox &box) const
+    {
+        for (const auto &p : planes)
+        {
+            float dist = Math::Min(p.x * box.min.x, p.x * box.max.x) + Math::Min(p.y * box.min.y, p.y * box.max.y) + Math::Min(p.z * box.min.z, p.z * box.max.z) + p.w;
+            if (dist < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
@@ -79,96 +79,100 @@ float Matrix4::Determinant() const
 
 Matrix4 Matrix4::Transpose() const
 {
+    Simd::Float4 c0 = Simd::Load(v[0]);
+    Simd::Float4 c1 = Simd::Load(v[1]);
+    Simd::Float4 c2 = Simd::Load(v[2]);
+    Simd::Float4 c3 = Simd::Load(v[3]);
+    Simd::Transpose(c0, c1, c2, c3);
+
     Matrix4 ret;
-    for (int32 col = 0; col < 4; ++col)
-    {
-        for (int32 row = 0; row < 4; ++row)
-        {
-            ret.v[col][row] = v[row][col];
-        }
-    }
+    Simd::Store(ret.v[0], c0);
+    Simd::Store(ret.v[1], c1);
+    Simd::Store(ret.v[2], c2);
+    Simd::Store(ret.v[3], c3);
     return ret;
 }
 
+namespace
+{
+// Cofactors through 2x2 sub-determinants of the column pairs (0,1) and (2,3).
+// Works on the transposed matrix, which is fine since adj(M^T) = adj(M)^T.
+void ComputeCofactors(const float *m, Simd::Float4 *rows, float &det)
+{
+    using namespace Simd;
+
+    Float4 r0 = Load(m);
+    Float4 r1 = Load(m + 4);
+    Float4 r2 = Load(m + 8);
+    Float4 r3 = Load(m + 12);
+
+    // (s0, s1, s2, s3), (s4, s5, c4, c5), (c0, c1, c2, c3)
+    Float4 d1 = Sub(Mul(Shuffle<0, 0, 0, 1>(r0), Shuffle<1, 2, 3, 2>(r1)), Mul(Shuffle<0, 0, 0, 1>(r1), Shuffle<1, 2, 3, 2>(r0)));
+    Float4 d2 = Sub(Mul(Shuffle<1, 2, 1, 2>(r0, r2), Shuffle<3, 3, 3, 3>(r1, r3)), Mul(Shuffle<1, 2, 1, 2>(r1, r3), Shuffle<3, 3, 3, 3>(r0, r2)));
+    Float4 d3 = Sub(Mul(Shuffle<0, 0, 0, 1>(r2), Shuffle<1, 2, 3, 2>(r3)), Mul(Shuffle<0, 0, 0, 1>(r3), Shuffle<1, 2, 3, 2>(r2)));
+
+    Float4 k5 = Shuffle<3, 3, 1, 1>(d2);
+    Float4 k4 = Shuffle<2, 2, 0, 0>(d2);
+    Float4 k3 = Shuffle<3, 3, 3, 3>(d3, d1);
+    Float4 k2 = Shuffle<2, 2, 2, 2>(d3, d1);
+    Float4 k1 = Shuffle<1, 1, 1, 1>(d3, d1);
+    Float4 k0 = Shuffle<0, 0, 0, 0>(d3, d1);
+
+    Float4 t0 = r0;
+    Float4 t1 = r1;
+    Float4 t2 = r2;
+    Float4 t3 = r3;
+    Transpose(t0, t1, t2, t3);
+    Float4 x0 = Shuffle<1, 0, 3, 2>(t0);
+    Float4 x1 = Shuffle<1, 0, 3, 2>(t1);
+    Float4 x2 = Shuffle<1, 0, 3, 2>(t2);
+    Float4 x3 = Shuffle<1, 0, 3, 2>(t3);
+
+    rows[0] = Add(Sub(Mul(x1, k5), Mul(x2, k4)), Mul(x3, k3));
+    rows[1] = Add(Sub(Mul(x0, k5), Mul(x2, k2)), Mul(x3, k1));
+    rows[2] = Add(Sub(Mul(x0, k4), Mul(x1, k2)), Mul(x3, k0));
+    rows[3] = Add(Sub(Mul(x0, k3), Mul(x1, k1)), Mul(x2, k0));
+
+    const float s0 = Lane<0>(d1), s1 = Lane<1>(d1), s2 = Lane<2>(d1), s3 = Lane<3>(d1);
+    const float s4 = Lane<0>(d2), s5 = Lane<1>(d2), c4 = Lane<2>(d2), c5 = Lane<3>(d2);
+    const float c0 = Lane<0>(d3), c1 = Lane<1>(d3), c2 = Lane<2>(d3), c3 = Lane<3>(d3);
+    det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+}
+
 Matrix4 Matrix4::Inverse() const
 {
-    float n00 = v[0][0];
-    float n01 = v[1][0];
-    float n02 = v[2][0];
-    float n03 = v[3][0];
-    float n10 = v[0][1];
-    float n11 = v[1][1];
-    float n12 = v[2][1];
-    float n13 = v[3][1];
-    float n20 = v[0][2];
-    float n21 = v[1][2];
-    float n22 = v[2][2];
-    float n23 = v[3][2];
-    float n30 = v[0][3];
-    float n31 = v[1][3];
-    float n32 = v[2][3];
-    float n33 = v[3][3];
+    Simd::Float4 rows[4];
+    float det;
+    ComputeCofactors(GetPtr(), rows, det);
+
+    float t = 1.0f / det;
+    Simd::Float4 even = Simd::Set(t, -t, t, -t);
+    Simd::Float4 odd = Simd::Set(-t, t, -t, t);
 
-    float p00 = n11 * (n22 * n33 - n23 * n32) + n12 * (n23 * n31 - n21 * n33) + n13 * (n21 * n32 - n22 * n31);
-    float p10 = n10 * (n23 * n32 - n22 * n33) + n12 * (n20 * n33 - n23 * n30) + n13 * (n22 * n30 - n20 * n32);
-    float p20 = n10 * (n21 * n33 - n23 * n31) + n11 * (n23 * n30 - n20 * n33) + n13 * (n20 * n31 - n21 * n30);
-    float p30 = n10 * (n22 * n31 - n21 * n32) + n11 * (n20 * n32 - n22 * n30) + n12 * (n21 * n30 - n20 * n31);
-
-    float t = 1.0f / (n00 * p00 + n01 * p10 + n02 * p20 + n03 * p30);
-
-    return Matrix4(p00 * t,
-                   (n01 * (n23 * n32 - n22 * n33) + n02 * (n21 * n33 - n23 * n31) + n03 * (n22 * n31 - n21 * n32)) * t,
-                   (n01 * (n12 * n33 - n13 * n32) + n02 * (n13 * n31 - n11 * n33) + n03 * (n11 * n32 - n12 * n31)) * t,
-                   (n01 * (n13 * n22 - n12 * n23) + n02 * (n11 * n23 - n13 * n21) + n03 * (n12 * n21 - n11 * n22)) * t,
-                   p10 * t,
-                   (n00 * (n22 * n33 - n23 * n32) + n02 * (n23 * n30 - n20 * n33) + n03 * (n20 * n32 - n22 * n30)) * t,
-                   (n00 * (n13 * n32 - n12 * n33) + n02 * (n10 * n33 - n13 * n30) + n03 * (n12 * n30 - n10 * n32)) * t,
-                   (n00 * (n12 * n23 - n13 * n22) + n02 * (n13 * n20 - n10 * n23) + n03 * (n10 * n22 - n12 * n20)) * t,
-                   p20 * t,
-                   (n00 * (n23 * n31 - n21 * n33) + n01 * (n20 * n33 - n23 * n30) + n03 * (n21 * n30 - n20 * n31)) * t,
-                   (n00 * (n11 * n33 - n13 * n31) + n01 * (n13 * n30 - n10 * n33) + n03 * (n10 * n31 - n11 * n30)) * t,
-                   (n00 * (n13 * n21 - n11 * n23) + n01 * (n10 * n23 - n13 * n20) + n03 * (n11 * n20 - n10 * n21)) * t,
-                   p30 * t,
-                   (n00 * (n21 * n32 - n22 * n31) + n01 * (n22 * n30 - n20 * n32) + n02 * (n20 * n31 - n21 * n30)) * t,
-                   (n00 * (n12 * n31 - n11 * n32) + n01 * (n10 * n32 - n12 * n30) + n02 * (n11 * n30 - n10 * n31)) * t,
-                   (n00 * (n11 * n22 - n12 * n21) + n01 * (n12 * n20 - n10 * n22) + n02 * (n10 * n21 - n11 * n20)) * t);
+    Matrix4 ret;
+    Simd::Store(ret.v[0], Simd::Mul(rows[0], even));
+    Simd::Store(ret.v[1], Simd::Mul(rows[1], odd));
+    Simd::Store(ret.v[2], Simd::Mul(rows[2], even));
+    Simd::Store(ret.v[3], Simd::Mul(rows[3], odd));
+    return ret;
 }
 
 Matrix4 Matrix4::Adjugate() const
 {
-    float n00 = v[0][0];
-    float n01 = v[1][0];
-    float n02 = v[2][0];
-    float n03 = v[3][0];
-    float n10 = v[0][1];
-    float n11 = v[1][1];
-    float n12 = v[2][1];
-    float n13 = v[3][1];
-    float n20 = v[0][2];
-    float n21 = v[1][2];
-    float n22 = v[2][2];
-    float n23 = v[3][2];
-    float n30 = v[0][3];
-    float n31 = v[1][3];
-    float n32 = v[2][3];
-    float n33 = v[3][3];
+    Simd::Float4 rows[4];
+    float det;
+    ComputeCofactors(GetPtr(), rows, det);
 
-    return Matrix4(n11 * (n22 * n33 - n23 * n32) + n12 * (n23 * n31 - n21 * n33) + n13 * (n21 * n32 - n22 * n31),
-                   n01 * (n23 * n32 - n22 * n33) + n02 * (n21 * n33 - n23 * n31) + n03 * (n22 * n31 - n21 * n32),
-                   n01 * (n12 * n33 - n13 * n32) + n02 * (n13 * n31 - n11 * n33) + n03 * (n11 * n32 - n12 * n31),
-                   n01 * (n13 * n22 - n12 * n23) + n02 * (n11 * n23 - n13 * n21) + n03 * (n12 * n21 - n11 * n22),
-                   n10 * (n23 * n32 - n22 * n33) + n12 * (n20 * n33 - n23 * n30) + n13 * (n22 * n30 - n20 * n32),
-                   n00 * (n22 * n33 - n23 * n32) + n02 * (n23 * n30 - n20 * n33) + n03 * (n20 * n32 - n22 * n30),
-                   n00 * (n13 * n32 - n12 * n33) + n02 * (n10 * n33 - n13 * n30) + n03 * (n12 * n30 - n10 * n32),
-                   n00 * (n12 * n23 - n13 * n22) + n02 * (n13 * n20 - n10 * n23) + n03 * (n10 * n22 - n12 * n20),
-                   n10 * (n21 * n33 - n23 * n31) + n11 * (n23 * n30 - n20 * n33) + n13 * (n20 * n31 - n21 * n30),
-                   n00 * (n23 * n31 - n21 * n33) + n01 * (n20 * n33 - n23 * n30) + n03 * (n21 * n30 - n20 * n31),
-                   n00 * (n11 * n33 - n13 * n31) + n01 * (n13 * n30 - n10 * n33) + n03 * (n10 * n31 - n11 * n30),
-                   n00 * (n13 * n21 - n11 * n23) + n01 * (n10 * n23 - n13 * n20) + n03 * (n11 * n20 - n10 * n21),
-                   n10 * (n22 * n31 - n21 * n32) + n11 * (n20 * n32 - n22 * n30) + n12 * (n21 * n30 - n20 * n31),
-                   n00 * (n21 * n32 - n22 * n31) + n01 * (n22 * n30 - n20 * n32) + n02 * (n20 * n31 - n21 * n30),
-                   n00 * (n12 * n31 - n11 * n32) + n01 * (n10 * n32 - n12 * n30) + n02 * (n11 * n30 - n10 * n31),
-                   n00 * (n11 * n22 - n12 * n21) + n01 * (n12 * n20 - n10 * n22) + n02 * (n10 * n21 - n11 * n20));
+    Simd::Float4 even = Simd::Set(1.0f, -1.0f, 1.0f, -1.0f);
+    Simd::Float4 odd = Simd::Set(-1.0f, 1.0f, -1.0f, 1.0f);
+
+    Matrix4 ret;
+    Simd::Store(ret.v[0], Simd::Mul(rows[0], even));
+    Simd::Store(ret.v[1], Simd::Mul(rows[1], odd));
+    Simd::Store(ret.v[2], Simd::Mul(rows[2], even));
+    Simd::Store(ret.v[3], Simd::Mul(rows[3], odd));
+    return ret;
 }
 
 String Matrix4::ToString() const
@@ -265,6 +269,23 @@ Matrix4 Matrix4::TRS(const Vector3 &translation, const Quat &rotation, const Vec
     return m;
 }
 
+void Matrix4::Decompose(Vector3 &translation, Quat &rotation, Vector3 &scale) const
+{
+    translation = Vector3(v[3][0], v[3][1], v[3][2]);
+    scale = Vector3(Vector3(v[0][0], v[0][1], v[0][2]).Length(), Vector3(v[1][0], v[1][1], v[1][2]).Length(), Vector3(v[2][0], v[2][1], v[2][2]).Length());
+    if (ToMatrix3().Determinant() < 0.0f)
+        scale.x = -scale.x;
+
+    Matrix4 m = *this;
+    for (int32 c = 0; c < 3; ++c)
+    {
+        float invScale = scale[c] != 0.0f ? 1.0f / scale[c] : 0.0f;
+        for (int32 r = 0; r < 3; ++r)
+            m.v[c][r] *= invScale;
+    }
+    rotation = Quat(m);
+}
+
 Matrix4 Matrix4::Ortho(float left, float right, float bottom, float top, float n, float f)
 {
     Matrix4 m = Matrix4();
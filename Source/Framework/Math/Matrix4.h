@@ -2,6 +2,7 @@
 
 #include "Math/.Package.h"
 #include "Math/Matrix3.h"
+#include "Math/Simd.h"
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
 
@@ -54,8 +55,27 @@ public:
     Matrix4 Transpose() const;
     Matrix4 Inverse() const;
     Matrix4 Adjugate() const;
+    // Inverse of TRS for affine transforms without shear, a mirrored transform gets a negative x scale.
+    void Decompose(Vector3 &translation, Quat &rotation, Vector3 &scale) const;
     String ToString() const;
 
+    // Affine transform, w is assumed to be 1 and the result is not divided by w.
+    Vector3 TransformPoint(const Vector3 &point) const
+    {
+        Simd::Float4 ret = Simd::Add(Simd::Mul(Simd::Load(v[0]), Simd::Splat(point.x)), Simd::Mul(Simd::Load(v[1]), Simd::Splat(point.y)));
+        ret = Simd::Add(ret, Simd::Mul(Simd::Load(v[2]), Simd::Splat(point.z)));
+        ret = Simd::Add(ret, Simd::Load(v[3]));
+        return Vector3(Simd::Lane<0>(ret), Simd::Lane<1>(ret), Simd::Lane<2>(ret));
+    }
+
+    // Ignores translation, w is assumed to be 0.
+    Vector3 TransformVector(const Vector3 &vec) const
+    {
+        Simd::Float4 ret = Simd::Add(Simd::Mul(Simd::Load(v[0]), Simd::Splat(vec.x)), Simd::Mul(Simd::Load(v[1]), Simd::Splat(vec.y)));
+        ret = Simd::Add(ret, Simd::Mul(Simd::Load(v[2]), Simd::Splat(vec.z)));
+        return Vector3(Simd::Lane<0>(ret), Simd::Lane<1>(ret), Simd::Lane<2>(ret));
+    }
+
     static Matrix4 Rotate(const Vector3 &axis, float rad);
     static Matrix4 Rotate(float yaw, float pitch, float roll);
     static Matrix4 Rotate(const Quat &quat);
@@ -148,7 +168,7 @@ public:
         return *this;
     }
 
-    Matrix4 operator+(const Matrix4 &rhs)
+    Matrix4 operator+(const Matrix4 &rhs) const
     {
         Matrix4 ret;
         for (int32 col = 0; col < 4; ++col)
@@ -161,7 +181,7 @@ public:
         return ret;
     }
 
-    Matrix4 operator-(const Matrix4 &rhs)
+    Matrix4 operator-(const Matrix4 &rhs) const
     {
         Matrix4 ret;
         for (int32 col = 0; col < 4; ++col)
@@ -174,17 +194,10 @@ public:
         return ret;
     }
 
-    Matrix4 operator*(const Matrix4 &rhs)
+    Matrix4 operator*(const Matrix4 &rhs) const
     {
         Matrix4 ret;
-        for (int32 col = 0; col < 4; ++col)
-        {
-            for (int32 row = 0; row < 4; ++row)
-            {
-                ret.v[col][row] =
-                    v[0][row] * rhs.v[col][0] + v[1][row] * rhs.v[col][1] + v[2][row] * rhs.v[col][2] + v[3][row] * rhs.v[col][3];
-            }
-        }
+        Simd::MultiplyMatrix4(GetPtr(), rhs.GetPtr(), ret.GetPtr());
         return ret;
     }
 
@@ -204,23 +217,21 @@ public:
 
     friend Vector4 operator*(const Vector4 &lhs, const Matrix4 &rhs)
     {
+        Simd::Float4 c0 = Simd::Load(rhs.v[0]);
+        Simd::Float4 c1 = Simd::Load(rhs.v[1]);
+        Simd::Float4 c2 = Simd::Load(rhs.v[2]);
+        Simd::Float4 c3 = Simd::Load(rhs.v[3]);
+        Simd::Transpose(c0, c1, c2, c3);
+
         Vector4 ret;
-        for (int32 col = 0; col < 4; ++col)
-        {
-            ret[col] =
-                rhs.v[col][0] * lhs[0] + rhs.v[col][1] * lhs[1] + rhs.v[col][2] * lhs[2] + rhs.v[col][3] * lhs[3];
-        }
+        Simd::Store(&ret.x, Simd::Combine(c0, Simd::Splat(lhs.x), c1, Simd::Splat(lhs.y), c2, Simd::Splat(lhs.z), c3, Simd::Splat(lhs.w)));
         return ret;
     }
 
     friend Vector4 operator*(const Matrix4 &lhs, const Vector4 &rhs)
     {
         Vector4 ret;
-        for (int32 row = 0; row < 4; ++row)
-        {
-            ret[row] =
-                lhs.v[0][row] * rhs[0] + lhs.v[1][row] * rhs[1] + lhs.v[2][row] * rhs[2] + lhs.v[3][row] * rhs[3];
-        }
+        Simd::Store(&ret.x, Simd::MultiplyMatrix4(lhs.GetPtr(), Simd::Load(&rhs.x)));
         return ret;
     }
 
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Math/Vector2.h"
+#include "Math/Vector3.h"
+#include "Math/Vector4.h"
+#include <cstring>
+
+// CPU side of the GLSL packing functions, the bit layouts match packHalf2x16, packSnorm2x16, packUnorm2x16 and packUnorm4x8.
+namespace Packing
+{
+
+inline uint16 FloatToHalf(float value)
+{
+    uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32 sign = (bits >> 16) & 0x8000;
+    int32 exponent = (int32)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32 mantissa = bits & 0x7FFFFF;
+
+    // NaN stays NaN, everything too large becomes infinity.
+    if (((bits >> 23) & 0xFF) == 0xFF)
+        return (uint16)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (uint16)(sign | 0x7C00);
+
+    if (exponent <= 0)
+    {
+        // Denormal half, or zero when too small.
+        if (exponent < -10)
+            return (uint16)sign;
+        mantissa |= 0x800000;
+        uint32 shift = 14 - exponent;
+        uint32 half = mantissa >> shift;
+        uint32 rest = mantissa & ((1u << shift) - 1);
+        uint32 midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            ++half;
+        return (uint16)(sign | half);
+    }
+
+    // Round to nearest even, a carry into the exponent is still correct.
+    uint32 half = sign | ((uint32)exponent << 10) | (mantissa >> 13);
+    uint32 rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return (uint16)half;
+}
+
+inline float HalfToFloat(uint16 value)
+{
+    uint32 sign = (uint32)(value & 0x8000) << 16;
+    uint32 exponent = (value >> 10) & 0x1F;
+    uint32 mantissa = value & 0x3FF;
+
+    uint32 bits;
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // Denormal half, normalize it.
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+
+    float ret;
+    std::memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
+
+inline uint32 PackHalf2x16(const Vector2 &v)
+{
+    return (uint32)FloatToHalf(v.x) | ((uint32)FloatToHalf(v.y) << 16);
+}
+
+inline Vector2 UnpackHalf2x16(uint32 packed)
+{
+    return Vector2(HalfToFloat((uint16)(packed & 0xFFFF)), HalfToFloat((uint16)(packed >> 16)));
+}
+
+inline uint32 PackSnorm2x16(const Vector2 &v)
+{
+    auto Pack = [](float x) { return (uint32)(uint16)(int16)Math::Round(Math::Clamp(x, -1.0f, 1.0f) * 32767.0f); };
+    return Pack(v.x) | (Pack(v.y) << 16);
+}
+
+inline Vector2 UnpackSnorm2x16(uint32 packed)
+{
+    auto Unpack = [](uint32 x) { return Math::Clamp((float)(int16)(uint16)x / 32767.0f, -1.0f, 1.0f); };
+    return Vector2(Unpack(packed & 0xFFFF), Unpack(packed >> 16));
+}
+
+inline uint32 PackUnorm2x16(const Vector2 &v)
+{
+    auto Pack = [](float x) { return (uint32)Math::Round(Math::Clamp(x, 0.0f, 1.0f) * 65535.0f); };
+    return Pack(v.x) | (Pack(v.y) << 16);
+}
+
+inline Vector2 UnpackUnorm2x16(uint32 packed)
+{
+    return Vector2((float)(packed & 0xFFFF) / 65535.0f, (float)(packed >> 16) / 65535.0f);
+}
+
+inline uint32 PackUnorm4x8(const Vector4 &v)
+{
+    uint32 ret = 0;
+    for (int32 i = 0; i < 4; ++i)
+        ret |= (uint32)Math::Round(Math::Clamp(v[i], 0.0f, 1.0f) * 255.0f) << (i * 8);
+    return ret;
+}
+
+inline Vector4 UnpackUnorm4x8(uint32 packed)
+{
+    Vector4 ret;
+    for (int32 i = 0; i < 4; ++i)
+        ret[i] = (float)((packed >> (i * 8)) & 0xFF) / 255.0f;
+    return ret;
+}
+
+// Unit vector to the octahedron unfolded onto [-1, 1]^2.
+inline Vector2 EncodeOctahedral(const Vector3 &n)
+{
+    float sum = Math::Abs(n.x) + Math::Abs(n.y) + Math::Abs(n.z);
+    if (sum == 0.0f)
+        return Vector2(0.0f, 0.0f);
+
+    Vector2 e(n.x / sum, n.y / sum);
+    if (n.z < 0.0f)
+    {
+        // The lower half folds over the diagonals.
+        Vector2 folded((1.0f - Math::Abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f), (1.0f - Math::Abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+        e = folded;
+    }
+    return e;
+}
+
+inline Vector3 DecodeOctahedral(const Vector2 &e)
+{
+    Vector3 n(e.x, e.y, 1.0f - Math::Abs(e.x) - Math::Abs(e.y));
+    float t = Math::Max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return n / n.Length();
+}
+
+}
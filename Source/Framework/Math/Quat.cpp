@@ -161,34 +161,25 @@ Matrix3 Quat::ToMatrix3() const
     };
 }
 
+// Each column is unit + sign * 2 * (products + sign * products), matching the scalar formula of ToMatrix3.
 Matrix4 Quat::ToMatrix4() const
 {
-    const float xx = x * x;
-    const float xy = x * y;
-    const float xz = x * z;
-    const float xw = x * w;
-    const float yy = y * y;
-    const float yz = y * z;
-    const float yw = y * w;
-    const float zz = z * z;
-    const float zw = z * w;
-
-    return {
-        1.0f - 2.0f * (yy + zz),
-        2.0f * (xy - zw),
-        2.0f * (xz + yw),
-        0.0f,
-        2.0f * (xy + zw),
-        1.0f - 2.0f * (xx + zz),
-        2.0f * (yz - xw),
-        0.0f,
-        2.0f * (xz - yw),
-        2.0f * (yz + xw),
-        1.0f - 2.0f * (xx + yy),
-        0.0f,
-        0.0f,
-        0.0f,
-        0.0f,
-        1.0f
-    };
-}
\ No newline at end of file
+    using namespace Simd;
+    const Float4 q = Load(&x);
+    const Float4 two = Splat(2.0f);
+
+    Float4 s0 = Add(Mul(Shuffle<1, 0, 0, 3>(q), Shuffle<1, 1, 2, 3>(q)), Mul(Mul(Shuffle<2, 2, 1, 3>(q), Shuffle<2, 3, 3, 3>(q)), Set(1.0f, 1.0f, -1.0f, 0.0f)));
+    Float4 s1 = Add(Mul(Shuffle<0, 0, 1, 3>(q), Shuffle<1, 0, 2, 3>(q)), Mul(Mul(Shuffle<2, 2, 0, 3>(q), Shuffle<3, 2, 3, 3>(q)), Set(-1.0f, 1.0f, 1.0f, 0.0f)));
+    Float4 s2 = Add(Mul(Shuffle<0, 1, 0, 3>(q), Shuffle<2, 2, 0, 3>(q)), Mul(Mul(Shuffle<1, 0, 1, 3>(q), Shuffle<3, 3, 1, 3>(q)), Set(1.0f, -1.0f, 1.0f, 0.0f)));
+
+    Float4 c0 = Add(Set(1.0f, 0.0f, 0.0f, 0.0f), Mul(Mul(two, s0), Set(-1.0f, 1.0f, 1.0f, 0.0f)));
+    Float4 c1 = Add(Set(0.0f, 1.0f, 0.0f, 0.0f), Mul(Mul(two, s1), Set(1.0f, -1.0f, 1.0f, 0.0f)));
+    Float4 c2 = Add(Set(0.0f, 0.0f, 1.0f, 0.0f), Mul(Mul(two, s2), Set(1.0f, 1.0f, -1.0f, 0.0f)));
+
+    // The w lanes end up as 0 since their sign factor is 0, the last column keeps the identity.
+    Matrix4 m;
+    Store(m.GetPtr(), c0);
+    Store(m.GetPtr() + 4, c1);
+    Store(m.GetPtr() + 8, c2);
+    return m;
+}
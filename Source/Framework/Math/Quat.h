@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/.Package.h"
+#include "Math/Simd.h"
 #include "Math/Vector3.h"
 
 class Quat
@@ -141,16 +142,7 @@ public:
 
     Quat &operator*=(const Quat &rhs)
     {
-        float x0 = w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y;
-        float y0 = w * rhs.y + y * rhs.w + z * rhs.x - x * rhs.z;
-        float z0 = w * rhs.z + z * rhs.w + x * rhs.y - y * rhs.x;
-        float w0 = w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z;
-
-        x = x0;
-        y = y0;
-        z = z0;
-        w = w0;
-
+        *this = *this * rhs;
         return *this;
     }
 
@@ -202,13 +194,23 @@ public:
         return Quat(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z, lhs.w - rhs.w);
     }
 
+    // Lane-wise form of the Hamilton product, x = lw * rx + lx * rw + ly * rz - lz * ry and so on.
+    // The negated w terms keep the summation order of the scalar formula.
     friend Quat operator*(const Quat &lhs, const Quat &rhs)
     {
-        return Quat(
-            lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,
-            lhs.w * rhs.y + lhs.y * rhs.w + lhs.z * rhs.x - lhs.x * rhs.z,
-            lhs.w * rhs.z + lhs.z * rhs.w + lhs.x * rhs.y - lhs.y * rhs.x,
-            lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z);
+        using namespace Simd;
+        const Float4 a = Load(&lhs.x);
+        const Float4 b = Load(&rhs.x);
+        const Float4 flipW = Set(1.0f, 1.0f, 1.0f, -1.0f);
+
+        Float4 r = Mul(Splat<3>(a), b);
+        r = Add(r, Mul(Mul(Shuffle<0, 1, 2, 0>(a), flipW), Shuffle<3, 3, 3, 0>(b)));
+        r = Add(r, Mul(Mul(Shuffle<1, 2, 0, 1>(a), flipW), Shuffle<2, 0, 1, 1>(b)));
+        r = Sub(r, Mul(Shuffle<2, 0, 1, 2>(a), Shuffle<1, 2, 0, 2>(b)));
+
+        Quat ret;
+        Store(&ret.x, r);
+        return ret;
     }
 
     friend Quat operator*(float lhs, const Quat &rhs)
@@ -233,7 +235,15 @@ public:
 
     static Quat Lerp(const Quat &a, const Quat &b, float t)
     {
-        return Quat(Math::Lerp(a.x, b.x, t), Math::Lerp(a.y, b.y, t), Math::Lerp(a.z, b.z, t), Math::Lerp(a.w, b.w, t));
+        return Blend(a, 1.0f - t, b, t);
+    }
+
+    // a * wa + b * wb
+    static Quat Blend(const Quat &a, float wa, const Quat &b, float wb)
+    {
+        Quat ret;
+        Simd::Store(&ret.x, Simd::Add(Simd::Mul(Simd::Load(&a.x), Simd::Splat(wa)), Simd::Mul(Simd::Load(&b.x), Simd::Splat(wb))));
+        return ret;
     }
 
     /** Assume t is in range [0,1]. */
@@ -256,7 +266,7 @@ public:
 
         float angle = Math::Acos(d);
         float invSin = 1.0f / Math::Sin(angle);
-        return invSin * (Math::Sin((1.0f - t) * angle) * a + Math::Sin(t * angle) * x);
+        return Blend(a, Math::Sin((1.0f - t) * angle), x, Math::Sin(t * angle)) * invSin;
     }
 
     String ToString() const
@@ -130,7 +130,7 @@ public:
         return *this;
     }
 
-    bool operator=(const Rect &other) const
+    bool operator==(const Rect &other) const
     {
         return x == other.x && y == other.y && width == other.width && height == other.height;
     }
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "Math/.Package.h"
+
+// SIMD backend of the math library, picked at compile time from the target instruction set.
+// Define CT_MATH_SIMD to CT_MATH_SIMD_SCALAR to force the scalar fallback.
+// Every backend runs the same per-lane operations in the same order, so results are bitwise identical.
+#define CT_MATH_SIMD_SCALAR 0
+#define CT_MATH_SIMD_SSE4 1
+#define CT_MATH_SIMD_AVX2 2
+
+#ifndef CT_MATH_SIMD
+#if defined(__AVX2__)
+#define CT_MATH_SIMD CT_MATH_SIMD_AVX2
+#elif defined(__SSE4_1__) || defined(__AVX__)
+#define CT_MATH_SIMD CT_MATH_SIMD_SSE4
+#else
+#define CT_MATH_SIMD CT_MATH_SIMD_SCALAR
+#endif
+#endif
+
+#if CT_MATH_SIMD >= CT_MATH_SIMD_AVX2
+#include <immintrin.h>
+#elif CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+#include <smmintrin.h>
+#endif
+
+namespace Simd
+{
+
+#if CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+
+struct Float4
+{
+    __m128 m;
+};
+
+CT_INLINE Float4 Load(const float *ptr)
+{
+    return { _mm_loadu_ps(ptr) };
+}
+
+CT_INLINE void Store(float *ptr, Float4 a)
+{
+    _mm_storeu_ps(ptr, a.m);
+}
+
+CT_INLINE Float4 Set(float x, float y, float z, float w)
+{
+    return { _mm_setr_ps(x, y, z, w) };
+}
+
+CT_INLINE Float4 Splat(float value)
+{
+    return { _mm_set1_ps(value) };
+}
+
+// Result is (a[X], a[Y], a[Z], a[W]).
+template <int32 X, int32 Y, int32 Z, int32 W>
+CT_INLINE Float4 Shuffle(Float4 a)
+{
+    return { _mm_shuffle_ps(a.m, a.m, _MM_SHUFFLE(W, Z, Y, X)) };
+}
+
+// Result is (a[X], a[Y], b[Z], b[W]).
+template <int32 X, int32 Y, int32 Z, int32 W>
+CT_INLINE Float4 Shuffle(Float4 a, Float4 b)
+{
+    return { _mm_shuffle_ps(a.m, b.m, _MM_SHUFFLE(W, Z, Y, X)) };
+}
+
+template <int32 I>
+CT_INLINE float Lane(Float4 a)
+{
+    return _mm_cvtss_f32(_mm_shuffle_ps(a.m, a.m, _MM_SHUFFLE(I, I, I, I)));
+}
+
+CT_INLINE Float4 Add(Float4 a, Float4 b)
+{
+    return { _mm_add_ps(a.m, b.m) };
+}
+
+CT_INLINE Float4 Sub(Float4 a, Float4 b)
+{
+    return { _mm_sub_ps(a.m, b.m) };
+}
+
+CT_INLINE Float4 Mul(Float4 a, Float4 b)
+{
+    return { _mm_mul_ps(a.m, b.m) };
+}
+
+CT_INLINE Float4 Div(Float4 a, Float4 b)
+{
+    return { _mm_div_ps(a.m, b.m) };
+}
+
+CT_INLINE Float4 Min(Float4 a, Float4 b)
+{
+    return { _mm_min_ps(a.m, b.m) };
+}
+
+CT_INLINE Float4 Max(Float4 a, Float4 b)
+{
+    return { _mm_max_ps(a.m, b.m) };
+}
+
+CT_INLINE void Transpose(Float4 &a, Float4 &b, Float4 &c, Float4 &d)
+{
+    _MM_TRANSPOSE4_PS(a.m, b.m, c.m, d.m);
+}
+
+#else
+
+struct Float4
+{
+    float v[4];
+};
+
+CT_INLINE Float4 Load(const float *ptr)
+{
+    return { { ptr[0], ptr[1], ptr[2], ptr[3] } };
+}
+
+CT_INLINE void Store(float *ptr, Float4 a)
+{
+    ptr[0] = a.v[0];
+    ptr[1] = a.v[1];
+    ptr[2] = a.v[2];
+    ptr[3] = a.v[3];
+}
+
+CT_INLINE Float4 Set(float x, float y, float z, float w)
+{
+    return { { x, y, z, w } };
+}
+
+CT_INLINE Float4 Splat(float value)
+{
+    return { { value, value, value, value } };
+}
+
+template <int32 X, int32 Y, int32 Z, int32 W>
+CT_INLINE Float4 Shuffle(Float4 a)
+{
+    return { { a.v[X], a.v[Y], a.v[Z], a.v[W] } };
+}
+
+template <int32 X, int32 Y, int32 Z, int32 W>
+CT_INLINE Float4 Shuffle(Float4 a, Float4 b)
+{
+    return { { a.v[X], a.v[Y], b.v[Z], b.v[W] } };
+}
+
+template <int32 I>
+CT_INLINE float Lane(Float4 a)
+{
+    return a.v[I];
+}
+
+CT_INLINE Float4 Add(Float4 a, Float4 b)
+{
+    return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+}
+
+CT_INLINE Float4 Sub(Float4 a, Float4 b)
+{
+    return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+}
+
+CT_INLINE Float4 Mul(Float4 a, Float4 b)
+{
+    return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+}
+
+CT_INLINE Float4 Div(Float4 a, Float4 b)
+{
+    return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+}
+
+// Same operand order as minps/maxps, so NaN handling matches too.
+CT_INLINE Float4 Min(Float4 a, Float4 b)
+{
+    return { { a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3] } };
+}
+
+CT_INLINE Float4 Max(Float4 a, Float4 b)
+{
+    return { { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] } };
+}
+
+CT_INLINE void Transpose(Float4 &a, Float4 &b, Float4 &c, Float4 &d)
+{
+    Float4 ta = { { a.v[0], b.v[0], c.v[0], d.v[0] } };
+    Float4 tb = { { a.v[1], b.v[1], c.v[1], d.v[1] } };
+    Float4 tc = { { a.v[2], b.v[2], c.v[2], d.v[2] } };
+    Float4 td = { { a.v[3], b.v[3], c.v[3], d.v[3] } };
+    a = ta;
+    b = tb;
+    c = tc;
+    d = td;
+}
+
+#endif
+
+template <int32 I>
+CT_INLINE Float4 Splat(Float4 a)
+{
+    return Shuffle<I, I, I, I>(a);
+}
+
+// ((a * b + c * d) + e * f) + g * h, the summation order of the scalar math code.
+CT_INLINE Float4 Combine(Float4 a, Float4 b, Float4 c, Float4 d, Float4 e, Float4 f, Float4 g, Float4 h)
+{
+    return Add(Add(Add(Mul(a, b), Mul(c, d)), Mul(e, f)), Mul(g, h));
+}
+
+// Column-major 4x4 matrices, out may not alias the inputs.
+CT_INLINE void MultiplyMatrix4(const float *lhs, const float *rhs, float *out)
+{
+#if CT_MATH_SIMD >= CT_MATH_SIMD_AVX2
+    // Two result columns per iteration, each 128-bit half broadcasts its own rhs column.
+    __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs));
+    __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 4));
+    __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 8));
+    __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 12));
+    for (int32 col = 0; col < 4; col += 2)
+    {
+        __m256 r = _mm256_loadu_ps(rhs + col * 4);
+        __m256 acc = _mm256_mul_ps(l0, _mm256_shuffle_ps(r, r, 0x00));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(l1, _mm256_shuffle_ps(r, r, 0x55)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(l2, _mm256_shuffle_ps(r, r, 0xAA)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(l3, _mm256_shuffle_ps(r, r, 0xFF)));
+        _mm256_storeu_ps(out + col * 4, acc);
+    }
+#else
+    Float4 l0 = Load(lhs);
+    Float4 l1 = Load(lhs + 4);
+    Float4 l2 = Load(lhs + 8);
+    Float4 l3 = Load(lhs + 12);
+    for (int32 col = 0; col < 4; ++col)
+    {
+        Float4 r = Load(rhs + col * 4);
+        Store(out + col * 4, Combine(l0, Splat<0>(r), l1, Splat<1>(r), l2, Splat<2>(r), l3, Splat<3>(r)));
+    }
+#endif
+}
+
+// Column-major matrix times column vector.
+CT_INLINE Float4 MultiplyMatrix4(const float *lhs, Float4 rhs)
+{
+    return Combine(Load(lhs), Splat<0>(rhs), Load(lhs + 4), Splat<1>(rhs), Load(lhs + 8), Splat<2>(rhs), Load(lhs + 12), Splat<3>(rhs));
+}
+
+}
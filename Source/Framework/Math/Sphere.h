@@ -61,7 +61,7 @@ public:
         return dst2 < radiusSum * radiusSum;
     }
 
-    bool operator=(const Sphere &other) const
+    bool operator==(const Sphere &other) const
     {
         return radius == other.radius && center == other.center;
     }
@@ -1,8 +1,11 @@
 #include "Math/Test.h"
 #include "Core/Logger.h"
+#include "Math/BVH.h"
+#include "Math/Batch.h"
 #include "Math/Circle.h"
 #include "Math/Matrix3.h"
 #include "Math/Matrix4.h"
+#include "Math/Packing.h"
 #include "Math/Quat.h"
 #include "Math/Ray.h"
 #include "Math/Rect.h"
@@ -45,6 +48,10 @@ static void TestRay()
 
 static void TestQuat()
 {
+    Quat a(Vector3::Y, 0.5f);
+    Quat b(Vector3::X, 1.0f);
+    CT_LOG(Info, CT_TEXT("Quat mul:{0}, slerp:{1}"), a * b, Quat::Slerp(a, b, 0.5f));
+    CT_LOG(Info, CT_TEXT("Quat to matrix:{0}"), (a * b).ToMatrix4());
 }
 
 static void TestMatrix3()
@@ -56,6 +63,100 @@ static void TestMatrix3()
 
 static void TestMatrix4()
 {
+    Matrix4 mat = Matrix4::TRS(Vector3(1.0f, 2.0f, 3.0f), Quat(Vector3::Z, 0.3f), Vector3(2.0f, 2.0f, 2.0f));
+    CT_LOG(Info, CT_TEXT("Matrix4:{0}, inverse:{1}"), mat, mat.Inverse());
+    CT_LOG(Info, CT_TEXT("Matrix4 mul inverse:{0}, transpose:{1}"), mat * mat.Inverse(), mat.Transpose());
+    CT_LOG(Info, CT_TEXT("Transform point:{0}, vector:{1}"), mat.TransformPoint(Vector3::ONE), mat.TransformVector(Vector3::ONE));
+
+    Vector3 translation, scale;
+    Quat rotation;
+    mat.Decompose(translation, rotation, scale);
+    CT_LOG(Info, CT_TEXT("Decompose translation:{0}, rotation:{1}, scale:{2}"), translation, rotation, scale);
+}
+
+static void TestPacking()
+{
+    Vector3 normal = Vector3(0.3f, -0.8f, -0.5f).Normalize();
+    Vector3 decoded = Packing::DecodeOctahedral(Packing::UnpackSnorm2x16(Packing::PackSnorm2x16(Packing::EncodeOctahedral(normal))));
+    Vector2 half = Packing::UnpackHalf2x16(Packing::PackHalf2x16(Vector2(1.0f / 3.0f, -65504.0f)));
+    CT_LOG(Info, CT_TEXT("Octahedral:{0} -> {1}, half:{2}, unorm8:{3}"), normal, decoded, half, Packing::UnpackUnorm4x8(Packing::PackUnorm4x8(Vector4(0.5f, 0.25f, 0.25f, 0.0f))));
+}
+
+static void TestBatch()
+{
+    Batch::Matrix4SoA matrices;
+    Batch::AABoxSoA boxes;
+    matrices.SetCount(5);
+    boxes.SetCount(5);
+    for (int32 i = 0; i < 5; ++i)
+    {
+        Vector3 scale(i % 2 ? -1.0f : 1.0f, 1.0f, 1.0f + i);
+        matrices.Set(i, Matrix4::TRS(Vector3(i * 2.0f, 0.0f, 1.0f), Quat(Vector3::Y, 0.4f * i), scale));
+        boxes.Set(i, AABox());
+    }
+
+    Batch::AABoxSoA transformed;
+    Array<bool> flipped;
+    Batch::TransformAABoxes(matrices, boxes, transformed);
+    Batch::NegativeDeterminants(matrices, flipped);
+    AABox merged = Batch::MergeAABoxes(transformed);
+    CT_LOG(Info, CT_TEXT("Batch merged bounds:{0} {1}, flipped:{2} {3}"), merged.min, merged.max, flipped[0], flipped[1]);
+
+    // Camera at the origin looking down -z, only boxes in front of it are visible.
+    Frustum frustum(Matrix4::Projection(60.0f, 1.0f, 0.1f, 100.0f) * Matrix4::LookAt(Vector3::ZERO, Vector3(0.0f, 0.0f, -1.0f), Vector3::Y));
+    Array<bool> visible;
+    visible.SetCount(transformed.Count());
+    Batch::CullAABoxes(frustum, transformed, 0, transformed.Count(), visible);
+    CT_LOG(Info, CT_TEXT("Batch culling:{0} {1}, front:{2}, behind:{3}"), visible[0], visible[1], frustum.Intersects(AABox(Vector3(-1.0f, -1.0f, -6.0f), Vector3(1.0f, 1.0f, -4.0f))), frustum.Intersects(AABox(Vector3(-1.0f, -1.0f, 4.0f), Vector3(1.0f, 1.0f, 6.0f))));
+    CT_LOG(Info, CT_TEXT("Sphere culling, front:{0}, behind:{1}, near plane:{2}"), frustum.Intersects(Sphere(Vector3(0.0f, 0.0f, -5.0f), 1.0f)), frustum.Intersects(Sphere(Vector3(0.0f, 0.0f, 5.0f), 1.0f)),
+           frustum.Intersects(Sphere(Vector3(0.0f, 0.0f, 0.5f), 0.5f)));
+}
+
+static void TestBVH()
+{
+    // A row of unit boxes along x.
+    Batch::AABoxSoA boxes;
+    boxes.SetCount(100);
+    for (int32 i = 0; i < 100; ++i)
+        boxes.Set(i, AABox(Vector3(i * 2.0f, 0.0f, 0.0f), Vector3(i * 2.0f + 1.0f, 1.0f, 1.0f)));
+
+    BVH bvh;
+    bvh.Build(boxes);
+
+    float distance = 0.0f;
+    int32 hit = bvh.Raycast(Ray(Vector3(-5.0f, 0.5f, 0.5f), Vector3::X), distance);
+    Array<int32> overlaps;
+    bvh.QueryOverlap(AABox(Vector3(9.5f, 0.0f, 0.0f), Vector3(14.5f, 1.0f, 1.0f)), overlaps);
+    CT_LOG(Info, CT_TEXT("BVH nodes:{0}, ray hit:{1} at {2}, overlaps:{3}"), bvh.GetNodes().Count(), hit, distance, overlaps.Count());
+
+    // Every item lands in exactly one subtree, and no subtree should take much more than its share.
+    Frustum all(Matrix4::Ortho(-10.0f, 210.0f, -10.0f, 10.0f, -100.0f, 100.0f));
+    Array<int32> roots;
+    bvh.GetSubtrees(8, roots);
+    Array<int32> seen;
+    seen.SetCount(100);
+    for (auto &e : seen)
+        e = 0;
+    int32 smallest = INT32_MAX, largest = 0;
+    for (int32 root : roots)
+    {
+        Array<int32> subtreeItems;
+        bvh.QueryFrustum(all, subtreeItems, root);
+        for (int32 item : subtreeItems)
+            seen[item]++;
+        smallest = Math::Min(smallest, subtreeItems.Count());
+        largest = Math::Max(largest, subtreeItems.Count());
+    }
+    bool covered = true;
+    for (int32 e : seen)
+        covered = covered && e == 1;
+    CT_LOG(Info, CT_TEXT("BVH subtrees:{0}, each item once:{1}, items smallest:{2} largest:{3}"), roots.Count(), covered, smallest, largest);
+
+    Array<int32> moved;
+    moved.Add(0);
+    boxes.Set(0, AABox(Vector3(-20.0f, 0.0f, 0.0f), Vector3(-19.0f, 1.0f, 1.0f)));
+    bvh.Refit(boxes, moved);
+    CT_LOG(Info, CT_TEXT("BVH refit bounds:{0} {1}"), bvh.GetBounds().min, bvh.GetBounds().max);
 }
 
 void Test::TestMath()
@@ -64,5 +165,15 @@ void Test::TestMath()
 
     TestSphere();
 
+    TestMatrix4();
+
+    TestQuat();
+
+    TestPacking();
+
+    TestBatch();
+
+    TestBVH();
+
     //TestMatrix3();
 }
\ No newline at end of file
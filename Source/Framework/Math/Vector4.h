@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/.Package.h"
+#include "Math/Simd.h"
 #include "Math/Vector3.h"
 
 class Vector4
@@ -33,6 +34,18 @@ public:
         return Vector3(x, y, z);
     }
 
+    Simd::Float4 ToSimd() const
+    {
+        return Simd::Load(&x);
+    }
+
+    static Vector4 FromSimd(Simd::Float4 value)
+    {
+        Vector4 ret;
+        Simd::Store(&ret.x, value);
+        return ret;
+    }
+
     float operator[](int32 i) const
     {
         CT_CHECK(i >= 0 && i < 4);
@@ -139,42 +152,42 @@ public:
 
     friend Vector4 operator+(const Vector4 &lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z, lhs.w + rhs.w);
+        return FromSimd(Simd::Add(lhs.ToSimd(), rhs.ToSimd()));
     }
 
     friend Vector4 operator-(const Vector4 &lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z, lhs.w - rhs.w);
+        return FromSimd(Simd::Sub(lhs.ToSimd(), rhs.ToSimd()));
     }
 
     friend Vector4 operator*(const Vector4 &lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs.x * rhs.x, lhs.y * rhs.y, lhs.z * rhs.z, lhs.w * rhs.w);
+        return FromSimd(Simd::Mul(lhs.ToSimd(), rhs.ToSimd()));
     }
 
     friend Vector4 operator*(float lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs * rhs.x, lhs * rhs.y, lhs * rhs.z, lhs * rhs.w);
+        return FromSimd(Simd::Mul(Simd::Splat(lhs), rhs.ToSimd()));
     }
 
     friend Vector4 operator*(const Vector4 &lhs, float rhs)
     {
-        return Vector4(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs, lhs.w * rhs);
+        return FromSimd(Simd::Mul(lhs.ToSimd(), Simd::Splat(rhs)));
     }
 
     friend Vector4 operator/(const Vector4 &lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs.x / rhs.x, lhs.y / rhs.y, lhs.z / rhs.z, lhs.w / rhs.w);
+        return FromSimd(Simd::Div(lhs.ToSimd(), rhs.ToSimd()));
     }
 
     friend Vector4 operator/(float lhs, const Vector4 &rhs)
     {
-        return Vector4(lhs / rhs.x, lhs / rhs.y, lhs / rhs.z, lhs / rhs.w);
+        return FromSimd(Simd::Div(Simd::Splat(lhs), rhs.ToSimd()));
     }
 
     friend Vector4 operator/(const Vector4 &lhs, float rhs)
     {
-        return Vector4(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs, lhs.w / rhs);
+        return FromSimd(Simd::Div(lhs.ToSimd(), Simd::Splat(rhs)));
     }
 
     float Length2() const
@@ -235,17 +248,17 @@ public:
 
     static Vector4 Lerp(const Vector4 &a, const Vector4 &b, float t)
     {
-        return Vector4(Math::Lerp(a.x, b.x, t), Math::Lerp(a.y, b.y, t), Math::Lerp(a.z, b.z, t), Math::Lerp(a.w, b.w, t));
+        return FromSimd(Simd::Add(Simd::Mul(a.ToSimd(), Simd::Splat(1.0f - t)), Simd::Mul(b.ToSimd(), Simd::Splat(t))));
     }
 
     static Vector4 Max(const Vector4 &a, const Vector4 &b)
     {
-        return Vector4(Math::Max(a.x, b.x), Math::Max(a.y, b.y), Math::Max(a.z, b.z), Math::Max(a.w, b.w));
+        return FromSimd(Simd::Max(a.ToSimd(), b.ToSimd()));
     }
 
     static Vector4 Min(const Vector4 &a, const Vector4 &b)
     {
-        return Vector4(Math::Min(a.x, b.x), Math::Min(a.y, b.y), Math::Min(a.z, b.z), Math::Min(a.w, b.w));
+        return FromSimd(Simd::Min(a.ToSimd(), b.ToSimd()));
     }
 
     String ToString() const
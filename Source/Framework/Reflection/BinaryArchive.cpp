@@ -0,0 +1,291 @@
+#include "Reflection/BinaryArchive.h"
+#include "Reflection/Registry.h"
+#include <cstring>
+
+namespace Reflection
+{
+
+namespace
+{
+void Append(Array<uint8> &bytes, const void *src, SizeType size)
+{
+    int32 offset = bytes.Count();
+    bytes.AddUninitialized(static_cast<int32>(size));
+    std::memcpy(bytes.GetData() + offset, src, size);
+}
+}
+
+BinarySchema::BinarySchema(const Type *type)
+    : type(type), stride(type->GetSize())
+{
+}
+
+const BinarySchema *BinarySchema::Get(const Type *type)
+{
+    if (!type)
+        return nullptr;
+
+    std::unique_lock<std::recursive_mutex> lock(schemasMutex);
+    if (auto cached = schemas.TryGet(type))
+        return cached->get();
+
+    auto schema = SPtr<BinarySchema>(Memory::New<BinarySchema>(type), [](BinarySchema *ptr) { Memory::Delete(ptr); });
+    if (!schema->Compile())
+        return nullptr;
+    schemas.Put(type, schema);
+    return schema.get();
+}
+
+bool BinarySchema::Compile()
+{
+    hash = Hash::BYTES_HASH_SEED;
+    Hash::HashBytesCombine(hash, type->GetName().ToString());
+    Hash::HashBytesCombine(hash, stride);
+
+    Array<const Type *> hierarchy;
+    for (const Type *current = type; current; current = current->GetBaseType())
+        hierarchy.Add(current);
+    hierarchy.Reverse();
+
+    Array<const Property *> props;
+    for (auto current : hierarchy)
+    {
+        for (auto prop : current->GetProperties())
+        {
+            if (prop->IsStatic())
+                continue;
+            if (!prop->HasLayout())
+            {
+                CT_LOG(Error, CT_TEXT("Property {0} of {1} has no layout, type is not serializable."), prop->GetName().ToString(), type->GetName().ToString());
+                return false;
+            }
+            props.Add(prop);
+        }
+    }
+    props.Sort([](const Property *a, const Property *b) {
+        return a->GetOffset() < b->GetOffset();
+    });
+
+    for (auto prop : props)
+        AddProperty(prop);
+    return true;
+}
+
+void BinarySchema::AddProperty(const Property *prop)
+{
+    auto propType = prop->GetType();
+    if (propType.IsPointer())
+    {
+        CT_LOG(Warning, CT_TEXT("Pointer property {0} of {1} is not serializable, skipped."), prop->GetName().ToString(), type->GetName().ToString());
+        return;
+    }
+
+    Op op;
+    op.offset = prop->GetOffset();
+    op.size = prop->GetSize();
+    if (propType.GetType() == TypeOf<String>())
+    {
+        op.code = OpCode::String;
+        op.size = sizeof(CharType);
+    }
+    else if (prop->IsTriviallyCopyable())
+    {
+        op.code = OpCode::Copy;
+    }
+    else
+    {
+        op.schema = Get(propType.GetType());
+        if (!op.schema || op.schema->GetOps().IsEmpty())
+        {
+            CT_LOG(Warning, CT_TEXT("Property {0} of {1} has no serializable layout, skipped."), prop->GetName().ToString(), type->GetName().ToString());
+            return;
+        }
+        op.code = OpCode::Object;
+    }
+
+    Hash::HashBytesCombine(hash, prop->GetName().ToString());
+    Hash::HashBytesCombine(hash, propType.ToString());
+    Hash::HashBytesCombine(hash, op.code);
+    Hash::HashBytesCombine(hash, op.offset);
+    Hash::HashBytesCombine(hash, op.size);
+    if (op.schema)
+        Hash::HashBytesCombine(hash, op.schema->GetHash());
+
+    if (op.code == OpCode::Copy)
+        minSize += op.size;
+    else if (op.code == OpCode::String)
+        minSize += sizeof(uint32);
+    else
+        minSize += op.schema->GetMinSize();
+
+    // Extend the previous run when the property follows it without padding.
+    if (op.code == OpCode::Copy && !ops.IsEmpty())
+    {
+        auto &last = ops.Last();
+        if (last.code == OpCode::Copy && last.offset + last.size == op.offset)
+        {
+            last.size += op.size;
+            return;
+        }
+    }
+    ops.Add(op);
+}
+
+void BinarySchema::Write(const void *obj, Array<uint8> &bytes) const
+{
+    auto base = static_cast<const uint8 *>(obj);
+    for (const auto &op : ops)
+    {
+        const uint8 *src = base + op.offset;
+        switch (op.code)
+        {
+        case OpCode::Copy:
+            Append(bytes, src, op.size);
+            break;
+        case OpCode::String:
+        {
+            auto str = reinterpret_cast<const String *>(src);
+            uint32 length = str->Length();
+            Append(bytes, &length, sizeof(length));
+            Append(bytes, str->CStr(), sizeof(CharType) * length);
+            break;
+        }
+        case OpCode::Object:
+            op.schema->Write(src, bytes);
+            break;
+        }
+    }
+}
+
+bool BinarySchema::Read(void *obj, const uint8 *&ptr, const uint8 *end) const
+{
+    auto base = static_cast<uint8 *>(obj);
+    for (const auto &op : ops)
+    {
+        uint8 *dst = base + op.offset;
+        switch (op.code)
+        {
+        case OpCode::Copy:
+            if (static_cast<SizeType>(end - ptr) < op.size)
+                return false;
+            std::memcpy(dst, ptr, op.size);
+            ptr += op.size;
+            break;
+        case OpCode::String:
+        {
+            uint32 length;
+            if (static_cast<SizeType>(end - ptr) < sizeof(length))
+                return false;
+            std::memcpy(&length, ptr, sizeof(length));
+            ptr += sizeof(length);
+            if (static_cast<SizeType>(end - ptr) / sizeof(CharType) < length)
+                return false;
+
+            Array<CharType> chars;
+            chars.AddUninitialized(length + 1);
+            std::memcpy(chars.GetData(), ptr, sizeof(CharType) * length);
+            chars[length] = 0;
+            ptr += sizeof(CharType) * length;
+            *reinterpret_cast<String *>(dst) = chars.GetData();
+            break;
+        }
+        case OpCode::Object:
+            if (!op.schema->Read(dst, ptr, end))
+                return false;
+            break;
+        }
+    }
+    return true;
+}
+
+//===============================================================================
+bool BinaryArchive::Save(const Type *type, const void *objects, int32 count, Array<uint8> &bytes)
+{
+    auto schema = BinarySchema::Get(type);
+    if (!schema)
+        return false;
+
+    BinaryArchiveHeader header;
+    header.schemaHash = schema->GetHash();
+    header.count = count;
+    Append(bytes, &header, sizeof(header));
+
+    if (schema->IsFlat())
+    {
+        Append(bytes, objects, schema->GetStride() * count);
+        return true;
+    }
+
+    auto ptr = static_cast<const uint8 *>(objects);
+    for (int32 i = 0; i < count; ++i)
+        schema->Write(ptr + schema->GetStride() * i, bytes);
+    return true;
+}
+
+int32 BinaryArchive::PeekCount(const Type *type, const uint8 *data, SizeType size)
+{
+    auto schema = BinarySchema::Get(type);
+    BinaryArchiveHeader header;
+    if (!schema || size < sizeof(header))
+        return -1;
+
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != BinaryArchiveHeader::MAGIC || header.version != BinaryArchiveHeader::VERSION)
+    {
+        CT_LOG(Error, CT_TEXT("Invalid binary archive header."));
+        return -1;
+    }
+    if (header.schemaHash != schema->GetHash())
+    {
+        CT_LOG(Error, CT_TEXT("Binary archive schema mismatch. Type: {0}."), type->GetName().ToString());
+        return -1;
+    }
+
+    // The count comes from the file, it must fit in the data before anyone allocates for it.
+    SizeType payload = size - sizeof(header);
+    SizeType minSize = schema->GetMinSize();
+    if (header.count > INT32_MAX || (minSize > 0 && header.count > payload / minSize))
+    {
+        CT_LOG(Error, CT_TEXT("Binary archive count {0} does not fit its {1} bytes. Type: {2}."), header.count, payload, type->GetName().ToString());
+        return -1;
+    }
+    return static_cast<int32>(header.count);
+}
+
+bool BinaryArchive::Load(const Type *type, void *objects, int32 count, const uint8 *data, SizeType size)
+{
+    int32 stored = PeekCount(type, data, size);
+    if (stored < 0)
+        return false;
+    if (stored != count)
+    {
+        CT_LOG(Error, CT_TEXT("Binary archive holds {0} objects, but {1} requested."), stored, count);
+        return false;
+    }
+
+    auto schema = BinarySchema::Get(type);
+    const uint8 *ptr = data + sizeof(BinaryArchiveHeader);
+    const uint8 *end = data + size;
+
+    if (schema->IsFlat())
+    {
+        SizeType bytes = schema->GetStride() * count;
+        if (static_cast<SizeType>(end - ptr) < bytes)
+            return false;
+        std::memcpy(objects, ptr, bytes);
+        return true;
+    }
+
+    auto dst = static_cast<uint8 *>(objects);
+    for (int32 i = 0; i < count; ++i)
+    {
+        if (!schema->Read(dst + schema->GetStride() * i, ptr, end))
+        {
+            CT_LOG(Error, CT_TEXT("Truncated binary archive. Type: {0}."), type->GetName().ToString());
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Reflection/Type.h"
+#include <mutex>
+
+namespace Reflection
+{
+
+/**
+ * Serialization plan of a reflected type, compiled once from its properties.
+ * Adjacent trivially copyable properties are merged into a single memcpy run,
+ * strings and nested reflected types get their own steps.
+ * Inherited properties assume single non-virtual inheritance, the base lives at offset 0.
+ */
+class BinarySchema
+{
+public:
+    enum class OpCode : uint8
+    {
+        Copy,
+        String,
+        Object,
+    };
+
+    struct Op
+    {
+        OpCode code;
+        SizeType offset;
+        SizeType size;
+        const BinarySchema *schema = nullptr;
+    };
+
+    explicit BinarySchema(const Type *type);
+
+    const Type *GetType() const
+    {
+        return type;
+    }
+
+    SizeType GetStride() const
+    {
+        return stride;
+    }
+
+    // Changes whenever names, types or layout of serialized properties change.
+    uint64 GetHash() const
+    {
+        return hash;
+    }
+
+    const Array<Op> &GetOps() const
+    {
+        return ops;
+    }
+
+    // Fewest bytes one serialized object can take, strings count as their length only.
+    SizeType GetMinSize() const
+    {
+        return minSize;
+    }
+
+    // True when an object is one memcpy, arrays of it are then copied in one go.
+    bool IsFlat() const
+    {
+        return ops.Count() == 1 && ops[0].code == OpCode::Copy && ops[0].offset == 0 && ops[0].size == stride;
+    }
+
+    void Write(const void *obj, Array<uint8> &bytes) const;
+    bool Read(void *obj, const uint8 *&ptr, const uint8 *end) const;
+
+    // Null when the type has a property that can not be located in the object.
+    static const BinarySchema *Get(const Type *type);
+
+private:
+    bool Compile();
+    void AddProperty(const Property *prop);
+
+private:
+    const Type *type;
+    SizeType stride;
+    uint64 hash = 0;
+    SizeType minSize = 0;
+    Array<Op> ops;
+
+    inline static HashMap<const Type *, SPtr<BinarySchema>> schemas;
+    inline static std::recursive_mutex schemasMutex;
+};
+
+struct BinaryArchiveHeader
+{
+    static constexpr uint32 MAGIC = 0x52415443; // "CTAR"
+    static constexpr uint32 VERSION = 1;
+
+    uint32 magic = MAGIC;
+    uint32 version = VERSION;
+    uint64 schemaHash = 0;
+    uint64 count = 0;
+};
+
+class BinaryArchive
+{
+public:
+    // Appends a header and count objects laid out with the type's stride.
+    static bool Save(const Type *type, const void *objects, int32 count, Array<uint8> &bytes);
+    // Objects must be constructed already. Fails if the data was written with another schema.
+    static bool Load(const Type *type, void *objects, int32 count, const uint8 *data, SizeType size);
+    // Object count stored in an archive, -1 if it is not readable with the type's schema.
+    static int32 PeekCount(const Type *type, const uint8 *data, SizeType size);
+
+    template <typename T>
+    static Array<uint8> Save(const T &obj)
+    {
+        Array<uint8> bytes;
+        Save(TypeOf<T>(), &obj, 1, bytes);
+        return bytes;
+    }
+
+    template <typename T>
+    static bool Load(T &obj, const Array<uint8> &bytes)
+    {
+        return Load(TypeOf<T>(), &obj, 1, bytes.GetData(), bytes.Count());
+    }
+
+    template <typename T>
+    static Array<uint8> SaveArray(const Array<T> &objects)
+    {
+        Array<uint8> bytes;
+        Save(TypeOf<T>(), objects.GetData(), objects.Count(), bytes);
+        return bytes;
+    }
+
+    template <typename T>
+    static bool LoadArray(Array<T> &objects, const Array<uint8> &bytes)
+    {
+        int32 count = PeekCount(TypeOf<T>(), bytes.GetData(), bytes.Count());
+        if (count < 0)
+            return false;
+        objects.Clear();
+        objects.SetCount(count);
+        return Load(TypeOf<T>(), objects.GetData(), count, bytes.GetData(), bytes.Count());
+    }
+};
+
+}
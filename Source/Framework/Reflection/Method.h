@@ -2,10 +2,42 @@
 
 #include "Reflection/.Package.h"
 #include "Reflection/ParamInfo.h"
+#include <typeinfo>
 
 namespace Reflection
 {
 
+class Method;
+
+// Calls a reflected method through a cached function pointer, arguments are passed as is without boxing.
+template <typename ReturnType, typename... Args>
+class MethodInvoker
+{
+public:
+    using FuncPtr = ReturnType (*)(const Method *, void *, Args...);
+
+    MethodInvoker() = default;
+
+    MethodInvoker(const Method *method, FuncPtr func)
+        : method(method), func(func)
+    {
+    }
+
+    bool IsValid() const
+    {
+        return func != nullptr;
+    }
+
+    ReturnType operator()(void *obj, Args... args) const
+    {
+        return func(method, obj, std::forward<Args>(args)...);
+    }
+
+private:
+    const Method *method = nullptr;
+    FuncPtr func = nullptr;
+};
+
 class Method : public MetaBase
 {
 protected:
@@ -45,6 +77,16 @@ public:
         return paramInfos;
     }
 
+    // Args must match the registered signature exactly, returns an invalid invoker otherwise.
+    template <typename ReturnType, typename... Args>
+    MethodInvoker<ReturnType, Args...> GetInvoker() const
+    {
+        using FuncPtr = typename MethodInvoker<ReturnType, Args...>::FuncPtr;
+        if (!invokerType || *invokerType != typeid(FuncPtr))
+            return {};
+        return MethodInvoker<ReturnType, Args...>(this, reinterpret_cast<FuncPtr>(invoker));
+    }
+
     virtual Any Invoke(Any obj) const
     {
         CT_EXCEPTION(Reflection, "Not implement");
@@ -92,6 +134,15 @@ protected:
     QualifiedType returnType;
     Array<ParamInfo> paramInfos;
     bool isStatic;
+    void (*invoker)() = nullptr;
+    const std::type_info *invokerType = nullptr;
+
+    template <typename ReturnType, typename... Args>
+    void SetInvoker(ReturnType (*func)(const Method *, void *, Args...))
+    {
+        invoker = reinterpret_cast<void (*)()>(func);
+        invokerType = &typeid(func);
+    }
 };
 
 template <typename OwnerType, typename ReturnType, typename... Args>
@@ -103,6 +154,7 @@ public:
     MemberMethod(const Name &name, FuncPtr func)
         : Method(name, TypeOf<OwnerType>(), GetQualifiedType<ReturnType>(), { GetQualifiedType<Args>()... }), funcPtr(func)
     {
+        SetInvoker(&Call);
     }
 
     virtual Any Invoke(Any obj, typename TAsType<Args, Any>::value... args) const override
@@ -110,6 +162,11 @@ public:
         return (Any)(((OwnerType *)obj)->*funcPtr)((Args)args...);
     }
 
+    static ReturnType Call(const Method *method, void *obj, Args... args)
+    {
+        return (static_cast<OwnerType *>(obj)->*static_cast<const MemberMethod *>(method)->funcPtr)(std::forward<Args>(args)...);
+    }
+
 private:
     FuncPtr funcPtr;
 };
@@ -123,6 +180,7 @@ public:
     MemberMethod(const Name &name, FuncPtr func)
         : Method(name, TypeOf<OwnerType>(), GetQualifiedType<void>(), { GetQualifiedType<Args>()... }), funcPtr(func)
     {
+        SetInvoker(&Call);
     }
 
     virtual Any Invoke(Any obj, typename TAsType<Args, Any>::value... args) const override
@@ -131,6 +189,11 @@ public:
         return Any();
     }
 
+    static void Call(const Method *method, void *obj, Args... args)
+    {
+        (static_cast<OwnerType *>(obj)->*static_cast<const MemberMethod *>(method)->funcPtr)(std::forward<Args>(args)...);
+    }
+
 private:
     FuncPtr funcPtr;
 };
@@ -144,6 +207,7 @@ public:
     StaticMethod(const Name &name, FuncPtr func)
         : Method(name, nullptr, GetQualifiedType<ReturnType>(), { GetQualifiedType<Args>()... }, true), funcPtr(func)
     {
+        SetInvoker(&Call);
     }
 
     virtual Any Invoke(Any obj, typename TAsType<Args, Any>::value... args) const override
@@ -151,6 +215,11 @@ public:
         return funcPtr((Args)args...);
     }
 
+    static ReturnType Call(const Method *method, void *obj, Args... args)
+    {
+        return static_cast<const StaticMethod *>(method)->funcPtr(std::forward<Args>(args)...);
+    }
+
 private:
     FuncPtr funcPtr;
 };
@@ -164,6 +233,7 @@ public:
     StaticMethod(const Name &name, FuncPtr func)
         : Method(name, nullptr, GetQualifiedType<void>(), { GetQualifiedType<Args>()... }, true), funcPtr(func)
     {
+        SetInvoker(&Call);
     }
 
     virtual Any Invoke(Any obj, typename TAsType<Args, Any>::value... args) const override
@@ -172,6 +242,11 @@ public:
         return Any();
     }
 
+    static void Call(const Method *method, void *obj, Args... args)
+    {
+        static_cast<const StaticMethod *>(method)->funcPtr(std::forward<Args>(args)...);
+    }
+
 private:
     FuncPtr funcPtr;
 };
@@ -2,6 +2,7 @@
 
 #include "Reflection/.Package.h"
 #include "Reflection/QualifiedType.h"
+#include <bit>
 
 namespace Reflection
 {
@@ -32,7 +33,53 @@ public:
 
     bool IsReadonly() const
     {
-        return type.IsConst();
+        return readonly || type.IsConst();
+    }
+
+    // Layout of member properties inside the owner, lets callers touch the value without going through Any.
+    // Members reached through virtual bases have none.
+    bool HasLayout() const
+    {
+        return size > 0;
+    }
+
+    SizeType GetOffset() const
+    {
+        return offset;
+    }
+
+    SizeType GetSize() const
+    {
+        return size;
+    }
+
+    bool IsTriviallyCopyable() const
+    {
+        return trivial;
+    }
+
+    // Typed fast path, reads the value in place instead of boxing it into Any.
+    // T must be the exact registered property type.
+    template <typename T>
+    T &GetValueRef(void *obj) const
+    {
+        if (GetQualifiedType<T>().RemoveCV() != type.RemoveCV() || (!isStatic && !HasLayout()))
+            CT_EXCEPTION(Reflection, "Property type mismatch.");
+        return *static_cast<T *>(GetValueAddress(obj));
+    }
+
+    template <typename T>
+    const T &GetValue(const void *obj) const
+    {
+        return GetValueRef<T>(const_cast<void *>(obj));
+    }
+
+    template <typename T>
+    void SetValue(void *obj, const T &value) const
+    {
+        if (IsReadonly())
+            CT_EXCEPTION(Reflection, "Attempt to modify a readonly property.");
+        GetValueRef<T>(obj) = value;
     }
 
     virtual void Set(Any obj, Any value) const
@@ -46,10 +93,37 @@ public:
         return Any();
     }
 
+protected:
+    void *GetValueAddress(void *obj) const
+    {
+        return isStatic ? staticAddress : static_cast<uint8 *>(obj) + offset;
+    }
+
+    template <typename OwnerType, typename PropertyType>
+    void SetLayout(PropertyType OwnerType::*property)
+    {
+        // Like offsetof, without an owner object: a member pointer of a class without virtual bases
+        // is stored as the member's byte offset. Wider member pointers get no layout.
+        using MemberPointer = PropertyType OwnerType::*;
+        if constexpr (sizeof(MemberPointer) == sizeof(int32))
+            offset = static_cast<SizeType>(std::bit_cast<int32>(property));
+        else if constexpr (sizeof(MemberPointer) == sizeof(int64))
+            offset = static_cast<SizeType>(std::bit_cast<int64>(property));
+        else
+            return;
+        size = sizeof(PropertyType);
+        trivial = std::is_trivially_copyable_v<PropertyType>;
+    }
+
 protected:
     Type *ownerType;
     QualifiedType type;
     bool isStatic;
+    SizeType offset = 0;
+    SizeType size = 0;
+    bool trivial = false;
+    bool readonly = false;
+    void *staticAddress = nullptr;
 };
 
 template <typename OwnerType, typename PropertyType>
@@ -59,6 +133,7 @@ public:
     MemberProperty(const Name &name, PropertyType OwnerType::*property)
         : Property(name, TypeOf<OwnerType>(), GetQualifiedType<PropertyType>()), property(property)
     {
+        SetLayout(property);
     }
 
     virtual void Set(Any obj, Any value) const override
@@ -82,6 +157,8 @@ public:
     ReadonlyProperty(const Name &name, PropertyType OwnerType::*property)
         : Property(name, TypeOf<OwnerType>(), GetQualifiedType<PropertyType>()), property(property)
     {
+        SetLayout(property);
+        readonly = true;
     }
 
     virtual void Set(Any obj, Any value) const override
@@ -105,6 +182,7 @@ public:
     StaticProperty(const Name &name, PropertyType *property)
         : Property(name, nullptr, GetQualifiedType<PropertyType>(), true), property(property)
     {
+        staticAddress = const_cast<std::remove_cv_t<PropertyType> *>(property);
     }
 
     virtual void Set(Any obj, Any value) const override
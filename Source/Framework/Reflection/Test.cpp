@@ -79,9 +79,57 @@ void Reflection::TestTypeMacro()
     std::wcout << L"TestNestedEnum is enum? :" << enumType->IsEnum() << std::endl;
 }
 
+void Reflection::TestBinaryArchive()
+{
+    Array<TestClass1> objects;
+    objects.Add(TestClass1(CT_TEXT("First"), 1));
+    objects.Add(TestClass1(CT_TEXT("Second"), 2));
+
+    auto schema = BinarySchema::Get(TypeOf<TestClass1>());
+    std::wcout << L"TestClass1 schema hash: " << schema->GetHash() << L" ops: " << schema->GetOps().Count() << std::endl;
+
+    auto bytes = BinaryArchive::SaveArray(objects);
+    Array<TestClass1> loaded;
+    bool success = BinaryArchive::LoadArray(loaded, bytes);
+    std::wcout << L"Load archive success? " << success << L" bytes: " << bytes.Count() << std::endl;
+    for (const auto &e : loaded)
+        e.Print();
+
+    auto corrupted = bytes;
+    reinterpret_cast<BinaryArchiveHeader *>(corrupted.GetData())->count = 1ull << 40;
+    std::wcout << L"Load corrupted count rejected? " << !BinaryArchive::LoadArray(loaded, corrupted) << std::endl;
+}
+
+void Reflection::TestTypedAccess()
+{
+    Type *type = TypeOf<TestClass1>();
+    auto numProp = type->GetProperty(CT_TEXT("num"));
+    auto incNum = type->GetMethod(CT_TEXT("IncNum"))->GetInvoker<void, int32>();
+    auto getName = type->GetMethod(CT_TEXT("GetName"))->GetInvoker<const String &>();
+
+    Array<TestClass1> objects;
+    objects.SetCount(1000);
+    for (auto &e : objects)
+    {
+        numProp->SetValue<int32>(&e, 1);
+        incNum(&e, 2);
+    }
+
+    int32 sum = 0;
+    for (const auto &e : objects)
+        sum += numProp->GetValue<int32>(&e);
+    std::wcout << L"Typed access sum: " << sum << L" name: " << *getName(&objects[0]) << std::endl;
+
+    Any small = 42;
+    Any large = String(CT_TEXT("Large"));
+    std::wcout << L"Any inline? int32: " << small.IsInline() << L" String: " << large.IsInline() << std::endl;
+}
+
 void Reflection::Test()
 {
     Registry::GetInstance()->PopulateAllTypes();
 
     TestTypeMacro();
+    TestBinaryArchive();
+    TestTypedAccess();
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Reflection/BinaryArchive.h"
 #include "Reflection/Constructor.h"
 #include "Reflection/Method.h"
 #include "Reflection/Property.h"
@@ -76,6 +77,10 @@ void TestBuiltinType();
 
 void TestTypeMacro();
 
+void TestBinaryArchive();
+
+void TestTypedAccess();
+
 void Test();
 
 }
\ No newline at end of file
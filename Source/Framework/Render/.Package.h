@@ -13,6 +13,14 @@ enum class LightType
     Directional = CT_LIGHT_TYPE_DIRECTIONAL,
 };
 
+// Layout of the scene vertex buffers, CT_VERTEX_FORMAT of the scene shaders.
+enum class VertexFormat
+{
+    Full = CT_VERTEX_FORMAT_FULL,
+    Compact = CT_VERTEX_FORMAT_COMPACT,
+    Quantized = CT_VERTEX_FORMAT_QUANTIZED,
+};
+
 CT_DECL_FLAGS(SceneUpdate){
     None = 0,
     MeshesMoved = 1 << 0,
@@ -27,6 +35,8 @@ CT_DECL_FLAGS(SceneUpdate){
 CT_DECL_FLAGS(SceneRender){
     None = 0,
     CustomRasterizationState = 1,
+    // Draw every instance, for passes that do not look through the scene camera.
+    NoCulling = 1 << 1,
 };
 
 struct SceneNode
@@ -46,6 +56,63 @@ struct Viewpoint
     Vector3 up;
 };
 
+// Coarser index list over the vertices of the same mesh, error is the object space distance it may deviate by.
+struct MeshLod
+{
+    Array<uint32> indices;
+    float error = 0.0f;
+};
+
+// Where a level of detail lives in the shared index buffer, level 0 is the full mesh.
+struct MeshLodDesc
+{
+    int32 indexOffset = 0;
+    int32 indexCount = 0;
+    float error = 0.0f;
+};
+
+// Cluster of neighbouring triangles that is culled on its own, a range of the mesh indices.
+// Every triangle normal is within the cone around coneAxis, coneCutoff is the sine of its half angle and 1 when the cone is useless.
+struct Meshlet
+{
+    Vector3 center;
+    float radius = 0.0f;
+    Vector3 coneAxis;
+    float coneCutoff = 1.0f;
+    int32 indexOffset = 0;
+    int32 indexCount = 0;
+};
+
+// Vertex buffers of a scene as the GPU reads them.
+struct PackedVertexBuffers
+{
+    VertexFormat format = VertexFormat::Full;
+    Array<uint8> staticDatas;
+    Array<uint8> dynamicDatas;
+    // Bone matrix IDs of every skinned mesh, compact dynamic vertices index into the range of their mesh.
+    Array<int32> bonePalette;
+    int32 vertexCount = 0;
+    int32 dynamicVertexCount = 0;
+
+    uint32 GetStaticStride() const
+    {
+        switch (format)
+        {
+        case VertexFormat::Compact:
+            return sizeof(CompactVertexData);
+        case VertexFormat::Quantized:
+            return sizeof(QuantizedVertexData);
+        default:
+            return sizeof(StaticVertexData);
+        }
+    }
+
+    uint32 GetDynamicStride() const
+    {
+        return format == VertexFormat::Full ? sizeof(DynamicVertexData) : sizeof(CompactDynamicVertexData);
+    }
+};
+
 struct Mesh
 {
     String name;
@@ -56,6 +123,8 @@ struct Mesh
     Array<Vector2> uvs;
     Array<Vector4I> boneIDs;
     Array<Vector4> boneWeights;
+    Array<MeshLod> lods;
+    Array<Meshlet> meshlets;
     Topology topology = Topology::Undefined;
     SPtr<Material> material;
 };
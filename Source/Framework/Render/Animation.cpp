@@ -1,4 +1,66 @@
 #include "Render/Animation.h"
+#include <cfloat>
+
+namespace
+{
+// Keyframes a cursor walks forward before falling back to a binary search.
+constexpr int32 MAX_CURSOR_STEPS = 4;
+constexpr uint16 ROTATION_MAX = 0x7FFF;
+constexpr float ROTATION_RANGE = 0.70710678f;
+
+uint16 Quantize(float value, float step)
+{
+    if (step == 0.0f)
+        return 0;
+    return (uint16)Math::Clamp(Math::Round(value / step), 0.0f, (float)UINT16_MAX);
+}
+
+// 15 bits for each of the three smallest components, the index of the largest one in the top bits of the first two words.
+void PackRotation(const Quat &rotation, uint16 *packed)
+{
+    Quat q = rotation;
+    q.Normalize();
+
+    int32 largest = 0;
+    for (int32 i = 1; i < 4; ++i)
+    {
+        if (Math::Abs(q[i]) > Math::Abs(q[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, keep the dropped component positive.
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    for (int32 i = 0, j = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        // Every other component is within +-sqrt(1/2).
+        float v = (sign * q[i] / ROTATION_RANGE) * 0.5f + 0.5f;
+        packed[j++] = (uint16)Math::Clamp(Math::Round(v * ROTATION_MAX), 0.0f, (float)ROTATION_MAX);
+    }
+    packed[0] |= (uint16)((largest & 1) << 15);
+    packed[1] |= (uint16)((largest >> 1) << 15);
+}
+
+Quat UnpackRotation(const uint16 *packed)
+{
+    int32 largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+
+    Quat q;
+    float sum = 0.0f;
+    for (int32 i = 0, j = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float v = (float)(packed[j++] & ROTATION_MAX) / ROTATION_MAX;
+        q[i] = (v * 2.0f - 1.0f) * ROTATION_RANGE;
+        sum += q[i] * q[i];
+    }
+    q[largest] = Math::Sqrt(Math::Max(1.0f - sum, 0.0f));
+    return q;
+}
+
+}
 
 SPtr<Animation> Animation::Create(AnimTimeType duration)
 {
@@ -10,7 +72,7 @@ Animation::Animation(AnimTimeType duration)
 {
 }
 
-Matrix4 Animation::Interpolate(const Keyframe &start, const Keyframe &end, AnimTimeType time) const
+Animation::Keyframe Animation::Interpolate(const Keyframe &start, const Keyframe &end, AnimTimeType time) const
 {
     AnimTimeType localTime = time - start.time;
     AnimTimeType keyframeDuration = end.time - start.time;
@@ -18,31 +80,75 @@ Matrix4 Animation::Interpolate(const Keyframe &start, const Keyframe &end, AnimT
         keyframeDuration += duration;
     float factor = keyframeDuration != 0.0 ? (float)(localTime / keyframeDuration) : 1.0f;
 
-    Vector3 translation = Vector3::Lerp(start.translation, end.translation, factor);
-    Vector3 scaling = Vector3::Lerp(start.scaling, end.scaling, factor);
-    Quat rotation = Quat::Slerp(start.rotation, end.rotation, factor);
+    Keyframe ret;
+    ret.time = time;
+    ret.translation = Vector3::Lerp(start.translation, end.translation, factor);
+    ret.scaling = Vector3::Lerp(start.scaling, end.scaling, factor);
+    ret.rotation = Quat::Slerp(start.rotation, end.rotation, factor);
+    return ret;
+}
+
+Animation::AnimTimeType Animation::GetKeyframeTime(int32 index, int32 keyframe) const
+{
+    return IsCompressed() ? tracks[index].times[keyframe] : channels[index].keyframes[keyframe].time;
+}
+
+Animation::Keyframe Animation::GetKeyframeAt(int32 index, int32 keyframe) const
+{
+    if (!IsCompressed())
+        return channels[index].keyframes[keyframe];
 
-    return Matrix4::TRS(translation, rotation, scaling);
+    const auto &track = tracks[index];
+    const auto &packed = track.keyframes[keyframe];
+
+    Keyframe ret;
+    ret.time = track.times[keyframe];
+    for (int32 i = 0; i < 3; ++i)
+    {
+        ret.translation[i] = track.translationMin[i] + track.translationStep[i] * packed.translation[i];
+        ret.scaling[i] = track.scalingMin[i] + track.scalingStep[i] * packed.scaling[i];
+    }
+    ret.rotation = UnpackRotation(packed.rotation);
+    return ret;
 }
 
-Matrix4 Animation::AnimateChannel(Channel &c, AnimTimeType time)
+int32 Animation::FindKeyframe(int32 index, AnimTimeType time, int32 hint) const
 {
-    int32 index = time < c.lastUpdateTime ? 0 : c.lastKeyframe;
-    while (index < c.keyframes.Count() - 1)
+    int32 count = GetKeyframeCount(index);
+    CT_CHECK(count > 0);
+
+    // Playing forward only moves a keyframe or two per call.
+    if (hint >= 0 && hint < count && GetKeyframeTime(index, hint) <= time)
     {
-        if (c.keyframes[index + 1].time > time)
-            break;
-        index++;
+        for (int32 step = 0; step < MAX_CURSOR_STEPS; ++step)
+        {
+            if (hint + 1 == count || GetKeyframeTime(index, hint + 1) > time)
+                return hint;
+            ++hint;
+        }
     }
 
-    int32 nextIndex = index + 1;
-    if (nextIndex == c.keyframes.Count())
-        nextIndex = 0;
+    // Last keyframe not after time, the first one if all are.
+    int32 low = 0, high = count;
+    while (low < high)
+    {
+        int32 mid = (low + high) / 2;
+        if (GetKeyframeTime(index, mid) <= time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return Math::Max(low - 1, 0);
+}
 
-    c.lastUpdateTime = time;
-    c.lastKeyframe = index;
+Animation::Keyframe Animation::Sample(int32 index, AnimTimeType time, int32 &keyframe) const
+{
+    keyframe = FindKeyframe(index, time, keyframe);
+    int32 nextKeyframe = keyframe + 1;
+    if (nextKeyframe == GetKeyframeCount(index))
+        nextKeyframe = 0;
 
-    return Interpolate(c.keyframes[index], c.keyframes[nextIndex], time);
+    return Interpolate(GetKeyframeAt(index, keyframe), GetKeyframeAt(index, nextKeyframe), time);
 }
 
 int32 Animation::AddChannel(int32 matrixID)
@@ -54,9 +160,15 @@ int32 Animation::AddChannel(int32 matrixID)
 void Animation::AddKeyframe(int32 index, const Keyframe &keyframe)
 {
     CT_CHECK(keyframe.time <= duration);
+    CT_CHECK(!IsCompressed());
 
-    channels[index].lastKeyframe = 0;
     auto &frames = channels[index].keyframes;
+    // Importers add keyframes in time order.
+    if (frames.IsEmpty() || frames.Last().time < keyframe.time)
+    {
+        frames.Add(keyframe);
+        return;
+    }
 
     for (int32 i = 0; i < frames.Count(); ++i)
     {
@@ -75,37 +187,99 @@ void Animation::AddKeyframe(int32 index, const Keyframe &keyframe)
     frames.Add(keyframe);
 }
 
-const Animation::Keyframe &Animation::GetKeyframe(int32 index, AnimTimeType time) const
+Animation::Keyframe Animation::GetKeyframe(int32 index, AnimTimeType time) const
+{
+    Keyframe ret;
+    [[maybe_unused]] bool found = TryGetKeyframe(index, time, ret);
+    CT_CHECK(found);
+    return ret;
+}
+
+bool Animation::TryGetKeyframe(int32 index, AnimTimeType time, Keyframe &out) const
+{
+    int32 keyframe = FindKeyframe(index, time, -1);
+    if (GetKeyframeTime(index, keyframe) != time)
+        return false;
+
+    out = GetKeyframeAt(index, keyframe);
+    return true;
+}
+
+void Animation::Compress()
 {
-    for (auto &e : channels[index].keyframes)
+    if (IsCompressed())
+        return;
+
+    tracks.SetCount(channels.Count());
+    for (int32 c = 0; c < channels.Count(); ++c)
     {
-        if (e.time == time)
+        auto &keyframes = channels[c].keyframes;
+        auto &track = tracks[c];
+
+        Vector3 translationMax(-FLT_MAX, -FLT_MAX, -FLT_MAX), scalingMax = translationMax;
+        track.translationMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+        track.scalingMin = track.translationMin;
+        for (const auto &e : keyframes)
+        {
+            track.translationMin = Vector3::Min(track.translationMin, e.translation);
+            translationMax = Vector3::Max(translationMax, e.translation);
+            track.scalingMin = Vector3::Min(track.scalingMin, e.scaling);
+            scalingMax = Vector3::Max(scalingMax, e.scaling);
+        }
+        track.translationStep = (translationMax - track.translationMin) / (float)UINT16_MAX;
+        track.scalingStep = (scalingMax - track.scalingMin) / (float)UINT16_MAX;
+
+        track.times.SetCount(keyframes.Count());
+        track.keyframes.SetCount(keyframes.Count());
+        for (int32 k = 0; k < keyframes.Count(); ++k)
         {
-            return e;
+            const auto &e = keyframes[k];
+            auto &packed = track.keyframes[k];
+            track.times[k] = (float)e.time;
+            for (int32 i = 0; i < 3; ++i)
+            {
+                packed.translation[i] = Quantize(e.translation[i] - track.translationMin[i], track.translationStep[i]);
+                packed.scaling[i] = Quantize(e.scaling[i] - track.scalingMin[i], track.scalingStep[i]);
+            }
+            PackRotation(e.rotation, packed.rotation);
         }
+
+        keyframes.Clear();
+        keyframes.Shrink();
     }
-    // Just throw an exception
-    return channels[index].keyframes[-1];
 }
 
-bool Animation::TryGetKeyframe(int32 index, AnimTimeType time, Keyframe &out) const
+int32 Animation::GetKeyframeMemorySize() const
 {
-    for (auto &e : channels[index].keyframes)
+    int32 size = 0;
+    for (int32 c = 0; c < channels.Count(); ++c)
     {
-        if (e.time == time)
-        {
-            out = e;
-            return true;
-        }
+        if (IsCompressed())
+            size += sizeof(Track) + tracks[c].times.Count() * (sizeof(float) + sizeof(PackedKeyframe));
+        else
+            size += channels[c].keyframes.Count() * sizeof(Keyframe);
+    }
+    return size;
+}
+
+void Animation::Animate(AnimTimeType totalTime, Array<Matrix4> &matrices) const
+{
+    auto time = GetLocalTime(totalTime);
+    for (int32 c = 0; c < channels.Count(); ++c)
+    {
+        int32 keyframe = -1;
+        matrices[channels[c].matrixID] = Sample(c, time, keyframe).ToMatrix4();
     }
-    return false;
 }
 
-void Animation::Animate(AnimTimeType totalTime, Array<Matrix4> &matrices)
+void Animation::Animate(AnimTimeType totalTime, Cursor &cursor, Array<Matrix4> &matrices) const
 {
-    auto time = Math::Fmod(totalTime, duration);
-    for (auto &c : channels)
+    if (cursor.keyframes.Count() != channels.Count())
+        cursor.Reset(channels.Count());
+
+    auto time = GetLocalTime(totalTime);
+    for (int32 c = 0; c < channels.Count(); ++c)
     {
-        matrices[c.matrixID] = AnimateChannel(c, time);
+        matrices[channels[c].matrixID] = Sample(c, time, cursor.keyframes[c]).ToMatrix4();
     }
-}
\ No newline at end of file
+}
@@ -13,6 +13,11 @@ public:
         Vector3 translation;
         Vector3 scaling{ 1.0f, 1.0f, 1.0f };
         Quat rotation;
+
+        Matrix4 ToMatrix4() const
+        {
+            return Matrix4::TRS(translation, rotation, scaling);
+        }
     };
 
     struct Channel
@@ -23,9 +28,22 @@ public:
         }
 
         int32 matrixID;
+        // Source keyframes, released by Compress.
         Array<Keyframe> keyframes;
-        int32 lastKeyframe = 0;
-        AnimTimeType lastUpdateTime = 0;
+    };
+
+    // Playback state of one animated instance, so that any number of them can sample the same animation.
+    struct Cursor
+    {
+        // Keyframe each channel was sampled at last time.
+        Array<int32> keyframes;
+
+        void Reset(int32 channelCount)
+        {
+            keyframes.SetCount(channelCount);
+            for (auto &e : keyframes)
+                e = -1;
+        }
     };
 
 public:
@@ -33,9 +51,35 @@ public:
 
     int32 AddChannel(int32 matrixID);
     void AddKeyframe(int32 index, const Keyframe &keyframe);
-    const Keyframe &GetKeyframe(int32 index, AnimTimeType time) const;
+    Keyframe GetKeyframe(int32 index, AnimTimeType time) const;
     bool TryGetKeyframe(int32 index, AnimTimeType time, Keyframe &out) const;
-    void Animate(AnimTimeType totalTime, Array<Matrix4> &matrices);
+    // Quantizes all keyframes to 16 bits per component and frees the source ones, no keyframe can be added afterwards.
+    void Compress();
+    // Stateless sampling, keyframes are found with a binary search.
+    void Animate(AnimTimeType totalTime, Array<Matrix4> &matrices) const;
+    // Starts the search at the keyframes of the last call, which is what playing forward needs.
+    void Animate(AnimTimeType totalTime, Cursor &cursor, Array<Matrix4> &matrices) const;
+    // Local transform of channel index at a time within the duration, keyframe is the cursor entry of the channel.
+    Keyframe Sample(int32 index, AnimTimeType time, int32 &keyframe) const;
+    Keyframe GetKeyframeAt(int32 index, int32 keyframe) const;
+
+    AnimTimeType GetLocalTime(AnimTimeType totalTime) const
+    {
+        return Math::Fmod(totalTime, duration);
+    }
+
+    bool IsCompressed() const
+    {
+        return !tracks.IsEmpty();
+    }
+
+    int32 GetKeyframeCount(int32 index) const
+    {
+        return IsCompressed() ? tracks[index].times.Count() : channels[index].keyframes.Count();
+    }
+
+    // Bytes taken by the keyframes of all channels.
+    int32 GetKeyframeMemorySize() const;
 
     int32 GetChannelCount() const
     {
@@ -65,11 +109,34 @@ public:
     static SPtr<Animation> Create(AnimTimeType duration);
 
 private:
-    Matrix4 AnimateChannel(Channel &c, AnimTimeType time);
-    Matrix4 Interpolate(const Keyframe &start, const Keyframe &end, AnimTimeType time) const;
+    friend class SceneCache;
+
+    // Translation and scaling relative to the range of their track, rotation as the smallest three components.
+    struct PackedKeyframe
+    {
+        uint16 translation[3];
+        uint16 scaling[3];
+        uint16 rotation[3];
+    };
+
+    struct Track
+    {
+        Vector3 translationMin;
+        Vector3 translationStep;
+        Vector3 scalingMin;
+        Vector3 scalingStep;
+        Array<float> times;
+        Array<PackedKeyframe> keyframes;
+    };
+
+    AnimTimeType GetKeyframeTime(int32 index, int32 keyframe) const;
+    int32 FindKeyframe(int32 index, AnimTimeType time, int32 hint) const;
+    Keyframe Interpolate(const Keyframe &start, const Keyframe &end, AnimTimeType time) const;
 
 private:
     String name;
     Array<Channel> channels;
+    // Compressed keyframes of each channel, empty until Compress.
+    Array<Track> tracks;
     AnimTimeType duration = 0;
 };
\ No newline at end of file
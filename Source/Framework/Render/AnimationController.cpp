@@ -1,11 +1,17 @@
 #include "Render/AnimationController.h"
 #include "Render/Scene.h"
 #include "RenderCore/RenderContext.h"
+#include "Core/Thread.h"
+#include <algorithm>
 
 namespace
 {
 const String WORLD_MATRIX_BUFFER_NAME = CT_TEXT("WorldMatrixBuffer");
 const String INVERSE_TRANSPOSE_WORLD_MATRIX_BUFFER_NAME = CT_TEXT("InverseTransposeWorldMatrixBuffer");
+// Clean matrices between two dirty ones are uploaded along with them when the gap is at most this long.
+constexpr int32 MAX_UPLOAD_GAP = 8;
+// Animated nodes evaluated by one thread at least.
+constexpr int32 ANIMATION_CHUNK_SIZE = 32;
 
 }
 
@@ -22,6 +28,21 @@ AnimationController::AnimationController(Scene *scene)
     globalMatrices.AddUninitialized(matCount);
     invTransposeGlobalMatrices.AddUninitialized(matCount);
     matricesChanged.AddUninitialized(matCount);
+    for (auto &v : matricesChanged)
+        v = false;
+    nodeStamps.AddUninitialized(matCount);
+    for (auto &v : nodeStamps)
+        v = 0;
+    CreateUpdateOrder();
+
+    for (auto *pose : { &restPose, &localPose })
+    {
+        pose->translations.AddUninitialized(matCount);
+        pose->rotations.AddUninitialized(matCount);
+        pose->scalings.AddUninitialized(matCount);
+    }
+    for (int32 i = 0; i < matCount; ++i)
+        scene->nodes[i].transform.Decompose(restPose.translations[i], restPose.rotations[i], restPose.scalings[i]);
 
     int32 vecCount = 4 * matCount;
     worldMatrixBuffer = Buffer::CreateStructured(sizeof(Vector4), vecCount);
@@ -34,6 +55,7 @@ void AnimationController::AddAnimation(int32 meshID, const SPtr<Animation> &anim
     if (!meshes.Contains(meshID))
     {
         meshes.Put(meshID, MeshAnimation());
+        meshes[meshID].layers.Add(AnimationLayer());
     }
     meshes[meshID].animations.Add(anim);
 }
@@ -42,18 +64,23 @@ void AnimationController::ToggleAnimations(bool animate)
 {
     for (auto &[k, v] : meshes)
     {
-        v.activeAnimation = animate ? 0 : -1;
+        v.layers[0].animationID = animate ? 0 : -1;
+        v.layers[0].fadeAnimationID = -1;
+        v.layers[0].cursor.keyframes.Clear();
     }
 
-    //TODO update activeAnimationCount
+    animationChanged = true;
+    UpdateActiveAnimationCount();
+    AllocPrevWorldMatrixBuffer();
 }
 
 bool AnimationController::Animate(RenderContext *ctx, Animation::AnimTimeType currentTime)
 {
-    for (auto &v : matricesChanged)
-        v = false;
+    for (int32 i : updatedNodes)
+        matricesChanged[i] = false;
+    updatedNodes.Clear();
 
-    if (animationChanged == false)
+    if (animationChanged == false && poseChanged == false)
     {
         if (activeAnimationCount == 0)
             return false;
@@ -67,25 +94,20 @@ bool AnimationController::Animate(RenderContext *ctx, Animation::AnimTimeType cu
     else
     {
         InitLocalMatrices();
+        fullUpdate = true;
     }
 
     animationChanged = false;
+    poseChanged = false;
     lastAnimationTime = currentTime;
 
-    for (const auto &[i, m] : meshes)
-    {
-        if (m.activeAnimation == -1)
-            continue;
-        auto &anim = m.animations[m.activeAnimation];
-        anim->Animate(currentTime, localMatrices);
-        for (int32 i = 0; i < anim->GetChannelCount(); ++i)
-        {
-            matricesChanged[anim->GetChannelMatrixID(i)] = true;
-        }
-    }
+    EvaluateAnimations(currentTime);
 
     std::swap(prevWorldMatrixBuffer, worldMatrixBuffer);
+    CollectUpdatedNodes();
     UpdateMatrices();
+    UploadMatrices(ctx);
+    fullUpdate = false;
     BindBuffers();
     ExecuteSkinningPass(ctx);
 
@@ -100,32 +122,7 @@ int32 AnimationController::GetAnimationCount(int32 meshID) const
 
 bool AnimationController::SetActiveAnimationID(int32 meshID, int32 animID)
 {
-    auto ptr = meshes.TryGet(meshID);
-    if (!ptr)
-        return false;
-
-    if (ptr->animations.Count() <= animID)
-        return false;
-
-    if (ptr->activeAnimation != animID)
-    {
-        animationChanged = true;
-
-        int32 oldActiveID = ptr->activeAnimation;
-        ptr->activeAnimation = animID;
-
-        if (oldActiveID == -1)
-        {
-            activeAnimationCount++;
-        }
-        else if (animID == -1)
-        {
-            activeAnimationCount--;
-        }
-        AllocPrevWorldMatrixBuffer();
-    }
-
-    return true;
+    return SetLayerAnimation(meshID, 0, animID);
 }
 
 int32 AnimationController::GetActiveAnimationID(int32 meshID) const
@@ -134,7 +131,7 @@ int32 AnimationController::GetActiveAnimationID(int32 meshID) const
     if (!ptr)
         return -1;
 
-    return ptr->activeAnimation;
+    return ptr->layers[0].animationID;
 }
 
 SPtr<Animation> AnimationController::GetAnimation(int32 meshID, int32 animID) const
@@ -155,13 +152,230 @@ SPtr<Animation> AnimationController::GetActiveAnimation(int32 meshID) const
     if (!ptr)
         return nullptr;
 
-    int32 animID = ptr->activeAnimation;
+    int32 animID = ptr->layers[0].animationID;
     if (animID < 0 || animID >= ptr->animations.Count())
         return nullptr;
 
     return ptr->animations[animID];
 }
 
+AnimationController::MeshAnimation *AnimationController::GetMeshAnimation(int32 meshID, int32 layer)
+{
+    auto ptr = meshes.TryGet(meshID);
+    if (!ptr || layer < 0 || layer >= ptr->layers.Count())
+        return nullptr;
+    return ptr;
+}
+
+bool AnimationController::CrossFade(int32 meshID, int32 animID, Animation::AnimTimeType duration, int32 layer)
+{
+    auto ptr = GetMeshAnimation(meshID, layer);
+    if (!ptr || animID < 0 || animID >= ptr->animations.Count())
+        return false;
+
+    auto &l = ptr->layers[layer];
+    if (l.animationID == animID)
+        return true;
+    if (l.animationID == -1 || duration <= 0.0)
+        return SetLayerAnimation(meshID, layer, animID);
+
+    l.fadeAnimationID = l.animationID;
+    std::swap(l.fadeCursor, l.cursor);
+    l.cursor.keyframes.Clear();
+    l.animationID = animID;
+    // Starts at the next evaluation.
+    l.fadeStart = -1.0;
+    l.fadeDuration = duration;
+    poseChanged = true;
+    return true;
+}
+
+int32 AnimationController::AddLayer(int32 meshID, AnimationBlend blend, float weight)
+{
+    auto ptr = meshes.TryGet(meshID);
+    if (!ptr)
+        return -1;
+
+    ptr->layers.Add(AnimationLayer());
+    ptr->layers.Last().blend = blend;
+    ptr->layers.Last().weight = weight;
+    return ptr->layers.Count() - 1;
+}
+
+bool AnimationController::SetLayerAnimation(int32 meshID, int32 layer, int32 animID)
+{
+    auto ptr = GetMeshAnimation(meshID, layer);
+    if (!ptr || animID < -1 || animID >= ptr->animations.Count())
+        return false;
+
+    auto &l = ptr->layers[layer];
+    if (l.animationID != animID || l.fadeAnimationID != -1)
+    {
+        animationChanged = true;
+        l.animationID = animID;
+        l.fadeAnimationID = -1;
+        l.cursor.keyframes.Clear();
+
+        UpdateActiveAnimationCount();
+        AllocPrevWorldMatrixBuffer();
+    }
+    return true;
+}
+
+bool AnimationController::SetLayerWeight(int32 meshID, int32 layer, float weight)
+{
+    auto ptr = GetMeshAnimation(meshID, layer);
+    if (!ptr)
+        return false;
+
+    ptr->layers[layer].weight = weight;
+    poseChanged = true;
+    return true;
+}
+
+bool AnimationController::SetLayerMask(int32 meshID, int32 layer, const Array<float> &nodeWeights)
+{
+    auto ptr = GetMeshAnimation(meshID, layer);
+    if (!ptr || (!nodeWeights.IsEmpty() && nodeWeights.Count() != scene->nodes.Count()))
+        return false;
+
+    ptr->layers[layer].nodeMask = nodeWeights;
+    poseChanged = true;
+    return true;
+}
+
+void AnimationController::UpdateActiveAnimationCount()
+{
+    activeAnimationCount = 0;
+    for (const auto &[k, v] : meshes)
+    {
+        if (v.IsActive())
+            activeAnimationCount++;
+    }
+}
+
+void AnimationController::EvaluateAnimations(Animation::AnimTimeType currentTime)
+{
+    // Fades and cursors are advanced here, the jobs below only sample.
+    channelSamples.Clear();
+    for (auto &[k, mesh] : meshes)
+    {
+        for (auto &layer : mesh.layers)
+        {
+            if (layer.animationID == -1)
+                continue;
+
+            float fade = 1.0f;
+            if (layer.fadeAnimationID != -1)
+            {
+                if (layer.fadeStart < 0.0)
+                    layer.fadeStart = currentTime;
+                fade = (float)Math::Clamp((currentTime - layer.fadeStart) / layer.fadeDuration, 0.0, 1.0);
+
+                // A finished fade still adds its channels for this frame, so the nodes only the old animation drove go back to rest.
+                float fadeWeight = layer.blend == AnimationBlend::Additive ? layer.weight * (1.0f - fade) : layer.weight;
+                AddChannels(*mesh.animations[layer.fadeAnimationID], layer.fadeCursor, currentTime, layer, fade < 1.0f ? fadeWeight : 0.0f);
+                if (fade >= 1.0f)
+                    layer.fadeAnimationID = -1;
+            }
+            AddChannels(*mesh.animations[layer.animationID], layer.cursor, currentTime, layer, layer.weight * fade);
+        }
+    }
+
+    // Grouped by node, so channels of any mesh or layer that drive the same node end up in one job.
+    std::sort(channelSamples.begin(), channelSamples.end(),
+              [](const ChannelSample &a, const ChannelSample &b) { return a.node != b.node ? a.node < b.node : a.order < b.order; });
+    nodeSampleStarts.Clear();
+    for (int32 i = 0; i < channelSamples.Count(); ++i)
+    {
+        if (i == 0 || channelSamples[i].node != channelSamples[i - 1].node)
+            nodeSampleStarts.Add(i);
+    }
+    nodeSampleStarts.Add(channelSamples.Count());
+
+    // Idle pool threads take a share of the nodes each, the calling thread takes the first one.
+    auto &pool = ThreadPool::GetGlobal();
+    int32 count = nodeSampleStarts.Count() - 1;
+    int32 threadCount = Math::Min((count + ANIMATION_CHUNK_SIZE - 1) / ANIMATION_CHUNK_SIZE, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1);
+    threadCount = Math::Max(threadCount, 1);
+    int32 chunkSize = (count + threadCount - 1) / threadCount;
+
+    auto Evaluate = [this, count, chunkSize](int32 chunk) {
+        int32 end = Math::Min((chunk + 1) * chunkSize, count);
+        for (int32 i = chunk * chunkSize; i < end; ++i)
+        {
+            int32 node = channelSamples[nodeSampleStarts[i]].node;
+            localPose.translations[node] = restPose.translations[node];
+            localPose.rotations[node] = restPose.rotations[node];
+            localPose.scalings[node] = restPose.scalings[node];
+            for (int32 s = nodeSampleStarts[i]; s < nodeSampleStarts[i + 1]; ++s)
+                ApplyChannel(channelSamples[s]);
+            localMatrices[node] = Matrix4::TRS(localPose.translations[node], localPose.rotations[node], localPose.scalings[node]);
+        }
+    };
+
+    Array<ThreadPool::Handle> handles;
+    for (int32 i = 1; i < threadCount; ++i)
+    {
+        handles.Add(pool.Run(CT_TEXT("Animation"), [&Evaluate, i]() { Evaluate(i); }));
+    }
+    Evaluate(0);
+    for (auto &handle : handles)
+        handle.Wait();
+
+    for (int32 i = 0; i < count; ++i)
+        dirtyNodes.Add(channelSamples[nodeSampleStarts[i]].node);
+}
+
+void AnimationController::AddChannels(const Animation &anim, Animation::Cursor &cursor, Animation::AnimTimeType currentTime, const AnimationLayer &layer, float weight)
+{
+    if (cursor.keyframes.Count() != anim.GetChannelCount())
+        cursor.Reset(anim.GetChannelCount());
+
+    auto time = anim.GetLocalTime(currentTime);
+    for (int32 c = 0; c < anim.GetChannelCount(); ++c)
+    {
+        int32 node = anim.GetChannelMatrixID(c);
+        float w = layer.nodeMask.IsEmpty() ? weight : weight * layer.nodeMask[node];
+        channelSamples.Add({ node, channelSamples.Count(), &anim, c, time, &cursor.keyframes[c], layer.blend, Math::Max(w, 0.0f) });
+    }
+}
+
+void AnimationController::ApplyChannel(const ChannelSample &channel)
+{
+    if (channel.weight <= 0.0f)
+        return;
+
+    const auto &anim = *channel.anim;
+    int32 c = channel.channel;
+    float w = channel.weight;
+    auto sample = anim.Sample(c, channel.time, *channel.keyframe);
+    auto &translation = localPose.translations[channel.node];
+    auto &rotation = localPose.rotations[channel.node];
+    auto &scaling = localPose.scalings[channel.node];
+
+    if (channel.blend == AnimationBlend::Additive)
+    {
+        // Relative to the first keyframe, which is taken as the reference pose of the animation.
+        auto reference = anim.GetKeyframeAt(c, 0);
+        translation += (sample.translation - reference.translation) * w;
+        rotation = rotation * Quat::Slerp(Quat(), reference.rotation.Inverse() * sample.rotation, w);
+        scaling = scaling * Vector3::Lerp(Vector3::ONE, sample.scaling / reference.scaling, w);
+    }
+    else if (w >= 1.0f)
+    {
+        translation = sample.translation;
+        rotation = sample.rotation;
+        scaling = sample.scaling;
+    }
+    else
+    {
+        translation = Vector3::Lerp(translation, sample.translation, w);
+        rotation = Quat::Slerp(rotation, sample.rotation, w);
+        scaling = Vector3::Lerp(scaling, sample.scaling, w);
+    }
+}
+
 void AnimationController::AllocPrevWorldMatrixBuffer()
 {
     if (activeAnimationCount > 0)
@@ -185,18 +399,77 @@ void AnimationController::InitLocalMatrices()
     }
 }
 
-void AnimationController::UpdateMatrices()
+void AnimationController::CreateUpdateOrder()
 {
-    globalMatrices = localMatrices;
+    const auto &nodes = scene->nodes;
+    updateOrder.Reserve(nodes.Count());
+    for (int32 i = 0; i < nodes.Count(); ++i)
+    {
+        if (nodes[i].parent == -1)
+            updateOrder.Add(i);
+    }
+    for (int32 head = 0; head < updateOrder.Count(); ++head)
+    {
+        for (int32 child : nodes[updateOrder[head]].children)
+            updateOrder.Add(child);
+    }
+    CT_CHECK(updateOrder.Count() == nodes.Count());
 
-    auto &nodes = scene->nodes;
-    for (int32 i = 0; i < globalMatrices.Count(); ++i)
+    nodeRanks.AddUninitialized(nodes.Count());
+    for (int32 i = 0; i < updateOrder.Count(); ++i)
+        nodeRanks[updateOrder[i]] = i;
+}
+
+void AnimationController::CollectUpdatedNodes()
+{
+    if (fullUpdate)
     {
-        if (nodes[i].parent != -1)
+        dirtyNodes.Clear();
+        updatedNodes = updateOrder;
+        return;
+    }
+
+    if (++stamp == 0)
+    {
+        for (auto &v : nodeStamps)
+            v = 0;
+        stamp = 1;
+    }
+
+    // A dirty ancestor is visited first and takes its dirty descendants along with its subtree.
+    const auto &nodes = scene->nodes;
+    dirtyNodes.Sort([&](int32 a, int32 b) { return nodeRanks[a] < nodeRanks[b]; });
+    for (int32 root : dirtyNodes)
+    {
+        if (nodeStamps[root] == stamp)
+            continue;
+
+        nodeStamps[root] = stamp;
+        int32 head = updatedNodes.Count();
+        updatedNodes.Add(root);
+        for (; head < updatedNodes.Count(); ++head)
         {
-            globalMatrices[i] = globalMatrices[nodes[i].parent] * globalMatrices[i];
-            matricesChanged[i] = matricesChanged[i] || matricesChanged[nodes[i].parent];
+            for (int32 child : nodes[updatedNodes[head]].children)
+            {
+                nodeStamps[child] = stamp;
+                updatedNodes.Add(child);
+            }
         }
+    }
+    dirtyNodes.Clear();
+}
+
+void AnimationController::UpdateMatrices()
+{
+    auto &nodes = scene->nodes;
+    for (int32 i : updatedNodes)
+    {
+        matricesChanged[i] = true;
+
+        if (nodes[i].parent != -1)
+            globalMatrices[i] = globalMatrices[nodes[i].parent] * localMatrices[i];
+        else
+            globalMatrices[i] = localMatrices[i];
 
         invTransposeGlobalMatrices[i] = globalMatrices[i].Inverse().Transpose();
 
@@ -206,8 +479,51 @@ void AnimationController::UpdateMatrices()
             invTransposeSkinningMatrices[i] = skinningMatrices[i].Inverse().Transpose();
         }
     }
-    worldMatrixBuffer->SetBlob(globalMatrices.GetData(), 0, worldMatrixBuffer->GetSize());
-    invTransposeWorldMatrixBuffer->SetBlob(invTransposeGlobalMatrices.GetData(), 0, invTransposeWorldMatrixBuffer->GetSize());
+}
+
+void AnimationController::UploadMatrices(RenderContext *ctx)
+{
+    auto upload = [&](Buffer *buffer, const Array<Matrix4> &matrices, int32 begin, int32 end) {
+        buffer->SetBlob(matrices.GetData() + begin, sizeof(Matrix4) * begin, sizeof(Matrix4) * (end - begin));
+    };
+    auto uploadAll = [&](int32 begin, int32 end) {
+        upload(worldMatrixBuffer.get(), globalMatrices, begin, end);
+        upload(invTransposeWorldMatrixBuffer.get(), invTransposeGlobalMatrices, begin, end);
+        if (skinningPass)
+        {
+            upload(skinningMatrixBuffer.get(), skinningMatrices, begin, end);
+            upload(invTransposeSkinningMatrixBuffer.get(), invTransposeSkinningMatrices, begin, end);
+        }
+    };
+
+    if (fullUpdate)
+    {
+        uploadAll(0, globalMatrices.Count());
+        return;
+    }
+
+    if (updatedNodes.IsEmpty())
+        return;
+
+    // The swapped in buffer still holds the matrices of two frames ago, bring it up to date before patching.
+    if (worldMatrixBuffer != prevWorldMatrixBuffer)
+        ctx->CopyResource(worldMatrixBuffer.get(), prevWorldMatrixBuffer.get());
+
+    // Only the set of updated nodes is needed from here on, sort it to find contiguous ranges.
+    updatedNodes.Sort();
+    int32 begin = updatedNodes[0];
+    int32 end = begin + 1;
+    for (int32 i = 1; i < updatedNodes.Count(); ++i)
+    {
+        int32 node = updatedNodes[i];
+        if (node - end > MAX_UPLOAD_GAP)
+        {
+            uploadAll(begin, end);
+            begin = node;
+        }
+        end = node + 1;
+    }
+    uploadAll(begin, end);
 }
 
 void AnimationController::BindBuffers()
@@ -217,27 +533,33 @@ void AnimationController::BindBuffers()
     //TODO sceneBlock prevWorldMatrixBuffer
 }
 
-void AnimationController::CreateSkinningPass(const Array<StaticVertexData> &staticDatas, const Array<DynamicVertexData> &dynamicDatas)
+void AnimationController::CreateSkinningPass(const PackedVertexBuffers &vertices)
 {
-    if (dynamicDatas.IsEmpty())
+    if (vertices.dynamicVertexCount == 0)
         return;
 
     int32 matCount = scene->nodes.Count();
     skinningMatrices.AddUninitialized(matCount);
     invTransposeSkinningMatrices.AddUninitialized(matCount);
 
-    skinningPass = ComputePass::Create(CT_TEXT("Assets/Shaders/Scene/Skinning.glsl"));
+    skinningPass = ComputePass::Create(CT_TEXT("Assets/Shaders/Scene/Skinning.glsl"), scene->GetSceneDefines());
     auto var = skinningPass->GetRootVar();
     var["SkinnedVertexBuffer"] = scene->GetStaticVertexBuffer();
     var["PrevSkinnedVertexBuffer"] = scene->GetPrevVertexBuffer();
 
     ResourceBindFlags bindFlags = ResourceBind::ShaderResource | ResourceBind::UnorderedAccess;
-    auto staticBuffer = Buffer::CreateStructured(sizeof(StaticVertexData), staticDatas.Count(), bindFlags);
-    auto dynamiBuffer = Buffer::CreateStructured(sizeof(StaticVertexData), dynamicDatas.Count(), bindFlags);
-    staticBuffer->SetBlob(staticDatas.GetData(), 0, staticBuffer->GetSize());
-    dynamiBuffer->SetBlob(dynamicDatas.GetData(), 0, dynamiBuffer->GetSize());
+    auto staticBuffer = Buffer::CreateStructured(vertices.GetStaticStride(), vertices.vertexCount, bindFlags);
+    auto dynamiBuffer = Buffer::CreateStructured(vertices.GetDynamicStride(), vertices.dynamicVertexCount, bindFlags);
+    staticBuffer->SetBlob(vertices.staticDatas.GetData(), 0, staticBuffer->GetSize());
+    dynamiBuffer->SetBlob(vertices.dynamicDatas.GetData(), 0, dynamiBuffer->GetSize());
     var["StaticVertexBuffer"] = staticBuffer;
     var["DynamicVertexBuffer"] = dynamiBuffer;
+    if (!vertices.bonePalette.IsEmpty())
+    {
+        auto paletteBuffer = Buffer::CreateStructured(sizeof(int32), vertices.bonePalette.Count(), bindFlags);
+        paletteBuffer->SetBlob(vertices.bonePalette.GetData(), 0, paletteBuffer->GetSize());
+        var["BonePaletteBuffer"] = paletteBuffer;
+    }
 
     int32 vecCount = 4 * matCount;
     skinningMatrixBuffer = Buffer::CreateStructured(sizeof(Vector4), vecCount);
@@ -245,17 +567,15 @@ void AnimationController::CreateSkinningPass(const Array<StaticVertexData> &stat
     var["BoneMatrixBuffer"] = skinningMatrixBuffer;
     var["InverseTransposeBoneMatrixBuffer"] = invTransposeSkinningMatrixBuffer;
     var["WorldMatrixBuffer"] = worldMatrixBuffer;
-    var["InverseTransposeBoneMatrixBuffer"] = invTransposeWorldMatrixBuffer;
+    var["InverseTransposeWorldMatrixBuffer"] = invTransposeWorldMatrixBuffer;
 
-    skinningDispatchSize = dynamicDatas.Count();
+    skinningDispatchSize = vertices.dynamicVertexCount;
 }
 
 void AnimationController::ExecuteSkinningPass(RenderContext *ctx)
 {
     if (!skinningPass)
         return;
-    
-    skinningMatrixBuffer->SetBlob(skinningMatrices.GetData(), 0, skinningMatrixBuffer->GetSize());
-    invTransposeSkinningMatrixBuffer->SetBlob(invTransposeSkinningMatrices.GetData(), 0, invTransposeSkinningMatrixBuffer->GetSize());
+
     skinningPass->Execute(ctx, skinningDispatchSize, 1, 1);
 }
\ No newline at end of file
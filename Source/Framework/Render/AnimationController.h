@@ -7,6 +7,14 @@
 
 class Scene;
 
+enum class AnimationBlend
+{
+    // Replaces the pose below by weight.
+    Override,
+    // Adds the difference of the animation to its first keyframe on top of the pose below.
+    Additive,
+};
+
 class AnimationController
 {
 public:
@@ -20,12 +28,26 @@ public:
     int32 GetActiveAnimationID(int32 meshID) const;
     SPtr<Animation> GetAnimation(int32 meshID, int32 animID) const;
     SPtr<Animation> GetActiveAnimation(int32 meshID) const;
+    // Blends from the current animation of the layer to animID over duration seconds.
+    bool CrossFade(int32 meshID, int32 animID, Animation::AnimTimeType duration, int32 layer = 0);
+    // Layers are evaluated in order on top of the base one, which SetActiveAnimationID drives. Returns the layer index.
+    int32 AddLayer(int32 meshID, AnimationBlend blend, float weight = 1.0f);
+    bool SetLayerAnimation(int32 meshID, int32 layer, int32 animID);
+    bool SetLayerWeight(int32 meshID, int32 layer, float weight);
+    // Scales the layer weight per node, nodeWeights is indexed by node and an empty array clears the mask.
+    bool SetLayerMask(int32 meshID, int32 layer, const Array<float> &nodeWeights);
 
     const Array<Matrix4> &GetGlobalMatrices() const
     {
         return globalMatrices;
     }
 
+    // Updated together with the global matrices, transposing gives the inverse without inverting again.
+    const Array<Matrix4> &GetInvTransposeGlobalMatrices() const
+    {
+        return invTransposeGlobalMatrices;
+    }
+
     bool DidMatrixChanged(int32 matrixID) const
     {
         return matricesChanged[matrixID];
@@ -39,33 +61,104 @@ public:
     static UPtr<AnimationController> Create(Scene *scene);
 
 private:
-    void CreateSkinningPass(const Array<StaticVertexData> &staticDatas, const Array<DynamicVertexData> &dynamicDatas);
+    void CreateSkinningPass(const PackedVertexBuffers &vertices);
     void ExecuteSkinningPass(RenderContext *ctx);
     void AllocPrevWorldMatrixBuffer();
     void InitLocalMatrices();
+    void EvaluateAnimations(Animation::AnimTimeType currentTime);
+    void CreateUpdateOrder();
+    void CollectUpdatedNodes();
     void UpdateMatrices();
+    void UploadMatrices(RenderContext *ctx);
     void BindBuffers();
 
 private:
     friend class SceneBuilder;
 
+    struct AnimationLayer
+    {
+        int32 animationID = -1;
+        AnimationBlend blend = AnimationBlend::Override;
+        float weight = 1.0f;
+        Array<float> nodeMask;
+        // Animation being faded out, -1 when there is none.
+        int32 fadeAnimationID = -1;
+        Animation::AnimTimeType fadeStart = 0.0;
+        Animation::AnimTimeType fadeDuration = 0.0;
+        Animation::Cursor cursor;
+        Animation::Cursor fadeCursor;
+    };
+
     struct MeshAnimation
     {
         Array<SPtr<Animation>> animations;
-        int32 activeAnimation = -1;
+        Array<AnimationLayer> layers;
+
+        bool IsActive() const
+        {
+            for (const auto &layer : layers)
+            {
+                if (layer.animationID != -1)
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    // Local transforms by node, one array per component.
+    struct Pose
+    {
+        Array<Vector3> translations;
+        Array<Quat> rotations;
+        Array<Vector3> scalings;
     };
 
+    // A channel of an animation in use. The channels of a node are applied on top of its rest pose in the order they were added.
+    struct ChannelSample
+    {
+        int32 node;
+        int32 order;
+        const Animation *anim;
+        int32 channel;
+        Animation::AnimTimeType time;
+        int32 *keyframe; // Cursor of the channel.
+        AnimationBlend blend;
+        // Channels of zero weight only put their node back to rest.
+        float weight;
+    };
+
+    MeshAnimation *GetMeshAnimation(int32 meshID, int32 layer);
+    void AddChannels(const Animation &anim, Animation::Cursor &cursor, Animation::AnimTimeType currentTime, const AnimationLayer &layer, float weight);
+    void ApplyChannel(const ChannelSample &channel);
+    void UpdateActiveAnimationCount();
+
     Scene *scene;
     int32 activeAnimationCount = 0;
     Animation::AnimTimeType lastAnimationTime = 0.0;
     bool animationChanged = true;
+    // Weights or fades changed, the pose must be evaluated again even if the time did not move.
+    bool poseChanged = false;
 
     HashMap<int32, MeshAnimation> meshes;
 
+    Pose restPose;
+    Pose localPose;
+    Array<ChannelSample> channelSamples;
+    // Start of the samples of each animated node, one past the last sample at the end.
+    Array<int32> nodeSampleStarts;
     Array<Matrix4> localMatrices;
     Array<Matrix4> globalMatrices;
     Array<Matrix4> invTransposeGlobalMatrices;
     Array<bool> matricesChanged;
+    // Breadth first node order, parents come before their children. nodeRanks is the position of each node in it.
+    Array<int32> updateOrder;
+    Array<int32> nodeRanks;
+    // Nodes animated this frame, and every node whose global matrix was recomputed, parents first.
+    Array<int32> dirtyNodes;
+    Array<int32> updatedNodes;
+    Array<uint32> nodeStamps;
+    uint32 stamp = 0;
+    bool fullUpdate = true;
     SPtr<Buffer> worldMatrixBuffer;
     SPtr<Buffer> prevWorldMatrixBuffer;
     SPtr<Buffer> invTransposeWorldMatrixBuffer;
@@ -23,6 +23,18 @@ static Vector2 ConvertScreenPosition(float x, float y, float viewportW, float vi
     return Vector2(x * 2.0f - 1.0f, -(y * 2.0f - 1.0f));
 }
 
+Ray CameraController::GetPickRay(float x, float y) const
+{
+    Vector2 ndc = ConvertScreenPosition(x, y, viewportWidth, viewportHeight);
+    const Matrix4 &invViewProj = camera->GetInvViewProjection();
+    Vector4 nearPoint = invViewProj * Vector4(ndc.x, ndc.y, -1.0f, 1.0f);
+    Vector4 farPoint = invViewProj * Vector4(ndc.x, ndc.y, 1.0f, 1.0f);
+
+    Vector3 origin = Vector3(nearPoint) * (1.0f / nearPoint.w);
+    Vector3 direction = Vector3(farPoint) * (1.0f / farPoint.w) - origin;
+    return Ray(origin, direction.Normalize());
+}
+
 void OrbiterCameraController::SetModelParams(const Vector3 &center, float radius, float distance)
 {
     modelCenter = center;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Application/InputEvent.h"
+#include "Math/Ray.h"
 #include "Render/Camera.h"
 
 class CameraController
@@ -70,6 +71,9 @@ public:
         return camera;
     }
 
+    // World space ray through a viewport position in pixels, for picking.
+    Ray GetPickRay(float x, float y) const;
+
 protected:
     SPtr<Camera> camera;
     float speed = 0.1f;
@@ -1,5 +1,74 @@
 #pragma once
 
+#include "Core/HashMap.h"
+#include "Render/Pixmap.h"
+
+// Glyph metrics and the atlas they were rasterized into. The atlas is RGBA8 with white color, coverage or distance is in alpha.
 class Font
 {
-};
\ No newline at end of file
+public:
+    struct Glyph
+    {
+        uint32 codepoint = 0;
+        // Rectangle in the atlas, rows go down from the top. Empty for glyphs without a bitmap, like a space.
+        int32 x = 0;
+        int32 y = 0;
+        int32 width = 0;
+        int32 height = 0;
+        // From the pen position on the baseline to the top left of the bitmap, y goes up.
+        int32 bearingX = 0;
+        int32 bearingY = 0;
+        float advance = 0.0f;
+    };
+
+    struct Metrics
+    {
+        int32 size = 0;
+        float ascender = 0.0f;
+        float descender = 0.0f;
+        float lineHeight = 0.0f;
+        // With a distance field the edge sits at alpha 0.5 and alpha falls to 0 spread texels outside it, bitmaps are padded by the spread.
+        bool sdf = false;
+        int32 sdfSpread = 0;
+    };
+
+    Font(const Metrics &metrics, Array<Glyph> glyphs, const SPtr<Pixmap> &atlas)
+        : metrics(metrics), glyphs(std::move(glyphs)), atlas(atlas)
+    {
+        for (int32 i = 0; i < this->glyphs.Count(); ++i)
+            glyphIndices.Put(this->glyphs[i].codepoint, i);
+    }
+
+    // Nullptr when the font has no glyph for the codepoint.
+    const Glyph *GetGlyph(uint32 codepoint) const
+    {
+        const int32 *index = glyphIndices.TryGet(codepoint);
+        return index ? &glyphs[*index] : nullptr;
+    }
+
+    const Array<Glyph> &GetGlyphs() const
+    {
+        return glyphs;
+    }
+
+    const Metrics &GetMetrics() const
+    {
+        return metrics;
+    }
+
+    const SPtr<Pixmap> &GetAtlas() const
+    {
+        return atlas;
+    }
+
+    static SPtr<Font> Create(const Metrics &metrics, Array<Glyph> glyphs, const SPtr<Pixmap> &atlas)
+    {
+        return Memory::MakeShared<Font>(metrics, std::move(glyphs), atlas);
+    }
+
+private:
+    Metrics metrics;
+    Array<Glyph> glyphs;
+    HashMap<uint32, int32> glyphIndices;
+    SPtr<Pixmap> atlas;
+};
@@ -1,15 +1,256 @@
 #include "Render/FontGenerator.h"
+#include "Core/Thread.h"
+#include "IO/CookCache.h"
+#include "Render/TextureAtlas.h"
+#include <atomic>
+#include <cstring>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+
+namespace
+{
+// Glyphs per job when rasterizing on several threads, a worker opens its own face so a job should be worth it.
+constexpr int32 GLYPH_CHUNK_SIZE = 16;
+constexpr int32 MAX_ATLAS_SIZE = 8192;
+// Squared distance of texels with nothing to measure to yet.
+constexpr float SDF_INF = 1e20f;
+
+struct FontCacheHeader
+{
+    static constexpr uint32 MAGIC = 0x43465443; // "CTFC"
+    static constexpr uint32 VERSION = 1;
+
+    uint32 magic = MAGIC;
+    uint32 version = VERSION;
+    uint64 key = 0;
+    Font::Metrics metrics;
+    int32 glyphCount = 0;
+    int32 atlasWidth = 0;
+    int32 atlasHeight = 0;
+};
+
+// Sorted and without duplicates, so the order the characters are listed in does not matter.
+Array<uint32> GetCodepoints(const String &characters)
+{
+    Array<uint32> codepoints;
+    const CharType *ptr = characters.CStr();
+    const CharType *end = ptr + characters.Length();
+    while (ptr < end)
+    {
+        char32 codepoint = 0;
+        int32 count = StringEncode::WideToUTF32(ptr, end, &codepoint);
+        if (count <= 0)
+        {
+            ++ptr;
+            continue;
+        }
+        ptr += count;
+        codepoints.Add(static_cast<uint32>(codepoint));
+    }
+
+    codepoints.Sort();
+    int32 unique = 0;
+    for (int32 i = 0; i < codepoints.Count(); ++i)
+    {
+        if (i == 0 || codepoints[i] != codepoints[unique - 1])
+            codepoints[unique++] = codepoints[i];
+    }
+    codepoints.SetCount(unique);
+    return codepoints;
+}
+
+bool OpenFace(const Array<uint8> &bytes, int32 size, FT_Library &library, FT_Face &face)
+{
+    library = nullptr;
+    face = nullptr;
+    if (FT_Init_FreeType(&library))
+        return false;
+    if (FT_New_Memory_Face(library, bytes.GetData(), bytes.Count(), 0, &face) || FT_Set_Pixel_Sizes(face, 0, size))
+    {
+        FT_Done_FreeType(library);
+        library = nullptr;
+        face = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Squared distance transform of one row or column, Felzenszwalb and Huttenlocher's lower envelope of parabolas.
+void DistanceTransform(float *grid, int32 offset, int32 stride, int32 length, float *f, int32 *v, float *z)
+{
+    v[0] = 0;
+    z[0] = -SDF_INF;
+    z[1] = SDF_INF;
+    f[0] = grid[offset];
+    for (int32 q = 1, k = 0; q < length; ++q)
+    {
+        f[q] = grid[offset + q * stride];
+        float s;
+        do
+        {
+            int32 r = v[k];
+            s = (f[q] - f[r] + static_cast<float>(q * q - r * r)) / (2.0f * (q - r));
+        } while (s <= z[k] && --k > -1);
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_INF;
+    }
+    for (int32 q = 0, k = 0; q < length; ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+        int32 r = v[k];
+        grid[offset + q * stride] = f[r] + static_cast<float>((q - r) * (q - r));
+    }
+}
+
+void DistanceTransform(Array<float> &grid, int32 width, int32 height)
+{
+    int32 length = Math::Max(width, height);
+    Array<float> f;
+    Array<int32> v;
+    Array<float> z;
+    f.AddUninitialized(length);
+    v.AddUninitialized(length);
+    z.AddUninitialized(length + 1);
+    for (int32 x = 0; x < width; ++x)
+        DistanceTransform(grid.GetData(), x, width, height, f.GetData(), v.GetData(), z.GetData());
+    for (int32 y = 0; y < height; ++y)
+        DistanceTransform(grid.GetData(), y * width, 1, width, f.GetData(), v.GetData(), z.GetData());
+}
+
+// Replaces the coverage with a distance field padded by the spread on every side. Partly covered texels place the edge
+// inside the texel, so the field is smoother than the one of a thresholded bitmap.
+void GenerateDistanceField(Array<uint8> &alpha, int32 &width, int32 &height, int32 spread)
+{
+    int32 fieldWidth = width + spread * 2;
+    int32 fieldHeight = height + spread * 2;
+    Array<float> outer;
+    Array<float> inner;
+    outer.AddUninitialized(fieldWidth * fieldHeight);
+    inner.AddUninitialized(fieldWidth * fieldHeight);
+    std::fill(outer.begin(), outer.end(), SDF_INF);
+    std::fill(inner.begin(), inner.end(), 0.0f);
+
+    for (int32 y = 0; y < height; ++y)
+    {
+        for (int32 x = 0; x < width; ++x)
+        {
+            float coverage = alpha[y * width + x] / 255.0f;
+            int32 index = (y + spread) * fieldWidth + x + spread;
+            if (coverage >= 1.0f)
+            {
+                outer[index] = 0.0f;
+                inner[index] = SDF_INF;
+            }
+            else if (coverage > 0.0f)
+            {
+                float d = 0.5f - coverage;
+                outer[index] = d > 0.0f ? d * d : 0.0f;
+                inner[index] = d < 0.0f ? d * d : 0.0f;
+            }
+        }
+    }
+
+    DistanceTransform(outer, fieldWidth, fieldHeight);
+    DistanceTransform(inner, fieldWidth, fieldHeight);
+
+    alpha.SetCount(fieldWidth * fieldHeight);
+    for (int32 i = 0; i < fieldWidth * fieldHeight; ++i)
+    {
+        float distance = Math::Sqrt(outer[i]) - Math::Sqrt(inner[i]);
+        alpha[i] = static_cast<uint8>(Math::RoundToInt(Math::Clamp(0.5f - distance / (2.0f * spread), 0.0f, 1.0f) * 255.0f));
+    }
+    width = fieldWidth;
+    height = fieldHeight;
+}
+
+struct RasterGlyph
+{
+    Font::Glyph glyph;
+    Array<uint8> alpha;
+    bool valid = false;
+};
+
+bool RasterizeGlyph(FT_Face face, uint32 codepoint, const FontGenerator::Options &options, RasterGlyph &result)
+{
+    FT_UInt index = FT_Get_Char_Index(face, codepoint);
+    if (index == 0 || FT_Load_Glyph(face, index, FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP))
+        return false;
+
+    FT_GlyphSlot slot = face->glyph;
+    if (slot->format == FT_GLYPH_FORMAT_OUTLINE)
+    {
+        if (options.bold)
+            FT_GlyphSlot_Embolden(slot);
+        if (options.italic)
+            FT_GlyphSlot_Oblique(slot);
+    }
+    if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL))
+        return false;
+
+    const FT_Bitmap &bitmap = slot->bitmap;
+    if (bitmap.width > 0 && bitmap.rows > 0 && bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+        return false;
+    auto &glyph = result.glyph;
+    glyph.codepoint = codepoint;
+    glyph.width = static_cast<int32>(bitmap.width);
+    glyph.height = static_cast<int32>(bitmap.rows);
+    glyph.bearingX = slot->bitmap_left;
+    glyph.bearingY = slot->bitmap_top;
+    glyph.advance = slot->advance.x / 64.0f;
+
+    result.alpha.SetCount(glyph.width * glyph.height);
+    for (int32 y = 0; y < glyph.height; ++y)
+    {
+        // A negative pitch means the rows are stored bottom up.
+        const uint8 *row = bitmap.buffer + (bitmap.pitch >= 0 ? y : glyph.height - 1 - y) * Math::Abs(bitmap.pitch);
+        std::memcpy(&result.alpha[y * glyph.width], row, glyph.width);
+    }
+
+    if (options.sdf && glyph.width > 0 && glyph.height > 0)
+    {
+        GenerateDistanceField(result.alpha, glyph.width, glyph.height, options.sdfSpread);
+        glyph.bearingX -= options.sdfSpread;
+        glyph.bearingY += options.sdfSpread;
+    }
+    return true;
+}
+
+SPtr<Pixmap> CreateAtlas(int32 width, int32 height)
+{
+    // White with the glyphs in alpha, so text can be tinted by the vertex color.
+    auto atlas = Pixmap::Create(width, height, ResourceFormat::RGBA8Unorm);
+    atlas->Fill(Color(1.0f, 1.0f, 1.0f, 0.0f));
+    return atlas;
+}
+
+void CopyGlyph(Pixmap &atlas, const Font::Glyph &glyph, const uint8 *alpha)
+{
+    auto texels = static_cast<uint8 *>(atlas.GetData());
+    for (int32 y = 0; y < glyph.height; ++y)
+    {
+        uint8 *row = texels + (static_cast<SizeType>(glyph.y + y) * atlas.GetWidth() + glyph.x) * 4;
+        for (int32 x = 0; x < glyph.width; ++x)
+            row[x * 4 + 3] = alpha[y * glyph.width + x];
+    }
+}
+}
 
 class FontGenerator::Impl
 {
 public:
-    FT_Library library;
-    FT_Face face;
+    Array<uint8> bytes;
+    FT_Library library = nullptr;
+    FT_Face face = nullptr;
 
 public:
-    Impl(const FT_Byte *bytes, FT_Long size)
+    // FreeType reads the face from the bytes for as long as it is open.
+    Impl(Array<uint8> fontBytes)
+        : bytes(std::move(fontBytes))
     {
         FT_Error err;
 
@@ -20,7 +261,7 @@ public:
             return;
         }
 
-        err = FT_New_Memory_Face(library, bytes, size, 0, &face);
+        err = FT_New_Memory_Face(library, bytes.GetData(), bytes.Count(), 0, &face);
         if (err)
         {
             CT_EXCEPTION(Render, "Create face failed.");
@@ -28,6 +269,12 @@ public:
         }
     }
 
+    ~Impl()
+    {
+        if (library)
+            FT_Done_FreeType(library);
+    }
+
     void SetPixelSizes(uint32 width, uint32 height)
     {
         FT_Error err = FT_Set_Pixel_Sizes(face, width, height);
@@ -37,42 +284,233 @@ public:
         }
     }
 
-    void GenerateFont(const FontGenerator::Options &options)
+    SPtr<Font> GenerateFont(const FontGenerator::Options &options)
     {
-        int32 fontSize = options.size;
-        SetPixelSizes(0, fontSize);
+        SetPixelSizes(0, options.size);
 
-        FT_Error err;
-        FT_Int32 loadFlags; //TODO set flags
-        FT_Render_Mode renderMode = FT_LOAD_TARGET_MODE(loadFlags);
+        Font::Metrics metrics;
+        metrics.size = options.size;
+        metrics.ascender = face->size->metrics.ascender / 64.0f;
+        metrics.descender = face->size->metrics.descender / 64.0f;
+        metrics.lineHeight = face->size->metrics.height / 64.0f;
+        metrics.sdf = options.sdf;
+        metrics.sdfSpread = options.sdf ? options.sdfSpread : 0;
+
+        Array<uint32> codepoints = GetCodepoints(options.characters);
+        Array<RasterGlyph> results;
+        results.SetCount(codepoints.Count());
+        RasterizeGlyphs(codepoints, options, results);
+
+        Array<Font::Glyph> glyphs;
+        Array<const uint8 *> alphas;
+        Array<Vector2I> sizes;
+        int64 area = 0;
+        for (const auto &result : results)
+        {
+            if (!result.valid)
+                continue;
+            glyphs.Add(result.glyph);
+            alphas.Add(result.alpha.GetData());
+            sizes.Add(Vector2I(result.glyph.width, result.glyph.height));
+            area += static_cast<int64>(result.glyph.width + options.padding) * (result.glyph.height + options.padding);
+        }
+        if (glyphs.Count() < codepoints.Count())
+            CT_LOG(Warning, CT_TEXT("Font has no glyph for {0} of {1} characters."), codepoints.Count() - glyphs.Count(), codepoints.Count());
 
-        for (CharType c : options.characters)
+        // Smallest power of two square that holds the area, then the atlas grows one side at a time until everything fits.
+        int32 width = 1;
+        while (static_cast<int64>(width) * width < area)
+            width *= 2;
+        int32 height = static_cast<int64>(width) * width / 2 >= area ? Math::Max(width / 2, 1) : width;
+        Array<TextureAtlas::Region> regions;
+        while (true)
         {
-            err = FT_Load_Char(face, (FT_ULong)c, loadFlags);
-            if (err)
+            TextureAtlas packer(width, height, options.padding);
+            if (packer.AddRegions(sizes, regions))
+                break;
+            if (height < width)
+                height *= 2;
+            else
+                width *= 2;
+            if (width > MAX_ATLAS_SIZE)
             {
-                CT_EXCEPTION(Render, "Load char failed");
+                CT_LOG(Error, CT_TEXT("Font glyphs do not fit in a {0}x{0} atlas."), MAX_ATLAS_SIZE);
+                return nullptr;
             }
+        }
+
+        auto atlas = CreateAtlas(width, height);
+        for (int32 i = 0; i < glyphs.Count(); ++i)
+        {
+            glyphs[i].x = regions[i].x;
+            glyphs[i].y = regions[i].y;
+            CopyGlyph(*atlas, glyphs[i], alphas[i]);
+        }
+        return Font::Create(metrics, std::move(glyphs), atlas);
+    }
 
-            FT_Render_Glyph(face->glyph, renderMode);
-            if (err)
+private:
+    void RasterizeGlyphs(const Array<uint32> &codepoints, const FontGenerator::Options &options, Array<RasterGlyph> &results)
+    {
+        int32 glyphCount = codepoints.Count();
+        std::atomic<int32> next{ 0 };
+        auto Rasterize = [&](FT_Face workerFace) {
+            for (int32 i = next++; i * GLYPH_CHUNK_SIZE < glyphCount; i = next++)
             {
-                CT_EXCEPTION(Render, "Render glyph failed");
+                for (int32 j = i * GLYPH_CHUNK_SIZE; j < Math::Min((i + 1) * GLYPH_CHUNK_SIZE, glyphCount); ++j)
+                    results[j].valid = RasterizeGlyph(workerFace, codepoints[j], options, results[j]);
             }
+        };
+        // FreeType faces can not be shared between threads. A worker that fails to open one leaves its glyphs to the others.
+        auto Worker = [&]() {
+            FT_Library workerLibrary;
+            FT_Face workerFace;
+            if (!OpenFace(bytes, options.size, workerLibrary, workerFace))
+                return;
+            Rasterize(workerFace);
+            FT_Done_FreeType(workerLibrary);
+        };
 
-            FT_GlyphSlot slot = face->glyph;
-            //TODO Atlas
+        auto &pool = ThreadPool::GetGlobal();
+        int32 chunkCount = (glyphCount + GLYPH_CHUNK_SIZE - 1) / GLYPH_CHUNK_SIZE;
+        int32 threadCount = Math::Min(chunkCount, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1);
+        threadCount = Math::Max(threadCount, 1);
+
+        Array<ThreadPool::Handle> handles;
+        for (int32 i = 1; i < threadCount; ++i)
+        {
+            handles.Add(pool.Run(CT_TEXT("FontGenerator"), [&Worker]() { Worker(); }));
         }
+        Rasterize(face);
+        for (auto &handle : handles)
+            handle.Wait();
     }
 };
 
 FontGenerator::FontGenerator(const IO::FileHandle &file)
+    : file(file)
 {
-    auto bytes = file.ReadBytes();
-    impl = Memory::MakeUnique<Impl>(bytes.GetData(), bytes.Count());
 }
 
 FontGenerator::~FontGenerator()
 {
-    FT_Done_FreeType(impl->library);
-}
\ No newline at end of file
+}
+
+SPtr<Font> FontGenerator::GenerateFont(const Options &options)
+{
+    CT_CHECK(options.size > 0 && options.padding >= 0 && (!options.sdf || options.sdfSpread > 0));
+
+    const bool useCache = !options.cacheDirectory.IsEmpty();
+    uint64 key = 0;
+    if (useCache)
+    {
+        key = GetKey(file.GetPath(), options);
+        if (auto font = Load(options.cacheDirectory, key))
+            return font;
+    }
+
+    if (!impl)
+        impl = Memory::MakeUnique<Impl>(file.ReadBytes());
+    auto font = impl->GenerateFont(options);
+    if (font && useCache)
+        Save(options.cacheDirectory, key, *font);
+    return font;
+}
+
+uint64 FontGenerator::GetKey(const String &path, const Options &options)
+{
+    uint64 hash = Hash::BYTES_HASH_SEED;
+    Hash::HashBytesCombine(hash, FontCacheHeader::VERSION);
+    hash = IO::CookCache::GetSourceKey(path, hash);
+
+    Hash::HashBytesCombine(hash, options.size);
+    Hash::HashBytesCombine(hash, options.bold);
+    Hash::HashBytesCombine(hash, options.italic);
+    Hash::HashBytesCombine(hash, options.sdf);
+    Hash::HashBytesCombine(hash, options.sdf ? options.sdfSpread : 0);
+    Hash::HashBytesCombine(hash, options.padding);
+    Array<uint32> codepoints = GetCodepoints(options.characters);
+    hash = Hash::HashBytes(codepoints.GetData(), sizeof(uint32) * codepoints.Count(), hash);
+    return hash;
+}
+
+String FontGenerator::GetPath(const String &directory, uint64 key)
+{
+    return IO::CookCache::GetPath(directory, key, CT_TEXT(".font"));
+}
+
+bool FontGenerator::Save(const String &directory, uint64 key, const Font &font)
+{
+    const auto &atlas = *font.GetAtlas();
+    const auto &glyphs = font.GetGlyphs();
+
+    FontCacheHeader header;
+    header.key = key;
+    header.metrics = font.GetMetrics();
+    header.glyphCount = glyphs.Count();
+    header.atlasWidth = atlas.GetWidth();
+    header.atlasHeight = atlas.GetHeight();
+
+    // Only alpha is stored, the color of the atlas is always white.
+    Array<uint8> alpha;
+    alpha.AddUninitialized(atlas.GetWidth() * atlas.GetHeight());
+    auto texels = static_cast<const uint8 *>(atlas.GetData());
+    for (int32 i = 0; i < alpha.Count(); ++i)
+        alpha[i] = texels[i * 4 + 3];
+
+    return IO::CookCache::Write(GetPath(directory, key), { { &header, sizeof(header) },
+                                                          { glyphs.GetData(), sizeof(Font::Glyph) * static_cast<uint64>(glyphs.Count()) },
+                                                          { alpha.GetData(), static_cast<uint64>(alpha.Count()) } });
+}
+
+SPtr<Font> FontGenerator::Load(const String &directory, uint64 key)
+{
+    String path = GetPath(directory, key);
+    Array<uint8> file;
+    if (!IO::CookCache::Read(path, file))
+        return nullptr;
+
+    FontCacheHeader header;
+    if (file.Count() >= static_cast<int32>(sizeof(header)))
+        std::memcpy(&header, file.GetData(), sizeof(header));
+    if (file.Count() < static_cast<int32>(sizeof(header)) || header.magic != FontCacheHeader::MAGIC || header.version != FontCacheHeader::VERSION ||
+        header.key != key || header.glyphCount < 0 || header.atlasWidth <= 0 || header.atlasWidth > MAX_ATLAS_SIZE || header.atlasHeight <= 0 ||
+        header.atlasHeight > MAX_ATLAS_SIZE)
+    {
+        CT_LOG(Warning, CT_TEXT("Font cache is stale or unreadable, the font is generated again. Path: {0}."), path);
+        return nullptr;
+    }
+
+    SizeType glyphBytes = sizeof(Font::Glyph) * static_cast<SizeType>(header.glyphCount);
+    SizeType alphaBytes = static_cast<SizeType>(header.atlasWidth) * header.atlasHeight;
+    if (static_cast<SizeType>(file.Count()) != sizeof(header) + glyphBytes + alphaBytes)
+    {
+        CT_LOG(Warning, CT_TEXT("Font cache is truncated, the font is generated again. Path: {0}."), path);
+        return nullptr;
+    }
+
+    Array<Font::Glyph> glyphs;
+    Array<uint8> alpha;
+    glyphs.AddUninitialized(header.glyphCount);
+    alpha.AddUninitialized(static_cast<int32>(alphaBytes));
+    if (glyphBytes > 0)
+        std::memcpy(glyphs.GetData(), file.GetData() + sizeof(header), glyphBytes);
+    std::memcpy(alpha.GetData(), file.GetData() + sizeof(header) + glyphBytes, alphaBytes);
+
+    // Every rectangle is checked, so a damaged file fails here instead of when text is drawn.
+    for (const auto &glyph : glyphs)
+    {
+        if (glyph.x < 0 || glyph.y < 0 || glyph.width < 0 || glyph.height < 0 || glyph.x + glyph.width > header.atlasWidth ||
+            glyph.y + glyph.height > header.atlasHeight)
+        {
+            CT_LOG(Warning, CT_TEXT("Font cache is damaged, the font is generated again. Path: {0}."), path);
+            return nullptr;
+        }
+    }
+
+    auto atlas = CreateAtlas(header.atlasWidth, header.atlasHeight);
+    auto texels = static_cast<uint8 *>(atlas->GetData());
+    for (int32 i = 0; i < alpha.Count(); ++i)
+        texels[i * 4 + 3] = alpha[i];
+    return Font::Create(header.metrics, std::move(glyphs), atlas);
+}
@@ -2,7 +2,7 @@
 
 #include "IO/FileHandle.h"
 #include "Math/Color.h"
-#include "Render/.Package.h"
+#include "Render/Font.h"
 
 class FontGenerator
 {
@@ -13,15 +13,34 @@ public:
         bool bold = false;
         bool italic = false;
         String characters;
+        // Distance field glyphs scale without rasterizing again, the spread is how many texels the field reaches past the edge.
+        bool sdf = false;
+        int32 sdfSpread = 4;
+        // Texels between glyphs in the atlas.
+        int32 padding = 1;
+        String cacheDirectory = CT_TEXT("Cache/Fonts"); // Generated fonts are kept here, empty turns the cache off.
     };
 
+    // The font file is only read when a font is not in the cache.
     FontGenerator(const IO::FileHandle &file);
     ~FontGenerator();
 
-    //void GenerateFont(const Options &options);
+    // Reads the cached font when there is one. Otherwise the glyphs are rasterized over the global thread pool with one FreeType face
+    // per worker, packed into the atlas and cached. Characters the font has no glyph for are left out.
+    SPtr<Font> GenerateFont(const Options &options);
+
+    // Changes with the font file, its modification time, the options and the set of characters.
+    static uint64 GetKey(const String &path, const Options &options);
+    // File of a key in the cache directory.
+    static String GetPath(const String &directory, uint64 key);
+
+    static bool Save(const String &directory, uint64 key, const Font &font);
+    // Nullptr when there is no readable file for the key.
+    static SPtr<Font> Load(const String &directory, uint64 key);
 
 private:
     class Impl;
     friend class Impl;
     UPtr<Impl> impl;
-};
\ No newline at end of file
+    IO::FileHandle file;
+};
@@ -0,0 +1,702 @@
+#include "Render/Importers/SceneCache.h"
+#include "Assets/AssetManager.h"
+#include "IO/CookCache.h"
+#include "Render/Importers/TextureImporter.h"
+#include <cstring>
+
+namespace
+{
+uint64 Align(uint64 value, uint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+class MetaWriter
+{
+public:
+    explicit MetaWriter(Array<uint8> &bytes)
+        : bytes(bytes)
+    {
+    }
+
+    template <typename T>
+    void Write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(T));
+    }
+
+    void Write(const String &str)
+    {
+        uint32 length = str.Length();
+        Write(length);
+        WriteBytes(str.CStr(), sizeof(CharType) * length);
+    }
+
+    template <typename T>
+    void WriteArray(const Array<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write((uint32)values.Count());
+        WriteBytes(values.GetData(), sizeof(T) * values.Count());
+    }
+
+private:
+    void WriteBytes(const void *src, SizeType size)
+    {
+        if (size == 0)
+            return;
+        int32 offset = bytes.Count();
+        bytes.AddUninitialized(static_cast<int32>(size));
+        std::memcpy(bytes.GetData() + offset, src, size);
+    }
+
+private:
+    Array<uint8> &bytes;
+};
+
+// Reads past the end leave the values default and mark the reader invalid, so callers check once per object.
+class MetaReader
+{
+public:
+    MetaReader(const uint8 *data, SizeType size)
+        : ptr(data), end(data + size)
+    {
+    }
+
+    bool IsValid() const
+    {
+        return valid;
+    }
+
+    template <typename T>
+    void Read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (Check(sizeof(T)))
+        {
+            std::memcpy(&value, ptr, sizeof(T));
+            ptr += sizeof(T);
+        }
+    }
+
+    void Read(String &str)
+    {
+        uint32 length = 0;
+        Read(length);
+        if (!Check(sizeof(CharType) * (SizeType)length))
+            return;
+
+        Array<CharType> chars;
+        chars.AddUninitialized(length + 1);
+        std::memcpy(chars.GetData(), ptr, sizeof(CharType) * length);
+        chars[length] = 0;
+        ptr += sizeof(CharType) * length;
+        str = chars.GetData();
+    }
+
+    template <typename T>
+    void ReadArray(Array<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint32 count = 0;
+        Read(count);
+        values.Clear();
+        if (!Check(sizeof(T) * (SizeType)count))
+            return;
+
+        values.AddUninitialized(count);
+        std::memcpy(values.GetData(), ptr, sizeof(T) * count);
+        ptr += sizeof(T) * count;
+    }
+
+    // Every object takes at least a byte, so a damaged count can not allocate more than the data holds.
+    int32 ReadCount()
+    {
+        uint32 count = 0;
+        Read(count);
+        if (!Check(count))
+            return 0;
+        return static_cast<int32>(count);
+    }
+
+private:
+    bool Check(SizeType size)
+    {
+        if (valid && static_cast<SizeType>(end - ptr) >= size)
+            return true;
+        valid = false;
+        return false;
+    }
+
+private:
+    const uint8 *ptr;
+    const uint8 *end;
+    bool valid = true;
+};
+
+template <typename T>
+bool InRange(const Array<T> &values, int32 maxValue)
+{
+    for (const auto &e : values)
+    {
+        if (e < 0 || e >= maxValue)
+            return false;
+    }
+    return true;
+}
+
+bool InRange(int64 offset, int64 count, int64 size)
+{
+    return offset >= 0 && count >= 0 && offset + count <= size;
+}
+
+// Index values are relative to the first vertex of their mesh, the range itself must already be checked.
+bool IndicesInRange(const Array<uint32> &indices, int32 offset, int32 count, int32 vertexCount)
+{
+    for (int32 i = offset; i < offset + count; ++i)
+    {
+        if (indices[i] >= static_cast<uint32>(vertexCount))
+            return false;
+    }
+    return true;
+}
+
+// Parents and children must describe the same forest, the animation update order visits every node exactly once.
+// Links must already be in range.
+bool NodesFormForest(const Array<SceneNode> &nodes)
+{
+    Array<int32> parentRefs;
+    parentRefs.SetCount(nodes.Count());
+    for (int32 i = 0; i < nodes.Count(); ++i)
+    {
+        for (int32 child : nodes[i].children)
+        {
+            if (nodes[child].parent != i)
+                return false;
+            ++parentRefs[child];
+        }
+    }
+    for (int32 i = 0; i < nodes.Count(); ++i)
+    {
+        if (parentRefs[i] != (nodes[i].parent == -1 ? 0 : 1))
+            return false;
+
+        // A chain longer than the node count loops.
+        int32 depth = 0;
+        for (int32 parent = nodes[i].parent; parent != -1; parent = nodes[parent].parent)
+        {
+            if (++depth > nodes.Count())
+                return false;
+        }
+    }
+    return true;
+}
+
+SPtr<Light> CreateLight(const LightData &data)
+{
+    switch ((LightType)data.type)
+    {
+    case LightType::Directional:
+    {
+        auto light = DirectionalLight::Create();
+        light->SetDirection(data.dirW);
+        light->SetIntensity(data.intensity);
+        return light;
+    }
+    case LightType::Point:
+    {
+        auto light = PointLight::Create();
+        light->SetPosition(data.posW);
+        light->SetDirection(data.dirW);
+        light->SetOpeningAngle(data.openingAngle);
+        light->SetPenumbraAngle(data.penumbraAngle);
+        light->SetIntensity(data.intensity);
+        return light;
+    }
+    default:
+        return nullptr;
+    }
+}
+}
+
+uint64 SceneCache::GetKey(const String &path, const SceneImportSettings &settings)
+{
+    uint64 hash = Hash::BYTES_HASH_SEED;
+    Hash::HashBytesCombine(hash, SceneCacheHeader::VERSION);
+    hash = IO::CookCache::GetSourceKey(path, hash);
+
+    // The vertex format is applied when the scene is built, so one cooked scene serves all of them.
+    Hash::HashBytesCombine(hash, settings.mergeMeshes);
+    Hash::HashBytesCombine(hash, settings.assumeLinearSpaceTextures);
+    Hash::HashBytesCombine(hash, settings.dontLoadBones);
+    Hash::HashBytesCombine(hash, settings.compressAnimations);
+    Hash::HashBytesCombine(hash, settings.optimizeMeshes);
+    Hash::HashBytesCombine(hash, settings.buildMeshlets);
+    Hash::HashBytesCombine(hash, settings.lodCount);
+    Hash::HashBytesCombine(hash, settings.lodMaxError);
+    Hash::HashBytesCombine(hash, settings.shadingModel);
+    Hash::HashBytesCombine(hash, settings.compressTextures);
+    Hash::HashBytesCombine(hash, settings.textureQuality);
+
+    // Raw arrays are only readable by a build with the same layouts.
+    Hash::HashBytesCombine(hash, sizeof(StaticVertexData));
+    Hash::HashBytesCombine(hash, sizeof(DynamicVertexData));
+    Hash::HashBytesCombine(hash, sizeof(MaterialData));
+    Hash::HashBytesCombine(hash, sizeof(LightData));
+    Hash::HashBytesCombine(hash, sizeof(CameraData));
+    Hash::HashBytesCombine(hash, sizeof(Meshlet));
+    Hash::HashBytesCombine(hash, sizeof(Animation::Keyframe));
+    return hash;
+}
+
+String SceneCache::GetPath(const String &directory, uint64 key)
+{
+    return IO::CookCache::GetPath(directory, key, CT_TEXT(".scene"));
+}
+
+bool SceneCache::Save(const String &directory, uint64 key, SceneBuilder &builder, const Array<TextureSource> &textures, const Array<SPtr<Material>> &materials,
+                      const Array<MaterialTextures> &materialTextures)
+{
+    builder.AssembleBuffers();
+
+    Array<uint8> meta;
+    Array<uint8> embedded;
+    MetaWriter writer(meta);
+
+    writer.Write((uint32)builder.nodes.Count());
+    for (const auto &node : builder.nodes)
+    {
+        writer.Write(node.name);
+        writer.Write(node.transform);
+        writer.Write(node.localToBindPose);
+        writer.Write(node.parent);
+        writer.WriteArray(node.children);
+        writer.WriteArray(node.meshes);
+    }
+
+    writer.Write((uint32)textures.Count());
+    for (const auto &texture : textures)
+    {
+        writer.Write(texture.path);
+        writer.Write(texture.srgb);
+        writer.Write(texture.compression);
+        writer.Write(texture.compressionQuality);
+        writer.Write((uint64)embedded.Count());
+        writer.Write((uint64)texture.bytes.Count());
+        for (auto e : texture.bytes)
+            embedded.Add(e);
+    }
+
+    writer.Write((uint32)builder.materials.Count());
+    for (const auto &material : builder.materials)
+    {
+        int32 index = -1;
+        materials.Find(material, &index);
+        writer.Write(material->GetName());
+        writer.Write(material->GetData());
+        writer.Write(index >= 0 ? materialTextures[index] : MaterialTextures());
+    }
+
+    // Animations are shared by pointer, the meshes refer to them by index.
+    Array<const Animation *> animations;
+    for (const auto &mesh : builder.meshes)
+    {
+        for (const auto &anim : mesh.animations)
+        {
+            const Animation *ptr = anim.get();
+            if (!animations.Contains(ptr))
+                animations.Add(anim.get());
+        }
+    }
+    writer.Write((uint32)animations.Count());
+    for (const auto *anim : animations)
+    {
+        writer.Write(anim->name);
+        writer.Write(anim->duration);
+        writer.Write((uint32)anim->channels.Count());
+        for (const auto &channel : anim->channels)
+        {
+            writer.Write(channel.matrixID);
+            writer.WriteArray(channel.keyframes);
+        }
+        writer.Write((uint32)anim->tracks.Count());
+        for (const auto &track : anim->tracks)
+        {
+            writer.Write(track.translationMin);
+            writer.Write(track.translationStep);
+            writer.Write(track.scalingMin);
+            writer.Write(track.scalingStep);
+            writer.WriteArray(track.times);
+            writer.WriteArray(track.keyframes);
+        }
+    }
+
+    writer.Write((uint32)builder.meshes.Count());
+    for (const auto &mesh : builder.meshes)
+    {
+        writer.Write(mesh.topology);
+        writer.Write(mesh.materialID);
+        writer.Write(mesh.indexOffset);
+        writer.Write(mesh.staticVertexOffset);
+        writer.Write(mesh.dynamicVertexOffset);
+        writer.Write(mesh.indexCount);
+        writer.Write(mesh.vertexCount);
+        writer.Write(mesh.bounds);
+        writer.Write(mesh.uvMin);
+        writer.Write(mesh.uvMax);
+        writer.Write(mesh.hasDynamicData);
+        writer.WriteArray(mesh.instances);
+
+        Array<int32> animIDs;
+        for (const auto &anim : mesh.animations)
+        {
+            int32 index = -1;
+            const Animation *ptr = anim.get();
+            animations.Find(ptr, index);
+            animIDs.Add(index);
+        }
+        writer.WriteArray(animIDs);
+        writer.WriteArray(mesh.lods);
+        writer.WriteArray(mesh.meshlets);
+    }
+
+    writer.Write((uint32)builder.lights.Count());
+    for (const auto &light : builder.lights)
+    {
+        writer.Write(light->GetName());
+        writer.Write(light->GetData());
+    }
+
+    writer.Write(builder.camera != nullptr);
+    if (builder.camera)
+    {
+        writer.Write(builder.camera->GetName());
+        writer.Write(builder.camera->GetData());
+    }
+
+    const auto &buffers = builder.buffersData;
+    const void *datas[SECTION_COUNT] = { meta.GetData(), buffers.indices.GetData(), buffers.staticDatas.GetData(), buffers.dynamicDatas.GetData(),
+                                         embedded.GetData() };
+    SceneCacheSection sections[SECTION_COUNT];
+    sections[META_SECTION].size = meta.Count();
+    sections[INDEX_SECTION].size = sizeof(uint32) * (uint64)buffers.indices.Count();
+    sections[STATIC_VERTEX_SECTION].size = sizeof(StaticVertexData) * (uint64)buffers.staticDatas.Count();
+    sections[DYNAMIC_VERTEX_SECTION].size = sizeof(DynamicVertexData) * (uint64)buffers.dynamicDatas.Count();
+    sections[TEXTURE_SECTION].size = embedded.Count();
+
+    uint64 offset = Align(sizeof(SceneCacheHeader) + sizeof(sections), ALIGNMENT);
+    for (auto &section : sections)
+    {
+        section.offset = offset;
+        offset = Align(offset + section.size, ALIGNMENT);
+    }
+
+    SceneCacheHeader header;
+    header.key = key;
+    header.sectionCount = SECTION_COUNT;
+    header.alignment = ALIGNMENT;
+
+    // Sections are padded to their aligned offsets.
+    Array<IO::CookCache::Part> parts = { { &header, sizeof(header) }, { sections, sizeof(sections) } };
+    uint64 position = sizeof(header) + sizeof(sections);
+    for (int32 i = 0; i < SECTION_COUNT; ++i)
+    {
+        parts.Add({ nullptr, sections[i].offset - position });
+        parts.Add({ datas[i], sections[i].size });
+        position = sections[i].offset + sections[i].size;
+    }
+    return IO::CookCache::Write(GetPath(directory, key), parts);
+}
+
+bool SceneCache::Load(const String &directory, uint64 key, SceneBuilder &builder, bool streamTextures)
+{
+    String path = GetPath(directory, key);
+    Array<uint8> file;
+    if (!IO::CookCache::Read(path, file))
+        return false;
+
+    SceneCacheHeader header;
+    SceneCacheSection sections[SECTION_COUNT];
+    uint64 fileSize = file.Count();
+    if (fileSize < sizeof(header) + sizeof(sections))
+    {
+        CT_LOG(Warning, CT_TEXT("Scene cache is stale or unreadable, the scene is imported again. Path: {0}."), path);
+        return false;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    std::memcpy(sections, file.GetData() + sizeof(header), sizeof(sections));
+    if (header.magic != SceneCacheHeader::MAGIC || header.version != SceneCacheHeader::VERSION || header.sectionCount != SECTION_COUNT || header.key != key)
+    {
+        CT_LOG(Warning, CT_TEXT("Scene cache is stale or unreadable, the scene is imported again. Path: {0}."), path);
+        return false;
+    }
+    for (const auto &section : sections)
+    {
+        if (section.offset > fileSize || section.size > fileSize - section.offset)
+        {
+            CT_LOG(Warning, CT_TEXT("Scene cache is truncated, the scene is imported again. Path: {0}."), path);
+            return false;
+        }
+    }
+
+    // The file is read whole so caches inside packs are found too, the sections are copied out of it.
+    auto ReadSection = [&](int32 index, auto &values) {
+        using Element = std::remove_reference_t<decltype(values[0])>;
+        const auto &section = sections[index];
+        if (section.size % sizeof(Element) != 0 || section.size / sizeof(Element) > INT32_MAX)
+            return false;
+        values.Clear();
+        values.AddUninitialized(static_cast<int32>(section.size / sizeof(Element)));
+        if (section.size > 0)
+            std::memcpy(values.GetData(), file.GetData() + section.offset, section.size);
+        return true;
+    };
+
+    SceneBuilder loaded;
+    auto &buffers = loaded.buffersData;
+    Array<uint8> meta;
+    Array<uint8> embedded;
+    if (!ReadSection(META_SECTION, meta) || !ReadSection(INDEX_SECTION, buffers.indices) || !ReadSection(STATIC_VERTEX_SECTION, buffers.staticDatas) ||
+        !ReadSection(DYNAMIC_VERTEX_SECTION, buffers.dynamicDatas) || !ReadSection(TEXTURE_SECTION, embedded))
+    {
+        CT_LOG(Warning, CT_TEXT("Read scene cache failed, the scene is imported again. Path: {0}."), path);
+        return false;
+    }
+
+    // Every index is checked, so a damaged file fails here instead of in GetScene.
+    MetaReader reader(meta.GetData(), meta.Count());
+    bool valid = true;
+
+    int32 nodeCount = reader.ReadCount();
+    loaded.nodes.SetCount(nodeCount);
+    for (auto &node : loaded.nodes)
+    {
+        reader.Read(node.name);
+        reader.Read(node.transform);
+        reader.Read(node.localToBindPose);
+        reader.Read(node.parent);
+        reader.ReadArray(node.children);
+        reader.ReadArray(node.meshes);
+        valid = valid && node.parent >= -1 && node.parent < nodeCount && InRange(node.children, nodeCount);
+    }
+    valid = valid && reader.IsValid() && NodesFormForest(loaded.nodes);
+
+    int32 textureCount = reader.ReadCount();
+    Array<TextureSource> textures;
+    textures.SetCount(textureCount);
+    for (auto &texture : textures)
+    {
+        uint64 offset = 0, size = 0;
+        reader.Read(texture.path);
+        reader.Read(texture.srgb);
+        reader.Read(texture.compression);
+        reader.Read(texture.compressionQuality);
+        reader.Read(offset);
+        reader.Read(size);
+        valid = valid && InRange((int64)offset, (int64)size, embedded.Count()) && (size > 0) == texture.path.IsEmpty();
+        valid = valid && texture.compression <= TextureCompression::BC7 && texture.compressionQuality <= CompressionQuality::High;
+        if (valid && size > 0)
+        {
+            texture.bytes.AddUninitialized(static_cast<int32>(size));
+            std::memcpy(texture.bytes.GetData(), embedded.GetData() + offset, size);
+        }
+    }
+
+    int32 materialCount = reader.ReadCount();
+    Array<String> materialNames;
+    Array<MaterialData> materialDatas;
+    Array<MaterialTextures> materialTextures;
+    materialNames.SetCount(materialCount);
+    materialDatas.SetCount(materialCount);
+    materialTextures.SetCount(materialCount);
+    for (int32 i = 0; i < materialCount; ++i)
+    {
+        reader.Read(materialNames[i]);
+        reader.Read(materialDatas[i]);
+        reader.Read(materialTextures[i]);
+        for (int32 slot : materialTextures[i].slots)
+            valid = valid && slot >= -1 && slot < textureCount;
+    }
+
+    int32 animationCount = reader.ReadCount();
+    Array<SPtr<Animation>> animations;
+    for (int32 i = 0; i < animationCount && reader.IsValid(); ++i)
+    {
+        String name;
+        Animation::AnimTimeType duration = 0;
+        reader.Read(name);
+        reader.Read(duration);
+
+        auto anim = Animation::Create(duration);
+        anim->SetName(name);
+        int32 channelCount = reader.ReadCount();
+        for (int32 c = 0; c < channelCount && reader.IsValid(); ++c)
+        {
+            int32 matrixID = -1;
+            reader.Read(matrixID);
+            anim->AddChannel(matrixID);
+            reader.ReadArray(anim->channels.Last().keyframes);
+            valid = valid && matrixID >= 0 && matrixID < nodeCount;
+        }
+        int32 trackCount = reader.ReadCount();
+        valid = valid && (trackCount == 0 || trackCount == channelCount);
+        anim->tracks.SetCount(trackCount);
+        for (auto &track : anim->tracks)
+        {
+            reader.Read(track.translationMin);
+            reader.Read(track.translationStep);
+            reader.Read(track.scalingMin);
+            reader.Read(track.scalingStep);
+            reader.ReadArray(track.times);
+            reader.ReadArray(track.keyframes);
+            valid = valid && track.times.Count() == track.keyframes.Count();
+        }
+        animations.Add(anim);
+    }
+
+    int32 meshCount = reader.ReadCount();
+    loaded.meshes.SetCount(meshCount);
+    for (auto &mesh : loaded.meshes)
+    {
+        reader.Read(mesh.topology);
+        reader.Read(mesh.materialID);
+        reader.Read(mesh.indexOffset);
+        reader.Read(mesh.staticVertexOffset);
+        reader.Read(mesh.dynamicVertexOffset);
+        reader.Read(mesh.indexCount);
+        reader.Read(mesh.vertexCount);
+        reader.Read(mesh.bounds);
+        reader.Read(mesh.uvMin);
+        reader.Read(mesh.uvMax);
+        reader.Read(mesh.hasDynamicData);
+        reader.ReadArray(mesh.instances);
+
+        Array<int32> animIDs;
+        reader.ReadArray(animIDs);
+        valid = valid && InRange(animIDs, animations.Count());
+        for (int32 i = 0; i < animIDs.Count() && valid; ++i)
+            mesh.animations.Add(animations[animIDs[i]]);
+
+        reader.ReadArray(mesh.lods);
+        reader.ReadArray(mesh.meshlets);
+
+        valid = valid && mesh.materialID >= 0 && mesh.materialID < materialCount && InRange(mesh.instances, nodeCount);
+        valid = valid && InRange(mesh.indexOffset, mesh.indexCount, buffers.indices.Count()) &&
+                InRange(mesh.staticVertexOffset, mesh.vertexCount, buffers.staticDatas.Count()) &&
+                (!mesh.hasDynamicData || InRange(mesh.dynamicVertexOffset, mesh.vertexCount, buffers.dynamicDatas.Count()));
+        for (const auto &lod : mesh.lods)
+            valid = valid && InRange(lod.indexOffset, lod.indexCount, buffers.indices.Count());
+        for (const auto &meshlet : mesh.meshlets)
+            valid = valid && InRange(meshlet.indexOffset, meshlet.indexCount, buffers.indices.Count());
+
+        // The GPU reads whatever vertices the indices and skinned vertices point at, so they must stay inside the mesh.
+        valid = valid && IndicesInRange(buffers.indices, mesh.indexOffset, mesh.indexCount, mesh.vertexCount);
+        for (const auto &lod : mesh.lods)
+            valid = valid && IndicesInRange(buffers.indices, lod.indexOffset, lod.indexCount, mesh.vertexCount);
+        for (const auto &meshlet : mesh.meshlets)
+            valid = valid && IndicesInRange(buffers.indices, meshlet.indexOffset, meshlet.indexCount, mesh.vertexCount);
+        for (int32 v = 0; v < mesh.vertexCount && valid && mesh.hasDynamicData; ++v)
+        {
+            int32 staticIndex = buffers.dynamicDatas[mesh.dynamicVertexOffset + v].staticIndex;
+            valid = staticIndex >= mesh.staticVertexOffset && staticIndex < mesh.staticVertexOffset + mesh.vertexCount;
+        }
+    }
+    for (const auto &node : loaded.nodes)
+        valid = valid && InRange(node.meshes, meshCount);
+
+    int32 lightCount = reader.ReadCount();
+    for (int32 i = 0; i < lightCount && reader.IsValid(); ++i)
+    {
+        String name;
+        LightData data;
+        reader.Read(name);
+        reader.Read(data);
+        auto light = CreateLight(data);
+        valid = valid && light != nullptr;
+        if (light)
+        {
+            light->SetName(name);
+            loaded.lights.Add(light);
+        }
+    }
+
+    bool hasCamera = false;
+    reader.Read(hasCamera);
+    if (hasCamera)
+    {
+        String name;
+        CameraData data;
+        reader.Read(name);
+        reader.Read(data);
+
+        auto camera = Camera::Create();
+        camera->SetName(name);
+        camera->SetPosition(data.posW);
+        camera->SetUp(data.up);
+        camera->SetTarget(data.target);
+        camera->SetFocalLength(data.focalLength);
+        camera->SetAspectRatio(data.aspectRatio);
+        camera->SetNearZ(data.nearZ);
+        camera->SetFarZ(data.farZ);
+        camera->SetFrameHeight(data.frameHeight);
+        camera->SetFocalDistance(data.focalDistance);
+        camera->SetApertureRadius(data.apertureRadius);
+        camera->SetShutterSpeed(data.shutterSpeed);
+        loaded.camera = camera;
+    }
+
+    if (!valid || !reader.IsValid())
+    {
+        CT_LOG(Warning, CT_TEXT("Scene cache is damaged, the scene is imported again. Path: {0}."), path);
+        return false;
+    }
+
+    // Textures are only imported once everything else is known to be good.
+    Array<APtr<Texture>> loadedTextures;
+    for (auto &texture : textures)
+    {
+        auto textureSettings = TextureImportSettings::Create();
+        textureSettings->generateMips = true;
+        textureSettings->srgbFormat = texture.srgb;
+        textureSettings->compression = texture.compression;
+        textureSettings->compressionQuality = texture.compressionQuality;
+        textureSettings->stream = streamTextures;
+        TextureImporter importer;
+        if (texture.path.IsEmpty())
+            loadedTextures.Add(importer.ImportFromMemory(std::move(texture.bytes), textureSettings));
+        else
+            loadedTextures.Add(gAssetManager->Import<Texture>(texture.path, textureSettings));
+    }
+
+    for (int32 i = 0; i < materialCount; ++i)
+    {
+        const auto &data = materialDatas[i];
+        const auto &slots = materialTextures[i].slots;
+        auto GetTexture = [&](int32 slot) { return slots[slot] >= 0 ? loadedTextures[slots[slot]] : APtr<Texture>(); };
+
+        auto material = Material::Create();
+        material->SetName(materialNames[i]);
+        material->SetShadingModel(GetMaterialShadingModel(data.flags));
+        material->SetDoubleSided(GetMaterialBit(data.flags, CT_MAT_DOUBLE_SIDED) != 0);
+        material->SetBaseTexture(GetTexture(0));
+        material->SetSpecularTexture(GetTexture(1));
+        material->SetEmissiveTexture(GetTexture(2));
+        material->SetNormalTexture(GetTexture(3));
+        material->SetOcclusionTexture(GetTexture(4));
+        material->SetBaseColor(data.base);
+        material->SetSpecularColor(data.specular);
+        material->SetEmissiveColor(data.emissive);
+        material->SetAlphaThreshold(data.alphaThreshold);
+        material->SetIndexOfRefraction(data.IoR);
+        material->SetSpecularTransmission(data.specularTransmission);
+        loaded.materials.Add(material);
+    }
+
+    loaded.totalIndexCount = buffers.indices.Count();
+    loaded.totalVertexCount = buffers.staticDatas.Count();
+    loaded.totalDynamicVertexCount = buffers.dynamicDatas.Count();
+    loaded.dirty = true;
+    builder = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Render/Importers/SceneImporter.h"
+
+/**
+ * Layout: SceneCacheHeader | SceneCacheSection[SECTION_COUNT] | aligned section blobs.
+ * Index and vertex sections are the raw SceneBuilder arrays, so they can be mapped or read straight into place.
+ * Everything else is in the meta section, offsets in it are relative to their section.
+ */
+struct SceneCacheHeader
+{
+    static constexpr uint32 MAGIC = 0x53435443; // "CTCS"
+    static constexpr uint32 VERSION = 2;
+
+    uint32 magic = MAGIC;
+    uint32 version = VERSION;
+    uint64 key = 0;
+    uint32 sectionCount = 0;
+    uint32 alignment = 0;
+    uint64 reserved = 0;
+};
+
+struct SceneCacheSection
+{
+    uint64 offset = 0;
+    uint64 size = 0;
+};
+
+static_assert(sizeof(SceneCacheHeader) == 32 && sizeof(SceneCacheSection) == 16, "Scene cache layout must stay stable.");
+
+// Cooked scenes, the SceneBuilder state at the end of an import so opening the same scene again skips assimp.
+class SceneCache
+{
+public:
+    enum Section
+    {
+        META_SECTION,
+        INDEX_SECTION,
+        STATIC_VERTEX_SECTION,
+        DYNAMIC_VERTEX_SECTION,
+        TEXTURE_SECTION, // Bytes of the textures embedded in the scene file.
+        SECTION_COUNT,
+    };
+
+    static constexpr uint32 ALIGNMENT = 64;
+
+    // Where a texture came from, textures are imported again from it when the cache is loaded.
+    struct TextureSource
+    {
+        String path; // Empty for a texture embedded in the scene file.
+        Array<uint8> bytes;
+        bool srgb = false;
+        TextureCompression compression = TextureCompression::None;
+        CompressionQuality compressionQuality = CompressionQuality::Normal;
+    };
+
+    // Index into the texture sources for each texture of a material, in MaterialResources order, -1 for none.
+    struct MaterialTextures
+    {
+        static constexpr int32 SLOT_COUNT = 5;
+
+        int32 slots[SLOT_COUNT] = { -1, -1, -1, -1, -1 };
+    };
+
+    // Changes with the scene file, its modification time and every import setting the cooked data depends on.
+    // Only the scene file itself is tracked, not the side files it refers to.
+    static uint64 GetKey(const String &path, const SceneImportSettings &settings);
+    // File of a key in the cache directory.
+    static String GetPath(const String &directory, uint64 key);
+
+    // materials and materialTextures are parallel arrays, materials not in them are saved without textures.
+    // Assembles the pending meshes of the builder first.
+    static bool Save(const String &directory, uint64 key, SceneBuilder &builder, const Array<TextureSource> &textures, const Array<SPtr<Material>> &materials,
+                     const Array<MaterialTextures> &materialTextures);
+    // Fills an empty builder, textures are imported again like the importer does, streamed when streamTextures is set.
+    // Fails when there is no readable file for the key.
+    static bool Load(const String &directory, uint64 key, SceneBuilder &builder, bool streamTextures = false);
+};
@@ -1,13 +1,20 @@
 #include "Render/Importers/SceneImporter.h"
 #include "Assets/AssetManager.h"
 #include "Core/HashMap.h"
+#include "Core/Thread.h"
 #include "IO/FileHandle.h"
+#include "IO/VirtualFileSystem.h"
+#include "Render/Importers/SceneCache.h"
 #include "Render/Importers/TextureImporter.h"
+#include "Render/MeshOptimizer.h"
 #include "Utils/DebugTimer.h"
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
+#include <assimp/MemoryIOWrapper.h>
 #include <assimp/pbrmaterial.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <atomic>
 
 namespace
 {
@@ -19,6 +26,7 @@ enum class ImportMode
     GLTF2,
 };
 
+// Same order as MaterialResources, it is the slot index of SceneCache::MaterialTextures.
 enum class TextureType
 {
     BaseColor,
@@ -77,6 +85,20 @@ bool IsSrgbRequired(TextureType textureType)
     }
 }
 
+TextureCompression GetTextureCompression(TextureType textureType)
+{
+    switch (textureType)
+    {
+    case TextureType::Normal:
+        return TextureCompression::BC5;
+    case TextureType::Emissive:
+    case TextureType::Occlusion:
+        return TextureCompression::BC1;
+    default:
+        return TextureCompression::BC7;
+    }
+}
+
 String ToString(const aiString &aStr)
 {
     return String(aStr.C_Str());
@@ -116,6 +138,27 @@ float SpecPowerToRoughness(float specPower)
     return Math::Clamp01(Math::Sqrt(2.0f / (specPower + 2.0f)));
 }
 
+// Lets assimp open the scene and its side files (mtl, bin...) out of mounted packs.
+class PackedIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    bool Exists(const char *file) const override
+    {
+        return IO::VirtualFileSystem::IsMounted(StringEncode::UTF8::FromChars(file)) || DefaultIOSystem::Exists(file);
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode) override
+    {
+        Array<uint8> bytes;
+        if (mode[0] != 'r' || !IO::VirtualFileSystem::ReadBytes(StringEncode::UTF8::FromChars(file), bytes))
+            return DefaultIOSystem::Open(file, mode);
+
+        auto buffer = new uint8[bytes.Count()];
+        std::memcpy(buffer, bytes.GetData(), bytes.Count());
+        return new Assimp::MemoryIOStream(buffer, bytes.Count(), true);
+    }
+};
+
 class ImporterImpl
 {
 public:
@@ -124,17 +167,36 @@ public:
     {
     }
 
-    void Import(const String &path)
+    // False when the scene can not be created, the caller marks the asset failed.
+    bool Import(const String &path)
     {
         auto fileHandle = IO::FileHandle(path);
         directory = fileHandle.GetParentPath();
 
+        // A cooked scene skips assimp and everything the builder did.
+        const bool useCache = !settings->cacheDirectory.IsEmpty();
+        uint64 cacheKey = 0;
+        if (useCache)
+        {
+            cacheKey = SceneCache::GetKey(path, *settings);
+
+            DebugTimer timer(CT_TEXT("Load scene cache"));
+            if (SceneCache::Load(settings->cacheDirectory, cacheKey, builder, settings->streamTextures))
+            {
+                BuildScene();
+                return true;
+            }
+        }
+
         Assimp::Importer aImporter;
+        aImporter.SetIOHandler(new PackedIOSystem());
 
         uint32 assimpFlags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_FlipUVs;
         assimpFlags &= ~(aiProcess_FindDegenerates);
         assimpFlags &= ~(aiProcess_OptimizeGraph);
         assimpFlags &= ~aiProcess_RemoveRedundantMaterials;
+        if (settings->optimizeMeshes)
+            assimpFlags &= ~aiProcess_ImproveCacheLocality;
 
         {
             DebugTimer timer(CT_TEXT("Assimp ReadFile"));
@@ -142,7 +204,7 @@ public:
             if (aScene == nullptr || aScene->mFlags == AI_SCENE_FLAGS_INCOMPLETE)
             {
                 CT_LOG(Error, CT_TEXT("Load scene failed, error: {0}."), String(aImporter.GetErrorString()));
-                return;
+                return false;
             }
         }
 
@@ -157,7 +219,7 @@ public:
             if (CreateMaterials() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene materials failed."));
-                return;
+                return false;
             }
         }
 
@@ -166,7 +228,7 @@ public:
             if (CreateSceneGraph() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene graph failed."));
-                return;
+                return false;
             }
         }
 
@@ -175,7 +237,7 @@ public:
             if (CreateMeshes() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene meshes failed."), path);
-                return;
+                return false;
             }
         }
 
@@ -184,7 +246,7 @@ public:
             if (CreateAnimations() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene animations failed."), path);
-                return;
+                return false;
             }
         }
 
@@ -193,7 +255,7 @@ public:
             if (CreateCamera() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene camera failed."), path);
-                return;
+                return false;
             }
         }
 
@@ -202,13 +264,40 @@ public:
             if (CreateLights() == false)
             {
                 CT_LOG(Error, CT_TEXT("Create scene lights failed."), path);
-                return;
+                return false;
             }
         }
 
-        gAssetManager->RunMainthread([asset = this->asset, builder = std::move(this->builder)]() mutable {
+        if (useCache)
+        {
+            DebugTimer timer(CT_TEXT("Save scene cache"));
+            if (!SceneCache::Save(settings->cacheDirectory, cacheKey, builder, textureSources, materials, materialTextures))
+                CT_LOG(Warning, CT_TEXT("Save scene cache failed, the scene is imported again next time. Path: {0}."), path);
+        }
+
+        BuildScene();
+        return true;
+    }
+
+    void BuildScene()
+    {
+        builder.SetVertexFormat(settings->vertexFormat);
+        // Buffers are sized by the builder, only the time of the tick bounds the build.
+        gAssetManager->RunMainthread<Scene>(asset, 0, [builder = std::move(this->builder)](const APtr<Scene> &asset) mutable {
             DebugTimer timer(CT_TEXT("SceneBuilder"));
-            asset.GetData()->ptr = builder.GetScene();
+            auto scene = builder.GetScene();
+            asset.GetData()->ptr = scene;
+
+            // Prefetching the scene again starts its textures along with it.
+            for (const auto &material : scene->GetMaterials())
+            {
+                const auto &resources = material->GetResources();
+                gAssetManager->AddDependency(asset, resources.baseTexture);
+                gAssetManager->AddDependency(asset, resources.specularTexture);
+                gAssetManager->AddDependency(asset, resources.emissiveTexture);
+                gAssetManager->AddDependency(asset, resources.normalTexture);
+                gAssetManager->AddDependency(asset, resources.occlusionTexture);
+            }
         });
     }
 
@@ -292,18 +381,26 @@ public:
                     continue;
                 }
 
-                APtr<Texture> texture;
+                int32 textureID;
                 auto texPtr = textureCache.TryGet(path);
                 if (texPtr)
                 {
-                    texture = *texPtr;
+                    textureID = *texPtr;
                 }
                 else
                 {
                     auto textureSettings = TextureImportSettings::Create();
                     textureSettings->generateMips = true;
                     textureSettings->srgbFormat = useSrgb && IsSrgbRequired(e.textureType);
+                    textureSettings->compression = settings->compressTextures ? GetTextureCompression(e.textureType) : TextureCompression::None;
+                    textureSettings->compressionQuality = settings->textureQuality;
+                    textureSettings->stream = settings->streamTextures;
                     TextureImporter importer;
+                    APtr<Texture> texture;
+                    SceneCache::TextureSource source;
+                    source.srgb = textureSettings->srgbFormat;
+                    source.compression = textureSettings->compression;
+                    source.compressionQuality = textureSettings->compressionQuality;
 
                     // Embedded texture
                     if (path.StartsWith(CT_TEXT("*")))
@@ -315,7 +412,8 @@ public:
                             Array<uint8> bytes;
                             bytes.AddUninitialized(aTex->mWidth);
                             std::memcpy(bytes.GetData(), aTex->pcData, aTex->mWidth);
-                            texture = importer.ImportFromMemory(std::move(bytes), settings);
+                            source.bytes = bytes;
+                            texture = importer.ImportFromMemory(std::move(bytes), textureSettings);
                         }
                         else
                         {
@@ -327,13 +425,19 @@ public:
                     else
                     {
                         String fullPath = directory + CT_TEXT("/") + path;
-                        texture = importer.Import(fullPath, textureSettings);
+                        source.path = fullPath;
+                        // Shared with other scenes and standalone imports of the same file and settings.
+                        texture = gAssetManager->Import<Texture>(fullPath, textureSettings);
                     }
 
-                    textureCache.Put(path, texture);
+                    textureID = textures.Count();
+                    textures.Add(texture);
+                    textureSources.Add(std::move(source));
+                    textureCache.Put(path, textureID);
                 }
 
-                SetTexture(mat, texture, e.textureType);
+                SetTexture(mat, textures[textureID], e.textureType);
+                materialTextures.Last().slots[(int32)e.textureType] = textureID;
             }
         }
     }
@@ -354,6 +458,7 @@ public:
         }
         mat->SetShadingModel(shadingModel);
 
+        materialTextures.Add(SceneCache::MaterialTextures());
         LoadTextures(mat, aMat);
 
         float opacity;
@@ -554,10 +659,9 @@ public:
         }
     }
 
-    bool CreateMesh(const aiMesh *aMesh, uint32 index)
+    // Reads only the imported scene and the materials, so meshes can be created on any thread.
+    bool CreateMesh(const aiMesh *aMesh, Mesh &mesh)
     {
-        Mesh mesh = {};
-
         const uint32 perFaceIndexCount = aMesh->mFaces[0].mNumIndices;
         const uint32 indexCount = aMesh->mNumFaces * perFaceIndexCount;
         mesh.indices.Reserve(indexCount);
@@ -606,10 +710,28 @@ public:
         }
         CT_CHECK(mesh.topology != Topology::Undefined);
 
-        mesh.material = materials[aMesh->mMaterialIndex];
+        if (settings->optimizeMeshes && mesh.topology == Topology::TriangleList)
+        {
+            MeshOptimizeStats before, after;
+            MeshOptimizer::Optimize(mesh, &before, &after);
+            CT_LOG(Info, CT_TEXT("Optimized mesh {0}, vertices: {1} -> {2}, ACMR: {3} -> {4}, ATVR: {5} -> {6}."), ToString(aMesh->mName), before.vertexCount,
+                   after.vertexCount, before.acmr, after.acmr, before.atvr, after.atvr);
+        }
 
-        int32 meshID = builder.AddMesh(std::move(mesh));
-        meshIndexToID.Put(index, meshID);
+        if (settings->buildMeshlets && mesh.topology == Topology::TriangleList)
+            MeshOptimizer::BuildMeshlets(mesh);
+
+        if (settings->lodCount > 0 && mesh.topology == Topology::TriangleList)
+        {
+            MeshOptimizer::GenerateLods(mesh, settings->lodCount, settings->lodMaxError);
+            if (!mesh.lods.IsEmpty())
+            {
+                CT_LOG(Info, CT_TEXT("Generated {0} levels of detail for mesh {1}, triangles: {2} -> {3}."), mesh.lods.Count(), ToString(aMesh->mName),
+                       mesh.indices.Count() / 3, mesh.lods.Last().indices.Count() / 3);
+            }
+        }
+
+        mesh.material = materials[aMesh->mMaterialIndex];
 
         return true;
     }
@@ -631,10 +753,39 @@ public:
 
     bool CreateMeshes()
     {
-        for (uint32 i = 0; i < aScene->mNumMeshes; ++i)
+        // Optimization dominates the import, so pool threads take the next mesh until none is left.
+        const int32 count = aScene->mNumMeshes;
+        Array<Mesh> meshes;
+        meshes.SetCount(count);
+
+        std::atomic<int32> next{ 0 };
+        std::atomic<bool> failed{ false };
+        auto Create = [this, &meshes, &next, &failed, count]() {
+            for (int32 i = next++; i < count && !failed; i = next++)
+            {
+                if (!CreateMesh(aScene->mMeshes[i], meshes[i]))
+                    failed = true;
+            }
+        };
+
+        auto &pool = ThreadPool::GetGlobal();
+        int32 threadCount = Math::Max(Math::Min(count, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1), 1);
+        Array<ThreadPool::Handle> handles;
+        for (int32 i = 1; i < threadCount; ++i)
         {
-            if (!CreateMesh(aScene->mMeshes[i], i))
-                return false;
+            handles.Add(pool.Run(CT_TEXT("SceneImporter"), [&Create]() { Create(); }));
+        }
+        Create();
+        for (auto &handle : handles)
+            handle.Wait();
+
+        if (failed)
+            return false;
+
+        for (int32 i = 0; i < count; ++i)
+        {
+            int32 meshID = builder.AddMesh(std::move(meshes[i]));
+            meshIndexToID.Put(i, meshID);
         }
 
         AddMeshes(aScene->mRootNode);
@@ -731,6 +882,8 @@ public:
             }
         }
 
+        if (settings->compressAnimations)
+            animation->Compress();
         builder.AddAnimation(0, animation);
 
         return true;
@@ -845,8 +998,11 @@ private:
     ImportMode importMode = ImportMode::Default;
     String directory;
     const aiScene *aScene = nullptr;
-    HashMap<String, APtr<Texture>> textureCache;
+    HashMap<String, int32> textureCache;
+    Array<APtr<Texture>> textures;
+    Array<SceneCache::TextureSource> textureSources;
     Array<SPtr<Material>> materials;
+    Array<SceneCache::MaterialTextures> materialTextures;
     SPtr<Camera> camera;
     HashMap<const aiNode *, int32> nodePtrToID;
     HashMap<String, Array<const aiNode *>> nodeNameToPtrs;
@@ -862,9 +1018,10 @@ APtr<Scene> SceneImporter::Import(const String &path, const SPtr<ImportSettings>
     APtr<Scene> result;
     result.NewData();
 
-    gAssetManager->RunMultithread([=]() {
-        ImporterImpl impl(result, ImportSettings::As<SceneImportSettings>(settings));
-        impl.Import(path);
+    gAssetManager->RunMultithread<Scene>(result, [=](const APtr<Scene> &asset) {
+        ImporterImpl impl(asset, ImportSettings::As<SceneImportSettings>(settings));
+        if (!impl.Import(path))
+            asset.GetData()->failed = true;
     });
 
     return result;
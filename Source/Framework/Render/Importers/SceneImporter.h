@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Assets/AssetImporter.h"
+#include "Render/Importers/TextureImporter.h"
 #include "Render/SceneBuilder.h"
 
 class SceneImportSettings : public ImportSettings
@@ -9,7 +10,36 @@ public:
     bool mergeMeshes = false;
     bool assumeLinearSpaceTextures = false; // By default all textures are assumed in srgb space.
     bool dontLoadBones = false;
+    bool compressAnimations = true; // Quantizes keyframes to 16 bits per component, off keeps them exact.
+    bool optimizeMeshes = true; // Reorders triangles and vertices of triangle meshes for the vertex cache, overdraw and fetch.
+    bool buildMeshlets = false; // Splits triangle meshes into meshlets that are culled on their own.
+    VertexFormat vertexFormat = VertexFormat::Full; // Quantized also packs positions, it falls back to compact for skinned scenes.
+    int32 lodCount = 0; // Simplified levels generated for each triangle mesh, 0 disables them.
+    float lodMaxError = 0.05f; // Error of the coarsest level relative to the mesh extent.
     int32 shadingModel = -1; // -1 means don't care.
+    bool compressTextures = false; // Normal maps become BC5, emissive and occlusion maps BC1, the others BC7.
+    CompressionQuality textureQuality = CompressionQuality::Normal;
+    bool streamTextures = false; // Cooked textures start with their coarse levels and gain finer ones as the screen needs them.
+    String cacheDirectory = CT_TEXT("Cache/Scenes"); // Cooked scenes are kept here, empty turns the cache off.
+
+    HashType HashCode() const override
+    {
+        HashType hash = Hash::HashValue(mergeMeshes);
+        Hash::HashCombine(hash, assumeLinearSpaceTextures);
+        Hash::HashCombine(hash, dontLoadBones);
+        Hash::HashCombine(hash, compressAnimations);
+        Hash::HashCombine(hash, optimizeMeshes);
+        Hash::HashCombine(hash, buildMeshlets);
+        Hash::HashCombine(hash, vertexFormat);
+        Hash::HashCombine(hash, lodCount);
+        Hash::HashCombine(hash, lodMaxError);
+        Hash::HashCombine(hash, shadingModel);
+        Hash::HashCombine(hash, compressTextures);
+        Hash::HashCombine(hash, textureQuality);
+        Hash::HashCombine(hash, streamTextures);
+        Hash::HashCombine(hash, cacheDirectory);
+        return hash;
+    }
 
     static SPtr<SceneImportSettings> Create()
     {
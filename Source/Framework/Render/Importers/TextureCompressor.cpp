@@ -0,0 +1,755 @@
+#include "Render/Importers/TextureCompressor.h"
+#include "Core/Thread.h"
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+// Blocks per job when a level is encoded on several threads.
+constexpr int32 COMPRESS_CHUNK_BLOCKS = 1024;
+
+// Least squares passes after the first fit of each block.
+int32 GetRefineCount(CompressionQuality quality)
+{
+    switch (quality)
+    {
+    case CompressionQuality::Fast:
+        return 0;
+    case CompressionQuality::Normal:
+        return 2;
+    default:
+        return 8;
+    }
+}
+
+using Texels = float[16][4];
+
+void ToTexels(const uint8 *texels, Texels &out)
+{
+    for (int32 i = 0; i < 16; ++i)
+    {
+        for (int32 c = 0; c < 4; ++c)
+            out[i][c] = texels[i * 4 + c];
+    }
+}
+
+// Mean of the texels and the direction they spread along the most, a zero axis for a solid block.
+void FindPrincipalAxis(const Texels &texels, int32 channels, float *mean, float *axis)
+{
+    for (int32 c = 0; c < channels; ++c)
+    {
+        mean[c] = 0.0f;
+        for (int32 i = 0; i < 16; ++i)
+            mean[c] += texels[i][c];
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int32 i = 0; i < 16; ++i)
+    {
+        for (int32 a = 0; a < channels; ++a)
+        {
+            for (int32 b = 0; b < channels; ++b)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+        }
+    }
+
+    // Power iteration, started from the row of the channel that varies most so it can not start orthogonal to the answer.
+    int32 largest = 0;
+    for (int32 c = 1; c < channels; ++c)
+    {
+        if (covariance[c][c] > covariance[largest][largest])
+            largest = c;
+    }
+    for (int32 c = 0; c < channels; ++c)
+        axis[c] = covariance[largest][c];
+
+    for (int32 iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int32 a = 0; a < channels; ++a)
+        {
+            for (int32 b = 0; b < channels; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+        length = Math::Sqrt(length);
+        for (int32 c = 0; c < channels; ++c)
+            axis[c] = length > 1e-6f ? next[c] / length : 0.0f;
+    }
+}
+
+// Ends of the texels projected on the principal axis.
+void FitEndpoints(const Texels &texels, int32 channels, float *e0, float *e1)
+{
+    float mean[4];
+    float axis[4];
+    FindPrincipalAxis(texels, channels, mean, axis);
+
+    float lo = 0.0f;
+    float hi = 0.0f;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int32 c = 0; c < channels; ++c)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        lo = Math::Min(lo, t);
+        hi = Math::Max(hi, t);
+    }
+    for (int32 c = 0; c < channels; ++c)
+    {
+        e0[c] = mean[c] + axis[c] * hi;
+        e1[c] = mean[c] + axis[c] * lo;
+    }
+}
+
+// Endpoints with the least squared error when texel i is weights[i] * e0 + (1 - weights[i]) * e1. Negative weights leave a texel out.
+// False when the weights do not pin both endpoints down.
+bool SolveEndpoints(const Texels &texels, const float *weights, int32 channels, float *e0, float *e1)
+{
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = {};
+    float bx[4] = {};
+    for (int32 i = 0; i < 16; ++i)
+    {
+        if (weights[i] < 0.0f)
+            continue;
+        float a = weights[i];
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int32 c = 0; c < channels; ++c)
+        {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (Math::Abs(det) < 1e-6f)
+        return false;
+    for (int32 c = 0; c < channels; ++c)
+    {
+        e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+        e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+    }
+    return true;
+}
+
+float Distance(const float *a, const float *b, int32 channels)
+{
+    float sum = 0.0f;
+    for (int32 c = 0; c < channels; ++c)
+        sum += (a[c] - b[c]) * (a[c] - b[c]);
+    return sum;
+}
+
+// BC1
+
+uint16 PackRgb565(const float *color)
+{
+    auto Quantize = [](float value, float max) { return static_cast<uint16>(Math::RoundToInt(Math::Clamp(value, 0.0f, 255.0f) * max / 255.0f)); };
+    return static_cast<uint16>((Quantize(color[0], 31.0f) << 11) | (Quantize(color[1], 63.0f) << 5) | Quantize(color[2], 31.0f));
+}
+
+void UnpackRgb565(uint16 packed, float *color)
+{
+    int32 r = (packed >> 11) & 31;
+    int32 g = (packed >> 5) & 63;
+    int32 b = packed & 31;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// Weight of the first endpoint for each index of the four color mode.
+constexpr float BC1_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+float AssignBC1(const Texels &texels, uint16 c0, uint16 c1, uint8 *indices)
+{
+    float palette[4][3];
+    UnpackRgb565(c0, palette[0]);
+    UnpackRgb565(c1, palette[1]);
+    for (int32 c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    float error = 0.0f;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        float best = Distance(texels[i], palette[0], 3);
+        indices[i] = 0;
+        for (int32 p = 1; p < 4; ++p)
+        {
+            float distance = Distance(texels[i], palette[p], 3);
+            if (distance < best)
+            {
+                best = distance;
+                indices[i] = static_cast<uint8>(p);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+void WriteBC1(uint16 c0, uint16 c1, uint8 *indices, uint8 *block)
+{
+    // The four color mode needs c0 > c1, swapping the endpoints mirrors the palette.
+    static const uint8 swapped[4] = { 1, 0, 3, 2 };
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        for (int32 i = 0; i < 16; ++i)
+            indices[i] = swapped[indices[i]];
+    }
+    else if (c0 == c1)
+    {
+        // Index 3 would be black in the three color mode.
+        std::memset(indices, 0, 16);
+    }
+
+    uint32 bits = 0;
+    for (int32 i = 0; i < 16; ++i)
+        bits |= static_cast<uint32>(indices[i]) << (i * 2);
+    std::memcpy(block, &c0, sizeof(c0));
+    std::memcpy(block + 2, &c1, sizeof(c1));
+    std::memcpy(block + 4, &bits, sizeof(bits));
+}
+
+// BC4
+
+// Weight of the first endpoint per index, -1 for the indices of the six value mode that stand for 0 and 255.
+constexpr float BC4_WEIGHTS[2][8] = {
+    { 1.0f, 0.0f, 6.0f / 7.0f, 5.0f / 7.0f, 4.0f / 7.0f, 3.0f / 7.0f, 2.0f / 7.0f, 1.0f / 7.0f },
+    { 1.0f, 0.0f, 4.0f / 5.0f, 3.0f / 5.0f, 2.0f / 5.0f, 1.0f / 5.0f, -1.0f, -1.0f },
+};
+
+// r0 > r1 selects eight interpolated values, otherwise six and the constants 0 and 255.
+float AssignBC4(const Texels &values, int32 r0, int32 r1, uint8 *indices)
+{
+    const float *weights = BC4_WEIGHTS[r0 > r1 ? 0 : 1];
+    float palette[8];
+    for (int32 p = 0; p < 8; ++p)
+        palette[p] = weights[p] * r0 + (1.0f - weights[p]) * r1;
+    if (r0 <= r1)
+    {
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+
+    float error = 0.0f;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        float best = (values[i][0] - palette[0]) * (values[i][0] - palette[0]);
+        indices[i] = 0;
+        for (int32 p = 1; p < 8; ++p)
+        {
+            float distance = (values[i][0] - palette[p]) * (values[i][0] - palette[p]);
+            if (distance < best)
+            {
+                best = distance;
+                indices[i] = static_cast<uint8>(p);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+// BC7
+
+constexpr int32 BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Mode 6 endpoint, 7 bits per channel and a shared lowest bit.
+struct BC7Endpoint
+{
+    int32 values[4];
+    int32 pbit;
+
+    int32 Expand(int32 c) const
+    {
+        return (values[c] << 1) | pbit;
+    }
+};
+
+BC7Endpoint QuantizeBC7(const float *color, int32 pbit)
+{
+    BC7Endpoint endpoint;
+    endpoint.pbit = pbit;
+    for (int32 c = 0; c < 4; ++c)
+        endpoint.values[c] = Math::Clamp(Math::RoundToInt((color[c] - pbit) * 0.5f), 0, 127);
+    return endpoint;
+}
+
+float AssignBC7(const Texels &texels, const BC7Endpoint &e0, const BC7Endpoint &e1, uint8 *indices)
+{
+    float palette[16][4];
+    for (int32 p = 0; p < 16; ++p)
+    {
+        for (int32 c = 0; c < 4; ++c)
+            palette[p][c] = static_cast<float>(((64 - BC7_WEIGHTS[p]) * e0.Expand(c) + BC7_WEIGHTS[p] * e1.Expand(c) + 32) >> 6);
+    }
+
+    float direction[4];
+    float length = 0.0f;
+    for (int32 c = 0; c < 4; ++c)
+    {
+        direction[c] = palette[15][c] - palette[0][c];
+        length += direction[c] * direction[c];
+    }
+
+    // The palette lies on a line, so the projection finds the nearest entry give or take the rounding of the weights.
+    float error = 0.0f;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        int32 guess = 0;
+        if (length > 0.0f)
+        {
+            float t = 0.0f;
+            for (int32 c = 0; c < 4; ++c)
+                t += (texels[i][c] - palette[0][c]) * direction[c];
+            guess = Math::Clamp(Math::RoundToInt(t / length * 15.0f), 0, 15);
+        }
+
+        float best = Distance(texels[i], palette[guess], 4);
+        indices[i] = static_cast<uint8>(guess);
+        for (int32 p = Math::Max(guess - 1, 0); p <= Math::Min(guess + 1, 15); ++p)
+        {
+            float distance = Distance(texels[i], palette[p], 4);
+            if (distance < best)
+            {
+                best = distance;
+                indices[i] = static_cast<uint8>(p);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+// Writes fields from the lowest bit of the block up.
+class BitWriter
+{
+public:
+    explicit BitWriter(uint8 *bytes)
+        : bytes(bytes)
+    {
+        std::memset(bytes, 0, 16);
+    }
+
+    void Write(uint32 value, int32 bits)
+    {
+        for (int32 i = 0; i < bits; ++i, ++position)
+            bytes[position >> 3] |= static_cast<uint8>(((value >> i) & 1) << (position & 7));
+    }
+
+private:
+    uint8 *bytes;
+    int32 position = 0;
+};
+
+void EncodeBlock(const uint8 *texels, uint8 *block, TextureCompression compression, CompressionQuality quality)
+{
+    switch (compression)
+    {
+    case TextureCompression::BC1:
+        TextureCompressor::EncodeBC1(texels, block, quality);
+        break;
+    case TextureCompression::BC3:
+        TextureCompressor::EncodeBC4(texels, 3, block, quality);
+        TextureCompressor::EncodeBC1(texels, block + 8, quality);
+        break;
+    case TextureCompression::BC4:
+        TextureCompressor::EncodeBC4(texels, 0, block, quality);
+        break;
+    case TextureCompression::BC5:
+        TextureCompressor::EncodeBC4(texels, 0, block, quality);
+        TextureCompressor::EncodeBC4(texels, 1, block + 8, quality);
+        break;
+    case TextureCompression::BC7:
+        TextureCompressor::EncodeBC7(texels, block, quality);
+        break;
+    default:
+        break;
+    }
+}
+
+void CompressLevel(const uint8 *src, int32 width, int32 height, int32 channels, uint8 *dst, int32 blockBytes, TextureCompression compression,
+                   CompressionQuality quality)
+{
+    int32 blocksX = (width + 3) / 4;
+    int32 blocksY = (height + 3) / 4;
+
+    auto CompressRows = [=](int32 rowBegin, int32 rowEnd) {
+        uint8 texels[16 * 4];
+        for (int32 by = rowBegin; by < rowEnd; ++by)
+        {
+            for (int32 bx = 0; bx < blocksX; ++bx)
+            {
+                for (int32 i = 0; i < 16; ++i)
+                {
+                    int32 x = Math::Min(bx * 4 + i % 4, width - 1);
+                    int32 y = Math::Min(by * 4 + i / 4, height - 1);
+                    const uint8 *texel = src + (static_cast<SizeType>(y) * width + x) * channels;
+                    texels[i * 4 + 0] = texel[0];
+                    texels[i * 4 + 1] = channels > 1 ? texel[1] : 0;
+                    texels[i * 4 + 2] = channels > 2 ? texel[2] : 0;
+                    texels[i * 4 + 3] = channels > 3 ? texel[3] : 255;
+                }
+                EncodeBlock(texels, dst + (static_cast<SizeType>(by) * blocksX + bx) * blockBytes, compression, quality);
+            }
+        }
+    };
+
+    auto &pool = ThreadPool::GetGlobal();
+    int32 rowsPerChunk = Math::Max(COMPRESS_CHUNK_BLOCKS / blocksX, 1);
+    int32 chunkCount = (blocksY + rowsPerChunk - 1) / rowsPerChunk;
+    int32 threadCount = Math::Min(chunkCount, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1);
+    threadCount = Math::Max(threadCount, 1);
+
+    std::atomic<int32> next{ 0 };
+    auto Compress = [&, rowsPerChunk, chunkCount]() {
+        for (int32 i = next++; i < chunkCount; i = next++)
+            CompressRows(i * rowsPerChunk, Math::Min((i + 1) * rowsPerChunk, blocksY));
+    };
+
+    Array<ThreadPool::Handle> handles;
+    for (int32 i = 1; i < threadCount; ++i)
+    {
+        handles.Add(pool.Run(CT_TEXT("TextureCompressor"), [&Compress]() { Compress(); }));
+    }
+    Compress();
+    for (auto &handle : handles)
+        handle.Wait();
+}
+}
+
+ResourceFormat TextureCompressor::GetCompressedFormat(TextureCompression compression, bool srgb)
+{
+    switch (compression)
+    {
+    case TextureCompression::BC1:
+        return srgb ? ResourceFormat::BC1UnormSrgb : ResourceFormat::BC1Unorm;
+    case TextureCompression::BC3:
+        return srgb ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC3Unorm;
+    case TextureCompression::BC4:
+        return srgb ? ResourceFormat::Unknown : ResourceFormat::BC4Unorm;
+    case TextureCompression::BC5:
+        return srgb ? ResourceFormat::Unknown : ResourceFormat::BC5Unorm;
+    case TextureCompression::BC7:
+        return srgb ? ResourceFormat::BC7UnormSrgb : ResourceFormat::BC7Unorm;
+    default:
+        return ResourceFormat::Unknown;
+    }
+}
+
+bool TextureCompressor::Compress(TextureCooker::Image &image, TextureCompression compression, CompressionQuality quality)
+{
+    int32 channels = 0;
+    switch (image.format)
+    {
+    case ResourceFormat::RGBA8Unorm:
+    case ResourceFormat::RGBA8UnormSrgb:
+        channels = 4;
+        break;
+    case ResourceFormat::RG8Unorm:
+        channels = 2;
+        break;
+    case ResourceFormat::R8Unorm:
+        channels = 1;
+        break;
+    default:
+        CT_LOG(Warning, CT_TEXT("Compress texture failed, only 8 bit images are supported. Format: {0}."), String(GetResourceFormatDesc(image.format).name));
+        return false;
+    }
+
+    // Texture sizes are rounded up to whole blocks on the GPU, mips of other sizes would not line up with the ones here.
+    if (image.width % 4 != 0 || image.height % 4 != 0)
+    {
+        CT_LOG(Warning, CT_TEXT("Compress texture failed, the size is not a multiple of 4. Size: {0}x{1}."), image.width, image.height);
+        return false;
+    }
+
+    TextureCooker::Image compressed;
+    compressed.width = image.width;
+    compressed.height = image.height;
+    compressed.mipLevels = image.mipLevels;
+    compressed.format = GetCompressedFormat(compression, IsSrgbFormat(image.format));
+    if (compressed.format == ResourceFormat::Unknown)
+    {
+        CT_LOG(Warning, CT_TEXT("Compress texture failed, the compression has no variant for the format. Format: {0}."),
+               String(GetResourceFormatDesc(image.format).name));
+        return false;
+    }
+    compressed.data.AddUninitialized(static_cast<int32>(TextureCooker::GetMipOffset(compressed, compressed.mipLevels)));
+
+    int32 blockBytes = static_cast<int32>(GetResourceFormatBytes(compressed.format));
+    for (int32 mip = 0; mip < image.mipLevels; ++mip)
+    {
+        int32 width = Math::Max(image.width >> mip, 1);
+        int32 height = Math::Max(image.height >> mip, 1);
+        CompressLevel(image.data.GetData() + TextureCooker::GetMipOffset(image, mip), width, height, channels,
+                      compressed.data.GetData() + TextureCooker::GetMipOffset(compressed, mip), blockBytes, compression, quality);
+    }
+
+    image = std::move(compressed);
+    return true;
+}
+
+void TextureCompressor::EncodeBC1(const uint8 *texels, uint8 *block, CompressionQuality quality)
+{
+    Texels colors;
+    ToTexels(texels, colors);
+
+    float e0[4];
+    float e1[4];
+    FitEndpoints(colors, 3, e0, e1);
+
+    uint16 c0 = PackRgb565(e0);
+    uint16 c1 = PackRgb565(e1);
+    uint8 indices[16];
+    float error = AssignBC1(colors, c0, c1, indices);
+
+    for (int32 iteration = 0; iteration < GetRefineCount(quality) && error > 0.0f; ++iteration)
+    {
+        float weights[16];
+        for (int32 i = 0; i < 16; ++i)
+            weights[i] = BC1_WEIGHTS[indices[i]];
+        if (!SolveEndpoints(colors, weights, 3, e0, e1))
+            break;
+
+        uint16 n0 = PackRgb565(e0);
+        uint16 n1 = PackRgb565(e1);
+        uint8 nextIndices[16];
+        float nextError = AssignBC1(colors, n0, n1, nextIndices);
+        if (nextError >= error)
+            break;
+        c0 = n0;
+        c1 = n1;
+        error = nextError;
+        std::memcpy(indices, nextIndices, sizeof(indices));
+    }
+
+    // High quality then nudges every endpoint channel by one step while that lowers the error.
+    if (quality == CompressionQuality::High && error > 0.0f)
+    {
+        static const int32 shifts[3] = { 11, 5, 0 };
+        static const int32 masks[3] = { 31, 63, 31 };
+        uint16 *endpoints[2] = { &c0, &c1 };
+        for (int32 e = 0; e < 2; ++e)
+        {
+            for (int32 c = 0; c < 3; ++c)
+            {
+                for (int32 step : { -1, 1 })
+                {
+                    int32 value = ((*endpoints[e] >> shifts[c]) & masks[c]) + step;
+                    if (value < 0 || value > masks[c])
+                        continue;
+                    uint16 saved = *endpoints[e];
+                    *endpoints[e] = static_cast<uint16>((saved & ~(masks[c] << shifts[c])) | (value << shifts[c]));
+                    uint8 nextIndices[16];
+                    float nextError = AssignBC1(colors, c0, c1, nextIndices);
+                    if (nextError < error)
+                    {
+                        error = nextError;
+                        std::memcpy(indices, nextIndices, sizeof(indices));
+                    }
+                    else
+                    {
+                        *endpoints[e] = saved;
+                    }
+                }
+            }
+        }
+    }
+
+    WriteBC1(c0, c1, indices, block);
+}
+
+void TextureCompressor::EncodeBC4(const uint8 *texels, int32 channel, uint8 *block, CompressionQuality quality)
+{
+    Texels values = {};
+    int32 lo = 255;
+    int32 hi = 0;
+    int32 innerLo = 255;
+    int32 innerHi = 0;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        int32 value = texels[i * 4 + channel];
+        values[i][0] = static_cast<float>(value);
+        lo = Math::Min(lo, value);
+        hi = Math::Max(hi, value);
+        if (value != 0 && value != 255)
+        {
+            innerLo = Math::Min(innerLo, value);
+            innerHi = Math::Max(innerHi, value);
+        }
+    }
+
+    // Eight values between the extremes, and six between the extremes other than 0 and 255 which have their own indices.
+    int32 candidates[2][2] = { { hi, lo }, { Math::Min(innerLo, innerHi), innerHi } };
+    int32 candidateCount = quality == CompressionQuality::Fast ? 1 : 2;
+
+    int32 best0 = hi;
+    int32 best1 = lo;
+    uint8 bestIndices[16] = {};
+    float bestError = -1.0f;
+    for (int32 m = 0; m < candidateCount; ++m)
+    {
+        int32 r0 = candidates[m][0];
+        int32 r1 = candidates[m][1];
+        // The eight value mode needs r0 > r1 even for a solid block, index 0 still hits it exactly.
+        if (m == 0 && r0 == r1)
+            r1 = r0 > 0 ? r0 - 1 : r0 + 1;
+
+        uint8 indices[16];
+        float error = AssignBC4(values, r0, r1, indices);
+        for (int32 iteration = 0; iteration < GetRefineCount(quality) && error > 0.0f; ++iteration)
+        {
+            float weights[16];
+            for (int32 i = 0; i < 16; ++i)
+                weights[i] = BC4_WEIGHTS[m][indices[i]];
+            float e0;
+            float e1;
+            if (!SolveEndpoints(values, weights, 1, &e0, &e1))
+                break;
+
+            // The mode is in the order of the endpoints, so it has to survive the rounding.
+            int32 n0 = Math::Clamp(Math::RoundToInt(e0), 0, 255);
+            int32 n1 = Math::Clamp(Math::RoundToInt(e1), 0, 255);
+            if (m == 0 ? n0 <= n1 : n0 > n1)
+                break;
+
+            uint8 nextIndices[16];
+            float nextError = AssignBC4(values, n0, n1, nextIndices);
+            if (nextError >= error)
+                break;
+            r0 = n0;
+            r1 = n1;
+            error = nextError;
+            std::memcpy(indices, nextIndices, sizeof(indices));
+        }
+
+        if (bestError < 0.0f || error < bestError)
+        {
+            best0 = r0;
+            best1 = r1;
+            bestError = error;
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    uint64 bits = 0;
+    for (int32 i = 0; i < 16; ++i)
+        bits |= static_cast<uint64>(bestIndices[i]) << (i * 3);
+    block[0] = static_cast<uint8>(best0);
+    block[1] = static_cast<uint8>(best1);
+    for (int32 i = 0; i < 6; ++i)
+        block[2 + i] = static_cast<uint8>(bits >> (i * 8));
+}
+
+void TextureCompressor::EncodeBC7(const uint8 *texels, uint8 *block, CompressionQuality quality)
+{
+    Texels colors;
+    ToTexels(texels, colors);
+
+    float e0[4];
+    float e1[4];
+    FitEndpoints(colors, 4, e0, e1);
+
+    BC7Endpoint best0;
+    BC7Endpoint best1;
+    uint8 indices[16];
+    float error = -1.0f;
+    auto Try = [&](const BC7Endpoint &q0, const BC7Endpoint &q1) {
+        uint8 nextIndices[16];
+        float nextError = AssignBC7(colors, q0, q1, nextIndices);
+        if (error >= 0.0f && nextError >= error)
+            return false;
+        best0 = q0;
+        best1 = q1;
+        error = nextError;
+        std::memcpy(indices, nextIndices, sizeof(indices));
+        return true;
+    };
+
+    // The fast path rounds each endpoint to its closest pbit, the others try every pair against the whole block.
+    auto Closest = [](const float *color) {
+        BC7Endpoint even = QuantizeBC7(color, 0);
+        BC7Endpoint odd = QuantizeBC7(color, 1);
+        float evenError = 0.0f;
+        float oddError = 0.0f;
+        for (int32 c = 0; c < 4; ++c)
+        {
+            evenError += (even.Expand(c) - color[c]) * (even.Expand(c) - color[c]);
+            oddError += (odd.Expand(c) - color[c]) * (odd.Expand(c) - color[c]);
+        }
+        return evenError <= oddError ? even : odd;
+    };
+    auto Fit = [&](const float *f0, const float *f1) {
+        if (quality == CompressionQuality::Fast)
+            return Try(Closest(f0), Closest(f1));
+
+        bool improved = false;
+        for (int32 pair = 0; pair < 4; ++pair)
+            improved = Try(QuantizeBC7(f0, pair & 1), QuantizeBC7(f1, pair >> 1)) || improved;
+        return improved;
+    };
+    Fit(e0, e1);
+
+    for (int32 iteration = 0; iteration < GetRefineCount(quality) && error > 0.0f; ++iteration)
+    {
+        float weights[16];
+        for (int32 i = 0; i < 16; ++i)
+            weights[i] = 1.0f - BC7_WEIGHTS[indices[i]] / 64.0f;
+        if (!SolveEndpoints(colors, weights, 4, e0, e1) || !Fit(e0, e1))
+            break;
+    }
+
+    if (quality == CompressionQuality::High && error > 0.0f)
+    {
+        for (int32 e = 0; e < 2; ++e)
+        {
+            for (int32 c = 0; c < 4; ++c)
+            {
+                for (int32 step : { -1, 1 })
+                {
+                    BC7Endpoint q0 = best0;
+                    BC7Endpoint q1 = best1;
+                    BC7Endpoint &endpoint = e == 0 ? q0 : q1;
+                    endpoint.values[c] += step;
+                    if (endpoint.values[c] >= 0 && endpoint.values[c] <= 127)
+                        Try(q0, q1);
+                }
+            }
+        }
+    }
+
+    // The first index is stored without its top bit, so it has to be in the lower half.
+    if (indices[0] >= 8)
+    {
+        std::swap(best0, best1);
+        for (int32 i = 0; i < 16; ++i)
+            indices[i] = static_cast<uint8>(15 - indices[i]);
+    }
+
+    BitWriter writer(block);
+    writer.Write(1 << 6, 7);
+    for (int32 c = 0; c < 4; ++c)
+    {
+        writer.Write(best0.values[c], 7);
+        writer.Write(best1.values[c], 7);
+    }
+    writer.Write(best0.pbit, 1);
+    writer.Write(best1.pbit, 1);
+    writer.Write(indices[0], 3);
+    for (int32 i = 1; i < 16; ++i)
+        writer.Write(indices[i], 4);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Render/Importers/TextureCooker.h"
+
+// CPU encoder for the BC block formats. Blocks are 4x4 texels, the ones hanging over the border of small mips repeat the edge texels.
+class TextureCompressor
+{
+public:
+    // Unknown when the compression has no variant for the color space.
+    static ResourceFormat GetCompressedFormat(TextureCompression compression, bool srgb);
+
+    // Replaces every mip of an RGBA8, RG8 or R8 image with its blocks, spread over the global thread pool.
+    // Missing channels read as 0 and alpha as 255, like the GPU samples them. Fails on other formats and on sizes that are not a multiple of 4.
+    static bool Compress(TextureCooker::Image &image, TextureCompression compression, CompressionQuality quality);
+
+    // Encoders of a single block, texels are 16 RGBA8 values in row order.
+    static void EncodeBC1(const uint8 *texels, uint8 *block, CompressionQuality quality);
+    // Encodes one channel of the texels.
+    static void EncodeBC4(const uint8 *texels, int32 channel, uint8 *block, CompressionQuality quality);
+    // Mode 6 only, one subset with RGBA endpoints and 4 bit indices.
+    static void EncodeBC7(const uint8 *texels, uint8 *block, CompressionQuality quality);
+};
@@ -0,0 +1,242 @@
+#include "Render/Importers/TextureCooker.h"
+#include "IO/CookCache.h"
+#include "Render/Pixmap.h"
+#include <cstring>
+#include <tinyddsloader.h>
+using namespace tinyddsloader;
+
+namespace
+{
+void HashSettings(uint64 &hash, const TextureImportSettings &settings)
+{
+    Hash::HashBytesCombine(hash, TextureCooker::VERSION);
+    Hash::HashBytesCombine(hash, settings.flipY);
+    Hash::HashBytesCombine(hash, settings.generateMips);
+    Hash::HashBytesCombine(hash, settings.srgbFormat);
+    Hash::HashBytesCombine(hash, settings.generateMips ? settings.mipFilter : MipFilter::Box);
+    Hash::HashBytesCombine(hash, settings.compression);
+    Hash::HashBytesCombine(hash, settings.compression != TextureCompression::None ? settings.compressionQuality : CompressionQuality::Normal);
+}
+
+DDSFile::DXGIFormat GetDXGIFormat(ResourceFormat format)
+{
+    switch (format)
+    {
+    case ResourceFormat::RGBA8Unorm:
+        return DDSFile::DXGIFormat::R8G8B8A8_UNorm;
+    case ResourceFormat::RGBA8UnormSrgb:
+        return DDSFile::DXGIFormat::R8G8B8A8_UNorm_SRGB;
+    case ResourceFormat::RG8Unorm:
+        return DDSFile::DXGIFormat::R8G8_UNorm;
+    case ResourceFormat::R8Unorm:
+        return DDSFile::DXGIFormat::R8_UNorm;
+    case ResourceFormat::RGBA16Unorm:
+        return DDSFile::DXGIFormat::R16G16B16A16_UNorm;
+    case ResourceFormat::RG16Unorm:
+        return DDSFile::DXGIFormat::R16G16_UNorm;
+    case ResourceFormat::R16Unorm:
+        return DDSFile::DXGIFormat::R16_UNorm;
+    case ResourceFormat::RGBA32Float:
+        return DDSFile::DXGIFormat::R32G32B32A32_Float;
+    case ResourceFormat::RG32Float:
+        return DDSFile::DXGIFormat::R32G32_Float;
+    case ResourceFormat::R32Float:
+        return DDSFile::DXGIFormat::R32_Float;
+    case ResourceFormat::BC1Unorm:
+        return DDSFile::DXGIFormat::BC1_UNorm;
+    case ResourceFormat::BC1UnormSrgb:
+        return DDSFile::DXGIFormat::BC1_UNorm_SRGB;
+    case ResourceFormat::BC3Unorm:
+        return DDSFile::DXGIFormat::BC3_UNorm;
+    case ResourceFormat::BC3UnormSrgb:
+        return DDSFile::DXGIFormat::BC3_UNorm_SRGB;
+    case ResourceFormat::BC4Unorm:
+        return DDSFile::DXGIFormat::BC4_UNorm;
+    case ResourceFormat::BC5Unorm:
+        return DDSFile::DXGIFormat::BC5_UNorm;
+    case ResourceFormat::BC7Unorm:
+        return DDSFile::DXGIFormat::BC7_UNorm;
+    case ResourceFormat::BC7UnormSrgb:
+        return DDSFile::DXGIFormat::BC7_UNorm_SRGB;
+    default:
+        return DDSFile::DXGIFormat::Unknown;
+    }
+}
+
+// Formats cooked files are written in, the reverse of GetDXGIFormat.
+ResourceFormat GetCookedFormat(DDSFile::DXGIFormat dxgiFormat)
+{
+    static const ResourceFormat formats[] = {
+        ResourceFormat::RGBA8Unorm, ResourceFormat::RGBA8UnormSrgb, ResourceFormat::RG8Unorm,    ResourceFormat::R8Unorm,      ResourceFormat::RGBA16Unorm,
+        ResourceFormat::RG16Unorm,  ResourceFormat::R16Unorm,       ResourceFormat::RGBA32Float, ResourceFormat::RG32Float,    ResourceFormat::R32Float,
+        ResourceFormat::BC1Unorm,   ResourceFormat::BC1UnormSrgb,   ResourceFormat::BC3Unorm,    ResourceFormat::BC3UnormSrgb, ResourceFormat::BC4Unorm,
+        ResourceFormat::BC5Unorm,   ResourceFormat::BC7Unorm,       ResourceFormat::BC7UnormSrgb,
+    };
+    for (auto format : formats)
+    {
+        if (GetDXGIFormat(format) == dxgiFormat)
+            return format;
+    }
+    return ResourceFormat::Unknown;
+}
+
+// DDS header words the cooked files fill in.
+constexpr uint32 DDS_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000; // Caps, height, width and pixel format.
+constexpr uint32 DDS_FLAG_PITCH = 0x8;
+constexpr uint32 DDS_FLAG_LINEAR_SIZE = 0x80000;
+constexpr uint32 DDS_FLAG_MIPMAP_COUNT = 0x20000;
+constexpr uint32 DDS_PIXEL_FORMAT_FOURCC = 0x4;
+constexpr uint32 DDS_FOURCC_DX10 = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+constexpr uint32 DDS_CAPS_TEXTURE = 0x1000;
+constexpr uint32 DDS_CAPS_MIPMAP = 0x8 | 0x400000; // Complex and mipmap.
+
+constexpr SizeType DDS_DATA_OFFSET = sizeof(uint32) + sizeof(DDSFile::Header) + sizeof(DDSFile::HeaderDXT10);
+static_assert(sizeof(DDSFile::Header) == 124 && sizeof(DDSFile::HeaderDXT10) == 20, "DDS headers must match the file format.");
+}
+
+int32 TextureCooker::GetMipLevels(int32 width, int32 height)
+{
+    int32 levels = 1;
+    for (int32 size = Math::Max(width, height); size > 1; size >>= 1)
+        ++levels;
+    return levels;
+}
+
+SizeType TextureCooker::GetMipSize(const Image &image, int32 mip)
+{
+    // Compressed formats store whole blocks, the bytes of a format are the bytes of its block.
+    SizeType blockWidth = GetResourceFormatWidthCompressionRatio(image.format);
+    SizeType blockHeight = GetResourceFormatHeightCompressionRatio(image.format);
+    SizeType width = (Math::Max(image.width >> mip, 1) + blockWidth - 1) / blockWidth;
+    SizeType height = (Math::Max(image.height >> mip, 1) + blockHeight - 1) / blockHeight;
+    return width * height * GetResourceFormatBytes(image.format);
+}
+
+SizeType TextureCooker::GetMipOffset(const Image &image, int32 mip)
+{
+    SizeType offset = 0;
+    for (int32 i = 0; i < mip; ++i)
+        offset += GetMipSize(image, i);
+    return offset;
+}
+
+bool TextureCooker::CanGenerateMips(ResourceFormat format)
+{
+    return Pixmap::IsSupportedFormat(format);
+}
+
+bool TextureCooker::GenerateMips(Image &image, MipFilter filter)
+{
+    if (!CanGenerateMips(image.format) || image.width <= 0 || image.height <= 0 || image.data.Count() < static_cast<int32>(GetMipSize(image, 0)))
+        return false;
+
+    image.mipLevels = GetMipLevels(image.width, image.height);
+    SizeType total = GetMipOffset(image, image.mipLevels);
+    if (total > INT32_MAX)
+        return false;
+    image.data.SetCount(static_cast<int32>(total));
+
+    // Alpha of a texture is not always coverage, so channels are filtered on their own.
+    PixmapFilter pixmapFilter = filter == MipFilter::Kaiser ? PixmapFilter::Kaiser : PixmapFilter::Box;
+    auto level = Pixmap::Create(image.width, image.height, image.format, image.data.GetData());
+    for (int32 mip = 1; mip < image.mipLevels; ++mip)
+    {
+        level = level->Resize(Math::Max(image.width >> mip, 1), Math::Max(image.height >> mip, 1), pixmapFilter, false);
+        std::memcpy(image.data.GetData() + GetMipOffset(image, mip), level->GetData(), level->GetSize());
+    }
+    return true;
+}
+
+uint64 TextureCooker::GetKey(const String &path, const TextureImportSettings &settings)
+{
+    uint64 hash = Hash::BYTES_HASH_SEED;
+    HashSettings(hash, settings);
+    return IO::CookCache::GetSourceKey(path, hash);
+}
+
+uint64 TextureCooker::GetKey(const Array<uint8> &bytes, const TextureImportSettings &settings)
+{
+    uint64 hash = Hash::BYTES_HASH_SEED;
+    HashSettings(hash, settings);
+    hash = Hash::HashBytes(bytes.GetData(), bytes.Count(), hash);
+    return hash;
+}
+
+String TextureCooker::GetPath(const String &directory, uint64 key)
+{
+    return IO::CookCache::GetPath(directory, key, CT_TEXT(".dds"));
+}
+
+bool TextureCooker::Save(const String &directory, uint64 key, const Image &image)
+{
+    auto dxgiFormat = GetDXGIFormat(image.format);
+    if (dxgiFormat == DDSFile::DXGIFormat::Unknown || image.data.Count() != static_cast<int32>(GetMipOffset(image, image.mipLevels)))
+    {
+        CT_LOG(Error, CT_TEXT("Cook texture failed, the image can not be stored as DDS. Format: {0}."), String(GetResourceFormatDesc(image.format).name));
+        return false;
+    }
+
+    DDSFile::Header header = {};
+    header.m_size = sizeof(DDSFile::Header);
+    // Compressed files give the size of the first level instead of the size of a row.
+    bool compressed = IsCompressedFormat(image.format);
+    header.m_flags = DDS_FLAGS | (compressed ? DDS_FLAG_LINEAR_SIZE : DDS_FLAG_PITCH) | (image.mipLevels > 1 ? DDS_FLAG_MIPMAP_COUNT : 0);
+    header.m_height = image.height;
+    header.m_width = image.width;
+    header.m_pitchOrLinerSize = static_cast<uint32>(compressed ? GetMipSize(image, 0) : image.width * GetResourceFormatBytes(image.format));
+    header.m_mipMapCount = image.mipLevels;
+    header.m_reserved1[0] = MAGIC;
+    header.m_reserved1[1] = VERSION;
+    header.m_reserved1[2] = static_cast<uint32>(key);
+    header.m_reserved1[3] = static_cast<uint32>(key >> 32);
+    header.m_pixelFormat.m_size = sizeof(DDSFile::PixelFormat);
+    header.m_pixelFormat.m_flags = DDS_PIXEL_FORMAT_FOURCC;
+    header.m_pixelFormat.m_fourCC = DDS_FOURCC_DX10;
+    header.m_caps = DDS_CAPS_TEXTURE | (image.mipLevels > 1 ? DDS_CAPS_MIPMAP : 0);
+
+    DDSFile::HeaderDXT10 dxt10 = {};
+    dxt10.m_format = dxgiFormat;
+    dxt10.m_resourceDimension = DDSFile::TextureDimension::Texture2D;
+    dxt10.m_arraySize = 1;
+
+    return IO::CookCache::Write(GetPath(directory, key), { { DDSFile::Magic, sizeof(DDSFile::Magic) },
+                                                          { &header, sizeof(header) },
+                                                          { &dxt10, sizeof(dxt10) },
+                                                          { image.data.GetData(), static_cast<uint64>(image.data.Count()) } });
+}
+
+bool TextureCooker::IsCooked(const Array<uint8> &bytes, uint64 key)
+{
+    if (static_cast<SizeType>(bytes.Count()) < DDS_DATA_OFFSET || std::memcmp(bytes.GetData(), DDSFile::Magic, sizeof(DDSFile::Magic)) != 0)
+        return false;
+
+    DDSFile::Header header;
+    std::memcpy(&header, bytes.GetData() + sizeof(uint32), sizeof(header));
+    return header.m_reserved1[0] == MAGIC && header.m_reserved1[1] == VERSION && header.m_reserved1[2] == static_cast<uint32>(key) &&
+           header.m_reserved1[3] == static_cast<uint32>(key >> 32);
+}
+
+SizeType TextureCooker::GetHeaderSize()
+{
+    return DDS_DATA_OFFSET;
+}
+
+bool TextureCooker::ReadHeader(const Array<uint8> &bytes, uint64 key, Image &image)
+{
+    if (!IsCooked(bytes, key))
+        return false;
+
+    DDSFile::Header header;
+    DDSFile::HeaderDXT10 dxt10;
+    std::memcpy(&header, bytes.GetData() + sizeof(uint32), sizeof(header));
+    std::memcpy(&dxt10, bytes.GetData() + sizeof(uint32) + sizeof(header), sizeof(dxt10));
+    if (dxt10.m_resourceDimension != DDSFile::TextureDimension::Texture2D || dxt10.m_arraySize != 1)
+        return false;
+
+    image.width = static_cast<int32>(header.m_width);
+    image.height = static_cast<int32>(header.m_height);
+    image.mipLevels = Math::Max(static_cast<int32>(header.m_mipMapCount), 1);
+    image.format = GetCookedFormat(dxt10.m_format);
+    image.data.Clear();
+    return image.format != ResourceFormat::Unknown && image.width > 0 && image.height > 0 && image.mipLevels <= GetMipLevels(image.width, image.height);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Render/Importers/TextureImporter.h"
+
+// Mip chains built on the CPU, and decoded images cooked into DDS files so importing them again skips decoding and mip generation.
+// Cooked files are plain DDS files with a DX10 header, the key sits in the reserved header words.
+class TextureCooker
+{
+public:
+    static constexpr uint32 MAGIC = 0x43545443; // "CTTC"
+    static constexpr uint32 VERSION = 2;
+
+    // 2D image with its mip levels tightly packed one after another, the layout Texture::Create2D uploads. Compressed levels are whole blocks.
+    struct Image
+    {
+        int32 width = 0;
+        int32 height = 0;
+        int32 mipLevels = 1;
+        ResourceFormat format = ResourceFormat::Unknown;
+        Array<uint8> data;
+    };
+
+    // Full chain down to 1x1, like the GPU generates it.
+    static int32 GetMipLevels(int32 width, int32 height);
+    static SizeType GetMipSize(const Image &image, int32 mip);
+    static SizeType GetMipOffset(const Image &image, int32 mip);
+
+    // Formats a Pixmap can hold.
+    static bool CanGenerateMips(ResourceFormat format);
+    // Replaces the levels after mip 0 with the full chain, every level is resized from the one before with Pixmap::Resize.
+    // Filtering happens in linear space, srgb formats have their color decoded first and alpha stays linear.
+    static bool GenerateMips(Image &image, MipFilter filter = MipFilter::Box);
+
+    // Changes with the file, its modification time and every import setting the cooked image depends on.
+    static uint64 GetKey(const String &path, const TextureImportSettings &settings);
+    // Images imported from memory are keyed by their bytes.
+    static uint64 GetKey(const Array<uint8> &bytes, const TextureImportSettings &settings);
+    // File of a key in the cache directory.
+    static String GetPath(const String &directory, uint64 key);
+
+    static bool Save(const String &directory, uint64 key, const Image &image);
+    // Whether the bytes are a cooked file of the key, the importer then reads them like any other DDS file.
+    static bool IsCooked(const Array<uint8> &bytes, uint64 key);
+    // Bytes in front of the first level of a cooked file, GetMipOffset of a level is relative to them.
+    static SizeType GetHeaderSize();
+    // Size, format and level count of a cooked file of the key, the image data stays empty. Only the first GetHeaderSize bytes are read,
+    // so a streamer can find any level without loading the file.
+    static bool ReadHeader(const Array<uint8> &bytes, uint64 key, Image &image);
+};
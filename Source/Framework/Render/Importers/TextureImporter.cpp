@@ -1,6 +1,9 @@
 #include "Render/Importers/TextureImporter.h"
 #include "Assets/AssetManager.h"
 #include "IO/FileHandle.h"
+#include "Render/Importers/TextureCompressor.h"
+#include "Render/TextureStreamer.h"
+#include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ASSERT(x) \
@@ -217,7 +220,8 @@ public:
         }
     }
 
-    void CreateFromDDSFile(Array<uint8> bytes)
+    // Cooked files already have the settings applied.
+    bool CreateFromDDSFile(const Array<uint8> &bytes, bool cooked = false)
     {
         DDSFile dds;
         auto ret = dds.Load(bytes.GetData(), bytes.Count());
@@ -225,7 +229,7 @@ public:
         if (tinyddsloader::Result::Success != ret)
         {
             CT_LOG(Error, "Load dds image failed. Path: {0}, errorCode: {1}.", path, static_cast<std::underlying_type_t<tinyddsloader::Result>>(ret));
-            return;
+            return false;
         }
 
         ResourceFormat format = GetResourceFormat(dds);
@@ -233,26 +237,27 @@ public:
         if (format == ResourceFormat::Unknown)
         {
             CT_LOG(Error, "Load dds image failed, Unknown resource format. Path: {0}.", path);
-            return;
+            return false;
         }
-        if (settings->srgbFormat)
+        if (settings->srgbFormat && !cooked)
         {
             format = LinearToSrgbFormat(format);
         }
 
-        int32 mipLevels = -1;
-        if (settings->generateMips == false || IsCompressedFormat(format))
+        // Mips stored in the file are uploaded as they are, only missing ones are generated by the GPU.
+        int32 mipLevels = dds.GetMipCount();
+        if (mipLevels == 1 && settings->generateMips && !IsCompressedFormat(format))
         {
-            // int32 count = dds.GetMipCount();
-            mipLevels = 1;
+            mipLevels = -1;
         }
 
-        if (settings->flipY)
+        if (settings->flipY && !cooked)
         {
             dds.Flip();
         }
 
-        gAssetManager->RunMainthread([asset = this->asset, dds = std::move(dds), format, mipLevels]() mutable {
+        // The file size stands in for the bytes uploaded, the header is all that is not.
+        gAssetManager->RunMainthread<Texture>(asset, bytes.Count(), [dds = std::move(dds), format, mipLevels](const APtr<Texture> &asset) mutable {
             int32 width = dds.GetWidth();
             int32 height = dds.GetHeight();
             int32 depth = dds.GetDepth();
@@ -280,9 +285,11 @@ public:
                 asset.GetData()->ptr = Texture::Create3D(width, height, depth, format, mipLevels, imageData->m_mem);
             }
         });
+        return true;
     }
 
-    void CreateFromStbi(Array<uint8> bytes)
+    // Cooks the decoded image under the key when there is one.
+    bool CreateFromStbi(const Array<uint8> &bytes, const uint64 *cookKey)
     {
         stbi_set_flip_vertically_on_load(settings->flipY ? 1 : 0);
 
@@ -291,7 +298,7 @@ public:
         if (!stbi_info_from_memory(bytes.GetData(), bytes.Count(), &width, &height, &channels))
         {
             CT_LOG(Error, "Load image failed, can not get image info. Path: {0}.", path);
-            return;
+            return false;
         }
 
         // NOTE Always convert 3-elements image to 4-elements.
@@ -367,53 +374,106 @@ public:
         if (!data)
         {
             CT_LOG(Error, "Load image failed. Path: {0}, reason: {1}", path, String(stbi_failure_reason()));
-            return;
+            return false;
         }
 
         if (format == ResourceFormat::Unknown)
         {
             CT_LOG(Error, "Load image failed, Unknown resource format. Path: {0}, channels:{1}.", path, channels);
             stbi_image_free(data);
-            return;
+            return false;
         }
         if (settings->srgbFormat)
         {
             format = LinearToSrgbFormat(format);
         }
 
-        int32 mipLevels = settings->generateMips ? -1 : 1;
-        gAssetManager->RunMainthread([asset = this->asset, width, height, format, mipLevels, data]() mutable {
-            asset.GetData()->ptr = Texture::Create2D(width, height, format, 1, mipLevels, data);
-            stbi_image_free(data);
+        TextureCooker::Image image;
+        image.width = width;
+        image.height = height;
+        image.format = format;
+        image.data.AddUninitialized(static_cast<int32>(TextureCooker::GetMipSize(image, 0)));
+        std::memcpy(image.data.GetData(), data, image.data.Count());
+        stbi_image_free(data);
+
+        // Mips are filtered on the CPU, so they are correct for srgb formats and can be cooked with the image.
+        if (settings->generateMips && !TextureCooker::GenerateMips(image, settings->mipFilter))
+        {
+            CT_LOG(Warning, "Generate mips failed, the texture only has its first level. Path: {0}.", path);
+        }
+
+        // Blocks are encoded from the filtered mips, an image that can not be compressed is kept as it is.
+        if (settings->compression != TextureCompression::None && !TextureCompressor::Compress(image, settings->compression, settings->compressionQuality))
+        {
+            CT_LOG(Warning, "Texture stays uncompressed. Path: {0}.", path);
+        }
+
+        // A failed save is only logged, the image is still good for this run.
+        if (cookKey)
+        {
+            TextureCooker::Save(settings->cacheDirectory, *cookKey, image);
+        }
+
+        uint64 uploadBytes = image.data.Count();
+        gAssetManager->RunMainthread<Texture>(asset, uploadBytes, [image = std::move(image)](const APtr<Texture> &asset) {
+            asset.GetData()->ptr = Texture::Create2D(image.width, image.height, image.format, 1, image.mipLevels, image.data.GetData());
         });
+        return true;
     }
 
-    void Import(const String &path)
+    // The import functions return false when the texture can not be created, callers mark the asset failed.
+    bool Import(const String &path, const Array<uint8> &bytes)
     {
         IO::FileHandle file(path);
-        if (!file.IsFile())
-        {
-            CT_LOG(Error, "Load image failed, can not open file. Path: {0}.", path);
-            return;
-        }
-
         this->path = path;
 
         String ext = file.GetExtension();
-        auto bytes = file.ReadBytes();
         if (ext == CT_TEXT(".dds"))
         {
-            CreateFromDDSFile(std::move(bytes));
+            return CreateFromDDSFile(bytes);
+        }
+        else if (settings->cacheDirectory.IsEmpty())
+        {
+            return CreateFromStbi(bytes, nullptr);
         }
         else
         {
-            CreateFromStbi(std::move(bytes));
+            uint64 key = TextureCooker::GetKey(path, *settings);
+            return CreateFromStbi(bytes, &key);
         }
     }
 
-    void ImportFromMemory(Array<uint8> bytes)
+    // Falls back to importing the source file when the cooked one does not belong to the key.
+    bool ImportCooked(const String &path, uint64 key, const Array<uint8> &bytes)
     {
-        CreateFromStbi(std::move(bytes));
+        this->path = path;
+        if (TextureCooker::IsCooked(bytes, key) && CreateFromDDSFile(bytes, true))
+            return true;
+
+        CT_LOG(Warning, "Cooked texture is stale or unreadable, the image is imported again. Path: {0}.", path);
+        return Import(path, IO::FileHandle(path).ReadBytes());
+    }
+
+    bool ImportFromMemory(const Array<uint8> &bytes)
+    {
+        if (settings->cacheDirectory.IsEmpty())
+        {
+            return CreateFromStbi(bytes, nullptr);
+        }
+
+        uint64 key = TextureCooker::GetKey(bytes, *settings);
+        IO::FileHandle cooked(TextureCooker::GetPath(settings->cacheDirectory, key));
+        if (cooked.IsFile())
+        {
+            if (settings->stream && gTextureStreamer->Add(asset, cooked.GetPath(), key))
+                return true;
+
+            path = cooked.GetPath();
+            auto cookedBytes = cooked.ReadBytes();
+            if (TextureCooker::IsCooked(cookedBytes, key) && CreateFromDDSFile(cookedBytes, true))
+                return true;
+        }
+        return CreateFromStbi(bytes, &key);
     }
 
 private:
@@ -429,9 +489,51 @@ APtr<Texture> TextureImporter::Import(const String &path, const SPtr<ImportSetti
     APtr<Texture> result;
     result.NewData();
 
-    gAssetManager->RunMultithread([=]() {
-        ImporterImpl impl(result, ImportSettings::As<TextureImportSettings>(settings));
-        impl.Import(path);
+    IO::FileHandle file(path);
+    if (!file.IsFile())
+    {
+        CT_LOG(Error, "Load image failed, can not open file. Path: {0}.", path);
+        result.GetData()->failed = true;
+        return result;
+    }
+
+    // A cooked image is read instead of the source when there is one, DDS files are not cooked.
+    auto textureSettings = ImportSettings::As<TextureImportSettings>(settings);
+    if (!textureSettings->cacheDirectory.IsEmpty() && file.GetExtension() != CT_TEXT(".dds"))
+    {
+        uint64 key = TextureCooker::GetKey(path, *textureSettings);
+        IO::FileHandle cooked(TextureCooker::GetPath(textureSettings->cacheDirectory, key));
+        if (cooked.IsFile())
+        {
+            // Streamed textures start with their coarse levels, a file the streamer does not take is read whole.
+            if (textureSettings->stream && gTextureStreamer->Add(result, cooked.GetPath(), key))
+                return result;
+
+            cooked.ReadAsync([=](IO::AsyncReadResult &read) {
+                gAssetManager->RunMultithread<Texture>(result, [=, bytes = read.success ? std::move(read.bytes) : Array<uint8>()](const APtr<Texture> &asset) {
+                    ImporterImpl impl(asset, textureSettings);
+                    if (!impl.ImportCooked(path, key, bytes))
+                        asset.GetData()->failed = true;
+                });
+            });
+            return result;
+        }
+    }
+
+    // Reading goes through the async io service, so no worker is blocked while the bytes are in flight.
+    file.ReadAsync([=](IO::AsyncReadResult &read) {
+        if (!read.success)
+        {
+            CT_LOG(Error, "Load image failed, can not read file. Path: {0}.", path);
+            result.GetData()->failed = true;
+            return;
+        }
+
+        gAssetManager->RunMultithread<Texture>(result, [=, bytes = std::move(read.bytes)](const APtr<Texture> &asset) {
+            ImporterImpl impl(asset, textureSettings);
+            if (!impl.Import(path, bytes))
+                asset.GetData()->failed = true;
+        });
     });
 
     return result;
@@ -442,9 +544,10 @@ APtr<Texture> TextureImporter::ImportFromMemory(Array<uint8> data, const SPtr<Im
     APtr<Texture> result;
     result.NewData();
 
-    gAssetManager->RunMultithread([=]() {
-        ImporterImpl impl(result, ImportSettings::As<TextureImportSettings>(settings));
-        impl.ImportFromMemory(std::move(data));
+    gAssetManager->RunMultithread<Texture>(result, [=](const APtr<Texture> &asset) {
+        ImporterImpl impl(asset, ImportSettings::As<TextureImportSettings>(settings));
+        if (!impl.ImportFromMemory(data))
+            asset.GetData()->failed = true;
     });
 
     return result;
@@ -3,12 +3,57 @@
 #include "Assets/AssetImporter.h"
 #include "RenderCore/Texture.h"
 
+enum class MipFilter
+{
+    Box,    // Averages the texels each one covers.
+    Kaiser, // Windowed sinc, sharper but may ring at hard edges.
+};
+
+// Block compressed format the importer encodes 8 bit images to.
+enum class TextureCompression
+{
+    None,
+    BC1, // RGB at 4 bits per texel, alpha is dropped.
+    BC3, // RGBA at 8 bits per texel, BC1 color with a BC4 alpha block.
+    BC4, // R at 4 bits per texel.
+    BC5, // RG at 8 bits per texel, for normal maps.
+    BC7, // RGBA at 8 bits per texel, the best quality for color maps.
+};
+
+// More time spent fitting the endpoints of each block for a lower error.
+enum class CompressionQuality
+{
+    Fast,
+    Normal,
+    High,
+};
+
 class TextureImportSettings : public ImportSettings
 {
 public:
     bool flipY = false;
     bool generateMips = false;
     bool srgbFormat = false; // If use srgb format, input data will be gamma corrected.
+    MipFilter mipFilter = MipFilter::Box;
+    TextureCompression compression = TextureCompression::None; // Images whose size is not a multiple of 4 stay uncompressed.
+    CompressionQuality compressionQuality = CompressionQuality::Normal;
+    // Decoded images and their mips are cooked into DDS files here, so the next import only uploads them. Empty disables cooking.
+    String cacheDirectory = CT_TEXT("Cache/Textures");
+    // Cooked images are handed to the texture streamer, which loads their coarse levels first. Needs the cache to take effect.
+    bool stream = false;
+
+    HashType HashCode() const override
+    {
+        HashType hash = Hash::HashValue(flipY);
+        Hash::HashCombine(hash, generateMips);
+        Hash::HashCombine(hash, srgbFormat);
+        Hash::HashCombine(hash, mipFilter);
+        Hash::HashCombine(hash, compression);
+        Hash::HashCombine(hash, compressionQuality);
+        Hash::HashCombine(hash, cacheDirectory);
+        Hash::HashCombine(hash, stream);
+        return hash;
+    }
 
     static SPtr<TextureImportSettings> Create()
     {
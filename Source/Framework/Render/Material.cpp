@@ -18,6 +18,7 @@ bool Material::Update()
     UpdateEmissiveType();
     UpdateOcclusonType();
     UpdateNormalType();
+    UpdateBoundTextures();
 
     bool changed = changedSinceLastUpdate;
     changedSinceLastUpdate = false;
@@ -88,6 +89,21 @@ void Material::UpdateNormalType()
     SetFlags(SetMaterialNormalMode(data.flags, mode));
 }
 
+// Importers and the texture streamer swap textures in behind the asset pointers, the scene has to bind them again.
+void Material::UpdateBoundTextures()
+{
+    const Texture *textures[] = { resources.baseTexture.Get(), resources.specularTexture.Get(), resources.emissiveTexture.Get(),
+                                  resources.normalTexture.Get(), resources.occlusionTexture.Get() };
+    for (int32 i = 0; i < 5; ++i)
+    {
+        if (boundTextures[i] != textures[i])
+        {
+            boundTextures[i] = textures[i];
+            MarkDirty();
+        }
+    }
+}
+
 void Material::SetBaseTexture(const APtr<Texture> &texture)
 {
     if (resources.baseTexture != texture)
@@ -144,11 +144,14 @@ private:
     void UpdateEmissiveType();
     void UpdateOcclusonType();
     void UpdateNormalType();
+    void UpdateBoundTextures();
 
 private:
     String name;
     MaterialData data{};
     MaterialResources resources{};
+    // Textures behind the asset pointers when the material last changed, in MaterialResources order.
+    const Texture *boundTextures[5] = {};
     bool dirty = true;
     bool changedSinceLastUpdate = false;
 };
\ No newline at end of file
@@ -0,0 +1,876 @@
+#include "Render/MeshOptimizer.h"
+#include <cfloat>
+
+namespace
+{
+constexpr int32 FORSYTH_CACHE_SIZE = 32;
+constexpr int32 FORSYTH_MAX_VALENCE = 32;
+constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+struct ForsythScores
+{
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE];
+
+    ForsythScores()
+    {
+        for (int32 i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+        {
+            // The vertices of the last triangle get a fixed score so that the next one does not simply reuse its edge.
+            if (i < 3)
+                cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+            else
+                cache[i] = Math::Pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+        }
+        // Vertices with few triangles left are finished first.
+        for (int32 i = 0; i < FORSYTH_MAX_VALENCE; ++i)
+            valence[i] = i == 0 ? 0.0f : FORSYTH_VALENCE_BOOST_SCALE * Math::Pow((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+
+    float Get(int32 cachePosition, int32 remaining) const
+    {
+        if (remaining == 0)
+            return -1.0f;
+
+        float score = cachePosition < 0 ? 0.0f : cache[cachePosition];
+        return score + valence[Math::Min(remaining, FORSYTH_MAX_VALENCE - 1)];
+    }
+};
+
+// Simulates a FIFO cache, returns the number of misses of one triangle.
+struct FifoCache
+{
+    Array<int32> timestamps;
+    int32 time = MeshOptimizer::FIFO_CACHE_SIZE + 1;
+
+    explicit FifoCache(int32 vertexCount)
+    {
+        timestamps.SetCount(vertexCount);
+        for (auto &e : timestamps)
+            e = 0;
+    }
+
+    void Reset()
+    {
+        // Entries older than the cache size are misses, moving the clock ahead makes all of them stale.
+        time += MeshOptimizer::FIFO_CACHE_SIZE + 1;
+    }
+
+    int32 Triangle(const uint32 *triangle)
+    {
+        int32 misses = 0;
+        for (int32 i = 0; i < 3; ++i)
+        {
+            int32 &stamp = timestamps[triangle[i]];
+            if (time - stamp > MeshOptimizer::FIFO_CACHE_SIZE)
+            {
+                stamp = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+};
+
+// Plane distance quadric, p^T Q p is the weighted sum of squared distances to the planes added.
+struct Quadric
+{
+    double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+    double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+    double weight = 0.0;
+
+    void AddPlane(const Vector3 &normal, float d, float w)
+    {
+        double a = normal.x, b = normal.y, c = normal.z;
+        a2 += a * a * w, b2 += b * b * w, c2 += c * c * w, d2 += d * d * w;
+        ab += a * b * w, ac += a * c * w, ad += a * d * w;
+        bc += b * c * w, bd += b * d * w, cd += c * d * w;
+        weight += w;
+    }
+
+    void Add(const Quadric &q)
+    {
+        a2 += q.a2, b2 += q.b2, c2 += q.c2, d2 += q.d2;
+        ab += q.ab, ac += q.ac, ad += q.ad;
+        bc += q.bc, bd += q.bd, cd += q.cd;
+        weight += q.weight;
+    }
+
+    // Root mean square distance of p to the planes.
+    float Error(const Vector3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + b2 * y * y + c2 * z * z + d2 + 2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+        return weight > 0.0 ? (float)Math::Sqrt(Math::Max(e, 0.0) / weight) : 0.0f;
+    }
+};
+
+struct Collapse
+{
+    int32 from;
+    int32 to;
+    float error;
+};
+
+template <typename T>
+void RemapArray(Array<T> &values, const Array<int32> &remap, int32 newCount)
+{
+    if (values.IsEmpty())
+        return;
+
+    Array<T> result;
+    result.SetCount(newCount);
+    for (int32 i = 0; i < values.Count(); ++i)
+    {
+        if (remap[i] >= 0)
+            result[remap[i]] = values[i];
+    }
+    values = std::move(result);
+}
+
+void RemapVertices(Mesh &mesh, const Array<int32> &remap, int32 newCount)
+{
+    for (auto &e : mesh.indices)
+        e = remap[e];
+    for (auto &lod : mesh.lods)
+    {
+        for (auto &e : lod.indices)
+            e = remap[e];
+    }
+
+    RemapArray(mesh.positions, remap, newCount);
+    RemapArray(mesh.normals, remap, newCount);
+    RemapArray(mesh.bitangents, remap, newCount);
+    RemapArray(mesh.uvs, remap, newCount);
+    RemapArray(mesh.boneIDs, remap, newCount);
+    RemapArray(mesh.boneWeights, remap, newCount);
+}
+
+template <typename T>
+bool EqualAt(const Array<T> &values, int32 a, int32 b)
+{
+    return values.IsEmpty() || std::memcmp(&values[a], &values[b], sizeof(T)) == 0;
+}
+
+template <typename T>
+void HashAt(const Array<T> &values, int32 index, uint64 &hash)
+{
+    if (values.IsEmpty())
+        return;
+
+    Hash::HashBytesCombine(hash, values[index]);
+}
+}
+
+void MeshOptimizer::Optimize(Mesh &mesh, MeshOptimizeStats *before, MeshOptimizeStats *after)
+{
+    CT_CHECK(mesh.topology == Topology::TriangleList);
+
+    if (before)
+        *before = AnalyzeVertexCache(mesh.indices, mesh.positions.Count());
+
+    DeduplicateVertices(mesh);
+    OptimizeVertexCache(mesh.indices, mesh.positions.Count());
+    OptimizeOverdraw(mesh.indices, mesh.positions);
+    OptimizeVertexFetch(mesh);
+
+    if (after)
+        *after = AnalyzeVertexCache(mesh.indices, mesh.positions.Count());
+}
+
+int32 MeshOptimizer::DeduplicateVertices(Mesh &mesh)
+{
+    int32 vertexCount = mesh.positions.Count();
+    auto Equal = [&](int32 a, int32 b) {
+        return EqualAt(mesh.positions, a, b) && EqualAt(mesh.normals, a, b) && EqualAt(mesh.bitangents, a, b) && EqualAt(mesh.uvs, a, b) &&
+               EqualAt(mesh.boneIDs, a, b) && EqualAt(mesh.boneWeights, a, b);
+    };
+
+    // Open addressing over vertex indices, the table is kept at most half full.
+    int32 tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+    Array<int32> table;
+    table.SetCount(tableSize);
+    for (auto &e : table)
+        e = -1;
+
+    Array<int32> remap;
+    remap.SetCount(vertexCount);
+    int32 uniqueCount = 0;
+    for (int32 i = 0; i < vertexCount; ++i)
+    {
+        uint64 hash = Hash::BYTES_HASH_SEED;
+        HashAt(mesh.positions, i, hash);
+        HashAt(mesh.normals, i, hash);
+        HashAt(mesh.bitangents, i, hash);
+        HashAt(mesh.uvs, i, hash);
+        HashAt(mesh.boneIDs, i, hash);
+        HashAt(mesh.boneWeights, i, hash);
+
+        int32 slot = (int32)(hash & (tableSize - 1));
+        while (table[slot] != -1 && !Equal(table[slot], i))
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == -1)
+        {
+            table[slot] = i;
+            remap[i] = uniqueCount++;
+        }
+        else
+        {
+            remap[i] = remap[table[slot]];
+        }
+    }
+
+    if (uniqueCount != vertexCount)
+        RemapVertices(mesh, remap, uniqueCount);
+    return uniqueCount;
+}
+
+void MeshOptimizer::OptimizeVertexCache(Array<uint32> &indices, int32 vertexCount)
+{
+    static const ForsythScores scores;
+
+    int32 triangleCount = indices.Count() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex, the live ones are kept at the front of each range.
+    Array<int32> offsets, remaining, adjacency;
+    offsets.SetCount(vertexCount + 1);
+    remaining.SetCount(vertexCount);
+    for (auto &e : remaining)
+        e = 0;
+    for (auto e : indices)
+        remaining[e]++;
+    offsets[0] = 0;
+    for (int32 v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    adjacency.SetCount(indices.Count());
+    Array<int32> fill;
+    fill.SetCount(vertexCount);
+    for (int32 v = 0; v < vertexCount; ++v)
+        fill[v] = offsets[v];
+    for (int32 i = 0; i < indices.Count(); ++i)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    Array<float> vertexScores, triangleScores;
+    Array<bool> emitted;
+    vertexScores.SetCount(vertexCount);
+    triangleScores.SetCount(triangleCount);
+    emitted.SetCount(triangleCount);
+    for (int32 v = 0; v < vertexCount; ++v)
+        vertexScores[v] = scores.Get(-1, remaining[v]);
+    int32 best = 0;
+    for (int32 t = 0; t < triangleCount; ++t)
+    {
+        emitted[t] = false;
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[best])
+            best = t;
+    }
+
+    Array<uint32> result;
+    result.Reserve(indices.Count());
+    int32 cache[FORSYTH_CACHE_SIZE + 3];
+    int32 newCache[FORSYTH_CACHE_SIZE + 3];
+    int32 cacheCount = 0;
+    int32 scanPosition = 0;
+
+    while (best >= 0)
+    {
+        const uint32 *triangle = &indices[best * 3];
+        emitted[best] = true;
+        int32 newCacheCount = 0;
+        for (int32 i = 0; i < 3; ++i)
+        {
+            int32 v = triangle[i];
+            result.Add(v);
+            newCache[newCacheCount++] = v;
+
+            // Take the triangle out of the live range of its vertex.
+            int32 begin = offsets[v], last = begin + --remaining[v];
+            for (int32 j = begin; j <= last; ++j)
+            {
+                if (adjacency[j] == best)
+                {
+                    std::swap(adjacency[j], adjacency[last]);
+                    break;
+                }
+            }
+        }
+
+        for (int32 i = 0; i < cacheCount; ++i)
+        {
+            int32 v = cache[i];
+            if (v != (int32)triangle[0] && v != (int32)triangle[1] && v != (int32)triangle[2])
+                newCache[newCacheCount++] = v;
+        }
+
+        // Rescore the vertices that were or are cached, and find the best triangle among theirs.
+        best = -1;
+        float bestScore = -1.0f;
+        for (int32 i = 0; i < newCacheCount; ++i)
+        {
+            int32 v = newCache[i];
+            float score = scores.Get(i < FORSYTH_CACHE_SIZE ? i : -1, remaining[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (int32 j = offsets[v]; j < offsets[v] + remaining[v]; ++j)
+            {
+                int32 t = adjacency[j];
+                triangleScores[t] += delta;
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = Math::Min(newCacheCount, FORSYTH_CACHE_SIZE);
+        for (int32 i = 0; i < cacheCount; ++i)
+            cache[i] = newCache[i];
+
+        // Dead end, continue with the next triangle in input order.
+        if (best < 0)
+        {
+            while (scanPosition < triangleCount && emitted[scanPosition])
+                scanPosition++;
+            best = scanPosition < triangleCount ? scanPosition : -1;
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(Array<uint32> &indices, const Array<Vector3> &positions, float threshold)
+{
+    int32 triangleCount = indices.Count() / 3;
+    if (triangleCount == 0)
+        return;
+
+    float acmr = AnalyzeVertexCache(indices, positions.Count()).acmr;
+
+    // Hard boundaries are where the cache flushes anyway, soft ones where the cluster so far is efficient enough to restart the cache.
+    Array<int32> clusters;
+    FifoCache fifo(positions.Count());
+    int32 clusterStart = 0, clusterMisses = 0;
+    for (int32 t = 0; t < triangleCount; ++t)
+    {
+        int32 misses = fifo.Triangle(&indices[t * 3]);
+        if (t == 0 || (misses == 3 && t > clusterStart))
+        {
+            clusters.Add(t);
+            clusterStart = t;
+            clusterMisses = 0;
+        }
+        clusterMisses += misses;
+
+        if ((float)clusterMisses / (t - clusterStart + 1) <= threshold * acmr && t + 1 < triangleCount)
+        {
+            clusters.Add(t + 1);
+            clusterStart = t + 1;
+            clusterMisses = 0;
+            fifo.Reset();
+        }
+    }
+    clusters.Add(triangleCount);
+
+    // Clusters further out along their own normal are more likely to occlude the rest of the mesh.
+    Vector3 meshCentroid;
+    float meshArea = 0.0f;
+    int32 clusterCount = clusters.Count() - 1;
+    Array<Vector3> centroids, normals;
+    centroids.SetCount(clusterCount);
+    normals.SetCount(clusterCount);
+    for (int32 c = 0; c < clusterCount; ++c)
+    {
+        Vector3 centroid, normal;
+        float area = 0.0f;
+        for (int32 t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const auto &p0 = positions[indices[t * 3]];
+            const auto &p1 = positions[indices[t * 3 + 1]];
+            const auto &p2 = positions[indices[t * 3 + 2]];
+            Vector3 n = (p1 - p0).Cross(p2 - p0);
+            float a = n.Length();
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : positions[indices[clusters[c] * 3]];
+        normals[c] = normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    Array<float> sortKeys;
+    Array<int32> order;
+    sortKeys.SetCount(clusterCount);
+    order.SetCount(clusterCount);
+    for (int32 c = 0; c < clusterCount; ++c)
+    {
+        float length = normals[c].Length();
+        sortKeys[c] = length > 0.0f ? (centroids[c] - meshCentroid).Dot(normals[c]) / length : 0.0f;
+        order[c] = c;
+    }
+    order.Sort([&](int32 a, int32 b) { return sortKeys[a] > sortKeys[b] || (sortKeys[a] == sortKeys[b] && a < b); });
+
+    Array<uint32> result;
+    result.Reserve(indices.Count());
+    for (int32 c : order)
+    {
+        for (int32 i = clusters[c] * 3; i < clusters[c + 1] * 3; ++i)
+            result.Add(indices[i]);
+    }
+    indices = std::move(result);
+}
+
+int32 MeshOptimizer::OptimizeVertexFetch(Mesh &mesh)
+{
+    Array<int32> remap;
+    remap.SetCount(mesh.positions.Count());
+    for (auto &e : remap)
+        e = -1;
+
+    int32 vertexCount = 0;
+    for (auto e : mesh.indices)
+    {
+        if (remap[e] == -1)
+            remap[e] = vertexCount++;
+    }
+
+    RemapVertices(mesh, remap, vertexCount);
+    return vertexCount;
+}
+
+MeshOptimizeStats MeshOptimizer::AnalyzeVertexCache(const Array<uint32> &indices, int32 vertexCount)
+{
+    MeshOptimizeStats stats;
+    stats.vertexCount = vertexCount;
+
+    int32 triangleCount = indices.Count() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return stats;
+
+    FifoCache fifo(vertexCount);
+    int32 misses = 0;
+    for (int32 t = 0; t < triangleCount; ++t)
+        misses += fifo.Triangle(&indices[t * 3]);
+
+    stats.acmr = (float)misses / triangleCount;
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+float MeshOptimizer::Simplify(const Array<uint32> &indices, const Array<Vector3> &positions, int32 targetIndexCount, float targetError, Array<uint32> &result)
+{
+    int32 vertexCount = positions.Count();
+    result = indices;
+
+    // Vertices sharing a position with another one sit on an attribute seam, they and the ones on open borders stay.
+    Array<int32> canonical;
+    canonical.SetCount(vertexCount);
+    {
+        int32 tableSize = 1;
+        while (tableSize < vertexCount * 2)
+            tableSize *= 2;
+        Array<int32> table;
+        table.SetCount(tableSize);
+        for (auto &e : table)
+            e = -1;
+
+        for (int32 i = 0; i < vertexCount; ++i)
+        {
+            uint64 hash = Hash::BYTES_HASH_SEED;
+            HashAt(positions, i, hash);
+            int32 slot = (int32)(hash & (tableSize - 1));
+            while (table[slot] != -1 && !EqualAt(positions, table[slot], i))
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == -1)
+                table[slot] = i;
+            canonical[i] = table[slot];
+        }
+    }
+
+    Array<bool> locked;
+    locked.SetCount(vertexCount);
+    for (int32 i = 0; i < vertexCount; ++i)
+        locked[i] = canonical[i] != i;
+    for (int32 i = 0; i < vertexCount; ++i)
+    {
+        if (canonical[i] != i)
+            locked[canonical[i]] = true;
+    }
+
+    // Edges used by a single triangle are borders, counted by sorting the undirected edges.
+    {
+        Array<uint64> edges;
+        edges.Reserve(indices.Count());
+        for (int32 t = 0; t < indices.Count() / 3; ++t)
+        {
+            for (int32 i = 0; i < 3; ++i)
+            {
+                uint64 a = canonical[indices[t * 3 + i]], b = canonical[indices[t * 3 + (i + 1) % 3]];
+                edges.Add(a < b ? (a << 32 | b) : (b << 32 | a));
+            }
+        }
+        edges.Sort();
+        for (int32 i = 0; i < edges.Count();)
+        {
+            int32 j = i + 1;
+            while (j < edges.Count() && edges[j] == edges[i])
+                ++j;
+            if (j - i == 1)
+            {
+                locked[(int32)(edges[i] >> 32)] = true;
+                locked[(int32)(edges[i] & 0xFFFFFFFF)] = true;
+            }
+            i = j;
+        }
+    }
+
+    Array<Quadric> quadrics;
+    quadrics.SetCount(vertexCount);
+    for (int32 t = 0; t < indices.Count() / 3; ++t)
+    {
+        const uint32 *triangle = &indices[t * 3];
+        const auto &p0 = positions[triangle[0]];
+        Vector3 normal = (positions[triangle[1]] - p0).Cross(positions[triangle[2]] - p0);
+        float area = normal.Length();
+        if (area == 0.0f)
+            continue;
+        normal /= area;
+        for (int32 i = 0; i < 3; ++i)
+            quadrics[triangle[i]].AddPlane(normal, -normal.Dot(p0), area);
+    }
+
+    Array<int32> offsets, adjacency, remap;
+    Array<bool> touched;
+    Array<Collapse> collapses;
+    Array<uint32> next;
+    offsets.SetCount(vertexCount + 1);
+    remap.SetCount(vertexCount);
+    touched.SetCount(vertexCount);
+    float resultError = 0.0f;
+
+    while (result.Count() > targetIndexCount)
+    {
+        int32 triangleCount = result.Count() / 3;
+
+        // Triangles of each vertex.
+        for (auto &e : offsets)
+            e = 0;
+        for (auto e : result)
+            offsets[e + 1]++;
+        for (int32 v = 0; v < vertexCount; ++v)
+            offsets[v + 1] += offsets[v];
+        adjacency.SetCount(result.Count());
+        for (int32 i = 0; i < result.Count(); ++i)
+            adjacency[offsets[result[i]]++] = i / 3;
+        for (int32 v = vertexCount; v > 0; --v)
+            offsets[v] = offsets[v - 1];
+        offsets[0] = 0;
+
+        // The cheapest collapse of every vertex that may go.
+        collapses.Clear();
+        for (int32 v = 0; v < vertexCount; ++v)
+        {
+            if (locked[v] || offsets[v] == offsets[v + 1])
+                continue;
+
+            Collapse best = { v, -1, FLT_MAX };
+            for (int32 j = offsets[v]; j < offsets[v + 1]; ++j)
+            {
+                const uint32 *triangle = &result[adjacency[j] * 3];
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    int32 to = triangle[i];
+                    if (to == v)
+                        continue;
+                    float error = quadrics[v].Error(positions[to]);
+                    if (error < best.error)
+                        best = { v, to, error };
+                }
+            }
+            if (best.to >= 0 && best.error <= targetError)
+                collapses.Add(best);
+        }
+        collapses.Sort([](const Collapse &a, const Collapse &b) { return a.error < b.error || (a.error == b.error && a.from < b.from); });
+
+        for (int32 v = 0; v < vertexCount; ++v)
+        {
+            remap[v] = v;
+            touched[v] = false;
+        }
+
+        int32 removed = 0, collapseCount = 0;
+        int32 removeGoal = triangleCount - targetIndexCount / 3;
+        for (const auto &c : collapses)
+        {
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            // Reject collapses that turn a remaining triangle around.
+            bool flips = false;
+            int32 shared = 0;
+            for (int32 j = offsets[c.from]; j < offsets[c.from + 1] && !flips; ++j)
+            {
+                const uint32 *triangle = &result[adjacency[j] * 3];
+                if (triangle[0] == (uint32)c.to || triangle[1] == (uint32)c.to || triangle[2] == (uint32)c.to)
+                {
+                    shared++;
+                    continue;
+                }
+
+                Vector3 p[3], q[3];
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    p[i] = positions[triangle[i]];
+                    q[i] = triangle[i] == (uint32)c.from ? positions[c.to] : p[i];
+                }
+                Vector3 before = (p[1] - p[0]).Cross(p[2] - p[0]);
+                Vector3 after = (q[1] - q[0]).Cross(q[2] - q[0]);
+                flips = before.Dot(after) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            // Positions never move, but the one ring of a collapsed vertex changes shape, so it waits for the next pass.
+            for (int32 j = offsets[c.from]; j < offsets[c.from + 1]; ++j)
+            {
+                const uint32 *triangle = &result[adjacency[j] * 3];
+                for (int32 i = 0; i < 3; ++i)
+                    touched[triangle[i]] = true;
+            }
+
+            remap[c.from] = c.to;
+            quadrics[c.to].Add(quadrics[c.from]);
+            resultError = Math::Max(resultError, c.error);
+            removed += shared;
+            collapseCount++;
+            if (removed >= removeGoal)
+                break;
+        }
+
+        if (collapseCount == 0)
+            break;
+
+        next.Clear();
+        next.Reserve(result.Count());
+        for (int32 t = 0; t < triangleCount; ++t)
+        {
+            uint32 a = remap[result[t * 3]], b = remap[result[t * 3 + 1]], c = remap[result[t * 3 + 2]];
+            if (a != b && b != c && a != c)
+            {
+                next.Add(a);
+                next.Add(b);
+                next.Add(c);
+            }
+        }
+        std::swap(result, next);
+    }
+
+    return resultError;
+}
+
+void MeshOptimizer::GenerateLods(Mesh &mesh, int32 count, float maxError)
+{
+    if (mesh.positions.IsEmpty())
+        return;
+
+    Vector3 min = mesh.positions[0], max = min;
+    for (const auto &p : mesh.positions)
+    {
+        min = Vector3::Min(min, p);
+        max = Vector3::Max(max, p);
+    }
+    Vector3 size = max - min;
+    float targetError = maxError * Math::Max(size.x, size.y, size.z);
+
+    // Each level starts from the one before, so their errors add up.
+    float error = 0.0f;
+    for (int32 level = 0; level < count; ++level)
+    {
+        const auto &source = mesh.lods.IsEmpty() ? mesh.indices : mesh.lods.Last().indices;
+        MeshLod lod;
+        float levelError = Simplify(source, mesh.positions, source.Count() / 6 * 3, targetError - error, lod.indices);
+
+        // Stop once the simplification stalls, another level would cost memory without saving triangles.
+        if (lod.indices.IsEmpty() || lod.indices.Count() * 5 > source.Count() * 4)
+            break;
+
+        OptimizeVertexCache(lod.indices, mesh.positions.Count());
+        error += levelError;
+        lod.error = error;
+        mesh.lods.Add(std::move(lod));
+    }
+}
+
+void MeshOptimizer::BuildMeshlets(Mesh &mesh, int32 maxVertices, int32 maxTriangles)
+{
+    const auto &indices = mesh.indices;
+    const auto &positions = mesh.positions;
+    int32 vertexCount = positions.Count();
+    int32 triangleCount = indices.Count() / 3;
+    mesh.meshlets.Clear();
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex.
+    Array<int32> offsets, adjacency;
+    offsets.SetCount(vertexCount + 1);
+    for (auto &e : offsets)
+        e = 0;
+    for (auto e : indices)
+        offsets[e + 1]++;
+    for (int32 v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+    adjacency.SetCount(indices.Count());
+    for (int32 i = 0; i < indices.Count(); ++i)
+        adjacency[offsets[indices[i]]++] = i / 3;
+    for (int32 v = vertexCount; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    Array<bool> emitted;
+    emitted.SetCount(triangleCount);
+    for (auto &e : emitted)
+        e = false;
+    // Meshlet each vertex was last added to, to count the vertices a triangle brings in.
+    Array<int32> vertexMeshlet, localIndex;
+    vertexMeshlet.SetCount(vertexCount);
+    localIndex.SetCount(vertexCount);
+    for (auto &e : vertexMeshlet)
+        e = -1;
+
+    Array<uint32> result, meshletIndices;
+    result.Reserve(indices.Count());
+    Array<int32> vertices, triangles;
+    Array<Vector3> normals;
+    int32 seed = 0;
+    while (true)
+    {
+        while (seed < triangleCount && emitted[seed])
+            ++seed;
+        if (seed == triangleCount)
+            break;
+
+        int32 meshletID = mesh.meshlets.Count();
+        vertices.Clear();
+        triangles.Clear();
+        Vector3 centroidSum;
+
+        int32 triangle = seed;
+        while (triangle >= 0)
+        {
+            emitted[triangle] = true;
+            triangles.Add(triangle);
+            for (int32 i = 0; i < 3; ++i)
+            {
+                uint32 v = indices[triangle * 3 + i];
+                if (vertexMeshlet[v] != meshletID)
+                {
+                    vertexMeshlet[v] = meshletID;
+                    localIndex[v] = vertices.Count();
+                    vertices.Add(v);
+                    centroidSum += positions[v];
+                }
+            }
+            if (triangles.Count() == maxTriangles)
+                break;
+
+            // Next the neighbour adding the fewest vertices, the one nearest to the meshlet on a tie, so meshlets stay round.
+            Vector3 centroid = centroidSum / (float)vertices.Count();
+            int32 bestNew = 3;
+            float bestDistance = FLT_MAX;
+            triangle = -1;
+            for (auto v : vertices)
+            {
+                for (int32 j = offsets[v]; j < offsets[v + 1]; ++j)
+                {
+                    int32 t = adjacency[j];
+                    if (emitted[t])
+                        continue;
+
+                    const uint32 *corners = &indices[t * 3];
+                    int32 newCount = (vertexMeshlet[corners[0]] != meshletID) + (vertexMeshlet[corners[1]] != meshletID) + (vertexMeshlet[corners[2]] != meshletID);
+                    if (vertices.Count() + newCount > maxVertices || newCount > bestNew)
+                        continue;
+
+                    Vector3 center = (positions[corners[0]] + positions[corners[1]] + positions[corners[2]]) / 3.0f;
+                    float distance = center.Distance2(centroid);
+                    if (newCount < bestNew || distance < bestDistance)
+                    {
+                        bestNew = newCount;
+                        bestDistance = distance;
+                        triangle = t;
+                    }
+                }
+            }
+        }
+
+        // Growing order is not the best cache order, reorder the triangles within the meshlet on its local vertices.
+        meshletIndices.Clear();
+        for (auto t : triangles)
+        {
+            for (int32 i = 0; i < 3; ++i)
+                meshletIndices.Add(localIndex[indices[t * 3 + i]]);
+        }
+        OptimizeVertexCache(meshletIndices, vertices.Count());
+        for (auto &e : meshletIndices)
+            e = vertices[e];
+
+        Meshlet meshlet;
+        meshlet.indexOffset = result.Count();
+        meshlet.indexCount = meshletIndices.Count();
+        for (auto e : meshletIndices)
+            result.Add(e);
+
+        Vector3 min = positions[vertices[0]], max = min;
+        for (auto v : vertices)
+        {
+            min = Vector3::Min(min, positions[v]);
+            max = Vector3::Max(max, positions[v]);
+        }
+        meshlet.center = (min + max) * 0.5f;
+        for (auto v : vertices)
+            meshlet.radius = Math::Max(meshlet.radius, (positions[v] - meshlet.center).Length());
+
+        // Axis from the average normal, the cone only helps when all normals lean the same way.
+        normals.Clear();
+        Vector3 normalSum;
+        for (auto t : triangles)
+        {
+            const auto &p0 = positions[indices[t * 3]];
+            Vector3 normal = (positions[indices[t * 3 + 1]] - p0).Cross(positions[indices[t * 3 + 2]] - p0);
+            float length = normal.Length();
+            if (length == 0.0f)
+                continue;
+            normals.Add(normal / length);
+            normalSum += normals.Last();
+        }
+        float axisLength = normalSum.Length();
+        if (axisLength > 0.0f)
+        {
+            meshlet.coneAxis = normalSum / axisLength;
+            float minDot = 1.0f;
+            for (const auto &n : normals)
+                minDot = Math::Min(minDot, n.Dot(meshlet.coneAxis));
+            if (minDot > 0.1f)
+                meshlet.coneCutoff = Math::Sqrt(1.0f - minDot * minDot);
+        }
+
+        mesh.meshlets.Add(meshlet);
+    }
+
+    mesh.indices = std::move(result);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Render/.Package.h"
+
+struct MeshOptimizeStats
+{
+    int32 vertexCount = 0;
+    // Average cache miss per triangle, and transformed vertices per vertex, with a FIFO cache of MeshOptimizer::FIFO_CACHE_SIZE.
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// Reorders triangle lists for the post transform vertex cache, overdraw and vertex fetch. All of them keep the rendered result.
+class MeshOptimizer
+{
+public:
+    static constexpr int32 FIFO_CACHE_SIZE = 16;
+    static constexpr int32 MESHLET_MAX_VERTICES = 64;
+    static constexpr int32 MESHLET_MAX_TRIANGLES = 124;
+
+    // Runs every step below in order, before and after receive the statistics of the input and the output.
+    static void Optimize(Mesh &mesh, MeshOptimizeStats *before = nullptr, MeshOptimizeStats *after = nullptr);
+
+    // Merges vertices equal in every attribute, returns the new vertex count.
+    static int32 DeduplicateVertices(Mesh &mesh);
+    // Forsyth's linear speed vertex cache optimization.
+    static void OptimizeVertexCache(Array<uint32> &indices, int32 vertexCount);
+    // Splits the triangles into clusters where the cache allows it and draws the ones facing outwards first.
+    // threshold bounds how much the cache efficiency may get worse, 1.05 allows 5%.
+    static void OptimizeOverdraw(Array<uint32> &indices, const Array<Vector3> &positions, float threshold = 1.05f);
+    // Orders vertices by first use and drops the ones no triangle refers to, returns the new vertex count.
+    static int32 OptimizeVertexFetch(Mesh &mesh);
+
+    // Collapses edges by quadric error until there are at most targetIndexCount indices or the next collapse would move the surface
+    // by more than targetError. Vertices are only removed, never moved, so the result indexes the same vertices. Returns the error reached.
+    static float Simplify(const Array<uint32> &indices, const Array<Vector3> &positions, int32 targetIndexCount, float targetError, Array<uint32> &result);
+    // Appends up to count levels to mesh.lods, each with about half the triangles of the one before.
+    // maxError bounds the error of the coarsest level, relative to the largest extent of the mesh.
+    static void GenerateLods(Mesh &mesh, int32 count, float maxError = 0.05f);
+
+    // Groups connected triangles into meshlets of at most maxVertices and maxTriangles, and reorders mesh.indices so each one is a range.
+    static void BuildMeshlets(Mesh &mesh, int32 maxVertices = MESHLET_MAX_VERTICES, int32 maxTriangles = MESHLET_MAX_TRIANGLES);
+
+    static MeshOptimizeStats AnalyzeVertexCache(const Array<uint32> &indices, int32 vertexCount);
+};
@@ -1,4 +1,560 @@
 #include "Render/Pixmap.h"
+#include "Core/Thread.h"
+#include "Math/Packing.h"
+#include "Math/Simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#if defined(__F16C__) && CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// Destination texels per job when a resize is spread over several threads.
+constexpr int32 RESIZE_CHUNK_TEXELS = 64 * 1024;
+// Buckets of the linear to srgb table, fine enough that a code is at most one step off before the correction.
+constexpr int32 SRGB_BUCKETS = 4096;
+// Kaiser window of NVTT's mip filter, the width is in destination texels.
+constexpr float KAISER_WIDTH = 3.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+
+static_assert(sizeof(Color) == sizeof(float) * 4, "Colors are converted as 4 packed floats.");
+
+float SrgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : Math::Pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+struct SrgbTables
+{
+    float toLinear[256];
+    // Linear value where each code starts, a code rounds exactly like the sRGB curve does.
+    float thresholds[256];
+    // First code of each bucket, the thresholds then move it up to the exact one.
+    uint8 buckets[SRGB_BUCKETS];
+
+    SrgbTables()
+    {
+        for (int32 i = 0; i < 256; ++i)
+            toLinear[i] = SrgbToLinear(i / 255.0f);
+        for (int32 i = 0; i < 255; ++i)
+            thresholds[i] = SrgbToLinear((i + 0.5f) / 255.0f);
+        // Never passed, so the correction needs no bounds check.
+        thresholds[255] = 2.0f;
+        for (int32 i = 0; i < SRGB_BUCKETS; ++i)
+            buckets[i] = static_cast<uint8>(std::upper_bound(thresholds, thresholds + 255, static_cast<float>(i) / SRGB_BUCKETS) - thresholds);
+    }
+
+    uint8 Encode(float value) const
+    {
+        // Also sends NaN to 0.
+        value = value > 0.0f ? Math::Min(value, 1.0f) : 0.0f;
+        int32 code = buckets[Math::Min(static_cast<int32>(value * SRGB_BUCKETS), SRGB_BUCKETS - 1)];
+        while (value >= thresholds[code])
+            ++code;
+        return static_cast<uint8>(code);
+    }
+};
+
+const SrgbTables &GetSrgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+// Channels of the formats without a fast path, read in memory order.
+struct PixelLayout
+{
+    int32 channels = 0;
+    int32 bits = 0;
+    bool isFloat = false;
+};
+
+bool GetPixelLayout(ResourceFormat format, PixelLayout &layout)
+{
+    const auto &desc = GetResourceFormatDesc(format);
+    if (desc.isCompressed || desc.isDepth || desc.isStencil)
+        return false;
+    if (desc.componentCount != 1 && desc.componentCount != 2 && desc.componentCount != 4)
+        return false;
+
+    layout.channels = static_cast<int32>(desc.componentCount);
+    layout.bits = static_cast<int32>(desc.componentBits[0]);
+    for (int32 i = 1; i < layout.channels; ++i)
+    {
+        if (desc.componentBits[i] != desc.componentBits[0])
+            return false;
+    }
+
+    switch (desc.componentType)
+    {
+    case ResourceComponentType::Unorm:
+        if (layout.bits != 8 && layout.bits != 16)
+            return false;
+        break;
+    case ResourceComponentType::Float:
+        if (layout.bits != 16 && layout.bits != 32)
+            return false;
+        layout.isFloat = true;
+        break;
+    case ResourceComponentType::UnormSrgb:
+        // Only RGBA8, it has a fast path.
+        return format == ResourceFormat::RGBA8UnormSrgb;
+    default:
+        return false;
+    }
+
+    // Memory order would swap their red and blue.
+    if (format == ResourceFormat::BGRA8Unorm || format == ResourceFormat::BGRX8Unorm)
+        return false;
+    return static_cast<int32>(desc.bytes) == layout.channels * layout.bits / 8;
+}
+
+// Result is (rgb[0], rgb[1], rgb[2], alpha[3]).
+CT_INLINE Simd::Float4 WithAlpha(Simd::Float4 rgb, Simd::Float4 alpha)
+{
+    Simd::Float4 zw = Simd::Shuffle<2, 2, 3, 3>(rgb, alpha);
+    return Simd::Shuffle<0, 1, 0, 2>(rgb, zw);
+}
+
+#if CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+
+void DecodeRGBA8(const uint8 *src, int32 count, float *dst)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    int32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_ps(dst + i * 4 + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(texels)), scale));
+        _mm_storeu_ps(dst + i * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 4))), scale));
+        _mm_storeu_ps(dst + i * 4 + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 8))), scale));
+        _mm_storeu_ps(dst + i * 4 + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(texels, 12))), scale));
+    }
+    for (; i < count; ++i)
+    {
+        int32 texel;
+        std::memcpy(&texel, src + i * 4, sizeof(texel));
+        _mm_storeu_ps(dst + i * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel))), scale));
+    }
+}
+
+// Clamped to [0, 1] and rounded half up like Math::RoundToInt, NaN becomes 0.
+CT_INLINE __m128i ToUnorm8(const float *src)
+{
+    __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+void EncodeRGBA8(const float *src, int32 count, uint8 *dst)
+{
+    int32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i lo = _mm_packus_epi32(ToUnorm8(src + i * 4 + 0), ToUnorm8(src + i * 4 + 4));
+        __m128i hi = _mm_packus_epi32(ToUnorm8(src + i * 4 + 8), ToUnorm8(src + i * 4 + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < count; ++i)
+    {
+        __m128i texel = ToUnorm8(src + i * 4);
+        texel = _mm_packus_epi16(_mm_packus_epi32(texel, texel), texel);
+        int32 packed = _mm_cvtsi128_si32(texel);
+        std::memcpy(dst + i * 4, &packed, sizeof(packed));
+    }
+}
+
+#else
+
+void DecodeRGBA8(const uint8 *src, int32 count, float *dst)
+{
+    for (int32 i = 0; i < count * 4; ++i)
+        dst[i] = static_cast<float>(src[i]) * (1.0f / 255.0f);
+}
+
+void EncodeRGBA8(const float *src, int32 count, uint8 *dst)
+{
+    for (int32 i = 0; i < count * 4; ++i)
+    {
+        float value = src[i] > 0.0f ? Math::Min(src[i], 1.0f) : 0.0f;
+        dst[i] = static_cast<uint8>(static_cast<int32>(value * 255.0f + 0.5f));
+    }
+}
+
+#endif
+
+#if defined(__F16C__) && CT_MATH_SIMD >= CT_MATH_SIMD_SSE4
+
+void DecodeRGBA16F(const uint8 *src, int32 count, float *dst)
+{
+    for (int32 i = 0; i < count; ++i)
+        _mm_storeu_ps(dst + i * 4, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * 8))));
+}
+
+void EncodeRGBA16F(const float *src, int32 count, uint8 *dst)
+{
+    for (int32 i = 0; i < count; ++i)
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i * 8), _mm_cvtps_ph(_mm_loadu_ps(src + i * 4), _MM_FROUND_TO_NEAREST_INT));
+}
+
+#else
+
+void DecodeRGBA16F(const uint8 *src, int32 count, float *dst)
+{
+    for (int32 i = 0; i < count * 4; ++i)
+    {
+        uint16 half;
+        std::memcpy(&half, src + i * 2, sizeof(half));
+        dst[i] = Packing::HalfToFloat(half);
+    }
+}
+
+void EncodeRGBA16F(const float *src, int32 count, uint8 *dst)
+{
+    for (int32 i = 0; i < count * 4; ++i)
+    {
+        uint16 half = Packing::FloatToHalf(src[i]);
+        std::memcpy(dst + i * 2, &half, sizeof(half));
+    }
+}
+
+#endif
+
+void DecodeRGBA8Srgb(const uint8 *src, int32 count, float *dst)
+{
+    const auto &tables = GetSrgbTables();
+    for (int32 i = 0; i < count; ++i)
+    {
+        const uint8 *texel = src + i * 4;
+        Simd::Store(dst + i * 4, Simd::Set(tables.toLinear[texel[0]], tables.toLinear[texel[1]], tables.toLinear[texel[2]], texel[3] * (1.0f / 255.0f)));
+    }
+}
+
+void EncodeRGBA8Srgb(const float *src, int32 count, uint8 *dst)
+{
+    // Alpha takes the unorm path, color is then replaced by the table lookups.
+    EncodeRGBA8(src, count, dst);
+    const auto &tables = GetSrgbTables();
+    for (int32 i = 0; i < count; ++i)
+    {
+        dst[i * 4 + 0] = tables.Encode(src[i * 4 + 0]);
+        dst[i * 4 + 1] = tables.Encode(src[i * 4 + 1]);
+        dst[i * 4 + 2] = tables.Encode(src[i * 4 + 2]);
+    }
+}
+
+// Pixmaps only hold formats IsSupportedFormat accepts.
+PixelLayout GetSupportedLayout(ResourceFormat format)
+{
+    PixelLayout layout;
+    [[maybe_unused]] bool supported = GetPixelLayout(format, layout);
+    CT_CHECK(supported);
+    return layout;
+}
+
+// Missing channels read as (0, 0, 0, 1) and are dropped when written.
+void DecodeTexels(const PixelLayout &layout, const uint8 *src, int32 count, float *dst)
+{
+    int32 channels = layout.channels;
+    for (int32 i = 0; i < count; ++i)
+        Simd::Store(dst + i * 4, Simd::Set(0.0f, 0.0f, 0.0f, 1.0f));
+    for (int32 i = 0; i < count; ++i)
+    {
+        const uint8 *texel = src + static_cast<SizeType>(i) * channels * layout.bits / 8;
+        for (int32 c = 0; c < channels; ++c)
+        {
+            if (layout.bits == 32)
+            {
+                std::memcpy(dst + i * 4 + c, texel + c * sizeof(float), sizeof(float));
+            }
+            else if (layout.bits == 16)
+            {
+                uint16 value;
+                std::memcpy(&value, texel + c * sizeof(uint16), sizeof(uint16));
+                dst[i * 4 + c] = layout.isFloat ? Packing::HalfToFloat(value) : value * (1.0f / 65535.0f);
+            }
+            else
+            {
+                dst[i * 4 + c] = texel[c] * (1.0f / 255.0f);
+            }
+        }
+    }
+}
+
+void EncodeTexels(const PixelLayout &layout, const float *src, int32 count, uint8 *dst)
+{
+    int32 channels = layout.channels;
+    auto ToUnorm = [](float value, float max) { return static_cast<int32>((value > 0.0f ? Math::Min(value, 1.0f) : 0.0f) * max + 0.5f); };
+    for (int32 i = 0; i < count; ++i)
+    {
+        uint8 *texel = dst + static_cast<SizeType>(i) * channels * layout.bits / 8;
+        for (int32 c = 0; c < channels; ++c)
+        {
+            float value = src[i * 4 + c];
+            if (layout.bits == 32)
+            {
+                std::memcpy(texel + c * sizeof(float), &value, sizeof(float));
+            }
+            else if (layout.bits == 16)
+            {
+                uint16 packed = layout.isFloat ? Packing::FloatToHalf(value) : static_cast<uint16>(ToUnorm(value, 65535.0f));
+                std::memcpy(texel + c * sizeof(uint16), &packed, sizeof(uint16));
+            }
+            else
+            {
+                texel[c] = static_cast<uint8>(ToUnorm(value, 255.0f));
+            }
+        }
+    }
+}
+
+void Decode(ResourceFormat format, const uint8 *src, int32 count, Color *dst)
+{
+    float *values = &dst->r;
+    switch (format)
+    {
+    case ResourceFormat::RGBA8Unorm:
+        DecodeRGBA8(src, count, values);
+        break;
+    case ResourceFormat::RGBA8UnormSrgb:
+        DecodeRGBA8Srgb(src, count, values);
+        break;
+    case ResourceFormat::RGBA16Float:
+        DecodeRGBA16F(src, count, values);
+        break;
+    case ResourceFormat::RGBA32Float:
+        std::memcpy(values, src, count * sizeof(Color));
+        break;
+    default:
+        DecodeTexels(GetSupportedLayout(format), src, count, values);
+        break;
+    }
+}
+
+void Encode(ResourceFormat format, const Color *src, int32 count, uint8 *dst)
+{
+    const float *values = &src->r;
+    switch (format)
+    {
+    case ResourceFormat::RGBA8Unorm:
+        EncodeRGBA8(values, count, dst);
+        break;
+    case ResourceFormat::RGBA8UnormSrgb:
+        EncodeRGBA8Srgb(values, count, dst);
+        break;
+    case ResourceFormat::RGBA16Float:
+        EncodeRGBA16F(values, count, dst);
+        break;
+    case ResourceFormat::RGBA32Float:
+        std::memcpy(dst, values, count * sizeof(Color));
+        break;
+    default:
+        EncodeTexels(GetSupportedLayout(format), values, count, dst);
+        break;
+    }
+}
+
+// Repeats the texel at dst over count texels, doubling the copied span each step.
+void FillTexels(uint8 *dst, const uint8 *texel, SizeType texelBytes, SizeType count)
+{
+    if (count == 0)
+        return;
+    std::memcpy(dst, texel, texelBytes);
+    SizeType total = texelBytes * count;
+    for (SizeType filled = texelBytes; filled < total; filled *= 2)
+        std::memcpy(dst + filled, dst, Math::Min(filled, total - filled));
+}
+
+// Source drawn over the destination, both straight alpha.
+void BlendRow(const Color *src, int32 count, Color *dst)
+{
+    const Simd::Float4 one = Simd::Splat(1.0f);
+    for (int32 i = 0; i < count; ++i)
+    {
+        float srcAlpha = src[i].a;
+        if (srcAlpha >= 1.0f)
+        {
+            dst[i] = src[i];
+            continue;
+        }
+        if (srcAlpha <= 0.0f)
+            continue;
+
+        Simd::Float4 s = Simd::Load(&src[i].r);
+        Simd::Float4 d = Simd::Load(&dst[i].r);
+        Simd::Float4 sa = Simd::Shuffle<3, 3, 3, 3>(s);
+        Simd::Float4 da = Simd::Mul(Simd::Shuffle<3, 3, 3, 3>(d), Simd::Sub(one, sa));
+        Simd::Float4 alpha = Simd::Add(sa, da);
+        Simd::Float4 color = Simd::Div(Simd::Add(Simd::Mul(s, sa), Simd::Mul(d, da)), alpha);
+        Simd::Store(&dst[i].r, WithAlpha(color, alpha));
+    }
+}
+
+void Premultiply(Color *colors, int32 count)
+{
+    for (int32 i = 0; i < count; ++i)
+    {
+        Simd::Float4 c = Simd::Load(&colors[i].r);
+        Simd::Float4 a = Simd::Shuffle<3, 3, 3, 3>(c);
+        Simd::Store(&colors[i].r, WithAlpha(Simd::Mul(c, a), a));
+    }
+}
+
+void Unpremultiply(Color *colors, int32 count)
+{
+    for (int32 i = 0; i < count; ++i)
+    {
+        float alpha = colors[i].a;
+        if (alpha <= 0.0f)
+        {
+            colors[i] = Color(0.0f, 0.0f, 0.0f, 0.0f);
+            continue;
+        }
+        Simd::Float4 c = Simd::Load(&colors[i].r);
+        Simd::Float4 a = Simd::Shuffle<3, 3, 3, 3>(c);
+        Simd::Store(&colors[i].r, WithAlpha(Simd::Div(c, a), a));
+    }
+}
+
+float GetFilterRadius(PixmapFilter filter)
+{
+    switch (filter)
+    {
+    case PixmapFilter::Box:
+        return 0.5f;
+    case PixmapFilter::Triangle:
+        return 1.0f;
+    case PixmapFilter::Kaiser:
+        return KAISER_WIDTH;
+    default:
+        return 3.0f;
+    }
+}
+
+float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    float halfX = x * 0.5f;
+    for (int32 k = 1; term > sum * 1e-8f; ++k)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Weight at x texels from the center, the box is handled by FilterAxis.
+float GetFilterWeight(PixmapFilter filter, float x)
+{
+    x = Math::Abs(x);
+    switch (filter)
+    {
+    case PixmapFilter::Triangle:
+        return Math::Max(1.0f - x, 0.0f);
+    case PixmapFilter::Kaiser:
+    {
+        float t = x / KAISER_WIDTH;
+        if (t >= 1.0f)
+            return 0.0f;
+        float sinc = x == 0.0f ? 1.0f : Math::Sin(Math::PI * x) / (Math::PI * x);
+        return sinc * BesselI0(KAISER_ALPHA * Math::Sqrt(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+    }
+    default:
+    {
+        // Lanczos 3.
+        if (x >= 3.0f)
+            return 0.0f;
+        if (x < 1e-5f)
+            return 1.0f;
+        float px = Math::PI * x;
+        return 3.0f * Math::Sin(px) * Math::Sin(px / 3.0f) / (px * px);
+    }
+    }
+}
+
+struct FilterTap
+{
+    int32 index;
+    float weight;
+};
+
+// One axis of the separable filter, the taps of destination texel i are taps[offsets[i], offsets[i + 1]).
+// Minifying widens the filter so every source texel contributes, texels past the border repeat the edge.
+struct FilterAxis
+{
+    Array<FilterTap> taps;
+    Array<int32> offsets;
+
+    FilterAxis(int32 srcSize, int32 dstSize, PixmapFilter filter)
+    {
+        float ratio = static_cast<float>(srcSize) / dstSize;
+        float scale = Math::Max(ratio, 1.0f);
+        float radius = GetFilterRadius(filter) * scale;
+        offsets.Reserve(dstSize + 1);
+        for (int32 i = 0; i < dstSize; ++i)
+        {
+            int32 first = taps.Count();
+            offsets.Add(first);
+
+            float center = (i + 0.5f) * ratio;
+            float sum = 0.0f;
+            for (int32 s = Math::FloorToInt(center - radius); s <= Math::CeilToInt(center + radius); ++s)
+            {
+                // The box weighs each source texel by its overlap with the footprint, with odd sizes a texel is shared by two
+                // destination texels.
+                float weight = filter == PixmapFilter::Box ? Math::Max(Math::Min(center + radius, s + 1.0f) - Math::Max(center - radius, static_cast<float>(s)), 0.0f)
+                                                           : GetFilterWeight(filter, (s + 0.5f - center) / scale);
+                if (weight == 0.0f)
+                    continue;
+                int32 index = Math::Clamp(s, 0, srcSize - 1);
+                // Clamped taps of the same edge texel are merged.
+                if (taps.Count() > first && taps.Last().index == index)
+                    taps.Last().weight += weight;
+                else
+                    taps.Add({ index, weight });
+                sum += weight;
+            }
+
+            if (sum == 0.0f)
+            {
+                taps.Add({ Math::Clamp(Math::FloorToInt(center), 0, srcSize - 1), 1.0f });
+                sum = 1.0f;
+            }
+            for (int32 t = first; t < taps.Count(); ++t)
+                taps[t].weight /= sum;
+        }
+        offsets.Add(taps.Count());
+    }
+};
+
+// Calls func(rowBegin, rowEnd) on chunks of the rows, spread over the global thread pool.
+template <typename Func>
+void ForEachRows(int32 rowCount, int32 rowTexels, Func &&func)
+{
+    auto &pool = ThreadPool::GetGlobal();
+    int32 rowsPerChunk = Math::Max(RESIZE_CHUNK_TEXELS / Math::Max(rowTexels, 1), 1);
+    int32 chunkCount = (rowCount + rowsPerChunk - 1) / rowsPerChunk;
+    int32 threadCount = Math::Min(chunkCount, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1);
+    threadCount = Math::Max(threadCount, 1);
+
+    std::atomic<int32> next{ 0 };
+    auto Process = [&, rowsPerChunk, chunkCount]() {
+        for (int32 i = next++; i < chunkCount; i = next++)
+            func(i * rowsPerChunk, Math::Min((i + 1) * rowsPerChunk, rowCount));
+    };
+
+    Array<ThreadPool::Handle> handles;
+    for (int32 i = 1; i < threadCount; ++i)
+    {
+        handles.Add(pool.Run(CT_TEXT("Pixmap"), [&Process]() { Process(); }));
+    }
+    Process();
+    for (auto &handle : handles)
+        handle.Wait();
+}
+}
 
 SPtr<Pixmap> Pixmap::Create(int32 width, int32 height, ResourceFormat format)
 {
@@ -14,6 +570,7 @@ Pixmap::Pixmap(int32 width, int32 height, ResourceFormat format)
     : width(width), height(height), format(format)
 {
     CT_CHECK(width >= 0 && height >= 0);
+    CT_CHECK(IsSupportedFormat(format));
 
     data = Memory::Alloc(GetSize());
     Fill(Color::WHITE);
@@ -23,6 +580,7 @@ Pixmap::Pixmap(int32 width, int32 height, ResourceFormat format, const void *src
     : width(width), height(height), format(format)
 {
     CT_CHECK(width >= 0 && height >= 0);
+    CT_CHECK(IsSupportedFormat(format));
 
     auto size = GetSize();
     data = Memory::Alloc(size);
@@ -34,40 +592,202 @@ Pixmap::~Pixmap()
     Memory::Free(data);
 }
 
+bool Pixmap::IsSupportedFormat(ResourceFormat format)
+{
+    PixelLayout layout;
+    return GetPixelLayout(format, layout);
+}
+
 uint32 Pixmap::GetSize() const
 {
     return width * height * GetResourceFormatBytes(format);
 }
 
+uint8 *Pixmap::GetPixelData(int32 x, int32 y) const
+{
+    return static_cast<uint8 *>(data) + (static_cast<SizeType>(y) * width + x) * GetResourceFormatBytes(format);
+}
+
 void Pixmap::Fill(const Color &color)
 {
-    //TODO
+    uint8 texel[sizeof(Color)];
+    Encode(format, &color, 1, texel);
+    FillTexels(static_cast<uint8 *>(data), texel, GetResourceFormatBytes(format), static_cast<SizeType>(width) * height);
+}
+
+void Pixmap::FillRect(int32 x, int32 y, int32 rectWidth, int32 rectHeight, const Color &color)
+{
+    int32 x0 = Math::Max(x, 0);
+    int32 y0 = Math::Max(y, 0);
+    int32 x1 = Math::Min(x + rectWidth, width);
+    int32 y1 = Math::Min(y + rectHeight, height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    uint8 texel[sizeof(Color)];
+    Encode(format, &color, 1, texel);
+    SizeType texelBytes = GetResourceFormatBytes(format);
+    uint8 *first = GetPixelData(x0, y0);
+    FillTexels(first, texel, texelBytes, x1 - x0);
+    for (int32 row = y0 + 1; row < y1; ++row)
+        std::memcpy(GetPixelData(x0, row), first, texelBytes * (x1 - x0));
 }
 
 void Pixmap::SetPixel(int32 x, int32 y, const Color &color)
 {
-    //TODO
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return;
+
+    Encode(format, &color, 1, GetPixelData(x, y));
 }
 
 void Pixmap::SetPixels(const Color *src, int32 count)
 {
-    //TODO
+    count = Math::Min(count, width * height);
+    if (count > 0)
+        Encode(format, src, count, static_cast<uint8 *>(data));
 }
 
 void Pixmap::SetPixels(const Array<Color> &colors)
 {
-    //TODO
+    SetPixels(colors.GetData(), colors.Count());
 }
 
-Color Pixmap::GetPixel(int32 x, int32 y)
+Color Pixmap::GetPixel(int32 x, int32 y) const
 {
-    //TODO
-    return Color();
+    Color result(0.0f, 0.0f, 0.0f, 0.0f);
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return result;
+
+    Decode(format, GetPixelData(x, y), 1, &result);
+    return result;
 }
 
 Array<Color> Pixmap::GetPixels() const
 {
     Array<Color> result;
-    //TODO
+    int32 count = width * height;
+    result.AddUninitialized(count);
+    if (count > 0)
+        Decode(format, static_cast<const uint8 *>(data), count, result.GetData());
+    return result;
+}
+
+void Pixmap::ReadRow(int32 x, int32 y, int32 count, Color *dst) const
+{
+    CT_CHECK(x >= 0 && y >= 0 && y < height && count >= 0 && x + count <= width);
+    Decode(format, GetPixelData(x, y), count, dst);
+}
+
+void Pixmap::WriteRow(int32 x, int32 y, int32 count, const Color *src)
+{
+    CT_CHECK(x >= 0 && y >= 0 && y < height && count >= 0 && x + count <= width);
+    Encode(format, src, count, GetPixelData(x, y));
+}
+
+void Pixmap::Blit(const Pixmap &src, int32 srcX, int32 srcY, int32 rectWidth, int32 rectHeight, int32 dstX, int32 dstY, bool blend)
+{
+    // Clip the source and destination rectangles together.
+    int32 left = Math::Max(Math::Max(-srcX, -dstX), 0);
+    int32 top = Math::Max(Math::Max(-srcY, -dstY), 0);
+    srcX += left;
+    dstX += left;
+    srcY += top;
+    dstY += top;
+    rectWidth = Math::Min(rectWidth - left, Math::Min(src.width - srcX, width - dstX));
+    rectHeight = Math::Min(rectHeight - top, Math::Min(src.height - srcY, height - dstY));
+    if (rectWidth <= 0 || rectHeight <= 0)
+        return;
+
+    // Rows that move down in the same pixmap go bottom up so none is overwritten before it is read.
+    bool reverse = &src == this && dstY > srcY;
+    if (!blend && src.format == format)
+    {
+        SizeType rowBytes = static_cast<SizeType>(rectWidth) * GetResourceFormatBytes(format);
+        for (int32 i = 0; i < rectHeight; ++i)
+        {
+            int32 row = reverse ? rectHeight - 1 - i : i;
+            std::memmove(GetPixelData(dstX, dstY + row), src.GetPixelData(srcX, srcY + row), rowBytes);
+        }
+        return;
+    }
+
+    Array<Color> srcRow;
+    Array<Color> dstRow;
+    srcRow.AddUninitialized(rectWidth);
+    if (blend)
+        dstRow.AddUninitialized(rectWidth);
+    for (int32 i = 0; i < rectHeight; ++i)
+    {
+        int32 row = reverse ? rectHeight - 1 - i : i;
+        src.ReadRow(srcX, srcY + row, rectWidth, srcRow.GetData());
+        if (blend)
+        {
+            ReadRow(dstX, dstY + row, rectWidth, dstRow.GetData());
+            BlendRow(srcRow.GetData(), rectWidth, dstRow.GetData());
+            WriteRow(dstX, dstY + row, rectWidth, dstRow.GetData());
+        }
+        else
+        {
+            WriteRow(dstX, dstY + row, rectWidth, srcRow.GetData());
+        }
+    }
+}
+
+void Pixmap::Blit(const Pixmap &src, int32 dstX, int32 dstY, bool blend)
+{
+    Blit(src, 0, 0, src.width, src.height, dstX, dstY, blend);
+}
+
+SPtr<Pixmap> Pixmap::Resize(int32 newWidth, int32 newHeight, PixmapFilter filter, bool premultiplyAlpha) const
+{
+    CT_CHECK(newWidth > 0 && newHeight > 0);
+    auto result = Create(newWidth, newHeight, format);
+    if (width == 0 || height == 0)
+        return result;
+
+    FilterAxis xAxis(width, newWidth, filter);
+    FilterAxis yAxis(height, newHeight, filter);
+
+    // Each destination row sums the source rows under it, then filters that row horizontally, so no intermediate image is kept.
+    ForEachRows(newHeight, Math::Max(width, newWidth), [&](int32 rowBegin, int32 rowEnd) {
+        Array<Color> decoded;
+        Array<Color> column;
+        Array<Color> filtered;
+        decoded.AddUninitialized(width);
+        column.AddUninitialized(width);
+        filtered.AddUninitialized(newWidth);
+        for (int32 y = rowBegin; y < rowEnd; ++y)
+        {
+            std::fill(column.begin(), column.end(), Color(0.0f, 0.0f, 0.0f, 0.0f));
+            for (int32 t = yAxis.offsets[y]; t < yAxis.offsets[y + 1]; ++t)
+            {
+                const auto &tap = yAxis.taps[t];
+                ReadRow(0, tap.index, width, decoded.GetData());
+                if (premultiplyAlpha)
+                    Premultiply(decoded.GetData(), width);
+                Simd::Float4 weight = Simd::Splat(tap.weight);
+                for (int32 x = 0; x < width; ++x)
+                {
+                    float *sum = &column[x].r;
+                    Simd::Store(sum, Simd::Add(Simd::Load(sum), Simd::Mul(Simd::Load(&decoded[x].r), weight)));
+                }
+            }
+
+            for (int32 x = 0; x < newWidth; ++x)
+            {
+                Simd::Float4 sum = Simd::Splat(0.0f);
+                for (int32 t = xAxis.offsets[x]; t < xAxis.offsets[x + 1]; ++t)
+                {
+                    const auto &tap = xAxis.taps[t];
+                    sum = Simd::Add(sum, Simd::Mul(Simd::Load(&column[tap.index].r), Simd::Splat(tap.weight)));
+                }
+                Simd::Store(&filtered[x].r, sum);
+            }
+            if (premultiplyAlpha)
+                Unpremultiply(filtered.GetData(), newWidth);
+            result->WriteRow(0, y, newWidth, filtered.GetData());
+        }
+    });
     return result;
 }
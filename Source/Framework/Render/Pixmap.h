@@ -3,6 +3,15 @@
 #include "Math/Color.h"
 #include "Render/.Package.h"
 
+enum class PixmapFilter
+{
+    Box,      // Averages the texels each one covers.
+    Triangle,
+    Lanczos,
+    Kaiser,   // NVTT's mip filter, a Kaiser windowed sinc.
+};
+
+// CPU image with tightly packed rows. Pixels are read and written as linear colors, srgb formats are decoded and encoded on the way.
 class Pixmap
 {
 public:
@@ -10,12 +19,32 @@ public:
     Pixmap(int32 width, int32 height, ResourceFormat format, const void *src);
     ~Pixmap();
 
+    // 8 and 16 bit unorm, 16 and 32 bit float formats with 1, 2 or 4 channels, and RGBA8 srgb. Missing channels read as
+    // (0, 0, 0, 1).
+    static bool IsSupportedFormat(ResourceFormat format);
+
     void Fill(const Color &color);
+    // Clipped against the pixmap.
+    void FillRect(int32 x, int32 y, int32 rectWidth, int32 rectHeight, const Color &color);
+    // Out of range pixels are ignored, and read as transparent black.
     void SetPixel(int32 x, int32 y, const Color &color);
     void SetPixels(const Color *src, int32 count);
     void SetPixels(const Array<Color> &colors);
-    Color GetPixel(int32 x, int32 y);
+    Color GetPixel(int32 x, int32 y) const;
     Array<Color> GetPixels() const;
+    // Converts count pixels of row y starting at x, the span must be inside the pixmap.
+    void ReadRow(int32 x, int32 y, int32 count, Color *dst) const;
+    void WriteRow(int32 x, int32 y, int32 count, const Color *src);
+
+    // Copies a rectangle of src to (dstX, dstY), clipped against both pixmaps. With blend the source is drawn over the
+    // destination with straight alpha in linear space. src may be this pixmap, overlapping rectangles are handled.
+    void Blit(const Pixmap &src, int32 srcX, int32 srcY, int32 rectWidth, int32 rectHeight, int32 dstX, int32 dstY, bool blend = false);
+    void Blit(const Pixmap &src, int32 dstX, int32 dstY, bool blend = false);
+
+    // Separable resample into a new pixmap of the same format, in linear space. premultiplyAlpha keeps transparent pixels from
+    // bleeding their color, without it every channel is filtered on its own, for data whose alpha is not coverage.
+    // Rows are spread over the global thread pool.
+    SPtr<Pixmap> Resize(int32 newWidth, int32 newHeight, PixmapFilter filter = PixmapFilter::Lanczos, bool premultiplyAlpha = true) const;
 
     uint32 GetSize() const;
 
@@ -43,8 +72,10 @@ public:
     static SPtr<Pixmap> Create(int32 width, int32 height, ResourceFormat format, const void *src);
 
 private:
+    uint8 *GetPixelData(int32 x, int32 y) const;
+
     int32 width;
     int32 height;
     ResourceFormat format;
     void *data = nullptr;
-};
\ No newline at end of file
+};
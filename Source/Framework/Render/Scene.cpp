@@ -1,4 +1,6 @@
 #include "Render/Scene.h"
+#include "Core/Thread.h"
+#include "Render/TextureStreamer.h"
 
 namespace
 {
@@ -15,10 +17,8 @@ const String MATERIAL_BUFFER_NAME = CT_TEXT("MaterialBuffer");
 const String LIGHT_BUFFER_NAME = CT_TEXT("LightBuffer");
 const String CAMERA_BUFFER_NAME = CT_TEXT("CameraBuffer");
 
-CT_INLINE bool DoesTransformFlip(const Matrix4 &m)
-{
-    return m.ToMatrix3().Determinant() < 0.0f;
-}
+// Fewer instances than this per thread are not worth a thread handoff.
+const int32 CULLING_CHUNK_SIZE = 16384;
 }
 
 SPtr<Scene> Scene::Create()
@@ -83,6 +83,7 @@ ProgramDefines Scene::GetSceneDefines() const
 {
     ProgramDefines defines;
     defines.Put(CT_TEXT("MATERIAL_COUNT"), StringConvert::ToString(materials.Count()));
+    defines.Put(CT_TEXT("CT_VERTEX_FORMAT"), StringConvert::ToString((int32)vertexFormat));
     return defines;
 }
 
@@ -94,14 +95,25 @@ SceneUpdateFlags Scene::Update(RenderContext *ctx, float currentTime)
         updateFlags |= SceneUpdate::SceneGraphChanged;
 
         auto &changes = animationController->GetMatricesChanged();
-        for (const auto &e : meshInstanceDatas)
+        movedInstances.Clear();
+        for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
         {
-            if (changes[e.globalMatrixID])
-            {
-                updateFlags |= SceneUpdate::MeshesMoved;
-                break;
-            }
+            if (changes[meshInstanceDatas[i].globalMatrixID])
+                movedInstances.Add(i);
         }
+        if (!movedInstances.IsEmpty())
+            updateFlags |= SceneUpdate::MeshesMoved;
+    }
+
+    if (updateFlags & SceneUpdate::MeshesMoved)
+    {
+        UpdateInstanceMatrices();
+        UpdateBounds();
+        // Walking the paths of single instances stops paying off once a good share of them moved.
+        if (movedInstances.Count() * 4 > meshInstanceDatas.Count())
+            instanceBVH.Refit(instanceBBs);
+        else
+            instanceBVH.Refit(instanceBBs, movedInstances);
     }
 
     if (UpdateCamera())
@@ -111,6 +123,15 @@ SceneUpdateFlags Scene::Update(RenderContext *ctx, float currentTime)
     if (UpdateMaterials())
         updateFlags |= SceneUpdate::MaterialChanged;
 
+    if (lodDirty || (updateFlags & (SceneUpdate::CameraChanged | SceneUpdate::MeshesMoved)))
+        SelectLods();
+    if (cullingEnabled && (cullingDirty || (updateFlags & (SceneUpdate::CameraChanged | SceneUpdate::MeshesMoved))))
+        CullInstances();
+    if (coveragesDirty || (updateFlags & (SceneUpdate::CameraChanged | SceneUpdate::MeshesMoved)))
+        UpdateTextureCoverages();
+    // Requests are repeated every frame, the streamer drops levels nobody asked for lately.
+    RequestTextures();
+
     ctx->Flush();
 
     //TODO
@@ -126,17 +147,23 @@ void Scene::Render(RenderContext *ctx, GraphicsState *state, GraphicsVars *vars,
     bool overrideRS = (flags & SceneRender::CustomRasterizationState) == 0;
     auto currentRS = state->GetRasterizationState();
 
-    if (counterClockwiseDrawArgs.count)
+    bool culled = cullingEnabled && (flags & SceneRender::NoCulling) == 0;
+    const auto &ccwArgs = culled ? visibleCounterClockwiseDrawArgs : counterClockwiseDrawArgs;
+    const auto &cwArgs = culled ? visibleClockwiseDrawArgs : clockwiseDrawArgs;
+    if (!culled && drawListDirty)
+        UploadDrawList();
+
+    if (ccwArgs.count)
     {
         if (overrideRS)
             state->SetRasterizationState(frontCounterClockwiseRS);
-        ctx->DrawIndexedIndirect(state, vars, counterClockwiseDrawArgs.count, counterClockwiseDrawArgs.buffer.get(), 0, nullptr, 0);
+        ctx->DrawIndexedIndirect(state, vars, ccwArgs.count, ccwArgs.buffer.get(), 0, nullptr, 0);
     }
-    if (clockwiseDrawArgs.count)
+    if (cwArgs.count)
     {
         if (overrideRS)
             state->SetRasterizationState(frontClockwiseRS);
-        ctx->DrawIndexedIndirect(state, vars, clockwiseDrawArgs.count, clockwiseDrawArgs.buffer.get(), 0, nullptr, 0);
+        ctx->DrawIndexedIndirect(state, vars, cwArgs.count, cwArgs.buffer.get(), 0, nullptr, 0);
     }
 
     if (overrideRS)
@@ -234,35 +261,38 @@ void Scene::UploadMaterial(int32 matID)
     var[CT_TEXT("samplerStates")][matID] = mat->GetSampler();
 }
 
+void Scene::UpdateInstanceMatrices()
+{
+    const auto &globalMatrices = animationController->GetGlobalMatrices();
+    instanceMatrices.SetCount(meshInstanceDatas.Count());
+    for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
+        instanceMatrices.Set(i, globalMatrices[meshInstanceDatas[i].globalMatrixID]);
+}
+
 void Scene::UpdateMeshInstanceFlags()
 {
-    for (auto &e : meshInstanceDatas)
+    Batch::NegativeDeterminants(instanceMatrices, instanceFlipped);
+    for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
     {
+        auto &e = meshInstanceDatas[i];
         e.flags = CT_MESH_INSTANCE_NONE;
-        const auto &m = animationController->GetGlobalMatrices()[e.globalMatrixID];
-        if (DoesTransformFlip(m))
+        if (instanceFlipped[i])
             e.flags |= CT_MESH_INSTANCE_FLIPPED;
     }
 }
 
 void Scene::UpdateBounds()
 {
-    auto &globalMatrices = animationController->GetGlobalMatrices();
-    Array<AABox> instanceBBs;
-    instanceBBs.Reserve(meshInstanceDatas.Count());
-
-    for (const auto &e : meshInstanceDatas)
+    // Mesh bounds never change after building, gather them once.
+    if (instanceMeshBBs.Count() != meshInstanceDatas.Count())
     {
-        const auto &meshBB = meshBBs[e.meshID];
-        const auto &transform = globalMatrices[e.globalMatrixID];
-        instanceBBs.Add(AABox::Transform(meshBB, transform));
+        instanceMeshBBs.SetCount(meshInstanceDatas.Count());
+        for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
+            instanceMeshBBs.Set(i, meshBBs[meshInstanceDatas[i].meshID]);
     }
 
-    sceneBB = instanceBBs[0];
-    for (int32 i = 1; i < instanceBBs.Count(); ++i)
-    {
-        sceneBB.Merge(instanceBBs[i]);
-    }
+    Batch::TransformAABoxes(instanceMatrices, instanceMeshBBs, instanceBBs);
+    sceneBB = Batch::MergeAABoxes(instanceBBs);
 }
 
 bool Scene::UpdateCamera(bool force)
@@ -330,35 +360,311 @@ bool Scene::UpdateMaterials(bool force)
 void Scene::CreateDrawList()
 {
     Array<DrawIndexedIndirectArgs> cwArgs, ccwArgs;
+    // Meshlet culling leaves at most one draw per two meshlets of an instance, the visible lists have room for that.
+    int32 cwCapacity = 0, ccwCapacity = 0;
 
-    auto buffer = sceneBlock->GetBuffer(CT_TEXT("WorldMatrixBuffer"));
-    const Matrix4 *matrices = (Matrix4 *)buffer->Map(BufferMapType::Read);
-    for (const auto &e : meshInstanceDatas)
+    instanceDrawArgs.Clear();
+    for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
     {
-        const auto &mesh = meshDesces[e.meshID];
-        const auto &transform = matrices[e.globalMatrixID];
+        int32 meshID = meshInstanceDatas[i].meshID;
+        const auto &mesh = meshDesces[meshID];
 
         DrawIndexedIndirectArgs args = {
             .indexCount = (uint32)mesh.indexCount,
             .instanceCount = 1,
             .firstIndex = (uint32)mesh.indexOffset,
             .vertexOffset = mesh.vertexOffset,
-            .firstInstance = (uint32)(cwArgs.Count() + ccwArgs.Count()),
+            .firstInstance = (uint32)i,
         };
-        DoesTransformFlip(transform) ? cwArgs.Add(args) : ccwArgs.Add(args);
+        instanceDrawArgs.Add(args);
+        instanceFlipped[i] ? cwArgs.Add(args) : ccwArgs.Add(args);
+        (instanceFlipped[i] ? cwCapacity : ccwCapacity) += Math::Max(1, (meshMeshlets[meshID].Count() + 1) / 2);
+    }
+
+    // The visible lists start out complete and are refilled by CullInstances.
+    auto CreateDrawArgs = [](const Array<DrawIndexedIndirectArgs> &args, int32 capacity, DrawArgs &drawArgs, DrawArgs &visibleDrawArgs) {
+        drawArgs.buffer = Buffer::CreateIndirect(args);
+        drawArgs.count = args.Count();
+
+        Array<DrawIndexedIndirectArgs> visibleArgs = args;
+        visibleArgs.SetCount(capacity);
+        visibleDrawArgs.buffer = Buffer::CreateIndirect(visibleArgs);
+        visibleDrawArgs.count = args.Count();
+    };
+    if (!cwArgs.IsEmpty())
+        CreateDrawArgs(cwArgs, cwCapacity, clockwiseDrawArgs, visibleClockwiseDrawArgs);
+    if (!ccwArgs.IsEmpty())
+        CreateDrawArgs(ccwArgs, ccwCapacity, counterClockwiseDrawArgs, visibleCounterClockwiseDrawArgs);
+
+    instanceLods.SetCount(meshInstanceDatas.Count());
+    for (auto &e : instanceLods)
+        e = 0;
+
+    visibleInstanceCount = meshInstanceDatas.Count();
+    cullingDirty = true;
+    lodDirty = true;
+}
+
+void Scene::UploadDrawList()
+{
+    drawListDirty = false;
+
+    Array<DrawIndexedIndirectArgs> cwArgs, ccwArgs;
+    for (int32 i = 0; i < instanceDrawArgs.Count(); ++i)
+        instanceFlipped[i] ? cwArgs.Add(instanceDrawArgs[i]) : ccwArgs.Add(instanceDrawArgs[i]);
+
+    if (!cwArgs.IsEmpty())
+        clockwiseDrawArgs.buffer->SetBlob(cwArgs.GetData(), 0, sizeof(DrawIndexedIndirectArgs) * cwArgs.Count());
+    if (!ccwArgs.IsEmpty())
+        counterClockwiseDrawArgs.buffer->SetBlob(ccwArgs.GetData(), 0, sizeof(DrawIndexedIndirectArgs) * ccwArgs.Count());
+}
+
+void Scene::SelectLods()
+{
+    lodDirty = false;
+
+    // World space error of one unit per distance, projected to a fraction of the screen height.
+    float projectionScale = 0.5f * Math::Abs(camera->GetProjection()(1, 1));
+    Vector3 eye = camera->GetPosition();
+    float nearZ = camera->GetNearZ();
+
+    int32 first = meshInstanceDatas.Count(), last = -1;
+    for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
+    {
+        const auto &lods = meshLods[meshInstanceDatas[i].meshID];
+        int32 lod = 0;
+        if (lodScreenError > 0.0f && lods.Count() > 1)
+        {
+            AABox box = instanceBBs.Get(i);
+            Vector3 delta = Vector3::Max(Vector3::Max(box.min - eye, eye - box.max), Vector3::ZERO);
+            float distance = Math::Max(delta.Length(), nearZ);
+
+            // Mesh errors scale with the largest axis of the instance.
+            float scale = 0.0f;
+            for (int32 col = 0; col < 3; ++col)
+            {
+                float x = instanceMatrices.m[col * 3][i], y = instanceMatrices.m[col * 3 + 1][i], z = instanceMatrices.m[col * 3 + 2][i];
+                scale = Math::Max(scale, x * x + y * y + z * z);
+            }
+            float allowedError = lodScreenError * distance / (projectionScale * Math::Sqrt(scale));
+
+            // Errors grow with the level, take the coarsest one still within bounds.
+            while (lod + 1 < lods.Count() && lods[lod + 1].error <= allowedError)
+                ++lod;
+        }
+
+        if (lod == instanceLods[i])
+            continue;
+
+        instanceLods[i] = lod;
+        instanceDrawArgs[i].firstIndex = (uint32)lods[lod].indexOffset;
+        instanceDrawArgs[i].indexCount = (uint32)lods[lod].indexCount;
+        // Shaders find the triangles of an instance through its index offset.
+        meshInstanceDatas[i].indexOffset = lods[lod].indexOffset;
+        first = Math::Min(first, i);
+        last = Math::Max(last, i);
+    }
+
+    if (last < first)
+        return;
+
+    meshInstancesBuffer->SetBlob(&meshInstanceDatas[first], first * sizeof(MeshInstanceData), (last - first + 1) * sizeof(MeshInstanceData));
+    cullingDirty = true;
+    drawListDirty = true;
+}
+
+void Scene::UpdateTextureCoverages()
+{
+    coveragesDirty = false;
+    materialCoverages.SetCount(materials.Count());
+    for (auto &e : materialCoverages)
+        e = 0.0f;
+
+    // Projected like SelectLods does it, the instance box stands in for the surface the uv range is spread over.
+    float projectionScale = 0.5f * Math::Abs(camera->GetProjection()(1, 1));
+    Vector3 eye = camera->GetPosition();
+    float nearZ = camera->GetNearZ();
+    auto Cover = [&](int32 i) {
+        const auto &mesh = meshDesces[meshInstanceDatas[i].meshID];
+        float uvExtent = Math::Max(mesh.uvScale.x, mesh.uvScale.y);
+        if (uvExtent <= 0.0f)
+            return;
+
+        AABox box = instanceBBs.Get(i);
+        Vector3 delta = Vector3::Max(Vector3::Max(box.min - eye, eye - box.max), Vector3::ZERO);
+        float distance = Math::Max(delta.Length(), nearZ);
+        Vector3 size = box.max - box.min;
+        float extent = Math::Max(Math::Max(size.x, size.y), size.z);
+
+        float &coverage = materialCoverages[mesh.materialID];
+        coverage = Math::Max(coverage, projectionScale * extent / (distance * uvExtent));
+    };
+
+    // Only visible instances ask for resolution when culling is on.
+    if (cullingEnabled)
+    {
+        for (const auto &result : cullingResults)
+        {
+            for (int32 i : result.instances)
+                Cover(i);
+        }
+    }
+    else
+    {
+        for (int32 i = 0; i < meshInstanceDatas.Count(); ++i)
+            Cover(i);
     }
-    buffer->Unmap();
+}
 
-    if (auto count = cwArgs.Count())
+void Scene::RequestTextures()
+{
+    for (int32 i = 0; i < materialCoverages.Count(); ++i)
     {
-        clockwiseDrawArgs.buffer = Buffer::CreateIndirect(cwArgs);
-        clockwiseDrawArgs.count = count;
+        float coverage = materialCoverages[i];
+        if (coverage <= 0.0f)
+            continue;
+
+        const auto &resources = materials[i]->GetResources();
+        gTextureStreamer->RequestCoverage(resources.baseTexture, coverage);
+        gTextureStreamer->RequestCoverage(resources.specularTexture, coverage);
+        gTextureStreamer->RequestCoverage(resources.emissiveTexture, coverage);
+        gTextureStreamer->RequestCoverage(resources.normalTexture, coverage);
+        gTextureStreamer->RequestCoverage(resources.occlusionTexture, coverage);
     }
-    if (auto count = ccwArgs.Count())
+}
+
+void Scene::CullInstances()
+{
+    cullingDirty = false;
+    if (instanceBVH.IsEmpty())
     {
-        counterClockwiseDrawArgs.buffer = Buffer::CreateIndirect(ccwArgs);
-        counterClockwiseDrawArgs.count = count;
+        // Nothing left from the last pass may be drawn or counted.
+        visibleInstanceCount = 0;
+        cullingResults.Clear();
+        visibleClockwiseDrawArgs.count = 0;
+        visibleCounterClockwiseDrawArgs.count = 0;
+        return;
     }
+
+    Frustum frustum(camera->GetViewProjection());
+
+    // Idle pool threads take a subtree each, the calling thread takes the first one.
+    auto &pool = ThreadPool::GetGlobal();
+    int32 count = instanceBVH.GetItemCount();
+    int32 threadCount = Math::Min((count + CULLING_CHUNK_SIZE - 1) / CULLING_CHUNK_SIZE, static_cast<int32>(Thread::HardwareConcurrency()), pool.GetAvailableCount() + 1);
+    instanceBVH.GetSubtrees(Math::Max(threadCount, 1), cullingRoots);
+    cullingResults.SetCount(cullingRoots.Count());
+
+    // Meshlets are tested on the same threads, each one emits the draws of its instances.
+    Matrix4 viewProj = camera->GetViewProjection();
+    Vector3 eye = camera->GetPosition();
+    auto Cull = [this, &frustum, &viewProj, &eye](int32 i) {
+        auto &result = cullingResults[i];
+        result.instances.Clear();
+        result.drawArgs[0].Clear();
+        result.drawArgs[1].Clear();
+        result.visibleInstanceCount = 0;
+        instanceBVH.QueryFrustum(frustum, result.instances, result.visible, cullingRoots[i]);
+        for (int32 id : result.instances)
+        {
+            // Keeping firstInstance so shaders still find their instance data.
+            auto &drawArgs = result.drawArgs[instanceFlipped[id] ? 1 : 0];
+            int32 drawCount = drawArgs.Count();
+            if (!CullMeshlets(id, viewProj, eye, drawArgs))
+                drawArgs.Add(instanceDrawArgs[id]);
+            if (drawArgs.Count() > drawCount)
+                result.visibleInstanceCount++;
+        }
+    };
+
+    Array<ThreadPool::Handle> handles;
+    for (int32 i = 1; i < cullingRoots.Count(); ++i)
+        handles.Add(pool.Run(CT_TEXT("SceneCulling"), [&Cull, i]() { Cull(i); }));
+    Cull(0);
+    for (auto &handle : handles)
+        handle.Wait();
+
+    visibleInstanceCount = 0;
+    for (const auto &result : cullingResults)
+        visibleInstanceCount += result.visibleInstanceCount;
+
+    auto Compact = [&](bool flipped, DrawArgs &drawArgs) {
+        visibleDrawArgs.Clear();
+        for (const auto &result : cullingResults)
+        {
+            for (const auto &args : result.drawArgs[flipped ? 1 : 0])
+                visibleDrawArgs.Add(args);
+        }
+
+        drawArgs.count = visibleDrawArgs.Count();
+        if (drawArgs.count)
+            drawArgs.buffer->SetBlob(visibleDrawArgs.GetData(), 0, sizeof(DrawIndexedIndirectArgs) * drawArgs.count);
+    };
+    Compact(true, visibleClockwiseDrawArgs);
+    Compact(false, visibleCounterClockwiseDrawArgs);
+}
+
+bool Scene::CullMeshlets(int32 instanceID, const Matrix4 &viewProj, const Vector3 &eye, Array<DrawIndexedIndirectArgs> &drawArgs) const
+{
+    const auto &instance = meshInstanceDatas[instanceID];
+    const auto &meshlets = meshMeshlets[instance.meshID];
+    // Meshlets only split the full mesh.
+    if (!meshletCullingEnabled || meshlets.Count() < 2 || instanceLods[instanceID] != 0)
+        return false;
+
+    // Testing in mesh space saves transforming every meshlet, planes and which side of a triangle the eye is on stay the same.
+    const auto &model = animationController->GetGlobalMatrices()[instance.globalMatrixID];
+    Frustum frustum(viewProj * model);
+    Vector3 localEye = animationController->GetInvTransposeGlobalMatrices()[instance.globalMatrixID].Transpose().TransformPoint(eye);
+    // Back faces of double sided materials are drawn.
+    bool coneCulling = !materials[instance.materialID]->IsDoubleSided();
+
+    // Neighbouring visible meshlets share one draw.
+    DrawIndexedIndirectArgs args = instanceDrawArgs[instanceID];
+    args.indexCount = 0;
+    for (const auto &meshlet : meshlets)
+    {
+        if (!frustum.Intersects(Sphere(meshlet.center, meshlet.radius)))
+            continue;
+        if (coneCulling)
+        {
+            Vector3 direction = meshlet.center - localEye;
+            if (direction.Dot(meshlet.coneAxis) >= meshlet.coneCutoff * direction.Length() + meshlet.radius)
+                continue;
+        }
+
+        if (args.indexCount && args.firstIndex + args.indexCount == (uint32)meshlet.indexOffset)
+        {
+            args.indexCount += meshlet.indexCount;
+            continue;
+        }
+        if (args.indexCount)
+            drawArgs.Add(args);
+        args.firstIndex = meshlet.indexOffset;
+        args.indexCount = meshlet.indexCount;
+    }
+    if (args.indexCount)
+        drawArgs.Add(args);
+    return true;
+}
+
+int32 Scene::Pick(const Ray &ray, float *distance) const
+{
+    float hitDistance;
+    int32 id = instanceBVH.Raycast(ray, hitDistance);
+    if (id >= 0 && distance)
+        *distance = hitDistance;
+    return id;
+}
+
+void Scene::QueryInstances(const AABox &box, Array<int32> &instanceIDs) const
+{
+    instanceBVH.QueryOverlap(box, instanceIDs);
+}
+
+void Scene::QueryInstances(const Frustum &frustum, Array<int32> &instanceIDs) const
+{
+    instanceBVH.QueryFrustum(frustum, instanceIDs);
 }
 
 void Scene::Finalize()
@@ -369,8 +675,10 @@ void Scene::Finalize()
     // This will bind matrix buffers.
     animationController->Animate(RenderAPI::GetDevice()->GetRenderContext(), 0);
 
+    UpdateInstanceMatrices();
     UpdateMeshInstanceFlags();
     UpdateBounds();
+    instanceBVH.Build(instanceBBs);
     CreateDrawList();
 
     UpdateCamera(true);
@@ -398,6 +706,10 @@ void Scene::SortMeshes()
 
 Scene::Statistics Scene::GetStatistics() const
 {
+    // Culling results change every frame, the rest only when the scene is rebuilt.
+    // Without culling everything is drawn, the count of the last culling pass is stale.
+    stats.visibleInstanceCount = cullingEnabled ? visibleInstanceCount : GetMeshInstanceCount();
+    stats.culledInstanceCount = GetMeshInstanceCount() - stats.visibleInstanceCount;
     if (!statsDirty)
         return stats;
 
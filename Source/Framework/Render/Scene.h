@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/AABox.h"
+#include "Math/BVH.h"
 #include "Render/AnimationController.h"
 #include "Render/CameraController.h"
 #include "Render/Light.h"
@@ -20,6 +21,8 @@ public:
         int32 instancedVertexCount;
         int32 materialCount;
         int32 lightCount;
+        int32 visibleInstanceCount;
+        int32 culledInstanceCount;
     };
 
     SceneUpdateFlags Update(RenderContext *ctx, float currentTime);
@@ -70,6 +73,56 @@ public:
         return cameraController;
     }
 
+    void SetCullingEnabled(bool enabled)
+    {
+        cullingEnabled = enabled;
+        cullingDirty = true;
+    }
+
+    bool IsCullingEnabled() const
+    {
+        return cullingEnabled;
+    }
+
+    // Culls the meshlets of visible instances against the frustum and their normal cones, and draws only the ranges left.
+    void SetMeshletCullingEnabled(bool enabled)
+    {
+        meshletCullingEnabled = enabled;
+        cullingDirty = true;
+    }
+
+    bool IsMeshletCullingEnabled() const
+    {
+        return meshletCullingEnabled;
+    }
+
+    const Array<Meshlet> &GetMeshlets(int32 meshID) const
+    {
+        return meshMeshlets[meshID];
+    }
+
+    // Largest error a level of detail may show, as a fraction of the screen height. 0 always draws the full meshes.
+    void SetLodScreenError(float error)
+    {
+        lodScreenError = error;
+        lodDirty = true;
+    }
+
+    float GetLodScreenError() const
+    {
+        return lodScreenError;
+    }
+
+    int32 GetMeshLodCount(int32 meshID) const
+    {
+        return meshLods[meshID].Count();
+    }
+
+    int32 GetMeshInstanceLod(int32 instanceID) const
+    {
+        return instanceLods[instanceID];
+    }
+
     const AABox &GetSceneBounds() const
     {
         return sceneBB;
@@ -80,6 +133,26 @@ public:
         return meshBBs[meshID];
     }
 
+    AABox GetMeshInstanceBounds(int32 instanceID) const
+    {
+        return instanceBBs.Get(instanceID);
+    }
+
+    const BVH &GetInstanceBVH() const
+    {
+        return instanceBVH;
+    }
+
+    // Nearest instance whose world bounds the ray hits, -1 if none.
+    int32 Pick(const Ray &ray, float *distance = nullptr) const;
+    void QueryInstances(const AABox &box, Array<int32> &instanceIDs) const;
+    void QueryInstances(const Frustum &frustum, Array<int32> &instanceIDs) const;
+
+    VertexFormat GetVertexFormat() const
+    {
+        return vertexFormat;
+    }
+
     int32 GetMeshCount() const
     {
         return meshDesces.Count();
@@ -141,6 +214,7 @@ private:
     void InitResources();
     void UploadResources();
     void UploadMaterial(int32 matID);
+    void UpdateInstanceMatrices();
     void UpdateMeshInstanceFlags();
     void UpdateBounds();
     bool UpdateCamera(bool force = false);
@@ -148,6 +222,12 @@ private:
     bool UpdateMaterials(bool force = false);
 
     void CreateDrawList();
+    void UploadDrawList();
+    void SelectLods();
+    void CullInstances();
+    void UpdateTextureCoverages();
+    void RequestTextures();
+    bool CullMeshlets(int32 instanceID, const Matrix4 &viewProj, const Vector3 &eye, Array<DrawIndexedIndirectArgs> &drawArgs) const;
     void Finalize();
 
 private:
@@ -159,6 +239,36 @@ private:
         SPtr<Buffer> buffer;
         int32 count = 0;
     } clockwiseDrawArgs, counterClockwiseDrawArgs;
+    // Subsets of the above that passed culling, rebuilt whenever the camera or the instances move.
+    DrawArgs visibleClockwiseDrawArgs, visibleCounterClockwiseDrawArgs;
+    Array<DrawIndexedIndirectArgs> instanceDrawArgs;
+    Array<DrawIndexedIndirectArgs> visibleDrawArgs;
+    // What one culling thread found in its subtree, draws are split by winding.
+    struct CullingResult
+    {
+        Array<int32> instances;
+        Array<DrawIndexedIndirectArgs> drawArgs[2];
+        Array<bool> visible;
+        int32 visibleInstanceCount = 0;
+    };
+    Array<int32> cullingRoots;
+    Array<CullingResult> cullingResults;
+    int32 visibleInstanceCount = 0;
+    bool cullingEnabled = true;
+    bool meshletCullingEnabled = true;
+    bool cullingDirty = true;
+    // Set when instanceDrawArgs changed after the complete lists were uploaded.
+    bool drawListDirty = false;
+
+    // Level of detail drawn by each instance, index into meshLods of its mesh.
+    Array<int32> instanceLods;
+    float lodScreenError = 0.001f;
+    bool lodDirty = true;
+
+    // Largest share of the screen height the uv range of each material spans on a visible instance, streamed textures are asked
+    // for that much.
+    Array<float> materialCoverages;
+    bool coveragesDirty = true;
 
     SPtr<Camera> camera;
     SPtr<CameraController> cameraController;
@@ -172,13 +282,25 @@ private:
     Array<SPtr<Material>> materials;
     Array<SPtr<Light>> lights;
 
+    VertexFormat vertexFormat = VertexFormat::Full;
     Array<MeshDesc> meshDesces;
+    // Levels of detail of each mesh, the first one is the full mesh.
+    Array<Array<MeshLodDesc>> meshLods;
+    // Meshlets of each mesh, index offsets are into the scene index buffer.
+    Array<Array<Meshlet>> meshMeshlets;
     Array<MeshInstanceData> meshInstanceDatas;
     Array<SceneNode> nodes;
     //Array<Array<int32>> meshGroups;
 
     Array<AABox> meshBBs;
     AABox sceneBB;
+    // Per instance, in meshInstanceDatas order.
+    Batch::Matrix4SoA instanceMatrices;
+    Batch::AABoxSoA instanceMeshBBs;
+    Batch::AABoxSoA instanceBBs;
+    Array<bool> instanceFlipped;
+    Array<int32> movedInstances;
+    BVH instanceBVH;
     Array<bool> meshHasDynamicDatas;
 
     SPtr<VertexArray> vao;
@@ -1,4 +1,61 @@
 #include "Render/SceneBuilder.h"
+#include "Math/Packing.h"
+#include "Core/Thread.h"
+#include <atomic>
+
+namespace
+{
+// Fewer vertices than this per thread are not worth a thread handoff.
+constexpr int32 ASSEMBLY_CHUNK_SIZE = 16384;
+
+// Bone indices of compact dynamic vertices are 8 bits.
+constexpr int32 MAX_PALETTE_BONES = 256;
+
+template <typename T>
+void AppendBytes(Array<uint8> &bytes, const T &value)
+{
+    int32 offset = bytes.Count();
+    bytes.AddUninitialized(sizeof(T));
+    std::memcpy(&bytes[offset], &value, sizeof(T));
+}
+
+// Value relative to a range, 0 when the range is empty.
+float Normalize(float value, float min, float max)
+{
+    return max > min ? (value - min) / (max - min) : 0.0f;
+}
+
+uint32 PackNormal(const Vector3 &normal)
+{
+    return Packing::PackSnorm2x16(Packing::EncodeOctahedral(normal));
+}
+
+// 0 is kept for a missing bitangent, the shaders decode it to zero.
+uint32 PackBitangent(const Vector3 &bitangent)
+{
+    if (bitangent.Length2() == 0.0f)
+        return 0;
+    uint32 packed = PackNormal(bitangent);
+    return packed == 0 ? 1 : packed;
+}
+
+// Rounded weights that still add up to the rounded total.
+uint32 PackBoneWeights(const Vector4 &weights)
+{
+    int32 quantized[4], sum = 0, largest = 0;
+    for (int32 i = 0; i < 4; ++i)
+    {
+        quantized[i] = (int32)Math::Round(Math::Clamp(weights[i], 0.0f, 1.0f) * 255.0f);
+        sum += quantized[i];
+        if (weights[i] > weights[largest])
+            largest = i;
+    }
+    float total = weights.x + weights.y + weights.z + weights.w;
+    quantized[largest] = Math::Clamp(quantized[largest] + (int32)Math::Round(Math::Clamp(total, 0.0f, 1.0f) * 255.0f) - sum, 0, 255);
+
+    return (uint32)quantized[0] | ((uint32)quantized[1] << 8) | ((uint32)quantized[2] << 16) | ((uint32)quantized[3] << 24);
+}
+}
 
 int32 SceneBuilder::AddNode(SceneNode node)
 {
@@ -31,9 +88,10 @@ int32 SceneBuilder::AddMesh(Mesh mesh)
     meshes.Add(MeshSpec());
     auto &spec = meshes.Last();
 
-    spec.indexOffset = buffersData.indices.Count();
-    spec.staticVertexOffset = buffersData.staticDatas.Count();
-    spec.dynamicVertexOffset = buffersData.dynamicDatas.Count();
+    // Only the ranges are taken here, AssembleBuffers converts the data of every pending mesh in parallel.
+    spec.indexOffset = totalIndexCount;
+    spec.staticVertexOffset = totalVertexCount;
+    spec.dynamicVertexOffset = totalDynamicVertexCount;
     spec.indexCount = mesh.indices.Count();
     spec.vertexCount = mesh.positions.Count();
     spec.topology = mesh.topology;
@@ -43,37 +101,101 @@ int32 SceneBuilder::AddMesh(Mesh mesh)
         spec.hasDynamicData = true;
     }
 
+    // Coarser levels follow the full mesh, they index the same vertices.
+    totalIndexCount += spec.indexCount;
+    spec.lods.Add({ spec.indexOffset, spec.indexCount, 0.0f });
+    for (const auto &lod : mesh.lods)
     {
-        buffersData.indices.Reserve(spec.indexCount);
-        buffersData.staticDatas.Reserve(spec.vertexCount);
-        buffersData.dynamicDatas.Reserve(spec.hasDynamicData ? spec.vertexCount : 0);
+        spec.lods.Add({ totalIndexCount, lod.indices.Count(), lod.error });
+        totalIndexCount += lod.indices.Count();
+    }
+    totalVertexCount += spec.vertexCount;
+    totalDynamicVertexCount += spec.hasDynamicData ? spec.vertexCount : 0;
 
-        for (auto e : mesh.indices)
-            buffersData.indices.Add(e);
+    pendingMeshes.Add(std::move(mesh));
+    dirty = true;
+    return meshes.Count() - 1;
+}
 
-        for (int32 i = 0; i < mesh.positions.Count(); ++i)
+void SceneBuilder::AssembleBuffers()
+{
+    if (pendingMeshes.IsEmpty())
+        return;
+
+    // The ranges of the meshes do not overlap, so every job writes its own part of the preallocated buffers.
+    buffersData.indices.AddUninitialized(totalIndexCount - buffersData.indices.Count());
+    buffersData.staticDatas.AddUninitialized(totalVertexCount - buffersData.staticDatas.Count());
+    buffersData.dynamicDatas.AddUninitialized(totalDynamicVertexCount - buffersData.dynamicDatas.Count());
+
+    // Mesh sizes vary a lot, so threads take the next mesh until none is left instead of a fixed share.
+    auto &pool = ThreadPool::GetGlobal();
+    int32 count = pendingMeshes.Count();
+    int32 firstMesh = meshes.Count() - count;
+    int32 vertexCount = totalVertexCount - meshes[firstMesh].staticVertexOffset;
+    int32 threadCount = Math::Min((vertexCount + ASSEMBLY_CHUNK_SIZE - 1) / ASSEMBLY_CHUNK_SIZE, count, static_cast<int32>(Thread::HardwareConcurrency()),
+                                  pool.GetAvailableCount() + 1);
+    threadCount = Math::Max(threadCount, 1);
+
+    std::atomic<int32> next{ 0 };
+    auto Assemble = [this, &next, count, firstMesh]() {
+        for (int32 i = next++; i < count; i = next++)
         {
-            StaticVertexData s;
-            s.position = mesh.positions[i];
-            s.normal = mesh.normals[i];
-            s.uv = mesh.uvs[i];
-            s.bitangent = mesh.bitangents[i];
+            AssembleMesh(meshes[firstMesh + i], pendingMeshes[i]);
+            pendingMeshes[i] = Mesh();
+        }
+    };
 
-            buffersData.staticDatas.Add(std::move(s));
+    Array<ThreadPool::Handle> handles;
+    for (int32 i = 1; i < threadCount; ++i)
+    {
+        handles.Add(pool.Run(CT_TEXT("SceneBuilder"), [&Assemble]() { Assemble(); }));
+    }
+    Assemble();
+    for (auto &handle : handles)
+        handle.Wait();
 
-            if (spec.hasDynamicData)
-            {
-                DynamicVertexData d;
-                d.boneID = mesh.boneIDs[i];
-                d.boneWeight = mesh.boneWeights[i];
-                d.staticIndex = buffersData.staticDatas.Count() - 1;
-                buffersData.dynamicDatas.Add(std::move(d));
-            }
-        }
+    pendingMeshes.Clear();
+}
+
+void SceneBuilder::AssembleMesh(MeshSpec &spec, const Mesh &mesh)
+{
+    std::memcpy(&buffersData.indices[spec.indexOffset], mesh.indices.GetData(), sizeof(uint32) * spec.indexCount);
+    for (int32 i = 0; i < mesh.lods.Count(); ++i)
+    {
+        const auto &lod = mesh.lods[i];
+        std::memcpy(&buffersData.indices[spec.lods[i + 1].indexOffset], lod.indices.GetData(), sizeof(uint32) * lod.indices.Count());
     }
 
-    dirty = true;
-    return meshes.Count() - 1;
+    spec.meshlets.Reserve(mesh.meshlets.Count());
+    for (auto meshlet : mesh.meshlets)
+    {
+        meshlet.indexOffset += spec.indexOffset;
+        spec.meshlets.Add(meshlet);
+    }
+
+    spec.bounds = AABox(mesh.positions[0], mesh.positions[0]);
+    spec.uvMin = spec.uvMax = mesh.uvs[0];
+    for (int32 i = 0; i < spec.vertexCount; ++i)
+    {
+        spec.bounds.min = Vector3::Min(spec.bounds.min, mesh.positions[i]);
+        spec.bounds.max = Vector3::Max(spec.bounds.max, mesh.positions[i]);
+        spec.uvMin = Vector2::Min(spec.uvMin, mesh.uvs[i]);
+        spec.uvMax = Vector2::Max(spec.uvMax, mesh.uvs[i]);
+
+        auto &s = buffersData.staticDatas[spec.staticVertexOffset + i];
+        s.position = mesh.positions[i];
+        s.normal = mesh.normals[i];
+        s.uv = mesh.uvs[i];
+        s.bitangent = mesh.bitangents[i];
+
+        if (spec.hasDynamicData)
+        {
+            auto &d = buffersData.dynamicDatas[spec.dynamicVertexOffset + i];
+            d.boneID = mesh.boneIDs[i];
+            d.boneWeight = mesh.boneWeights[i];
+            d.staticIndex = spec.staticVertexOffset + i;
+        }
+    }
 }
 
 void SceneBuilder::AddMeshInstance(int32 nodeID, int32 meshID)
@@ -89,6 +211,12 @@ void SceneBuilder::SetCamera(const SPtr<Camera> &newCamera)
     dirty = true;
 }
 
+void SceneBuilder::SetVertexFormat(VertexFormat format)
+{
+    vertexFormat = format;
+    dirty = true;
+}
+
 int32 SceneBuilder::AddLight(const SPtr<Light> &light)
 {
     lights.Add(light);
@@ -105,10 +233,11 @@ int32 SceneBuilder::AddAnimation(int32 meshID, const SPtr<Animation> &anim)
 
 SPtr<VertexArray> SceneBuilder::CreateVao(int32 drawCount)
 {
-    const auto vertexCount = buffersData.staticDatas.Count();
+    const auto vertexCount = packedBuffers.vertexCount;
     const auto indexCount = buffersData.indices.Count();
+    const auto staticStride = packedBuffers.GetStaticStride();
     uint64 ibSize = sizeof(uint32) * indexCount;
-    uint64 staticVbSize = sizeof(StaticVertexData) * vertexCount;
+    uint64 staticVbSize = (uint64)staticStride * vertexCount;
     CT_CHECK(ibSize <= UINT32_MAX);
     CT_CHECK(staticVbSize <= UINT32_MAX);
 
@@ -116,10 +245,10 @@ SPtr<VertexArray> SceneBuilder::CreateVao(int32 drawCount)
     auto ibo = Buffer::Create((uint32)ibSize, ibBindFlags, BufferCpuAccess::None, buffersData.indices.GetData());
 
     ResourceBindFlags vbBindFlags = ResourceBind::Vertex | ResourceBind::ShaderResource | ResourceBind::UnorderedAccess;
-    auto staticVbo = Buffer::CreateStructured(sizeof(StaticVertexData), vertexCount, vbBindFlags, BufferCpuAccess::None, nullptr, false);
+    auto staticVbo = Buffer::CreateStructured(staticStride, vertexCount, vbBindFlags, BufferCpuAccess::None, nullptr, false);
     auto prevVbo = Buffer::CreateStructured(sizeof(PrevVertexData), vertexCount, vbBindFlags, BufferCpuAccess::None, nullptr, false);
 
-    staticVbo->SetBlob(buffersData.staticDatas.GetData(), 0, staticVbo->GetSize());
+    staticVbo->SetBlob(packedBuffers.staticDatas.GetData(), 0, staticVbo->GetSize());
 
     Array<PrevVertexData> prevVertexDatas;
     prevVertexDatas.AddUninitialized(vertexCount);
@@ -137,11 +266,32 @@ SPtr<VertexArray> SceneBuilder::CreateVao(int32 drawCount)
     }
     auto instVbo = Buffer::Create(drawCount * sizeof(int32), ResourceBind::Vertex, BufferCpuAccess::None, instanceIDs.GetData());
 
-    auto staticLayout = VertexBufferLayout::Create(
-        { { 0, CT_TEXT("inPos"), ResourceFormat::RGB32Float },
-          { 1, CT_TEXT("inNormal"), ResourceFormat::RGB32Float },
-          { 2, CT_TEXT("inBitangent"), ResourceFormat::RGB32Float },
-          { 3, CT_TEXT("inUV"), ResourceFormat::RG32Float } });
+    // Compact attributes are expanded by their formats, RasterVS decodes the rest.
+    SPtr<VertexBufferLayout> staticLayout;
+    switch (packedBuffers.format)
+    {
+    case VertexFormat::Compact:
+        staticLayout = VertexBufferLayout::Create(
+            { { 0, CT_TEXT("inPos"), ResourceFormat::RGB32Float },
+              { 1, CT_TEXT("inNormal"), ResourceFormat::RG16Snorm },
+              { 2, CT_TEXT("inBitangent"), ResourceFormat::RG16Snorm },
+              { 3, CT_TEXT("inUV"), ResourceFormat::RG16Unorm } });
+        break;
+    case VertexFormat::Quantized:
+        staticLayout = VertexBufferLayout::Create(
+            { { 0, CT_TEXT("inPos"), ResourceFormat::RGBA16Unorm },
+              { 1, CT_TEXT("inNormal"), ResourceFormat::RG16Snorm },
+              { 2, CT_TEXT("inBitangent"), ResourceFormat::RG16Snorm },
+              { 3, CT_TEXT("inUV"), ResourceFormat::RG16Unorm } });
+        break;
+    default:
+        staticLayout = VertexBufferLayout::Create(
+            { { 0, CT_TEXT("inPos"), ResourceFormat::RGB32Float },
+              { 1, CT_TEXT("inNormal"), ResourceFormat::RGB32Float },
+              { 2, CT_TEXT("inBitangent"), ResourceFormat::RGB32Float },
+              { 3, CT_TEXT("inUV"), ResourceFormat::RG32Float } });
+        break;
+    }
     auto instLayout = VertexBufferLayout::Create(
         { { 4, CT_TEXT("inMeshInstanceID"), ResourceFormat::R32Int } }, true);
     auto prevLayout = VertexBufferLayout::Create(
@@ -174,6 +324,8 @@ int32 SceneBuilder::CreateMeshData(Scene *scene)
 
     scene->meshDesces.Reserve(meshes.Count());
     scene->meshHasDynamicDatas.Reserve(meshes.Count());
+    scene->meshLods.Reserve(meshes.Count());
+    scene->meshMeshlets.Reserve(meshes.Count());
     for (int32 i = 0; i < meshes.Count(); ++i)
     {
         scene->meshDesces.Add(MeshDesc());
@@ -185,6 +337,10 @@ int32 SceneBuilder::CreateMeshData(Scene *scene)
         desc.indexOffset = mesh.indexOffset;
         desc.vertexCount = mesh.vertexCount;
         desc.indexCount = mesh.indexCount;
+        desc.positionMin = mesh.bounds.min;
+        desc.positionScale = mesh.bounds.max - mesh.bounds.min;
+        desc.uvMin = mesh.uvMin;
+        desc.uvScale = mesh.uvMax - mesh.uvMin;
 
         drawCount += mesh.instances.Count();
 
@@ -200,6 +356,8 @@ int32 SceneBuilder::CreateMeshData(Scene *scene)
         }
 
         scene->meshHasDynamicDatas.Add(mesh.hasDynamicData);
+        scene->meshLods.Add(mesh.lods);
+        scene->meshMeshlets.Add(mesh.meshlets);
         if (mesh.hasDynamicData)
         {
             CT_CHECK(mesh.instances.Count() == 1);
@@ -216,27 +374,137 @@ int32 SceneBuilder::CreateMeshData(Scene *scene)
 void SceneBuilder::CreateMeshBoundingBoxes(Scene *scene)
 {
     scene->meshBBs.Reserve(meshes.Count());
-    for (int32 i = 0; i < meshes.Count(); ++i)
+    for (const auto &mesh : meshes)
+        scene->meshBBs.Add(mesh.bounds);
+}
+
+VertexFormat SceneBuilder::PackVertices(VertexFormat format)
+{
+    auto &packed = packedBuffers;
+    packed.staticDatas.Clear();
+    packed.dynamicDatas.Clear();
+    packed.bonePalette.Clear();
+    packed.vertexCount = buffersData.staticDatas.Count();
+    packed.dynamicVertexCount = buffersData.dynamicDatas.Count();
+
+    bool skinned = !buffersData.dynamicDatas.IsEmpty();
+    if (format == VertexFormat::Quantized && skinned)
     {
-        const auto &mesh = meshes[i];
-        int32 vertexOffset = mesh.staticVertexOffset;
-        int32 vertexCount = mesh.vertexCount;
+        CT_LOG(Warning, CT_TEXT("Skinned positions leave the mesh bounds, the scene uses compact vertices without quantized positions."));
+        format = VertexFormat::Compact;
+    }
+
+    // Bone palettes of the skinned meshes, localBones maps a bone matrix ID to its index in the palette of the current mesh.
+    Array<int32> localBones, paletteOffsets;
+    if (format != VertexFormat::Full && skinned)
+    {
+        localBones.SetCount(nodes.Count());
+        for (auto &e : localBones)
+            e = -1;
+        paletteOffsets.SetCount(meshes.Count());
 
-        Vector3 min(buffersData.staticDatas[vertexOffset].position);
-        Vector3 max = min;
-        for (int32 v = 1; v < vertexCount; ++v)
+        for (int32 m = 0; m < meshes.Count() && format != VertexFormat::Full; ++m)
         {
-            min = Vector3::Min(min, buffersData.staticDatas[vertexOffset + v].position);
-            max = Vector3::Max(max, buffersData.staticDatas[vertexOffset + v].position);
+            const auto &mesh = meshes[m];
+            paletteOffsets[m] = packed.bonePalette.Count();
+            if (!mesh.hasDynamicData)
+                continue;
+
+            for (int32 v = 0; v < mesh.vertexCount; ++v)
+            {
+                const auto &d = buffersData.dynamicDatas[mesh.dynamicVertexOffset + v];
+                for (int32 i = 0; i < 4; ++i)
+                {
+                    int32 bone = d.boneID[i];
+                    if (localBones[bone] >= 0)
+                        continue;
+                    localBones[bone] = packed.bonePalette.Count() - paletteOffsets[m];
+                    packed.bonePalette.Add(bone);
+                }
+            }
+            for (int32 i = paletteOffsets[m]; i < packed.bonePalette.Count(); ++i)
+                localBones[packed.bonePalette[i]] = -1;
+
+            if (packed.bonePalette.Count() - paletteOffsets[m] > MAX_PALETTE_BONES)
+            {
+                CT_LOG(Warning, CT_TEXT("A skinned mesh uses more than {0} bones, the scene uses full vertices."), MAX_PALETTE_BONES);
+                format = VertexFormat::Full;
+            }
         }
-        scene->meshBBs.Add(AABox(min, max));
     }
+    packed.format = format;
+
+    if (format == VertexFormat::Full)
+    {
+        packed.bonePalette.Clear();
+        packed.staticDatas.SetCount(packed.vertexCount * sizeof(StaticVertexData));
+        std::memcpy(packed.staticDatas.GetData(), buffersData.staticDatas.GetData(), packed.staticDatas.Count());
+        packed.dynamicDatas.SetCount(packed.dynamicVertexCount * sizeof(DynamicVertexData));
+        std::memcpy(packed.dynamicDatas.GetData(), buffersData.dynamicDatas.GetData(), packed.dynamicDatas.Count());
+        return format;
+    }
+
+    packed.staticDatas.Reserve(packed.vertexCount * packed.GetStaticStride());
+    packed.dynamicDatas.Reserve(packed.dynamicVertexCount * packed.GetDynamicStride());
+    for (int32 m = 0; m < meshes.Count(); ++m)
+    {
+        const auto &mesh = meshes[m];
+        const auto &min = mesh.bounds.min;
+        const auto &max = mesh.bounds.max;
+        for (int32 v = 0; v < mesh.vertexCount; ++v)
+        {
+            const auto &s = buffersData.staticDatas[mesh.staticVertexOffset + v];
+            uint32 normal = PackNormal(s.normal);
+            uint32 bitangent = PackBitangent(s.bitangent);
+            uint32 uv = Packing::PackUnorm2x16(Vector2(Normalize(s.uv.x, mesh.uvMin.x, mesh.uvMax.x), Normalize(s.uv.y, mesh.uvMin.y, mesh.uvMax.y)));
+
+            if (format == VertexFormat::Compact)
+            {
+                CompactVertexData c = { { s.position.x, s.position.y, s.position.z }, normal, bitangent, uv };
+                AppendBytes(packed.staticDatas, c);
+            }
+            else
+            {
+                Vector2 xy(Normalize(s.position.x, min.x, max.x), Normalize(s.position.y, min.y, max.y));
+                Vector2 z(Normalize(s.position.z, min.z, max.z), 0.0f);
+                QuantizedVertexData q = { { Packing::PackUnorm2x16(xy), Packing::PackUnorm2x16(z) }, normal, bitangent, uv };
+                AppendBytes(packed.staticDatas, q);
+            }
+        }
+
+        if (!mesh.hasDynamicData)
+            continue;
+
+        int32 paletteOffset = paletteOffsets[m];
+        int32 paletteCount = (m + 1 < meshes.Count() ? paletteOffsets[m + 1] : packed.bonePalette.Count()) - paletteOffset;
+        for (int32 i = 0; i < paletteCount; ++i)
+            localBones[packed.bonePalette[paletteOffset + i]] = i;
+
+        for (int32 v = 0; v < mesh.vertexCount; ++v)
+        {
+            const auto &d = buffersData.dynamicDatas[mesh.dynamicVertexOffset + v];
+            CompactDynamicVertexData c;
+            c.boneIDs = 0;
+            for (int32 i = 0; i < 4; ++i)
+                c.boneIDs |= (uint32)localBones[d.boneID[i]] << (i * 8);
+            c.boneWeights = PackBoneWeights(d.boneWeight);
+            c.paletteOffset = paletteOffset;
+            c.staticIndex = d.staticIndex;
+            c.globalMatrixID = d.globalMatrixID;
+            AppendBytes(packed.dynamicDatas, c);
+        }
+
+        for (int32 i = 0; i < paletteCount; ++i)
+            localBones[packed.bonePalette[paletteOffset + i]] = -1;
+    }
+
+    return format;
 }
 
 void SceneBuilder::CreateAnimationController(Scene *scene)
 {
     scene->animationController = AnimationController::Create(scene);
-    scene->animationController->CreateSkinningPass(buffersData.staticDatas, buffersData.dynamicDatas);
+    scene->animationController->CreateSkinningPass(packedBuffers);
     for (int32 i = 0; i < meshes.Count(); ++i)
     {
         for (const auto &anim : meshes[i].animations)
@@ -280,8 +548,10 @@ SPtr<Scene> SceneBuilder::GetScene()
     }
     // TODO lightProbe, envMap
 
+    AssembleBuffers();
     CreateSceneGraph(scene.get());
     int32 drawCount = CreateMeshData(scene.get());
+    scene->vertexFormat = PackVertices(vertexFormat);
     scene->vao = CreateVao(drawCount);
     CreateMeshBoundingBoxes(scene.get());
     CreateAnimationController(scene.get());
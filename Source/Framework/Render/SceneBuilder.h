@@ -14,9 +14,14 @@ public:
         int32 dynamicVertexOffset = 0;
         int32 indexCount = 0;
         int32 vertexCount = 0;
+        AABox bounds;
+        Vector2 uvMin;
+        Vector2 uvMax;
         bool hasDynamicData = false;
         Array<int32> instances;
         Array<SPtr<Animation>> animations;
+        Array<MeshLodDesc> lods;
+        Array<Meshlet> meshlets;
     };
 
     struct BuffersData
@@ -31,16 +36,23 @@ public:
     int32 AddMesh(Mesh mesh);
     void AddMeshInstance(int32 nodeID, int32 meshID);
     void SetCamera(const SPtr<Camera> &newCamera);
+    // Compact formats fall back when the scene can not use them, see PackVertices.
+    void SetVertexFormat(VertexFormat format);
     int32 AddLight(const SPtr<Light> &light);
     int32 AddAnimation(int32 meshID, const SPtr<Animation> &anim);
 
     SPtr<Scene> GetScene();
 
 private:
+    friend class SceneCache;
+
     int32 AddMaterial(const SPtr<Material> &material);
+    void AssembleBuffers();
+    void AssembleMesh(MeshSpec &spec, const Mesh &mesh);
     SPtr<VertexArray> CreateVao(int32 drawCount);
     void CreateSceneGraph(Scene *scene);
     int32 CreateMeshData(Scene *scene);
+    VertexFormat PackVertices(VertexFormat format);
     void CreateMeshBoundingBoxes(Scene *scene);
     void CreateAnimationController(Scene *scene);
 
@@ -53,7 +65,14 @@ private:
 
     SPtr<Scene> scene;
 
+    // Meshes added since the last GetScene, their data moves into buffersData at the given offsets.
+    Array<Mesh> pendingMeshes;
+    int32 totalIndexCount = 0;
+    int32 totalVertexCount = 0;
+    int32 totalDynamicVertexCount = 0;
     BuffersData buffersData{};
+    PackedVertexBuffers packedBuffers;
+    VertexFormat vertexFormat = VertexFormat::Full;
 
     bool dirty = true;
 };
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "Render/TextureAtlas.h"
+
+TextureAtlas::TextureAtlas(int32 width, int32 height, int32 padding)
+    : width(width), height(height), padding(padding)
+{
+    CT_CHECK(width > 0 && height > 0 && padding >= 0);
+    Clear();
+}
+
+void TextureAtlas::Clear()
+{
+    // Regions reserve their padding on the right and bottom, which may hang over the border.
+    skyline.Clear();
+    skyline.Add({ 0, 0, width + padding });
+    usedArea = 0;
+}
+
+int32 TextureAtlas::GetFitY(int32 index, int32 regionWidth, int32 regionHeight) const
+{
+    if (skyline[index].x + regionWidth > width + padding)
+        return -1;
+
+    int32 y = 0;
+    for (int32 remaining = regionWidth; remaining > 0; remaining -= skyline[index].width, ++index)
+    {
+        y = Math::Max(y, skyline[index].y);
+        if (y + regionHeight > height + padding)
+            return -1;
+    }
+    return y;
+}
+
+bool TextureAtlas::AddRegion(int32 regionWidth, int32 regionHeight, Region &region)
+{
+    region = { 0, 0, regionWidth, regionHeight };
+    // Empty regions, like the glyph of a space, take no room.
+    if (regionWidth <= 0 || regionHeight <= 0)
+        return true;
+
+    int32 w = regionWidth + padding;
+    int32 h = regionHeight + padding;
+    int32 bestIndex = -1;
+    int32 bestBottom = INT32_MAX;
+    int32 bestWidth = INT32_MAX;
+    for (int32 i = 0; i < skyline.Count(); ++i)
+    {
+        int32 y = GetFitY(i, w, h);
+        if (y < 0)
+            continue;
+        if (y + h < bestBottom || (y + h == bestBottom && skyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestBottom = y + h;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (bestIndex < 0)
+        return false;
+
+    region.x = skyline[bestIndex].x;
+    region.y = bestBottom - h;
+    skyline.Insert(bestIndex, { region.x, bestBottom, w });
+
+    // Nodes under the new one are cut back or dropped.
+    for (int32 i = bestIndex + 1; i < skyline.Count();)
+    {
+        int32 covered = skyline[i - 1].x + skyline[i - 1].width - skyline[i].x;
+        if (covered <= 0)
+            break;
+        if (covered < skyline[i].width)
+        {
+            skyline[i].x += covered;
+            skyline[i].width -= covered;
+            break;
+        }
+        skyline.RemoveAt(i);
+    }
+    for (int32 i = 1; i < skyline.Count();)
+    {
+        if (skyline[i - 1].y == skyline[i].y)
+        {
+            skyline[i - 1].width += skyline[i].width;
+            skyline.RemoveAt(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    usedArea += static_cast<int64>(regionWidth) * regionHeight;
+    return true;
+}
+
+bool TextureAtlas::AddRegions(const Array<Vector2I> &sizes, Array<Region> &regions)
+{
+    Array<int32> order;
+    order.Reserve(sizes.Count());
+    for (int32 i = 0; i < sizes.Count(); ++i)
+        order.Add(i);
+    order.Sort([&](int32 a, int32 b) { return sizes[a].y > sizes[b].y || (sizes[a].y == sizes[b].y && (sizes[a].x > sizes[b].x || (sizes[a].x == sizes[b].x && a < b))); });
+
+    auto savedSkyline = skyline;
+    int64 savedArea = usedArea;
+    regions.SetCount(sizes.Count());
+    for (int32 i : order)
+    {
+        if (!AddRegion(sizes[i].x, sizes[i].y, regions[i]))
+        {
+            skyline = std::move(savedSkyline);
+            usedArea = savedArea;
+            return false;
+        }
+    }
+    return true;
+}
+
+float TextureAtlas::GetOccupancy() const
+{
+    return static_cast<float>(static_cast<double>(usedArea) / (static_cast<int64>(width) * height));
+}
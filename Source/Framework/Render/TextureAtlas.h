@@ -1,9 +1,59 @@
 #pragma once
 
-#include "Render/TextureRegion.h"
+#include "Math/IntVector.h"
+#include "Render/.Package.h"
 
+/**
+ * Skyline rectangle packer. A region goes where it reaches the least far down, ties go to the narrowest span of the skyline.
+ * Positions are top left corners with rows going down, like Pixmap rows. Regions keep padding texels between each other.
+ */
 class TextureAtlas
 {
 public:
-    void AddRegion(const TextureRegion &region);
-};
\ No newline at end of file
+    struct Region
+    {
+        int32 x = 0;
+        int32 y = 0;
+        int32 width = 0;
+        int32 height = 0;
+    };
+
+    TextureAtlas(int32 width, int32 height, int32 padding = 1);
+
+    // False when the region does not fit anymore.
+    bool AddRegion(int32 regionWidth, int32 regionHeight, Region &region);
+    // Adds the sizes tallest first, which packs much tighter than arrival order. regions is parallel to sizes.
+    // Fails without changing the atlas when one of them does not fit.
+    bool AddRegions(const Array<Vector2I> &sizes, Array<Region> &regions);
+    void Clear();
+
+    // Share of the atlas covered by regions, padding excluded.
+    float GetOccupancy() const;
+
+    int32 GetWidth() const
+    {
+        return width;
+    }
+
+    int32 GetHeight() const
+    {
+        return height;
+    }
+
+private:
+    struct SkylineNode
+    {
+        int32 x;
+        int32 y;
+        int32 width;
+    };
+
+    // Top of the skyline under [x, x + regionWidth) starting at node index, -1 when the region does not fit there.
+    int32 GetFitY(int32 index, int32 regionWidth, int32 regionHeight) const;
+
+    int32 width;
+    int32 height;
+    int32 padding;
+    int64 usedArea = 0;
+    Array<SkylineNode> skyline;
+};
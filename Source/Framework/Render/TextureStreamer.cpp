@@ -0,0 +1,322 @@
+#include "Render/TextureStreamer.h"
+#include "IO/FileHandle.h"
+#include "Render/RenderManager.h"
+#include <algorithm>
+
+TextureStreamer textureStreamer;
+TextureStreamer *gTextureStreamer = &textureStreamer;
+
+void TextureStreamer::Startup()
+{
+}
+
+void TextureStreamer::Shutdown()
+{
+    // Reads in flight still post their completions.
+    IO::AsyncIOService::GetGlobal().WaitIdle();
+
+    std::unique_lock<std::mutex> lock(entriesMutex);
+    std::unique_lock<std::mutex> completionsLock(completionsMutex);
+    entries.Clear();
+    entryIndices.Clear();
+    completions.Clear();
+    residentBytes = 0;
+    pendingBytes = 0;
+}
+
+void TextureStreamer::Tick()
+{
+    Array<Completion> arrived;
+    {
+        std::unique_lock<std::mutex> lock(completionsMutex);
+        std::swap(arrived, completions);
+    }
+
+    const auto &target = gRenderManager->GetTargetFrameBuffer();
+    if (target)
+        screenHeight = target->GetHeight();
+
+    std::unique_lock<std::mutex> lock(entriesMutex);
+    Upload(arrived);
+    RemoveUnused();
+    SelectTargets();
+    IssueReads();
+    ++frame;
+}
+
+bool TextureStreamer::Add(const APtr<Texture> &texture, const String &path, uint64 key)
+{
+    CT_CHECK(texture.GetData() != nullptr);
+
+    // Only the headers are read here, the levels come with the next tick.
+    IO::FileHandle file(path);
+    Array<uint8> header = file.ReadRange(0, TextureCooker::GetHeaderSize());
+    if (header.Count() != static_cast<int32>(TextureCooker::GetHeaderSize()))
+        return false;
+
+    Entry entry;
+    if (!TextureCooker::ReadHeader(header, key, entry.image))
+        return false;
+    // A file cut short would only fail once its finest levels are asked for.
+    if (file.GetSize() != TextureCooker::GetHeaderSize() + TextureCooker::GetMipOffset(entry.image, entry.image.mipLevels))
+        return false;
+
+    entry.asset = texture;
+    entry.path = path;
+    entry.tailBytes.SetCount(entry.image.mipLevels + 1);
+    entry.tailBytes[entry.image.mipLevels] = 0;
+    for (int32 mip = entry.image.mipLevels - 1; mip >= 0; --mip)
+        entry.tailBytes[mip] = entry.tailBytes[mip + 1] + TextureCooker::GetMipSize(entry.image, mip);
+
+    std::unique_lock<std::mutex> lock(entriesMutex);
+    if (entryIndices.Contains(texture.GetData().get()))
+        return true;
+
+    entry.tailMip = GetTailMip(entry.image);
+    entry.targetMip = entry.tailMip;
+    entryIndices.Put(texture.GetData().get(), entries.Count());
+    entries.Add(std::move(entry));
+    return true;
+}
+
+void TextureStreamer::RequestCoverage(const APtr<Texture> &texture, float coverage)
+{
+    if (!texture.GetData())
+        return;
+
+    std::unique_lock<std::mutex> lock(entriesMutex);
+    auto index = entryIndices.TryGet(texture.GetData().get());
+    if (!index)
+        return;
+
+    auto &entry = entries[*index];
+    if (entry.requestFrame != frame)
+    {
+        entry.requestFrame = frame;
+        entry.requestedCoverage = coverage;
+    }
+    else
+    {
+        entry.requestedCoverage = Math::Max(entry.requestedCoverage, coverage);
+    }
+}
+
+void TextureStreamer::SetSettings(const Settings &newSettings)
+{
+    std::unique_lock<std::mutex> lock(entriesMutex);
+    settings = newSettings;
+    // Textures whose tail grew load the new levels with the next tick.
+    for (auto &entry : entries)
+        entry.tailMip = GetTailMip(entry.image);
+}
+
+int32 TextureStreamer::GetTailMip(const TextureCooker::Image &image) const
+{
+    int32 mip = 0;
+    while (mip + 1 < image.mipLevels && Math::Max(image.width >> mip, image.height >> mip) > settings.tailSize)
+        ++mip;
+    return mip;
+}
+
+bool TextureStreamer::IsStale(const Entry &entry) const
+{
+    return entry.requestFrame < 0 || frame - entry.requestFrame > settings.keepFrames;
+}
+
+int32 TextureStreamer::GetWantedMip(const Entry &entry) const
+{
+    float texels = entry.requestedCoverage * screenHeight;
+    if (IsStale(entry) || texels <= 0.0f)
+        return entry.tailMip;
+
+    // Every level halves the texels, the coarsest one still giving a texel per pixel is enough.
+    float size = static_cast<float>(Math::Max(entry.image.width, entry.image.height));
+    int32 mip = Math::FloorToInt(Math::Log2(size / texels));
+    return Math::Clamp(mip, 0, entry.tailMip);
+}
+
+void TextureStreamer::Upload(Array<Completion> &arrived)
+{
+    for (auto &completion : arrived)
+    {
+        pendingBytes -= completion.size;
+        auto index = entryIndices.TryGet(completion.data);
+        if (!index)
+            continue;
+
+        auto &entry = entries[*index];
+        entry.pendingMip = -1;
+        if (!completion.success || static_cast<uint64>(completion.bytes.Count()) != completion.size)
+        {
+            CT_LOG(Warning, CT_TEXT("Stream texture failed, it keeps the levels it has. Path: {0}."), entry.path);
+            entry.failed = true;
+            // Without any level the texture never loads, the next import tries again.
+            if (entry.residentMip < 0)
+                entry.asset.GetData()->failed = true;
+            continue;
+        }
+
+        // Nothing else changes the levels of a texture while its read is in flight.
+        CT_CHECK(completion.keptMip == (entry.residentMip >= 0 ? entry.residentMip : entry.image.mipLevels));
+        Replace(entry, completion.mip, completion.keptMip, completion.bytes.GetData());
+    }
+}
+
+void TextureStreamer::Replace(Entry &entry, int32 mip, int32 keptMip, const uint8 *data)
+{
+    // The levels are tightly packed like the file stores them, the new texture starts at mip.
+    const auto &image = entry.image;
+    int32 width = Math::Max(image.width >> mip, 1);
+    int32 height = Math::Max(image.height >> mip, 1);
+    SPtr<Texture> texture;
+    if (keptMip == image.mipLevels)
+    {
+        texture = Texture::Create2D(width, height, image.format, 1, image.mipLevels - mip, data);
+    }
+    else
+    {
+        const auto &resident = entry.asset.GetData()->ptr;
+        texture = Texture::Create2D(width, height, image.format, 1, image.mipLevels - mip);
+        auto context = gRenderManager->GetRenderContext();
+        if (keptMip > mip)
+            context->UpdateSubresources(texture.get(), 0, keptMip - mip, data);
+        for (int32 level = keptMip; level < image.mipLevels; ++level)
+            context->CopySubresource(texture.get(), texture->GetSubresourceIndex(0, level - mip), resident.get(), resident->GetSubresourceIndex(0, level - entry.residentMip));
+    }
+
+    if (entry.residentMip >= 0)
+        residentBytes -= entry.tailBytes[entry.residentMip];
+    residentBytes += entry.tailBytes[mip];
+    entry.residentMip = mip;
+    entry.asset.GetData()->ptr = texture;
+}
+
+void TextureStreamer::RemoveUnused()
+{
+    for (int32 i = entries.Count() - 1; i >= 0; --i)
+    {
+        // Entries with a read in flight stay, the address of their asset must not be taken by another one until it lands.
+        auto &entry = entries[i];
+        if (entry.asset.GetData().use_count() > 1 || entry.pendingMip >= 0)
+            continue;
+
+        if (entry.residentMip >= 0)
+            residentBytes -= entry.tailBytes[entry.residentMip];
+        entryIndices.Remove(entry.asset.GetData().get());
+        if (i != entries.Count() - 1)
+        {
+            entries[i] = std::move(entries.Last());
+            entryIndices.Put(entries[i].asset.GetData().get(), i);
+        }
+        entries.RemoveLast();
+    }
+}
+
+void TextureStreamer::SelectTargets()
+{
+    for (auto &entry : entries)
+        entry.targetMip = GetWantedMip(entry);
+
+    // The smallest bias that fits the budget, tails are resident whatever it costs.
+    for (int32 bias = 0;; ++bias)
+    {
+        uint64 total = 0;
+        bool allTails = true;
+        for (const auto &entry : entries)
+        {
+            int32 mip = Math::Min(entry.targetMip + bias, entry.tailMip);
+            total += entry.tailBytes[mip];
+            allTails = allTails && mip == entry.tailMip;
+        }
+
+        if (total <= settings.memoryBudget || allTails)
+        {
+            if (bias > 0)
+            {
+                for (auto &entry : entries)
+                    entry.targetMip = Math::Min(entry.targetMip + bias, entry.tailMip);
+            }
+            break;
+        }
+    }
+}
+
+void TextureStreamer::IssueReads()
+{
+    // Memory taken once every read in flight has landed.
+    uint64 committed = residentBytes;
+    Array<int32> upgrades, drops;
+    for (int32 i = 0; i < entries.Count(); ++i)
+    {
+        const auto &entry = entries[i];
+        if (entry.pendingMip >= 0)
+        {
+            committed += entry.tailBytes[entry.pendingMip] - (entry.residentMip >= 0 ? entry.tailBytes[entry.residentMip] : 0);
+            continue;
+        }
+        if (entry.failed)
+            continue;
+
+        if (entry.residentMip < 0 || entry.targetMip < entry.residentMip)
+            upgrades.Add(i);
+        else if (entry.targetMip > entry.residentMip)
+            drops.Add(i);
+    }
+
+    auto CanRead = [this](uint64 size) { return pendingBytes == 0 || pendingBytes + size <= settings.readBudget; };
+
+    // Tails first so every texture shows up, then the largest gains in resolution.
+    std::sort(upgrades.begin(), upgrades.end(), [this](int32 a, int32 b) {
+        const auto &lhs = entries[a];
+        const auto &rhs = entries[b];
+        if ((lhs.residentMip < 0) != (rhs.residentMip < 0))
+            return lhs.residentMip < 0;
+        return lhs.residentMip - lhs.targetMip > rhs.residentMip - rhs.targetMip;
+    });
+
+    bool outOfMemory = false;
+    for (int32 i : upgrades)
+    {
+        auto &entry = entries[i];
+        int32 mip = entry.residentMip < 0 ? Math::Max(entry.targetMip, entry.tailMip) : entry.targetMip;
+        // Only the gained levels are read, which is also the growth.
+        uint64 growth = entry.tailBytes[mip] - (entry.residentMip >= 0 ? entry.tailBytes[entry.residentMip] : 0);
+        if (entry.residentMip >= 0 && committed + growth > settings.memoryBudget)
+        {
+            outOfMemory = true;
+            continue;
+        }
+        if (!CanRead(growth))
+            break;
+
+        Read(entry, mip);
+        committed += growth;
+    }
+
+    // Levels are only dropped when nothing asked for them lately or the memory is needed. The kept ones are all resident already.
+    for (int32 i : drops)
+    {
+        auto &entry = entries[i];
+        if (!IsStale(entry) && !outOfMemory && committed <= settings.memoryBudget)
+            continue;
+
+        committed -= entry.tailBytes[entry.residentMip] - entry.tailBytes[entry.targetMip];
+        Replace(entry, entry.targetMip, entry.targetMip, nullptr);
+    }
+}
+
+void TextureStreamer::Read(Entry &entry, int32 mip)
+{
+    // Levels already resident are copied on the GPU once the read lands, the file holds the others right before them.
+    int32 keptMip = entry.residentMip >= 0 ? entry.residentMip : entry.image.mipLevels;
+    uint64 offset = TextureCooker::GetHeaderSize() + TextureCooker::GetMipOffset(entry.image, mip);
+    uint64 size = entry.tailBytes[mip] - entry.tailBytes[keptMip];
+    entry.pendingMip = mip;
+    pendingBytes += size;
+
+    const InnerData *data = entry.asset.GetData().get();
+    IO::FileHandle(entry.path).ReadRangeAsync(offset, size, [this, data, mip, keptMip, size](IO::AsyncReadResult &read) {
+        std::unique_lock<std::mutex> lock(completionsMutex);
+        completions.Add({ data, mip, keptMip, size, std::move(read.bytes), read.success });
+    });
+}
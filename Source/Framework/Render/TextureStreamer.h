@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Assets/AssetPtr.h"
+#include "Core/HashMap.h"
+#include "Render/Importers/TextureCooker.h"
+#include "Utils/Module.h"
+#include <mutex>
+
+/**
+ * Streams the mip levels of cooked textures. A texture first gets its tail, the levels no larger than tailSize, and gains finer
+ * levels as the screen asks for them. Levels nothing asked for lately are dropped again, and when the wanted levels of all textures
+ * do not fit the memory budget every texture is biased towards coarser levels by the same amount.
+ * A texture that gains levels reads only those with a single read, the levels it keeps are copied over from the resident texture
+ * on the GPU, and dropping levels copies without reading at all. Either way a new texture is swapped in behind the asset pointer,
+ * so a texture is never seen partly uploaded.
+ */
+class TextureStreamer : public Module
+{
+public:
+    struct Settings
+    {
+        uint64 memoryBudget = 512ull << 20; // Bytes of all streamed textures together, tails always stay resident.
+        uint64 readBudget = 64ull << 20;    // Bytes read from disk and not uploaded yet.
+        int32 tailSize = 64;                // Levels this small in both dimensions are loaded up front and never dropped.
+        int32 keepFrames = 60;              // Ticks the levels of a texture stay after the last request for them.
+    };
+
+    void Startup() override;
+    void Shutdown() override;
+    void Tick() override;
+
+    // Takes over an asset whose cooked file of the key is at path, the texture appears once the tail is read.
+    // False when the file is not a cooked 2D file of the key, the caller imports it the usual way then. Safe on any thread.
+    bool Add(const APtr<Texture> &texture, const String &path, uint64 key);
+    // Share of the screen height the full uv range of the texture spans, the largest request of a tick wins. Textures that are not
+    // streamed are ignored.
+    void RequestCoverage(const APtr<Texture> &texture, float coverage);
+
+    void SetSettings(const Settings &newSettings);
+
+    const Settings &GetSettings() const
+    {
+        return settings;
+    }
+
+    uint64 GetResidentBytes() const
+    {
+        return residentBytes;
+    }
+
+    uint64 GetPendingBytes() const
+    {
+        return pendingBytes;
+    }
+
+    int32 GetTextureCount() const
+    {
+        return entries.Count();
+    }
+
+    String GetName() const override
+    {
+        return CT_TEXT("TextureStreamer");
+    }
+
+private:
+    using InnerData = AssetPtr<Texture>::InnerData;
+
+    struct Entry
+    {
+        APtr<Texture> asset;
+        String path;
+        TextureCooker::Image image; // Header only, the data stays empty.
+        Array<uint64> tailBytes;    // Bytes of the levels from each one to the last.
+        int32 tailMip = 0;
+        int32 residentMip = -1; // Finest level on the GPU, -1 until the tail arrived.
+        int32 pendingMip = -1;  // Finest level of the read in flight, -1 when there is none.
+        int32 targetMip = 0;
+        float requestedCoverage = 0.0f;
+        int64 requestFrame = -1;
+        bool failed = false;
+    };
+
+    struct Completion
+    {
+        const InnerData *data;
+        int32 mip;
+        int32 keptMip; // First level copied from the resident texture, the level count when there is none.
+        uint64 size;
+        Array<uint8> bytes;
+        bool success;
+    };
+
+    int32 GetTailMip(const TextureCooker::Image &image) const;
+    bool IsStale(const Entry &entry) const;
+    int32 GetWantedMip(const Entry &entry) const;
+
+    void Upload(Array<Completion> &arrived);
+    void RemoveUnused();
+    void SelectTargets();
+    void IssueReads();
+    void Read(Entry &entry, int32 mip);
+    // Swaps in a texture of the levels from mip to the last. Levels before keptMip come from data, the rest from the resident texture.
+    void Replace(Entry &entry, int32 mip, int32 keptMip, const uint8 *data);
+
+    Settings settings;
+    // Add runs on import threads, completions arrive on io threads.
+    std::mutex entriesMutex;
+    std::mutex completionsMutex;
+    Array<Entry> entries;
+    HashMap<const InnerData *, int32> entryIndices;
+    Array<Completion> completions;
+    uint64 residentBytes = 0;
+    uint64 pendingBytes = 0;
+    int32 screenHeight = 0;
+    int64 frame = 0;
+};
+
+extern TextureStreamer *gTextureStreamer;
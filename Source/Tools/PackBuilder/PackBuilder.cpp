@@ -0,0 +1,48 @@
+#include "IO/PackFile.h"
+#include "Core/Logger.h"
+#include "Core/String/StringConvert.h"
+
+// Usage: PackBuilder <inputDirectory> <outputPack> [-lz4] [-align <bytes>]
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        CT_LOG(Error, CT_TEXT("Usage: PackBuilder <inputDirectory> <outputPack> [-lz4] [-align <bytes>]"));
+        return 1;
+    }
+
+    String inputDirectory = StringEncode::UTF8::FromChars(argv[1]);
+    String outputPath = StringEncode::UTF8::FromChars(argv[2]);
+    IO::CompressionMethod compression = IO::CompressionMethod::None;
+    IO::PackFileBuilder builder;
+
+    for (int32 i = 3; i < argc; ++i)
+    {
+        String arg = StringEncode::UTF8::FromChars(argv[i]);
+        if (arg == CT_TEXT("-lz4"))
+        {
+            compression = IO::CompressionMethod::LZ4;
+        }
+        else if (arg == CT_TEXT("-align") && i + 1 < argc)
+        {
+            builder.SetAlignment(static_cast<uint32>(StringConvert::ParseInt32(StringEncode::UTF8::FromChars(argv[++i]))));
+        }
+        else
+        {
+            CT_LOG(Warning, CT_TEXT("Unknown argument {0}, ignored."), arg);
+        }
+    }
+
+    int32 count = builder.AddDirectory(inputDirectory, compression);
+    if (count == 0)
+    {
+        CT_LOG(Error, CT_TEXT("No file found in {0}."), inputDirectory);
+        return 1;
+    }
+
+    if (!builder.Write(outputPath))
+        return 1;
+
+    CT_LOG(Info, CT_TEXT("Packed {0} files into {1}."), count, outputPath);
+    return 0;
+}